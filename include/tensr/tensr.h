@@ -36,8 +36,67 @@ typedef enum {
     TENSR_TPU
 } TensrDevice;
 
-/* Tensor structure */
+/* Activation functions */
+typedef enum {
+    TENSR_ACT_NONE,
+    TENSR_ACT_RELU,
+    TENSR_ACT_GELU,
+    TENSR_ACT_SILU,
+    TENSR_ACT_SIGMOID,
+    TENSR_ACT_TANH
+} TensrActivation;
+
+/* Embedding bag pooling modes */
+typedef enum {
+    TENSR_EMBED_SUM,
+    TENSR_EMBED_MEAN,
+    TENSR_EMBED_MAX
+} TensrEmbeddingMode;
+
+/* Memory-mapping modes for tensr_load_mmap */
+typedef enum {
+    TENSR_MAP_READONLY,
+    TENSR_MAP_COPY_ON_WRITE
+} TensrMapMode;
+
+/* Payload compression for tensr_save_ex */
+typedef enum {
+    TENSR_CODEC_NONE,
+    TENSR_CODEC_LZ
+} TensrCodec;
+
+/* Filters applied to each chunk before compression */
+typedef enum {
+    TENSR_FILTER_AUTO,
+    TENSR_FILTER_NONE,
+    TENSR_FILTER_SHUFFLE,
+    TENSR_FILTER_BITSHUFFLE,
+    TENSR_FILTER_DELTA
+} TensrFilter;
+
+/* Options for tensr_save_ex */
 typedef struct {
+    size_t alignment;  /* Payload alignment in bytes, a power of two >= 8 (0 = 64) */
+    bool checksum;     /* Store an XXH64 checksum of the payload */
+    TensrCodec codec;  /* TENSR_CODEC_LZ stores the payload as compressed chunks */
+    TensrFilter filter;  /* Chunk filter (TENSR_FILTER_AUTO picks per chunk) */
+    size_t chunk_size;   /* Uncompressed bytes per chunk (0 = 1 MB) */
+} TensrSaveOptions;
+
+/* Multi-tensor archive opened for lazy loading (opaque) */
+typedef struct TensrArchive TensrArchive;
+
+/* Tensor stored in a chunked file and streamed through a bounded cache (opaque) */
+typedef struct TensrDiskTensor TensrDiskTensor;
+
+/* Append-mode writer for a tensor growing along its first axis (opaque) */
+typedef struct TensrWriter TensrWriter;
+
+/* Pending asynchronous save or load (opaque) */
+typedef struct TensrFuture TensrFuture;
+
+/* Tensor structure */
+typedef struct Tensor {
     void* data;
     size_t* shape;
     size_t* strides;
@@ -47,8 +106,21 @@ typedef struct {
     TensrDevice device;
     int device_id;
     bool owns_data;
+    bool requires_grad;
+    struct Tensor* grad;
+    void* autograd;
 } Tensor;
 
+/* Random number generator handle (opaque) */
+typedef struct TensrGenerator TensrGenerator;
+
+/* Snapshot of a generator: Philox key, stream and counter position */
+typedef struct {
+    uint64_t seed;
+    uint64_t stream;
+    uint64_t counter;
+} TensrGeneratorState;
+
 /* Core tensor operations */
 Tensor* tensr_create(size_t* shape, size_t ndim, TensrDType dtype, TensrDevice device);
 Tensor* tensr_zeros(size_t* shape, size_t ndim, TensrDType dtype, TensrDevice device);
@@ -102,11 +174,113 @@ Tensor* tensr_arcsin(const Tensor* t);
 Tensor* tensr_arccos(const Tensor* t);
 Tensor* tensr_arctan(const Tensor* t);
 
+/* Activation operations */
+Tensor* tensr_relu(const Tensor* t);
+Tensor* tensr_gelu(const Tensor* t);
+Tensor* tensr_silu(const Tensor* t);
+Tensor* tensr_sigmoid(const Tensor* t);
+Tensor* tensr_tanh(const Tensor* t);
+Tensor* tensr_relu_(Tensor* t);
+Tensor* tensr_gelu_(Tensor* t);
+Tensor* tensr_silu_(Tensor* t);
+Tensor* tensr_sigmoid_(Tensor* t);
+Tensor* tensr_tanh_(Tensor* t);
+Tensor* tensr_relu_out(const Tensor* t, Tensor* out);
+Tensor* tensr_gelu_out(const Tensor* t, Tensor* out);
+Tensor* tensr_silu_out(const Tensor* t, Tensor* out);
+Tensor* tensr_sigmoid_out(const Tensor* t, Tensor* out);
+Tensor* tensr_tanh_out(const Tensor* t, Tensor* out);
+Tensor* tensr_bias_act(const Tensor* x, const Tensor* bias, TensrActivation act);
+
+/* Normalization operations */
+Tensor* tensr_layer_norm(const Tensor* x, const Tensor* gamma, const Tensor* beta, double eps, int axis);
+Tensor* tensr_rms_norm(const Tensor* x, const Tensor* gamma, double eps, int axis);
+Tensor* tensr_batch_norm(const Tensor* x, const Tensor* running_mean, const Tensor* running_var,
+                         const Tensor* gamma, const Tensor* beta, double eps);
+
+/* Attention operations */
+Tensor* tensr_attention(const Tensor* q, const Tensor* k, const Tensor* v, const Tensor* mask,
+                        double scale, bool causal);
+
+/* Embedding operations */
+Tensor* tensr_embedding(const Tensor* table, const Tensor* indices);
+Tensor* tensr_embedding_bag(const Tensor* table, const Tensor* indices, const Tensor* offsets,
+                            TensrEmbeddingMode mode);
+
+/* Dropout */
+Tensor* tensr_dropout(const Tensor* x, double p, TensrGenerator* gen, Tensor** out_mask);
+Tensor* tensr_dropout_backward(const Tensor* grad, const Tensor* mask, double p);
+
+/* Optimizer updates */
+int tensr_sgd_step(Tensor** params, Tensor** grads, Tensor** momentum_bufs, size_t n,
+                   double lr, double momentum, double weight_decay, bool nesterov);
+int tensr_adam_step(Tensor** params, Tensor** grads, Tensor** exp_avg, Tensor** exp_avg_sq,
+                    size_t n, double lr, double beta1, double beta2, double eps,
+                    double weight_decay, int64_t step);
+int tensr_adamw_step(Tensor** params, Tensor** grads, Tensor** exp_avg, Tensor** exp_avg_sq,
+                     size_t n, double lr, double beta1, double beta2, double eps,
+                     double weight_decay, int64_t step);
+
+/* Automatic differentiation */
+typedef Tensor* (*TensrCheckpointFn)(Tensor** inputs, size_t ninputs, void* ctx);
+void tensr_requires_grad(Tensor* t, bool requires_grad);
+int tensr_backward(Tensor* loss);
+void tensr_zero_grad(Tensor* t);
+void tensr_set_grad_enabled(bool enabled);
+bool tensr_is_grad_enabled(void);
+void tensr_tape_clear(void);
+Tensor* tensr_checkpoint(TensrCheckpointFn fn, Tensor** inputs, size_t ninputs, void* ctx);
+
 /* Random operations */
 Tensor* tensr_rand(size_t* shape, size_t ndim, TensrDevice device);
 Tensor* tensr_randn(size_t* shape, size_t ndim, TensrDevice device);
 Tensor* tensr_randint(int low, int high, size_t* shape, size_t ndim, TensrDevice device);
 void tensr_seed(unsigned int seed);
+TensrGenerator* tensr_generator_create(uint64_t seed);
+void tensr_generator_free(TensrGenerator* gen);
+void tensr_generator_seed(TensrGenerator* gen, uint64_t seed);
+TensrGenerator* tensr_generator_split(TensrGenerator* gen);
+void tensr_generator_jump(TensrGenerator* gen, uint64_t blocks);
+void tensr_generator_get_state(const TensrGenerator* gen, TensrGeneratorState* state);
+void tensr_generator_set_state(TensrGenerator* gen, const TensrGeneratorState* state);
+TensrGenerator* tensr_default_generator(void);
+Tensor* tensr_rand_gen(TensrGenerator* gen, size_t* shape, size_t ndim, TensrDevice device);
+Tensor* tensr_randn_gen(TensrGenerator* gen, size_t* shape, size_t ndim, TensrDevice device);
+Tensor* tensr_randint_gen(TensrGenerator* gen, int low, int high, size_t* shape, size_t ndim,
+                          TensrDevice device);
+Tensor* tensr_randint64(TensrGenerator* gen, int64_t low, int64_t high, size_t* shape,
+                        size_t ndim, TensrDevice device);
+Tensor* tensr_standard_normal(TensrGenerator* gen, size_t* shape, size_t ndim, TensrDType dtype,
+                              TensrDevice device);
+Tensor* tensr_uniform(TensrGenerator* gen, double low, double high, size_t* shape, size_t ndim,
+                      TensrDType dtype, TensrDevice device);
+Tensor* tensr_normal(TensrGenerator* gen, double mean, double std, size_t* shape, size_t ndim,
+                     TensrDType dtype, TensrDevice device);
+Tensor* tensr_bernoulli(TensrGenerator* gen, double p, size_t* shape, size_t ndim,
+                        TensrDType dtype, TensrDevice device);
+Tensor* tensr_exponential(TensrGenerator* gen, double rate, size_t* shape, size_t ndim,
+                          TensrDType dtype, TensrDevice device);
+Tensor* tensr_gamma(TensrGenerator* gen, double k, double theta, size_t* shape, size_t ndim,
+                    TensrDType dtype, TensrDevice device);
+Tensor* tensr_beta(TensrGenerator* gen, double a, double b, size_t* shape, size_t ndim,
+                   TensrDType dtype, TensrDevice device);
+Tensor* tensr_poisson(TensrGenerator* gen, double lambda, size_t* shape, size_t ndim,
+                      TensrDType dtype, TensrDevice device);
+Tensor* tensr_binomial(TensrGenerator* gen, int64_t n, double p, size_t* shape, size_t ndim,
+                       TensrDType dtype, TensrDevice device);
+Tensor* tensr_categorical(TensrGenerator* gen, const Tensor* probs, size_t num_samples,
+                          TensrDType dtype);
+Tensor* tensr_rand_(TensrGenerator* gen, Tensor* t);
+Tensor* tensr_randn_(TensrGenerator* gen, Tensor* t);
+Tensor* tensr_uniform_(TensrGenerator* gen, Tensor* t, double low, double high);
+Tensor* tensr_sobol(TensrGenerator* gen, size_t n, size_t dim, bool scramble, uint64_t skip,
+                    TensrDType dtype);
+Tensor* tensr_halton(TensrGenerator* gen, size_t n, size_t dim, bool scramble, uint64_t skip,
+                     TensrDType dtype);
+Tensor* tensr_permutation(TensrGenerator* gen, size_t n);
+int tensr_shuffle(TensrGenerator* gen, Tensor* t, int axis);
+Tensor* tensr_choice(TensrGenerator* gen, const Tensor* t, size_t k, bool replace,
+                     const Tensor* weights);
 
 /* Comparison operations */
 Tensor* tensr_equal(const Tensor* a, const Tensor* b);
@@ -141,13 +315,76 @@ Tensor* tensr_ifft2(const Tensor* t);
 
 /* I/O operations */
 int tensr_save(const char* filename, const Tensor* t);
+int tensr_save_ex(const char* filename, const Tensor* t, const TensrSaveOptions* opts);
 Tensor* tensr_load(const char* filename);
+Tensor* tensr_load_mmap(const char* filename, TensrMapMode mode);
+Tensor* tensr_load_slice(const char* filename, const size_t* start, const size_t* stop,
+                         const size_t* step, size_t ndim);
+int tensr_save_archive(const char* filename, const char** names, Tensor** tensors, size_t n,
+                       const TensrSaveOptions* opts);
+TensrArchive* tensr_archive_open(const char* filename);
+void tensr_archive_close(TensrArchive* a);
+size_t tensr_archive_count(const TensrArchive* a);
+const char* tensr_archive_name(const TensrArchive* a, size_t i);
+Tensor* tensr_archive_load(TensrArchive* a, const char* name);
+Tensor* tensr_archive_load_mmap(TensrArchive* a, const char* name, TensrMapMode mode);
+Tensor* tensr_load_npy(const char* filename);
+Tensor* tensr_load_npy_mmap(const char* filename, TensrMapMode mode);
+int tensr_save_npy(const char* filename, const Tensor* t);
+Tensor* tensr_load_npz(const char* filename, const char* name);
+Tensor* tensr_load_npz_mmap(const char* filename, const char* name, TensrMapMode mode);
+int tensr_save_npz(const char* filename, const char** names, Tensor** tensors, size_t n);
+
+/* Disk-backed tensors */
+typedef Tensor* (*TensrDiskMapFn)(Tensor** blocks, size_t nblocks, void* ctx);
+TensrDiskTensor* tensr_disk_create(const char* filename, const size_t* shape, size_t ndim,
+                                   TensrDType dtype, const TensrSaveOptions* opts,
+                                   size_t cache_bytes);
+TensrDiskTensor* tensr_disk_open(const char* filename, const TensrSaveOptions* opts,
+                                 size_t cache_bytes);
+int tensr_disk_flush(TensrDiskTensor* d);
+int tensr_disk_close(TensrDiskTensor* d);
+const size_t* tensr_disk_shape(const TensrDiskTensor* d, size_t* ndim);
+TensrDType tensr_disk_dtype(const TensrDiskTensor* d);
+Tensor* tensr_disk_read(TensrDiskTensor* d, size_t row, size_t nrows);
+int tensr_disk_write(TensrDiskTensor* d, size_t row, const Tensor* rows);
+int tensr_disk_map(TensrDiskTensor* out, TensrDiskTensor** inputs, size_t ninputs,
+                   TensrDiskMapFn fn, void* ctx);
+int tensr_disk_add(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b);
+int tensr_disk_sub(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b);
+int tensr_disk_mul(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b);
+int tensr_disk_div(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b);
+int tensr_disk_matmul(TensrDiskTensor* out, TensrDiskTensor* a, const Tensor* b);
+Tensor* tensr_disk_sum(TensrDiskTensor* d, int* axes, size_t naxes, bool keepdims);
+Tensor* tensr_disk_mean(TensrDiskTensor* d, int* axes, size_t naxes, bool keepdims);
+Tensor* tensr_disk_max(TensrDiskTensor* d, int* axes, size_t naxes, bool keepdims);
+Tensor* tensr_disk_min(TensrDiskTensor* d, int* axes, size_t naxes, bool keepdims);
+
+/* Streaming writer */
+TensrWriter* tensr_writer_open(const char* filename, TensrDType dtype, const size_t* inner_shape,
+                               size_t inner_ndim, const TensrSaveOptions* opts);
+int tensr_writer_append(TensrWriter* w, const Tensor* t);
+size_t tensr_writer_rows(const TensrWriter* w);
+int tensr_writer_flush(TensrWriter* w);
+int tensr_writer_close(TensrWriter* w);
+
+/* Asynchronous I/O */
+typedef void (*TensrFutureFn)(TensrFuture* f, void* ctx);
+TensrFuture* tensr_save_async(const char* filename, const Tensor* t, const TensrSaveOptions* opts,
+                              TensrFutureFn callback, void* ctx);
+TensrFuture* tensr_load_async(const char* filename, TensrFutureFn callback, void* ctx);
+bool tensr_future_done(TensrFuture* f);
+int tensr_future_wait(TensrFuture* f);
+Tensor* tensr_future_take(TensrFuture* f);
+void tensr_future_free(TensrFuture* f);
 void tensr_print(const Tensor* t);
 
 /* Device management */
 void tensr_to_device(Tensor* t, TensrDevice device, int device_id);
 void tensr_synchronize(TensrDevice device, int device_id);
 int tensr_device_count(TensrDevice device);
+void tensr_set_num_threads(int n);
+int tensr_get_num_threads(void);
 
 /* Utility functions */
 size_t tensr_dtype_size(TensrDType dtype);
@@ -77,6 +77,13 @@ public:
     Tensor log() const;
     Tensor abs() const;
 
+    /* Activation functions */
+    Tensor relu() const;
+    Tensor gelu() const;
+    Tensor silu() const;
+    Tensor sigmoid() const;
+    Tensor tanh() const;
+
     /* Reduction operations */
     Tensor sum(const std::vector<int>& axes = {}, bool keepdims = false) const;
     Tensor mean(const std::vector<int>& axes = {}, bool keepdims = false) const;
@@ -111,6 +118,11 @@ public:
     double get(const std::vector<size_t>& indices) const;
     void set(const std::vector<size_t>& indices, double value);
 
+    /* Automatic differentiation */
+    void requires_grad(bool value = true);
+    Tensor grad() const;
+    void backward();
+
     /* Device management */
     void to(Device device, int device_id = 0);
     Device device() const;
@@ -118,6 +130,7 @@ public:
     /* I/O */
     void save(const char* filename) const;
     static Tensor load(const char* filename);
+    static Tensor load_mmap(const char* filename, bool copy_on_write = false);
     void print() const;
 
     /* Properties */
@@ -0,0 +1,574 @@
+/**
+ * @file autograd.c
+ * @brief Reverse-mode automatic differentiation with a thread-local tape
+ * @author Muhammad Fiaz
+ *
+ * Differentiable operations append a node to the calling thread's tape when
+ * one of their inputs requires gradients. tensr_backward() walks the tape in
+ * reverse, accumulating gradients into Tensor.grad. Gradients of intermediate
+ * results are released as soon as their node has been processed and their
+ * buffers are pooled for reuse by later nodes and later backward passes.
+ *
+ * Tensors referenced by the tape stay alive until the tape is cleared: calling
+ * tensr_free() on them only marks them as released. Checkpointed segments
+ * (tensr_checkpoint) keep nothing from their forward pass except inputs and
+ * output, and are recomputed on a nested tape during the backward pass.
+ */
+
+#include "tensr/tensr.h"
+#include "autograd.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(_MSC_VER)
+#define TENSR_THREAD_LOCAL __declspec(thread)
+#else
+#define TENSR_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct Tape Tape;
+
+/**
+ * @brief Per-tensor bookkeeping stored in Tensor.autograd
+ */
+typedef struct {
+    Tape* owner;    /* Tape that tracks the tensor and will release it */
+    bool released;  /* tensr_free() was called while the tape referenced it */
+} AutogradMeta;
+
+/**
+ * @brief One recorded operation
+ */
+typedef struct {
+    AutogradOp op;
+    Tensor* out;
+    Tensor* inputs[2];
+    double param;
+    /* Checkpoint segments only */
+    TensrCheckpointFn fn;
+    void* ctx;
+    Tensor** ckpt_inputs;
+    size_t nckpt;
+} TapeNode;
+
+struct Tape {
+    TapeNode* nodes;
+    size_t nnodes, cap_nodes;
+    Tensor** tracked;
+    size_t ntracked, cap_tracked;
+    Tensor** pool;
+    size_t npool, cap_pool;
+};
+
+static TENSR_THREAD_LOCAL Tape* current_tape = NULL;
+static TENSR_THREAD_LOCAL bool grad_disabled = false;
+
+/**
+ * @brief Make room for one more element in a growable array
+ * @return true on success
+ */
+static bool reserve(void** items, size_t* cap, size_t count, size_t elem_size) {
+    if (count < *cap) return true;
+    size_t new_cap = *cap ? *cap * 2 : 16;
+    void* grown = realloc(*items, new_cap * elem_size);
+    if (!grown) return false;
+    *items = grown;
+    *cap = new_cap;
+    return true;
+}
+
+/**
+ * @brief Get (creating on first use) the calling thread's tape
+ */
+static Tape* get_tape(void) {
+    if (!current_tape) current_tape = (Tape*)calloc(1, sizeof(Tape));
+    return current_tape;
+}
+
+/**
+ * @brief Start tracking a tensor on a tape so it outlives tensr_free()
+ * @return true if the tensor is tracked (by this or another tape)
+ */
+static bool track(Tape* tape, Tensor* t) {
+    if (!t || t->autograd) return true;
+    if (!reserve((void**)&tape->tracked, &tape->cap_tracked, tape->ntracked, sizeof(Tensor*))) {
+        return false;
+    }
+    AutogradMeta* meta = (AutogradMeta*)malloc(sizeof(AutogradMeta));
+    if (!meta) return false;
+    meta->owner = tape;
+    meta->released = false;
+    t->autograd = meta;
+    tape->tracked[tape->ntracked++] = t;
+    return true;
+}
+
+/**
+ * @brief Append a node to a tape and track its tensors
+ * @return Pointer to the new node, or NULL on allocation failure
+ */
+static TapeNode* push_node(Tape* tape, AutogradOp op, Tensor* out, Tensor* a, Tensor* b) {
+    if (!reserve((void**)&tape->nodes, &tape->cap_nodes, tape->nnodes, sizeof(TapeNode))) return NULL;
+    if (!track(tape, out) || !track(tape, a) || !track(tape, b)) return NULL;
+
+    TapeNode* node = &tape->nodes[tape->nnodes++];
+    memset(node, 0, sizeof(TapeNode));
+    node->op = op;
+    node->out = out;
+    node->inputs[0] = a;
+    node->inputs[1] = b;
+    return node;
+}
+
+void autograd_record(AutogradOp op, Tensor* out, const Tensor* a, const Tensor* b, double param) {
+    if (!out || op == AG_NONE) return;
+    if (!(a && a->requires_grad) && !(b && b->requires_grad)) return;
+    if (grad_disabled) return;
+    if (out->dtype != TENSR_FLOAT32 && out->dtype != TENSR_FLOAT64) return;
+
+    Tape* tape = get_tape();
+    if (!tape) return;
+    TapeNode* node = push_node(tape, op, out, (Tensor*)a, (Tensor*)b);
+    if (!node) return;
+    node->param = param;
+    out->requires_grad = true;
+}
+
+bool autograd_defer_free(Tensor* t) {
+    AutogradMeta* meta = (AutogradMeta*)t->autograd;
+    if (!meta) return false;
+    meta->released = true;
+    return true;
+}
+
+/**
+ * @brief Get a zeroed gradient buffer shaped like t, reusing pooled buffers
+ */
+static Tensor* grad_buffer(Tape* tape, const Tensor* t) {
+    for (size_t i = 0; i < tape->npool; i++) {
+        Tensor* g = tape->pool[i];
+        if (g->dtype == t->dtype && g->size == t->size && g->ndim == t->ndim) {
+            tape->pool[i] = tape->pool[--tape->npool];
+            memcpy(g->shape, t->shape, t->ndim * sizeof(size_t));
+            memcpy(g->strides, t->strides, t->ndim * sizeof(size_t));
+            memset(g->data, 0, g->size * tensr_dtype_size(g->dtype));
+            return g;
+        }
+    }
+    return tensr_zeros(t->shape, t->ndim, t->dtype, t->device);
+}
+
+/**
+ * @brief Return the gradient of t, allocating a zeroed one if needed
+ */
+static Tensor* ensure_grad(Tape* tape, Tensor* t) {
+    if (!t->grad) t->grad = grad_buffer(tape, t);
+    return t->grad;
+}
+
+/**
+ * @brief Drop the gradient of an intermediate result into the buffer pool
+ */
+static void release_grad(Tape* tape, Tensor* t) {
+    if (!t->grad) return;
+    if (reserve((void**)&tape->pool, &tape->cap_pool, tape->npool, sizeof(Tensor*))) {
+        tape->pool[tape->npool++] = t->grad;
+    } else {
+        tensr_free(t->grad);
+    }
+    t->grad = NULL;
+}
+
+/**
+ * @brief Forget all recorded nodes and release tensors freed by the user
+ * @param tape Tape to reset
+ * @param keep_pool Whether to keep pooled gradient buffers for reuse
+ */
+static void tape_reset(Tape* tape, bool keep_pool) {
+    for (size_t i = 0; i < tape->nnodes; i++) free(tape->nodes[i].ckpt_inputs);
+    tape->nnodes = 0;
+
+    for (size_t i = 0; i < tape->ntracked; i++) {
+        Tensor* t = tape->tracked[i];
+        AutogradMeta* meta = (AutogradMeta*)t->autograd;
+        t->autograd = NULL;
+        if (meta && meta->released) tensr_free(t);
+        free(meta);
+    }
+    tape->ntracked = 0;
+
+    if (!keep_pool) {
+        for (size_t i = 0; i < tape->npool; i++) tensr_free(tape->pool[i]);
+        tape->npool = 0;
+    }
+}
+
+/**
+ * @brief Release all memory held by a tape (the struct itself is not freed)
+ */
+static void tape_destroy(Tape* tape) {
+    tape_reset(tape, false);
+    free(tape->nodes);
+    free(tape->tracked);
+    free(tape->pool);
+    memset(tape, 0, sizeof(Tape));
+}
+
+/**
+ * @brief Accumulate g into ga for every element (the shared grad loop)
+ */
+#define GRAD_LOOP(expr) for (size_t i = 0; i < n; i++) ga[i] += g[i] * (expr)
+
+/**
+ * @brief Macro to generate typed backward kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ * @param EXP, SQRT, ERF, SIN, COS, POW Math functions matching T
+ *
+ * Every kernel accumulates into the input gradients (+=) so a tensor used by
+ * several operations receives the sum of all contributions.
+ */
+#define GRAD_KERNELS(suffix, T, EXP, ERF, SIN, COS, POW) \
+static void unary_grad_##suffix(AutogradOp op, const T* g, const T* a, const T* out, T* ga, \
+                                size_t n, double param) { \
+    switch (op) { \
+        case AG_NEG: GRAD_LOOP((T)-1); break; \
+        case AG_POW: GRAD_LOOP((T)param * POW(a[i], (T)(param - 1.0))); break; \
+        case AG_SQRT: GRAD_LOOP((T)0.5 / out[i]); break; \
+        case AG_EXP: GRAD_LOOP(out[i]); break; \
+        case AG_LOG: GRAD_LOOP((T)1 / a[i]); break; \
+        case AG_ABS: GRAD_LOOP(a[i] > 0 ? (T)1 : (a[i] < 0 ? (T)-1 : (T)0)); break; \
+        case AG_SIN: GRAD_LOOP(COS(a[i])); break; \
+        case AG_COS: GRAD_LOOP(-SIN(a[i])); break; \
+        case AG_RELU: GRAD_LOOP(a[i] > 0 ? (T)1 : (T)0); break; \
+        case AG_SIGMOID: GRAD_LOOP(out[i] * ((T)1 - out[i])); break; \
+        case AG_TANH: GRAD_LOOP((T)1 - out[i] * out[i]); break; \
+        case AG_SILU: \
+            for (size_t i = 0; i < n; i++) { \
+                T s = (T)1 / ((T)1 + EXP(-a[i])); \
+                ga[i] += g[i] * s * ((T)1 + a[i] * ((T)1 - s)); \
+            } \
+            break; \
+        case AG_GELU: \
+            for (size_t i = 0; i < n; i++) { \
+                T cdf = (T)0.5 * ((T)1 + ERF(a[i] * (T)0.70710678118654752440)); \
+                T pdf = EXP((T)-0.5 * a[i] * a[i]) * (T)0.39894228040143267794; \
+                ga[i] += g[i] * (cdf + a[i] * pdf); \
+            } \
+            break; \
+        default: break; \
+    } \
+} \
+static void binary_grad_##suffix(AutogradOp op, const T* g, const T* a, const T* b, \
+                                 T* ga, T* gb, size_t n) { \
+    for (size_t i = 0; i < n; i++) { \
+        switch (op) { \
+            case AG_ADD: \
+                if (ga) ga[i] += g[i]; \
+                if (gb) gb[i] += g[i]; \
+                break; \
+            case AG_SUB: \
+                if (ga) ga[i] += g[i]; \
+                if (gb) gb[i] -= g[i]; \
+                break; \
+            case AG_MUL: \
+                if (ga) ga[i] += g[i] * b[i]; \
+                if (gb) gb[i] += g[i] * a[i]; \
+                break; \
+            case AG_DIV: \
+                if (ga) ga[i] += g[i] / b[i]; \
+                if (gb) gb[i] -= g[i] * a[i] / (b[i] * b[i]); \
+                break; \
+            default: break; \
+        } \
+    } \
+} \
+static void reduce_grad_##suffix(T g0, T* ga, size_t n) { \
+    for (size_t i = 0; i < n; i++) ga[i] += g0; \
+} \
+static void matmul_grad_##suffix(const T* g, const T* a, const T* b, T* ga, T* gb, \
+                                 size_t m, size_t k, size_t n) { \
+    if (ga) { \
+        for (size_t i = 0; i < m; i++) { \
+            for (size_t p = 0; p < k; p++) { \
+                T sum = 0; \
+                for (size_t j = 0; j < n; j++) sum += g[i * n + j] * b[p * n + j]; \
+                ga[i * k + p] += sum; \
+            } \
+        } \
+    } \
+    if (gb) { \
+        for (size_t i = 0; i < m; i++) { \
+            for (size_t p = 0; p < k; p++) { \
+                T aip = a[i * k + p]; \
+                for (size_t j = 0; j < n; j++) gb[p * n + j] += aip * g[i * n + j]; \
+            } \
+        } \
+    } \
+}
+
+GRAD_KERNELS(f32, float, expf, erff, sinf, cosf, powf)
+GRAD_KERNELS(f64, double, exp, erf, sin, cos, pow)
+
+static int run_backward(Tape* tape);
+
+/**
+ * @brief Backward pass of a checkpointed segment
+ *
+ * Re-runs the segment on a nested tape with recording enabled, seeds the
+ * recomputed output with the incoming gradient and back-propagates through
+ * the nested tape into the segment inputs. Recomputed intermediates are
+ * released together with the nested tape.
+ */
+static int checkpoint_backward(TapeNode* node) {
+    Tape nested;
+    memset(&nested, 0, sizeof(Tape));
+
+    Tape* saved_tape = current_tape;
+    bool saved_disabled = grad_disabled;
+    current_tape = &nested;
+    grad_disabled = false;
+    Tensor* out = node->fn(node->ckpt_inputs, node->nckpt, node->ctx);
+    current_tape = saved_tape;
+    grad_disabled = saved_disabled;
+
+    int rc = -1;
+    AutogradMeta* meta = out ? (AutogradMeta*)out->autograd : NULL;
+    if (meta && meta->owner == &nested && out->size == node->out->size) {
+        out->grad = tensr_copy(node->out->grad);
+        rc = out->grad ? run_backward(&nested) : -1;
+    }
+
+    /* Release the recomputed output unless the segment returned one of its
+       inputs or a tensor another tape tracks; tensors on the nested tape are
+       freed with it */
+    bool is_input = false;
+    for (size_t i = 0; i < node->nckpt; i++) is_input |= out == node->ckpt_inputs[i];
+    if (out && !is_input && (!meta || meta->owner == &nested)) tensr_free(out);
+    tape_destroy(&nested);
+    return rc;
+}
+
+/**
+ * @brief Propagate the gradient of one node's output to its inputs
+ */
+static int node_backward(Tape* tape, TapeNode* node) {
+    if (node->op == AG_CHECKPOINT) return checkpoint_backward(node);
+
+    Tensor* out = node->out;
+    Tensor* a = node->inputs[0];
+    Tensor* b = node->inputs[1];
+    Tensor* ga = a && a->requires_grad ? ensure_grad(tape, a) : NULL;
+    Tensor* gb = b && b->requires_grad ? ensure_grad(tape, b) : NULL;
+    if ((a && a->requires_grad && !ga) || (b && b->requires_grad && !gb)) return -1;
+
+    if (out->dtype == TENSR_FLOAT32) {
+        const float* g = (const float*)out->grad->data;
+        float* dga = ga ? (float*)ga->data : NULL;
+        float* dgb = gb ? (float*)gb->data : NULL;
+        if (node->op == AG_MATMUL) {
+            matmul_grad_f32(g, (const float*)a->data, (const float*)b->data, dga, dgb,
+                            a->shape[0], a->shape[1], b->shape[1]);
+        } else if (node->op == AG_SUM || node->op == AG_MEAN) {
+            float scale = node->op == AG_MEAN ? 1.0f / (float)a->size : 1.0f;
+            if (dga) reduce_grad_f32(g[0] * scale, dga, a->size);
+        } else if (b) {
+            binary_grad_f32(node->op, g, (const float*)a->data, (const float*)b->data,
+                            dga, dgb, out->size);
+        } else if (dga) {
+            unary_grad_f32(node->op, g, (const float*)a->data, (const float*)out->data,
+                           dga, out->size, node->param);
+        }
+    } else {
+        const double* g = (const double*)out->grad->data;
+        double* dga = ga ? (double*)ga->data : NULL;
+        double* dgb = gb ? (double*)gb->data : NULL;
+        if (node->op == AG_MATMUL) {
+            matmul_grad_f64(g, (const double*)a->data, (const double*)b->data, dga, dgb,
+                            a->shape[0], a->shape[1], b->shape[1]);
+        } else if (node->op == AG_SUM || node->op == AG_MEAN) {
+            double scale = node->op == AG_MEAN ? 1.0 / (double)a->size : 1.0;
+            if (dga) reduce_grad_f64(g[0] * scale, dga, a->size);
+        } else if (b) {
+            binary_grad_f64(node->op, g, (const double*)a->data, (const double*)b->data,
+                            dga, dgb, out->size);
+        } else if (dga) {
+            unary_grad_f64(node->op, g, (const double*)a->data, (const double*)out->data,
+                           dga, out->size, node->param);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Walk a tape in reverse, propagating gradients from node outputs
+ *
+ * Nodes whose output received no gradient are not on the path to the loss
+ * and are skipped. Once a node is processed, its output gradient is no longer
+ * needed and its buffer goes back to the pool.
+ */
+static int run_backward(Tape* tape) {
+    for (size_t i = tape->nnodes; i-- > 0;) {
+        TapeNode* node = &tape->nodes[i];
+        if (!node->out->grad) continue;
+        int rc = node_backward(tape, node);
+        release_grad(tape, node->out);
+        if (rc != 0) return rc;
+    }
+    return 0;
+}
+
+/**
+ * @brief Mark a tensor as requiring gradients
+ * @param t Tensor (float32 or float64)
+ * @param requires_grad Whether operations on t should be recorded
+ *
+ * Operations on tensors that require gradients are recorded on the calling
+ * thread's tape, and their results require gradients as well.
+ *
+ * Example:
+ *   Tensor* w = tensr_randn((size_t[]){784, 10}, 2, TENSR_CPU);
+ *   tensr_requires_grad(w, true);
+ */
+void tensr_requires_grad(Tensor* t, bool requires_grad) {
+    if (t->dtype != TENSR_FLOAT32 && t->dtype != TENSR_FLOAT64) return;
+    t->requires_grad = requires_grad;
+}
+
+/**
+ * @brief Compute gradients of a result with respect to all recorded inputs
+ * @param loss Result tensor produced by recorded operations
+ * @return 0 on success, -1 on failure
+ *
+ * Seeds d(loss)/d(loss) with ones, walks the tape in reverse and accumulates
+ * gradients into the grad field of every tensor that requires gradients and
+ * was not produced by a recorded op (leaf tensors). Intermediate gradients are
+ * freed along the way. The tape is cleared afterwards.
+ *
+ * Tensors used by recorded operations must not be modified in place before
+ * tensr_backward() is called.
+ *
+ * Example:
+ *   Tensor* loss = tensr_mean(tensr_mul(err, err), NULL, 0, false);
+ *   tensr_backward(loss);
+ *   tensr_print(w->grad);
+ */
+int tensr_backward(Tensor* loss) {
+    if (!loss || !loss->requires_grad) return -1;
+    Tape* tape = get_tape();
+    if (!tape) return -1;
+
+    if (loss->grad) tensr_free(loss->grad);
+    loss->grad = tensr_ones(loss->shape, loss->ndim, loss->dtype, loss->device);
+    if (!loss->grad) return -1;
+
+    int rc = run_backward(tape);
+    tape_reset(tape, true);
+    return rc;
+}
+
+/**
+ * @brief Free the accumulated gradient of a tensor
+ * @param t Tensor whose grad should be cleared
+ *
+ * Call between optimization steps since backward passes accumulate.
+ */
+void tensr_zero_grad(Tensor* t) {
+    if (t->grad) {
+        tensr_free(t->grad);
+        t->grad = NULL;
+    }
+}
+
+/**
+ * @brief Enable or disable recording on the calling thread
+ * @param enabled Whether differentiable operations are recorded
+ *
+ * Disable recording for inference or for parameter updates that must not be
+ * differentiated.
+ */
+void tensr_set_grad_enabled(bool enabled) {
+    grad_disabled = !enabled;
+}
+
+/**
+ * @brief Check whether recording is enabled on the calling thread
+ * @return true if operations are recorded
+ */
+bool tensr_is_grad_enabled(void) {
+    return !grad_disabled;
+}
+
+/**
+ * @brief Discard the calling thread's tape without computing gradients
+ *
+ * Releases recorded nodes, tensors freed while the tape referenced them and
+ * pooled gradient buffers.
+ */
+void tensr_tape_clear(void) {
+    if (current_tape) tape_destroy(current_tape);
+}
+
+/**
+ * @brief Run a segment without storing its intermediates
+ * @param fn Segment function computing one new output tensor from inputs
+ * @param inputs Segment inputs
+ * @param ninputs Number of inputs
+ * @param ctx User data passed to fn
+ * @return Output of fn, or NULL if fn failed
+ *
+ * Runs fn with recording disabled, so fn may free its intermediates right
+ * away, and records a single node for the whole segment. During
+ * tensr_backward() fn is run again with recording enabled and the gradient is
+ * propagated through the recomputed intermediates. Trades one extra forward
+ * computation of the segment for not keeping its activations alive.
+ *
+ * Example:
+ *   static Tensor* block(Tensor** in, size_t n, void* ctx) {
+ *       Tensor* h = tensr_matmul(in[0], in[1]);
+ *       Tensor* y = tensr_gelu(h);
+ *       tensr_free(h);
+ *       return y;
+ *   }
+ *   Tensor* y = tensr_checkpoint(block, (Tensor*[]){x, w}, 2, NULL);
+ */
+Tensor* tensr_checkpoint(TensrCheckpointFn fn, Tensor** inputs, size_t ninputs, void* ctx) {
+    bool saved_disabled = grad_disabled;
+    grad_disabled = true;
+    Tensor* out = fn(inputs, ninputs, ctx);
+    grad_disabled = saved_disabled;
+    if (!out || grad_disabled) return out;
+    if (out->dtype != TENSR_FLOAT32 && out->dtype != TENSR_FLOAT64) return out;
+
+    bool any = false;
+    for (size_t i = 0; i < ninputs; i++) {
+        if (inputs[i] == out) return out;
+        if (inputs[i]->requires_grad) any = true;
+    }
+    if (!any) return out;
+
+    Tape* tape = get_tape();
+    if (!tape) return out;
+    Tensor** saved = (Tensor**)malloc(ninputs * sizeof(Tensor*));
+    if (!saved) return out;
+    memcpy(saved, inputs, ninputs * sizeof(Tensor*));
+    for (size_t i = 0; i < ninputs; i++) {
+        if (!track(tape, saved[i])) {
+            free(saved);
+            return out;
+        }
+    }
+
+    TapeNode* node = push_node(tape, AG_CHECKPOINT, out, NULL, NULL);
+    if (!node) {
+        free(saved);
+        return out;
+    }
+    node->fn = fn;
+    node->ctx = ctx;
+    node->ckpt_inputs = saved;
+    node->nckpt = ninputs;
+    out->requires_grad = true;
+    return out;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file autograd.h
+ * @brief Internal hooks between tensor operations and the autograd tape
+ * @author Muhammad Fiaz
+ *
+ * Operations call autograd_record() after computing their result. The call
+ * returns immediately unless one of the inputs requires gradients, so ops pay
+ * nothing when autograd is not in use.
+ */
+
+#ifndef TENSR_AUTOGRAD_H
+#define TENSR_AUTOGRAD_H
+
+#include "tensr/tensr.h"
+
+/* Differentiable operations recorded on the tape */
+typedef enum {
+    AG_NONE,
+    AG_ADD,
+    AG_SUB,
+    AG_MUL,
+    AG_DIV,
+    AG_NEG,
+    AG_POW,
+    AG_SQRT,
+    AG_EXP,
+    AG_LOG,
+    AG_ABS,
+    AG_SIN,
+    AG_COS,
+    AG_SUM,
+    AG_MEAN,
+    AG_MATMUL,
+    AG_RELU,
+    AG_GELU,
+    AG_SILU,
+    AG_SIGMOID,
+    AG_TANH,
+    AG_CHECKPOINT
+} AutogradOp;
+
+/**
+ * @brief Record an operation on the calling thread's tape
+ * @param op Operation that produced out (AG_NONE for non-differentiable ops)
+ * @param out Result tensor
+ * @param a First input
+ * @param b Second input (NULL for unary ops)
+ * @param param Scalar parameter of the op (e.g. the exponent of pow)
+ */
+void autograd_record(AutogradOp op, Tensor* out, const Tensor* a, const Tensor* b, double param);
+
+/**
+ * @brief Defer freeing a tensor that is still referenced by a tape
+ * @param t Tensor passed to tensr_free()
+ * @return true if the tape took ownership and will free t when cleared
+ */
+bool autograd_defer_free(Tensor* t);
+
+#endif /* TENSR_AUTOGRAD_H */
@@ -8,6 +8,7 @@
  */
 
 #include "tensr/tensr.h"
+#include "../core/parallel.h"
 
 /**
  * @brief Transfer tensor to specified device
@@ -60,3 +61,33 @@ void tensr_synchronize(TensrDevice device, int device_id) {
 int tensr_device_count(TensrDevice device) {
     return 1;
 }
+
+/**
+ * @brief Set the number of CPU threads used by parallel kernels
+ * @param n Number of threads (values below 1 are ignored)
+ * 
+ * Has no effect when Tensr is built without OpenMP. Results of random
+ * generation do not depend on this setting.
+ * 
+ * Example:
+ *   tensr_set_num_threads(8);
+ */
+void tensr_set_num_threads(int n) {
+#ifdef _OPENMP
+    if (n > 0) omp_set_num_threads(n);
+#else
+    (void)n;
+#endif
+}
+
+/**
+ * @brief Get the number of CPU threads used by parallel kernels
+ * @return Thread count (1 when built without OpenMP)
+ */
+int tensr_get_num_threads(void) {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
@@ -0,0 +1,32 @@
+/**
+ * @file parallel.h
+ * @brief Internal helpers for CPU parallel loops
+ * @author Muhammad Fiaz
+ *
+ * Thin wrapper over OpenMP so kernels can mark independent outer loops as
+ * parallel without depending on OpenMP being enabled. When the library is
+ * built without OpenMP the macros expand to nothing and loops run serially.
+ */
+
+#ifndef TENSR_PARALLEL_H
+#define TENSR_PARALLEL_H
+
+#include <stddef.h>
+
+#if defined(_MSC_VER)
+#define TENSR_PRAGMA(x) __pragma(x)
+#else
+#define TENSR_PRAGMA(x) _Pragma(#x)
+#endif
+
+/* Minimum amount of work (in elements) before a loop is split across threads */
+#define TENSR_PARALLEL_GRAIN 32768
+
+#ifdef _OPENMP
+#include <omp.h>
+#define TENSR_PARALLEL_FOR(cond) TENSR_PRAGMA(omp parallel for schedule(static) if(cond))
+#else
+#define TENSR_PARALLEL_FOR(cond)
+#endif
+
+#endif /* TENSR_PARALLEL_H */
@@ -8,6 +8,8 @@
  */
 
 #include "tensr/tensr.h"
+#include "../autograd/autograd.h"
+#include "../io/file.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -128,6 +130,9 @@ Tensor* tensr_create(size_t* shape, size_t ndim, TensrDType dtype, TensrDevice d
     t->device = device;
     t->device_id = 0;
     t->owns_data = true;
+    t->requires_grad = false;
+    t->grad = NULL;
+    t->autograd = NULL;
 
     t->shape = (size_t*)malloc(ndim * sizeof(size_t));
     t->strides = (size_t*)malloc(ndim * sizeof(size_t));
@@ -367,12 +372,16 @@ Tensor* tensr_copy(const Tensor* src) {
  * @param t Tensor to free
  * 
  * Releases all memory associated with the tensor including data, shape,
- * and strides arrays. Always call this when done with a tensor to prevent
- * memory leaks.
+ * strides and gradient. Always call this when done with a tensor to prevent
+ * memory leaks. Tensors still referenced by an autograd tape are released
+ * when the tape is cleared.
  */
 void tensr_free(Tensor* t) {
     if (t) {
+        if (t->autograd && autograd_defer_free(t)) return;
+        if (t->grad) tensr_free(t->grad);
         if (t->owns_data && t->data) free(t->data);
+        else if (!t->owns_data) io_release_mapped(t);
         if (t->shape) free(t->shape);
         if (t->strides) free(t->strides);
         free(t);
@@ -407,6 +416,9 @@ Tensor* tensr_reshape(const Tensor* t, size_t* new_shape, size_t new_ndim) {
     result->size = t->size;
     result->owns_data = false;
     result->data = t->data;
+    result->requires_grad = false;
+    result->grad = NULL;
+    result->autograd = NULL;
 
     result->shape = (size_t*)malloc(new_ndim * sizeof(size_t));
     result->strides = (size_t*)malloc(new_ndim * sizeof(size_t));
@@ -448,16 +460,3 @@ Tensor* tensr_transpose(const Tensor* t, size_t* axes, size_t naxes) {
 
     return result;
 }
-
-void tensr_to_device(Tensor* t, TensrDevice device, int device_id) {
-    t->device = device;
-    t->device_id = device_id;
-}
-
-void tensr_synchronize(TensrDevice device, int device_id) {
-    /* Implementation depends on device backend */
-}
-
-int tensr_device_count(TensrDevice device) {
-    return 1; /* Default implementation */
-}
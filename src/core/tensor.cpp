@@ -181,6 +181,26 @@ Tensor Tensor::abs() const {
     return Tensor(tensr_abs(tensor_));
 }
 
+Tensor Tensor::relu() const {
+    return Tensor(tensr_relu(tensor_));
+}
+
+Tensor Tensor::gelu() const {
+    return Tensor(tensr_gelu(tensor_));
+}
+
+Tensor Tensor::silu() const {
+    return Tensor(tensr_silu(tensor_));
+}
+
+Tensor Tensor::sigmoid() const {
+    return Tensor(tensr_sigmoid(tensor_));
+}
+
+Tensor Tensor::tanh() const {
+    return Tensor(tensr_tanh(tensor_));
+}
+
 Tensor Tensor::sum(const std::vector<int>& axes, bool keepdims) const {
     auto t = tensr_sum(tensor_, const_cast<int*>(axes.data()), axes.size(), keepdims);
     return Tensor(t);
@@ -225,6 +245,27 @@ void Tensor::set(const std::vector<size_t>& indices, double value) {
     tensr_set(tensor_, const_cast<size_t*>(indices.data()), indices.size(), value);
 }
 
+void Tensor::requires_grad(bool value) {
+    tensr_requires_grad(tensor_, value);
+}
+
+/**
+ * @brief Copy of the accumulated gradient
+ * @throws std::runtime_error if no gradient has been computed
+ */
+Tensor Tensor::grad() const {
+    if (!tensor_->grad) throw std::runtime_error("Tensor has no gradient");
+    return Tensor(tensr_copy(tensor_->grad));
+}
+
+/**
+ * @brief Back-propagate from this tensor
+ * @throws std::runtime_error if the tensor was not produced by recorded operations
+ */
+void Tensor::backward() {
+    if (tensr_backward(tensor_) != 0) throw std::runtime_error("Backward pass failed");
+}
+
 void Tensor::to(Device device, int device_id) {
     tensr_to_device(tensor_, static_cast<TensrDevice>(device), device_id);
 }
@@ -241,6 +282,11 @@ Tensor Tensor::load(const char* filename) {
     return Tensor(tensr_load(filename));
 }
 
+Tensor Tensor::load_mmap(const char* filename, bool copy_on_write) {
+    return Tensor(tensr_load_mmap(filename, copy_on_write ? TENSR_MAP_COPY_ON_WRITE
+                                                          : TENSR_MAP_READONLY));
+}
+
 void Tensor::print() const {
     tensr_print(tensor_);
 }
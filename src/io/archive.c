@@ -0,0 +1,434 @@
+/**
+ * @file archive.c
+ * @brief Multi-tensor archives with an index and lazy per-tensor loading
+ * @author Muhammad Fiaz
+ *
+ * An archive stores many named tensors in one file. A binary index at the
+ * front maps each name to its dtype, shape and payload location. Payloads
+ * are aligned like those of single-tensor files. Writing is a single
+ * streaming pass. Opening an archive reads only the index, and each tensor
+ * is then read with one positional read or memory-mapped on request, so
+ * loading a subset touches only that subset.
+ *
+ * Layout (all integers little-endian):
+ *
+ *   offset  size  field
+ *        0     8  magic "TENSRAR\x1a"
+ *        8     2  format version
+ *       10     2  flags (FMT_FLAG_CHECKSUM: every entry has a checksum)
+ *       12     4  payload alignment in bytes
+ *       16     8  number of tensors
+ *       24     8  index size in bytes (the index starts at offset 32)
+ *
+ * Each index entry (8-byte aligned):
+ *
+ *        0     2  name length
+ *        2     1  dtype code
+ *        3     1  reserved, 0
+ *        4     2  ndim
+ *        6     2  reserved, 0
+ *        8     8  payload offset
+ *       16     8  payload size in bytes
+ *       24     8  XXH64 of the payload, or 0
+ *       32  8*nd  shape
+ *          name   UTF-8 name, zero padded to a multiple of 8
+ */
+
+#include "tensr/tensr.h"
+#include "file.h"
+#include "format.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARCHIVE_MAGIC "TENSRAR\x1a"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_FIXED_SIZE 32
+#define ARCHIVE_ENTRY_FIXED 32
+#define ARCHIVE_MAX_NAME 65535
+
+typedef struct {
+    char* name;
+    TensrDType dtype;
+    size_t ndim;
+    size_t shape[FMT_MAX_NDIM];
+    uint64_t offset;
+    uint64_t nbytes;
+    uint64_t checksum;
+} ArchiveEntry;
+
+struct TensrArchive {
+    IoFile file;
+    char* path;
+    bool checksums;
+    size_t count;
+    ArchiveEntry* entries;
+    size_t* by_name;  /* Entry indices sorted by name */
+    IoMutex lock;
+    IoMapping* mapping;  /* Lazily created read-only mapping shared by mapped tensors */
+};
+
+static size_t pad8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static uint64_t align_up(uint64_t n, uint64_t alignment) {
+    return (n + alignment - 1) / alignment * alignment;
+}
+
+static size_t entry_size(size_t ndim, size_t name_len) {
+    return ARCHIVE_ENTRY_FIXED + 8 * ndim + pad8(name_len);
+}
+
+typedef struct {
+    const char* name;
+    size_t index;
+} NameRef;
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(((const NameRef*)a)->name, ((const NameRef*)b)->name);
+}
+
+/**
+ * @brief Sort indices 0..n-1 by name
+ * @param order Output, n indices in name order
+ * @return false if two names are equal or memory runs out
+ */
+static bool sort_unique(const char** names, size_t n, size_t* order) {
+    NameRef* refs = (NameRef*)malloc((n ? n : 1) * sizeof(NameRef));
+    if (!refs) return false;
+    for (size_t i = 0; i < n; i++) {
+        refs[i].name = names[i];
+        refs[i].index = i;
+    }
+    qsort(refs, n, sizeof(NameRef), compare_names);
+    bool unique = true;
+    for (size_t i = 0; i < n; i++) {
+        order[i] = refs[i].index;
+        if (i > 0 && strcmp(refs[i - 1].name, refs[i].name) == 0) unique = false;
+    }
+    free(refs);
+    return unique;
+}
+
+/**
+ * @brief Write zero bytes up to an absolute offset
+ */
+static bool write_padding(FILE* f, uint64_t from, uint64_t to) {
+    static const unsigned char zeros[4096];
+    while (from < to) {
+        size_t len = to - from < sizeof(zeros) ? (size_t)(to - from) : sizeof(zeros);
+        if (fwrite(zeros, 1, len, f) != len) return false;
+        from += len;
+    }
+    return true;
+}
+
+/**
+ * @brief Save named tensors into one archive file
+ * @param filename Path to output file
+ * @param names Unique, non-empty tensor names
+ * @param tensors Tensors to store
+ * @param n Number of tensors
+ * @param opts Alignment and checksum options, or NULL for the defaults
+ * @return 0 on success, -1 on failure (including when opts asks for compression,
+ *         which archives do not support; entries are always mappable)
+ *
+ * All tensors are written in one streaming pass behind a single index, so
+ * a checkpoint of hundreds of tensors costs one file open instead of one
+ * per tensor.
+ *
+ * Example:
+ *   const char* names[] = {"encoder.weight", "encoder.bias"};
+ *   Tensor* params[] = {w, b};
+ *   tensr_save_archive("model.tsra", names, params, 2, NULL);
+ */
+int tensr_save_archive(const char* filename, const char** names, Tensor** tensors, size_t n,
+                       const TensrSaveOptions* opts) {
+    size_t alignment = opts && opts->alignment ? opts->alignment : FMT_DEFAULT_ALIGNMENT;
+    if (alignment & (alignment - 1) || alignment < 8 || alignment > FMT_MAX_ALIGNMENT) return -1;
+    bool checksum = opts && opts->checksum;
+    if (opts && opts->codec != TENSR_CODEC_NONE) return -1;
+
+    size_t index_bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t len = names[i] ? strlen(names[i]) : 0;
+        if (len == 0 || len > ARCHIVE_MAX_NAME) return -1;
+        if (tensors[i]->ndim > FMT_MAX_NDIM || fmt_dtype_code(tensors[i]->dtype) == 0) return -1;
+        index_bytes += entry_size(tensors[i]->ndim, len);
+    }
+    size_t* order = (size_t*)malloc((n ? n : 1) * sizeof(size_t));
+    unsigned char* header = (unsigned char*)calloc(1, ARCHIVE_FIXED_SIZE + index_bytes);
+    uint64_t* offsets = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));
+    if (!order || !header || !offsets || !sort_unique(names, n, order)) {
+        free(order);
+        free(header);
+        free(offsets);
+        return -1;
+    }
+    free(order);
+
+    /* Lay out the payloads, then encode the index */
+    memcpy(header, ARCHIVE_MAGIC, 8);
+    fmt_put_u16(header + 8, ARCHIVE_VERSION);
+    fmt_put_u16(header + 10, checksum ? FMT_FLAG_CHECKSUM : 0);
+    fmt_put_u32(header + 12, (uint32_t)alignment);
+    fmt_put_u64(header + 16, n);
+    fmt_put_u64(header + 24, index_bytes);
+    uint64_t pos = align_up(ARCHIVE_FIXED_SIZE + index_bytes, alignment);
+    unsigned char* e = header + ARCHIVE_FIXED_SIZE;
+    for (size_t i = 0; i < n; i++) {
+        const Tensor* t = tensors[i];
+        size_t len = strlen(names[i]);
+        uint64_t nbytes = (uint64_t)t->size * tensr_dtype_size(t->dtype);
+        offsets[i] = pos;
+        fmt_put_u16(e, (uint16_t)len);
+        e[2] = (unsigned char)fmt_dtype_code(t->dtype);
+        fmt_put_u16(e + 4, (uint16_t)t->ndim);
+        fmt_put_u64(e + 8, pos);
+        fmt_put_u64(e + 16, nbytes);
+        for (size_t d = 0; d < t->ndim; d++) {
+            fmt_put_u64(e + ARCHIVE_ENTRY_FIXED + 8 * d, t->shape[d]);
+        }
+        memcpy(e + ARCHIVE_ENTRY_FIXED + 8 * t->ndim, names[i], len);
+        e += entry_size(t->ndim, len);
+        pos = align_up(pos + nbytes, alignment);
+    }
+
+    FILE* f = fopen(filename, "wb");
+    if (!f) {
+        free(header);
+        free(offsets);
+        return -1;
+    }
+    uint64_t written = ARCHIVE_FIXED_SIZE + index_bytes;
+    bool ok = fwrite(header, 1, (size_t)written, f) == written;
+    e = header + ARCHIVE_FIXED_SIZE;
+    for (size_t i = 0; ok && i < n; i++) {
+        const Tensor* t = tensors[i];
+        size_t esize = tensr_dtype_size(t->dtype);
+        FmtHash hash;
+        fmt_hash_init(&hash);
+        ok = write_padding(f, written, offsets[i]) &&
+             fmt_write_payload(f, t->data, t->size, esize, checksum ? &hash : NULL);
+        written = offsets[i] + (uint64_t)t->size * esize;
+        if (checksum) fmt_put_u64(e + 24, fmt_hash_digest(&hash));
+        e += entry_size(t->ndim, strlen(names[i]));
+    }
+    if (ok && checksum) {
+        /* Checksums are known only after the payload pass; rewrite the index */
+        ok = io_fseek(f, ARCHIVE_FIXED_SIZE) &&
+             fwrite(header + ARCHIVE_FIXED_SIZE, 1, index_bytes, f) == index_bytes;
+    }
+    free(header);
+    free(offsets);
+    if (fclose(f) != 0) ok = false;
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Decode the index of an archive
+ * @return false if any entry is malformed or points past the end of the file
+ */
+static bool parse_index(TensrArchive* a, const unsigned char* p, size_t len, uint64_t file_size) {
+    size_t at = 0;
+    for (size_t i = 0; i < a->count; i++) {
+        ArchiveEntry* ent = &a->entries[i];
+        if (len - at < ARCHIVE_ENTRY_FIXED) return false;
+        const unsigned char* e = p + at;
+        size_t name_len = fmt_get_u16(e);
+        ent->ndim = fmt_get_u16(e + 4);
+        if (!fmt_dtype_from_code(e[2], &ent->dtype) || ent->ndim > FMT_MAX_NDIM) return false;
+        if (name_len == 0 || len - at < entry_size(ent->ndim, name_len)) return false;
+        ent->offset = fmt_get_u64(e + 8);
+        ent->nbytes = fmt_get_u64(e + 16);
+        ent->checksum = fmt_get_u64(e + 24);
+
+        uint64_t count = 1;
+        for (size_t d = 0; d < ent->ndim; d++) {
+            uint64_t dim = fmt_get_u64(e + ARCHIVE_ENTRY_FIXED + 8 * d);
+            if (dim > SIZE_MAX || (dim != 0 && count > UINT64_MAX / dim)) return false;
+            ent->shape[d] = (size_t)dim;
+            count *= dim;
+        }
+        size_t esize = tensr_dtype_size(ent->dtype);
+        if (count > UINT64_MAX / esize || ent->nbytes != count * esize) return false;
+        if (ent->offset > file_size || ent->nbytes > file_size - ent->offset) return false;
+        if (ent->offset % esize) return false;
+
+        ent->name = (char*)malloc(name_len + 1);
+        if (!ent->name) return false;
+        memcpy(ent->name, e + ARCHIVE_ENTRY_FIXED + 8 * ent->ndim, name_len);
+        ent->name[name_len] = '\0';
+        at += entry_size(ent->ndim, name_len);
+    }
+    return true;
+}
+
+/**
+ * @brief Open an archive and read its index
+ * @param filename Archive written by tensr_save_archive()
+ * @return Archive handle, or NULL if the file is missing or malformed
+ *
+ * Only the index is read. Tensors are loaded individually with
+ * tensr_archive_load() or tensr_archive_load_mmap().
+ *
+ * Example:
+ *   TensrArchive* ar = tensr_archive_open("model.tsra");
+ *   Tensor* w = tensr_archive_load(ar, "encoder.weight");
+ *   tensr_archive_close(ar);
+ */
+TensrArchive* tensr_archive_open(const char* filename) {
+    TensrArchive* a = (TensrArchive*)calloc(1, sizeof(TensrArchive));
+    if (!a) return NULL;
+    if (!io_file_open(&a->file, filename)) {
+        free(a);
+        return NULL;
+    }
+    io_mutex_init(&a->lock);
+
+    unsigned char fixed[ARCHIVE_FIXED_SIZE];
+    uint64_t file_size = 0;
+    bool ok = io_file_size(&a->file, &file_size) && file_size >= ARCHIVE_FIXED_SIZE &&
+              io_pread(&a->file, fixed, ARCHIVE_FIXED_SIZE, 0) &&
+              memcmp(fixed, ARCHIVE_MAGIC, 8) == 0 && fmt_get_u16(fixed + 8) == ARCHIVE_VERSION;
+    uint64_t count = ok ? fmt_get_u64(fixed + 16) : 0;
+    uint64_t index_bytes = ok ? fmt_get_u64(fixed + 24) : 0;
+    ok = ok && index_bytes <= file_size - ARCHIVE_FIXED_SIZE &&
+         count <= index_bytes / ARCHIVE_ENTRY_FIXED;
+
+    unsigned char* index = NULL;
+    if (ok) {
+        a->checksums = (fmt_get_u16(fixed + 10) & FMT_FLAG_CHECKSUM) != 0;
+        a->count = (size_t)count;
+        a->entries = (ArchiveEntry*)calloc(a->count ? a->count : 1, sizeof(ArchiveEntry));
+        a->by_name = (size_t*)malloc((a->count ? a->count : 1) * sizeof(size_t));
+        a->path = (char*)malloc(strlen(filename) + 1);
+        index = (unsigned char*)malloc(index_bytes ? (size_t)index_bytes : 1);
+        ok = a->entries && a->by_name && a->path && index &&
+             io_pread(&a->file, index, (size_t)index_bytes, ARCHIVE_FIXED_SIZE) &&
+             parse_index(a, index, (size_t)index_bytes, file_size);
+    }
+    free(index);
+    if (ok) {
+        strcpy(a->path, filename);
+        const char** names = (const char**)malloc((a->count ? a->count : 1) * sizeof(char*));
+        ok = names != NULL;
+        if (ok) {
+            for (size_t i = 0; i < a->count; i++) names[i] = a->entries[i].name;
+            ok = sort_unique(names, a->count, a->by_name);
+        }
+        free(names);
+    }
+    if (!ok) {
+        tensr_archive_close(a);
+        return NULL;
+    }
+    return a;
+}
+
+/**
+ * @brief Close an archive
+ *
+ * Tensors loaded from the archive, including memory-mapped ones, stay valid.
+ */
+void tensr_archive_close(TensrArchive* a) {
+    if (!a) return;
+    io_file_close(&a->file);
+    io_mutex_destroy(&a->lock);
+    if (a->mapping) io_mapping_unref(a->mapping);
+    if (a->entries) {
+        for (size_t i = 0; i < a->count; i++) free(a->entries[i].name);
+    }
+    free(a->entries);
+    free(a->by_name);
+    free(a->path);
+    free(a);
+}
+
+/**
+ * @brief Number of tensors in an archive
+ */
+size_t tensr_archive_count(const TensrArchive* a) {
+    return a->count;
+}
+
+/**
+ * @brief Name of the i-th tensor, in the order they were saved
+ * @return Name, or NULL if i is out of range
+ */
+const char* tensr_archive_name(const TensrArchive* a, size_t i) {
+    return i < a->count ? a->entries[i].name : NULL;
+}
+
+/**
+ * @brief Find an entry by name (binary search over the sorted index)
+ */
+static const ArchiveEntry* find_entry(const TensrArchive* a, const char* name) {
+    size_t lo = 0, hi = a->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = strcmp(a->entries[a->by_name[mid]].name, name);
+        if (c == 0) return &a->entries[a->by_name[mid]];
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Read one tensor from an archive
+ * @param a Open archive
+ * @param name Tensor name
+ * @return New tensor, or NULL if the name is unknown, the read fails or the
+ *         checksum does not match
+ *
+ * Only this tensor's bytes are read. Safe to call from several threads at once.
+ */
+Tensor* tensr_archive_load(TensrArchive* a, const char* name) {
+    const ArchiveEntry* e = find_entry(a, name);
+    if (!e) return NULL;
+    Tensor* t = tensr_create((size_t*)e->shape, e->ndim, e->dtype, TENSR_CPU);
+    if (!t) return NULL;
+    if (!io_pread(&a->file, t->data, (size_t)e->nbytes, e->offset) ||
+        (a->checksums && fmt_checksum(t->data, (size_t)e->nbytes) != e->checksum)) {
+        tensr_free(t);
+        return NULL;
+    }
+    if (!fmt_host_little_endian()) fmt_swap_elements(t->data, t->size, tensr_dtype_size(e->dtype));
+    return t;
+}
+
+/**
+ * @brief Memory-map one tensor of an archive
+ * @param a Open archive
+ * @param name Tensor name
+ * @param mode TENSR_MAP_READONLY or TENSR_MAP_COPY_ON_WRITE
+ * @return Tensor pointing into the mapping, or NULL if the name is unknown
+ *
+ * Read-only tensors share one mapping of the file. Each copy-on-write
+ * tensor gets a private mapping of its own, so writes through one never show
+ * up in another. Pages are read only when touched, and the checksum is not
+ * verified. A mapping stays alive until the archive is closed and every
+ * tensor mapped from it has been freed.
+ */
+Tensor* tensr_archive_load_mmap(TensrArchive* a, const char* name, TensrMapMode mode) {
+    const ArchiveEntry* e = find_entry(a, name);
+    if (!e) return NULL;
+    if (!fmt_host_little_endian()) return tensr_archive_load(a, name);
+
+    IoMapping* m;
+    if (mode == TENSR_MAP_COPY_ON_WRITE) {
+        m = io_map_file(a->path, mode);
+    } else {
+        io_mutex_lock(&a->lock);
+        if (!a->mapping) a->mapping = io_map_file(a->path, mode);
+        m = a->mapping;
+        io_mutex_unlock(&a->lock);
+    }
+    Tensor* t = NULL;
+    if (m && e->offset + e->nbytes <= io_mapping_size(m)) {
+        t = io_tensor_from_mapping(m, (size_t)e->offset, e->shape, e->ndim, e->dtype);
+    }
+    if (m && mode == TENSR_MAP_COPY_ON_WRITE) io_mapping_unref(m);
+    return t;
+}
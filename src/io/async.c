@@ -0,0 +1,262 @@
+/**
+ * @file async.c
+ * @brief Asynchronous save and load on background I/O threads
+ * @author Muhammad Fiaz
+ *
+ * Requests are queued to a small pool of I/O threads that is started on
+ * first use and drained and joined at exit, so saves still pending when the
+ * program ends are completed. Each request is tracked by a future that the
+ * caller polls, waits on or gets a callback from.
+ */
+
+#include "tensr/tensr.h"
+#include "file.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Disk bandwidth rarely grows past two concurrent streams */
+#define ASYNC_THREADS 2
+
+struct TensrFuture {
+    TensrFuture* next;      /* Queue link */
+    char* filename;
+    bool load;
+    bool has_opts;
+    TensrSaveOptions opts;
+    Tensor* tensor;         /* Snapshot being saved, or the loaded tensor */
+    TensrFutureFn callback;
+    void* ctx;
+    IoMutex lock;
+    IoCond cond;
+    bool done;              /* Result is available */
+    bool finished;          /* The I/O thread no longer touches the future */
+    int status;
+};
+
+static IoMutex pool_lock = IO_MUTEX_INIT;
+static IoCond pool_wake;
+static TensrFuture* queue_head;
+static TensrFuture* queue_tail;
+static IoThread pool_threads[ASYNC_THREADS];
+static size_t pool_nthreads;
+static bool pool_started;
+static bool pool_stop;
+
+static void run_request(TensrFuture* f) {
+    Tensor* result = NULL;
+    int status;
+    if (f->load) {
+        result = tensr_load(f->filename);
+        status = result ? 0 : -1;
+    } else {
+        status = f->has_opts ? tensr_save_ex(f->filename, f->tensor, &f->opts)
+                             : tensr_save(f->filename, f->tensor);
+        tensr_free(f->tensor);
+    }
+
+    io_mutex_lock(&f->lock);
+    f->tensor = result;
+    f->status = status;
+    f->done = true;
+    io_cond_broadcast(&f->cond);
+    io_mutex_unlock(&f->lock);
+
+    if (f->callback) f->callback(f, f->ctx);
+
+    io_mutex_lock(&f->lock);
+    f->finished = true;
+    io_cond_broadcast(&f->cond);
+    io_mutex_unlock(&f->lock);
+}
+
+static void pool_main(void* arg) {
+    (void)arg;
+    io_mutex_lock(&pool_lock);
+    for (;;) {
+        while (!queue_head && !pool_stop) io_cond_wait(&pool_wake, &pool_lock);
+        TensrFuture* f = queue_head;
+        if (!f) break;
+        queue_head = f->next;
+        if (!queue_head) queue_tail = NULL;
+        io_mutex_unlock(&pool_lock);
+        run_request(f);
+        io_mutex_lock(&pool_lock);
+    }
+    io_mutex_unlock(&pool_lock);
+}
+
+/**
+ * @brief Finish queued requests and join the pool at exit
+ */
+static void pool_shutdown(void) {
+    io_mutex_lock(&pool_lock);
+    pool_stop = true;
+    io_cond_broadcast(&pool_wake);
+    io_mutex_unlock(&pool_lock);
+    for (size_t i = 0; i < pool_nthreads; i++) io_thread_join(&pool_threads[i]);
+}
+
+/**
+ * @brief Queue a request, starting the pool on first use
+ * @return false if no I/O thread could be started
+ */
+static bool submit(TensrFuture* f) {
+    io_mutex_lock(&pool_lock);
+    if (!pool_started) {
+        pool_started = true;
+        io_cond_init(&pool_wake);
+        while (pool_nthreads < ASYNC_THREADS &&
+               io_thread_start(&pool_threads[pool_nthreads], pool_main, NULL)) {
+            pool_nthreads++;
+        }
+        atexit(pool_shutdown);
+    }
+    bool ok = pool_nthreads > 0;
+    if (ok) {
+        if (queue_tail) queue_tail->next = f;
+        else queue_head = f;
+        queue_tail = f;
+        io_cond_broadcast(&pool_wake);
+    }
+    io_mutex_unlock(&pool_lock);
+    return ok;
+}
+
+static TensrFuture* future_new(const char* filename, TensrFutureFn callback, void* ctx) {
+    TensrFuture* f = (TensrFuture*)calloc(1, sizeof(TensrFuture));
+    if (!f) return NULL;
+    size_t len = strlen(filename) + 1;
+    f->filename = (char*)malloc(len);
+    if (!f->filename) {
+        free(f);
+        return NULL;
+    }
+    memcpy(f->filename, filename, len);
+    f->callback = callback;
+    f->ctx = ctx;
+    io_mutex_init(&f->lock);
+    io_cond_init(&f->cond);
+    return f;
+}
+
+static void future_destroy(TensrFuture* f) {
+    tensr_free(f->tensor);
+    io_cond_destroy(&f->cond);
+    io_mutex_destroy(&f->lock);
+    free(f->filename);
+    free(f);
+}
+
+/**
+ * @brief Save a tensor on a background I/O thread
+ * @param filename Path to output file
+ * @param t Tensor to save; it is copied before returning, so the caller may
+ *        modify or free it right away
+ * @param opts Save options as for tensr_save_ex(), or NULL for tensr_save()
+ * @param callback Called on the I/O thread when the save finishes, or NULL
+ * @param ctx Passed to callback
+ * @return Future to wait on and free, or NULL if the request cannot be queued
+ *
+ * The callback may call tensr_future_wait() and tensr_future_take(), which
+ * return at once, but must not free the future.
+ *
+ * Example:
+ *   TensrFuture* ckpt = tensr_save_async("step_1000.tsr", weights, NULL, NULL, NULL);
+ *   train_step(weights);               (overlaps with the write)
+ *   if (tensr_future_wait(ckpt) != 0) report_failure();
+ *   tensr_future_free(ckpt);
+ */
+TensrFuture* tensr_save_async(const char* filename, const Tensor* t, const TensrSaveOptions* opts,
+                              TensrFutureFn callback, void* ctx) {
+    TensrFuture* f = future_new(filename, callback, ctx);
+    if (!f) return NULL;
+    if (opts) {
+        f->opts = *opts;
+        f->has_opts = true;
+    }
+    f->tensor = tensr_copy(t);
+    if (!f->tensor || !submit(f)) {
+        future_destroy(f);
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * @brief Load a tensor on a background I/O thread
+ * @param filename Path to input file
+ * @param callback Called on the I/O thread when the load finishes, or NULL
+ * @param ctx Passed to callback
+ * @return Future whose tensor is claimed with tensr_future_take(), or NULL if
+ *         the request cannot be queued
+ *
+ * Loading the next file while computing on the current one hides the read:
+ *
+ * Example:
+ *   TensrFuture* next = tensr_load_async(files[0], NULL, NULL);
+ *   for (size_t i = 0; i < nfiles; i++) {
+ *       Tensor* batch = tensr_future_take(next);
+ *       tensr_future_free(next);
+ *       next = i + 1 < nfiles ? tensr_load_async(files[i + 1], NULL, NULL) : NULL;
+ *       process(batch);
+ *       tensr_free(batch);
+ *   }
+ */
+TensrFuture* tensr_load_async(const char* filename, TensrFutureFn callback, void* ctx) {
+    TensrFuture* f = future_new(filename, callback, ctx);
+    if (!f) return NULL;
+    f->load = true;
+    if (!submit(f)) {
+        future_destroy(f);
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * @brief Check whether a request has completed without blocking
+ */
+bool tensr_future_done(TensrFuture* f) {
+    io_mutex_lock(&f->lock);
+    bool done = f->done;
+    io_mutex_unlock(&f->lock);
+    return done;
+}
+
+/**
+ * @brief Wait for a request to complete
+ * @return 0 if the save or load succeeded, -1 otherwise
+ */
+int tensr_future_wait(TensrFuture* f) {
+    io_mutex_lock(&f->lock);
+    while (!f->done) io_cond_wait(&f->cond, &f->lock);
+    int status = f->status;
+    io_mutex_unlock(&f->lock);
+    return status;
+}
+
+/**
+ * @brief Wait for a load and take ownership of its tensor
+ * @return Loaded tensor, or NULL for a save, a failed load, or a tensor
+ *         already taken
+ */
+Tensor* tensr_future_take(TensrFuture* f) {
+    io_mutex_lock(&f->lock);
+    while (!f->done) io_cond_wait(&f->cond, &f->lock);
+    Tensor* t = f->tensor;
+    f->tensor = NULL;
+    io_mutex_unlock(&f->lock);
+    return t;
+}
+
+/**
+ * @brief Wait for a request to complete and release the future
+ * @param f Future (NULL is ignored); a loaded tensor not yet taken is freed
+ */
+void tensr_future_free(TensrFuture* f) {
+    if (!f) return;
+    io_mutex_lock(&f->lock);
+    while (!f->finished) io_cond_wait(&f->cond, &f->lock);
+    io_mutex_unlock(&f->lock);
+    future_destroy(f);
+}
@@ -0,0 +1,482 @@
+/**
+ * @file chunk.c
+ * @brief Chunked, filtered and compressed tensor payloads
+ * @author Muhammad Fiaz
+ *
+ * Each chunk is filtered to make it more compressible and then compressed
+ * with the LZ codec:
+ *
+ * - Byte shuffle groups byte k of every element together. The high bytes of
+ *   floats with similar magnitudes, and of small integers, become long runs.
+ * - Bit shuffle groups bit k of every element together. This suits
+ *   integers of small range, flags, and mostly-zero data.
+ * - Delta replaces integers by the difference from their predecessor, then
+ *   byte shuffles. Counters, sorted ids and timestamps become small
+ *   repeating values.
+ *
+ * TENSR_FILTER_AUTO tries each applicable filter on every chunk and keeps
+ * the smallest result. A chunk that does not compress is stored as is.
+ * Chunks are independent, so they are encoded and decoded in parallel, and
+ * any element can be reached by decoding one chunk.
+ */
+
+#include "chunk.h"
+#include "lz.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Chunks encoded per parallel batch before being written in order */
+#define CHUNK_BATCH 16
+
+size_t chunk_length(const ChunkIndex* idx, size_t i) {
+    uint64_t start = (uint64_t)i * idx->chunk_size;
+    uint64_t left = idx->data_bytes - start;
+    return left < idx->chunk_size ? (size_t)left : idx->chunk_size;
+}
+
+static inline void shuffle_n(const unsigned char* in, unsigned char* out, size_t n,
+                             size_t esize) {
+    for (size_t b = 0; b < esize; b++) {
+        unsigned char* plane = out + b * n;
+        for (size_t i = 0; i < n; i++) plane[i] = in[i * esize + b];
+    }
+}
+
+static inline void unshuffle_n(const unsigned char* in, unsigned char* out, size_t n,
+                               size_t esize) {
+    for (size_t b = 0; b < esize; b++) {
+        const unsigned char* plane = in + b * n;
+        for (size_t i = 0; i < n; i++) out[i * esize + b] = plane[i];
+    }
+}
+
+/* Dispatch on the element size so the common widths get constant-stride loops */
+#define CHUNK_DISPATCH(fn, ...)                                  \
+    switch (esize) {                                             \
+        case 4: fn(__VA_ARGS__, 4); break;                       \
+        case 8: fn(__VA_ARGS__, 8); break;                       \
+        default: fn(__VA_ARGS__, esize); break;                  \
+    }
+
+static void shuffle(const unsigned char* in, unsigned char* out, size_t n, size_t esize) {
+    CHUNK_DISPATCH(shuffle_n, in, out, n)
+}
+
+static void unshuffle(const unsigned char* in, unsigned char* out, size_t n, size_t esize) {
+    CHUNK_DISPATCH(unshuffle_n, in, out, n)
+}
+
+/**
+ * @brief Transpose an 8x8 bit matrix held one row per byte (its own inverse)
+ */
+static inline uint64_t transpose8(uint64_t x) {
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+/**
+ * @brief Bit shuffle: plane 8b+j holds bit j of byte b of every element
+ *
+ * Elements are taken in groups of 8; up to 7 trailing elements are copied
+ * unchanged after the planes.
+ */
+static void bitshuffle(const unsigned char* in, unsigned char* out, size_t n, size_t esize) {
+    size_t n8 = n & ~(size_t)7;
+    size_t plane = n8 / 8;
+    for (size_t i = 0; i < n8; i += 8) {
+        for (size_t b = 0; b < esize; b++) {
+            uint64_t x = 0;
+            for (size_t k = 0; k < 8; k++) x |= (uint64_t)in[(i + k) * esize + b] << (8 * k);
+            x = transpose8(x);
+            for (size_t j = 0; j < 8; j++) {
+                out[(b * 8 + j) * plane + i / 8] = (unsigned char)(x >> (8 * j));
+            }
+        }
+    }
+    memcpy(out + n8 * esize, in + n8 * esize, (n - n8) * esize);
+}
+
+static void unbitshuffle(const unsigned char* in, unsigned char* out, size_t n, size_t esize) {
+    size_t n8 = n & ~(size_t)7;
+    size_t plane = n8 / 8;
+    for (size_t i = 0; i < n8; i += 8) {
+        for (size_t b = 0; b < esize; b++) {
+            uint64_t x = 0;
+            for (size_t j = 0; j < 8; j++) {
+                x |= (uint64_t)in[(b * 8 + j) * plane + i / 8] << (8 * j);
+            }
+            x = transpose8(x);
+            for (size_t k = 0; k < 8; k++) {
+                out[(i + k) * esize + b] = (unsigned char)(x >> (8 * k));
+            }
+        }
+    }
+    memcpy(out + n8 * esize, in + n8 * esize, (n - n8) * esize);
+}
+
+/* Little-endian element of esize bytes, as an unsigned integer */
+static inline uint64_t load_le(const unsigned char* p, size_t esize) {
+    uint64_t v = 0;
+    for (size_t b = esize; b-- > 0;) v = (v << 8) | p[b];
+    return v;
+}
+
+static inline void store_le(unsigned char* p, uint64_t v, size_t esize) {
+    for (size_t b = 0; b < esize; b++) p[b] = (unsigned char)(v >> (8 * b));
+}
+
+static inline void delta_encode_n(unsigned char* p, size_t n, size_t esize) {
+    uint64_t prev = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v = load_le(p + i * esize, esize);
+        store_le(p + i * esize, v - prev, esize);
+        prev = v;
+    }
+}
+
+static inline void delta_decode_n(unsigned char* p, size_t n, size_t esize) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        acc += load_le(p + i * esize, esize);
+        store_le(p + i * esize, acc, esize);
+    }
+}
+
+/* Native-width versions for little-endian hosts, where chunk bytes are host order */
+#define DELTA_NATIVE(name, T, op)                                \
+    static void name(unsigned char* p, size_t n) {               \
+        T acc = 0;                                               \
+        for (size_t i = 0; i < n; i++) {                         \
+            T v;                                                 \
+            memcpy(&v, p + i * sizeof(T), sizeof(T));            \
+            op;                                                  \
+            memcpy(p + i * sizeof(T), &v, sizeof(T));            \
+        }                                                        \
+    }
+
+DELTA_NATIVE(delta_encode_u32, uint32_t, { v -= acc; acc += v; })
+DELTA_NATIVE(delta_encode_u64, uint64_t, { v -= acc; acc += v; })
+DELTA_NATIVE(delta_decode_u32, uint32_t, { acc += v; v = acc; })
+DELTA_NATIVE(delta_decode_u64, uint64_t, { acc += v; v = acc; })
+
+/**
+ * @brief Replace each element by its difference from the previous one (mod 2^bits)
+ */
+static void delta_encode(unsigned char* p, size_t n, size_t esize) {
+    if (fmt_host_little_endian() && esize == 4) delta_encode_u32(p, n);
+    else if (fmt_host_little_endian() && esize == 8) delta_encode_u64(p, n);
+    else delta_encode_n(p, n, esize);
+}
+
+static void delta_decode(unsigned char* p, size_t n, size_t esize) {
+    if (fmt_host_little_endian() && esize == 4) delta_decode_u32(p, n);
+    else if (fmt_host_little_endian() && esize == 8) delta_decode_u64(p, n);
+    else delta_decode_n(p, n, esize);
+}
+
+/**
+ * @brief Apply a filter to len bytes of elements
+ * @param tmp Scratch of len bytes (used by the delta filter)
+ */
+static void apply_filter(int filter, const unsigned char* in, unsigned char* out,
+                         unsigned char* tmp, size_t len, size_t esize) {
+    size_t n = len / esize;
+    switch (filter) {
+        case CHUNK_FILTER_SHUFFLE: shuffle(in, out, n, esize); break;
+        case CHUNK_FILTER_BITSHUFFLE: bitshuffle(in, out, n, esize); break;
+        case CHUNK_FILTER_DELTA:
+            memcpy(tmp, in, len);
+            delta_encode(tmp, n, esize);
+            shuffle(tmp, out, n, esize);
+            break;
+        default: memcpy(out, in, len); break;
+    }
+}
+
+static void undo_filter(int filter, const unsigned char* in, unsigned char* out, size_t len,
+                        size_t esize) {
+    size_t n = len / esize;
+    switch (filter) {
+        case CHUNK_FILTER_SHUFFLE: unshuffle(in, out, n, esize); break;
+        case CHUNK_FILTER_BITSHUFFLE: unbitshuffle(in, out, n, esize); break;
+        case CHUNK_FILTER_DELTA:
+            unshuffle(in, out, n, esize);
+            delta_decode(out, n, esize);
+            break;
+        default: memcpy(out, in, len); break;
+    }
+}
+
+static int filter_code(TensrFilter filter) {
+    switch (filter) {
+        case TENSR_FILTER_SHUFFLE: return CHUNK_FILTER_SHUFFLE;
+        case TENSR_FILTER_BITSHUFFLE: return CHUNK_FILTER_BITSHUFFLE;
+        case TENSR_FILTER_DELTA: return CHUNK_FILTER_DELTA;
+        default: return CHUNK_FILTER_NONE;
+    }
+}
+
+void chunk_codec_init(ChunkCodec* c, TensrDType dtype, const TensrSaveOptions* opts) {
+    c->esize = tensr_dtype_size(dtype);
+    c->checksum = opts->checksum;
+    c->nfilters = 0;
+    if (opts->codec == TENSR_CODEC_NONE) return;
+    if (opts->filter == TENSR_FILTER_AUTO) {
+        bool integer = dtype == TENSR_INT32 || dtype == TENSR_INT64 || dtype == TENSR_UINT8;
+        if (c->esize > 1) c->filters[c->nfilters++] = CHUNK_FILTER_SHUFFLE;
+        else c->filters[c->nfilters++] = CHUNK_FILTER_NONE;
+        c->filters[c->nfilters++] = CHUNK_FILTER_BITSHUFFLE;
+        if (integer) c->filters[c->nfilters++] = CHUNK_FILTER_DELTA;
+    } else {
+        c->filters[c->nfilters++] = filter_code(opts->filter);
+    }
+}
+
+/**
+ * @brief Try each candidate filter on little-endian chunk bytes
+ */
+static void encode_le(const ChunkCodec* c, const unsigned char* raw, size_t len,
+                      ChunkOut* out) {
+    out->bytes = raw;
+    out->owned = NULL;
+    out->stored = len;
+    out->filter = CHUNK_FILTER_NONE;
+    out->flags = 0;
+    out->ok = true;
+    if (c->nfilters == 0) return;
+
+    size_t cap = lz_bound(len);
+    unsigned char* filtered = (unsigned char*)malloc(len ? len : 1);
+    unsigned char* tmp = (unsigned char*)malloc(len ? len : 1);
+    unsigned char* trial = (unsigned char*)malloc(cap);
+    unsigned char* best = NULL;
+    out->ok = filtered && tmp && trial;
+    for (size_t k = 0; out->ok && k < c->nfilters; k++) {
+        apply_filter(c->filters[k], raw, filtered, tmp, len, c->esize);
+        /* Only a result smaller than both the raw chunk and the best so far is kept */
+        size_t limit = out->stored - (out->stored > 0);
+        size_t size = lz_compress(filtered, len, trial, limit < cap ? limit : cap);
+        if (size == 0) continue;
+        unsigned char* swap = best;
+        best = trial;
+        trial = swap ? swap : (unsigned char*)malloc(cap);
+        out->ok = trial != NULL;
+        out->bytes = best;
+        out->stored = size;
+        out->filter = (uint8_t)c->filters[k];
+        out->flags = CHUNK_COMPRESSED;
+    }
+    out->owned = best;
+    free(filtered);
+    free(tmp);
+    free(trial);
+}
+
+void chunk_encode(const ChunkCodec* c, const void* data, size_t len, ChunkOut* out) {
+    const unsigned char* raw = (const unsigned char*)data;
+    unsigned char* swapped = NULL;
+    if (!fmt_host_little_endian() && c->esize > 1) {
+        /* Chunks are encoded from little-endian bytes on every host */
+        swapped = (unsigned char*)malloc(len ? len : 1);
+        if (!swapped) {
+            out->owned = NULL;
+            out->ok = false;
+            return;
+        }
+        memcpy(swapped, raw, len);
+        fmt_swap_elements(swapped, len / c->esize, c->esize);
+        raw = swapped;
+    }
+    encode_le(c, raw, len, out);
+    out->checksum = c->checksum ? fmt_checksum(raw, len) : 0;
+    if (swapped && !(out->flags & CHUNK_COMPRESSED)) {
+        free(out->owned);
+        out->owned = swapped;
+        out->bytes = swapped;
+    } else {
+        free(swapped);
+    }
+}
+
+size_t chunk_index_bytes(size_t nchunks) {
+    return CHUNK_PREFIX_SIZE + nchunks * CHUNK_ENTRY_SIZE;
+}
+
+void chunk_index_encode(const ChunkIndex* idx, unsigned char* out) {
+    memset(out, 0, CHUNK_PREFIX_SIZE);
+    fmt_put_u32(out, (uint32_t)idx->chunk_size);
+    out[4] = CHUNK_CODEC_LZ;
+    fmt_put_u64(out + 8, idx->nchunks);
+    for (size_t i = 0; i < idx->nchunks; i++) {
+        const ChunkEntry* c = &idx->entries[i];
+        unsigned char* e = out + CHUNK_PREFIX_SIZE + i * CHUNK_ENTRY_SIZE;
+        fmt_put_u64(e, c->offset);
+        fmt_put_u32(e + 8, c->stored);
+        e[12] = c->filter;
+        e[13] = c->flags;
+        fmt_put_u16(e + 14, 0);
+        fmt_put_u64(e + 16, c->checksum);
+    }
+}
+
+bool chunk_write(FILE* f, uint64_t offset, const Tensor* t, const TensrSaveOptions* opts,
+                 uint64_t* index_hash) {
+    size_t esize = tensr_dtype_size(t->dtype);
+    size_t cs = opts->chunk_size ? opts->chunk_size : CHUNK_DEFAULT_SIZE;
+    if (cs > CHUNK_MAX_SIZE || opts->codec != TENSR_CODEC_LZ) return false;
+    cs = cs < esize ? esize : cs / esize * esize;
+    ChunkCodec codec;
+    chunk_codec_init(&codec, t->dtype, opts);
+
+    uint64_t bytes = (uint64_t)t->size * esize;
+    size_t nchunks = (size_t)((bytes + cs - 1) / cs);
+    size_t index_bytes = chunk_index_bytes(nchunks);
+    unsigned char* index = (unsigned char*)malloc(index_bytes);
+    ChunkEntry* entries = (ChunkEntry*)calloc(nchunks ? nchunks : 1, sizeof(ChunkEntry));
+    ChunkIndex layout = {t->dtype, cs, nchunks, bytes, opts->checksum, entries};
+    bool ok = index && entries;
+    if (ok) chunk_index_encode(&layout, index);
+    ok = ok && fwrite(index, 1, index_bytes, f) == index_bytes;
+
+    const unsigned char* data = (const unsigned char*)t->data;
+    uint64_t pos = offset + index_bytes;
+    for (size_t first = 0; ok && first < nchunks; first += CHUNK_BATCH) {
+        ChunkOut outs[CHUNK_BATCH];
+        size_t left = nchunks - first;
+        ptrdiff_t count = (ptrdiff_t)(left < CHUNK_BATCH ? left : CHUNK_BATCH);
+        TENSR_PARALLEL_FOR(count > 1)
+        for (ptrdiff_t k = 0; k < count; k++) {
+            size_t i = first + (size_t)k;
+            chunk_encode(&codec, data + i * cs, chunk_length(&layout, i), &outs[k]);
+        }
+        for (ptrdiff_t k = 0; k < count; k++) {
+            ChunkOut* o = &outs[k];
+            ok = ok && o->ok && fwrite(o->bytes, 1, o->stored, f) == o->stored;
+            entries[first + (size_t)k] = (ChunkEntry){pos, (uint32_t)o->stored, o->filter,
+                                                      o->flags, o->checksum};
+            pos += o->stored;
+            free(o->owned);
+        }
+    }
+
+    /* Offsets and sizes are known only now; rewrite the index in place */
+    if (ok) chunk_index_encode(&layout, index);
+    ok = ok && io_fseek(f, offset) && fwrite(index, 1, index_bytes, f) == index_bytes;
+    if (ok) *index_hash = fmt_checksum(index, index_bytes);
+    free(index);
+    free(entries);
+    return ok;
+}
+
+bool chunk_index_read(const IoFile* f, const FmtHeader* h, ChunkIndex* idx) {
+    uint64_t file_size;
+    unsigned char prefix[CHUNK_PREFIX_SIZE];
+    memset(idx, 0, sizeof(*idx));
+    if (!io_file_size(f, &file_size) || h->data_offset > file_size ||
+        file_size - h->data_offset < CHUNK_PREFIX_SIZE ||
+        !io_pread(f, prefix, CHUNK_PREFIX_SIZE, h->data_offset)) {
+        return false;
+    }
+    size_t esize = tensr_dtype_size(h->dtype);
+    uint64_t cs = fmt_get_u32(prefix);
+    uint64_t nchunks = fmt_get_u64(prefix + 8);
+    if (prefix[4] != CHUNK_CODEC_LZ || cs == 0 || cs > CHUNK_MAX_SIZE || cs % esize != 0 ||
+        nchunks != (h->data_bytes + cs - 1) / cs ||
+        nchunks > (file_size - h->data_offset - CHUNK_PREFIX_SIZE) / CHUNK_ENTRY_SIZE) {
+        return false;
+    }
+
+    size_t index_bytes = CHUNK_PREFIX_SIZE + (size_t)nchunks * CHUNK_ENTRY_SIZE;
+    unsigned char* index = (unsigned char*)malloc(index_bytes);
+    idx->entries = (ChunkEntry*)malloc((nchunks ? (size_t)nchunks : 1) * sizeof(ChunkEntry));
+    bool ok = index && idx->entries && io_pread(f, index, index_bytes, h->data_offset);
+    idx->dtype = h->dtype;
+    idx->chunk_size = (size_t)cs;
+    idx->nchunks = (size_t)nchunks;
+    idx->data_bytes = h->data_bytes;
+    idx->checksum = (h->flags & FMT_FLAG_CHECKSUM) != 0;
+    if (ok && idx->checksum) ok = fmt_checksum(index, index_bytes) == h->checksum;
+    for (size_t i = 0; ok && i < idx->nchunks; i++) {
+        const unsigned char* e = index + CHUNK_PREFIX_SIZE + i * CHUNK_ENTRY_SIZE;
+        ChunkEntry* c = &idx->entries[i];
+        c->offset = fmt_get_u64(e);
+        c->stored = fmt_get_u32(e + 8);
+        c->filter = e[12];
+        c->flags = e[13];
+        c->checksum = fmt_get_u64(e + 16);
+        size_t len = chunk_length(idx, i);
+        bool compressed = (c->flags & CHUNK_COMPRESSED) != 0;
+        ok = c->offset <= file_size && c->stored <= file_size - c->offset &&
+             c->filter <= CHUNK_FILTER_DELTA &&
+             (compressed ? c->stored <= lz_bound(len)
+                         : c->stored == len && c->filter == CHUNK_FILTER_NONE);
+    }
+    free(index);
+    if (!ok) chunk_index_free(idx);
+    return ok;
+}
+
+void chunk_index_free(ChunkIndex* idx) {
+    free(idx->entries);
+    idx->entries = NULL;
+}
+
+bool chunk_decode(const IoFile* f, const ChunkEntry* c, size_t len, TensrDType dtype,
+                  bool verify, void* out) {
+    bool ok;
+    if (!(c->flags & CHUNK_COMPRESSED)) {
+        ok = io_pread(f, out, len, c->offset);
+    } else {
+        bool direct = c->filter == CHUNK_FILTER_NONE;
+        unsigned char* packed = (unsigned char*)malloc(c->stored + (direct ? 0 : len) + 1);
+        unsigned char* plain = direct ? (unsigned char*)out : packed + c->stored;
+        ok = packed && io_pread(f, packed, c->stored, c->offset) &&
+             lz_decompress(packed, c->stored, plain, len);
+        if (ok && !direct) undo_filter(c->filter, plain, (unsigned char*)out, len,
+                                       tensr_dtype_size(dtype));
+        free(packed);
+    }
+    return ok && (!verify || fmt_checksum(out, len) == c->checksum);
+}
+
+bool chunk_read(const IoFile* f, const ChunkIndex* idx, size_t i, void* out) {
+    return chunk_decode(f, &idx->entries[i], chunk_length(idx, i), idx->dtype, idx->checksum,
+                        out);
+}
+
+Tensor* chunk_load(const IoFile* f, const FmtHeader* h) {
+    ChunkIndex idx;
+    if (!chunk_index_read(f, h, &idx)) return NULL;
+    Tensor* t = tensr_create((size_t*)h->shape, h->ndim, h->dtype, TENSR_CPU);
+    bool* ok = t ? (bool*)malloc((idx.nchunks ? idx.nchunks : 1) * sizeof(bool)) : NULL;
+    if (!ok) {
+        tensr_free(t);
+        chunk_index_free(&idx);
+        return NULL;
+    }
+
+    unsigned char* data = (unsigned char*)t->data;
+    ptrdiff_t n = (ptrdiff_t)idx.nchunks;
+    TENSR_PARALLEL_FOR(n > 1)
+    for (ptrdiff_t i = 0; i < n; i++) {
+        ok[i] = chunk_read(f, &idx, (size_t)i, data + (size_t)i * idx.chunk_size);
+    }
+
+    bool all = true;
+    for (size_t i = 0; i < idx.nchunks; i++) all = all && ok[i];
+    free(ok);
+    chunk_index_free(&idx);
+    if (!all) {
+        tensr_free(t);
+        return NULL;
+    }
+    if (!fmt_host_little_endian()) fmt_swap_elements(t->data, t->size, tensr_dtype_size(t->dtype));
+    return t;
+}
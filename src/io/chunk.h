@@ -0,0 +1,159 @@
+/**
+ * @file chunk.h
+ * @brief Internal chunked, compressed payloads of the tensor file format
+ * @author Muhammad Fiaz
+ *
+ * Files with FMT_FLAG_CHUNKED (format version 2) store the payload as
+ * independently compressed chunks of a fixed uncompressed size. The chunk
+ * section starts at the header's payload offset (all integers
+ * little-endian):
+ *
+ *   offset  size     field
+ *        0     4     uncompressed chunk size in bytes (a multiple of the element size)
+ *        4     1     codec (CHUNK_CODEC_*)
+ *        5     3     reserved, 0
+ *        8     8     number of chunks
+ *       16  24*n     index: per chunk
+ *                      u64 absolute file offset of the stored bytes
+ *                      u32 stored size in bytes
+ *                      u8  filter (CHUNK_FILTER_*)
+ *                      u8  flags (CHUNK_COMPRESSED)
+ *                      u16 reserved
+ *                      u64 XXH64 of the uncompressed chunk (0 without checksums)
+ *
+ * The chunk data follows the index. With FMT_FLAG_CHECKSUM, the header's
+ * checksum field holds the XXH64 of the index. Uncompressed chunk bytes are
+ * the little-endian row-major elements, as in plain files.
+ */
+
+#ifndef TENSR_IO_CHUNK_H
+#define TENSR_IO_CHUNK_H
+
+#include "file.h"
+#include "format.h"
+
+#define CHUNK_DEFAULT_SIZE (1u << 20)
+#define CHUNK_MAX_SIZE (1u << 30)
+#define CHUNK_PREFIX_SIZE 16
+#define CHUNK_ENTRY_SIZE 24
+
+#define CHUNK_CODEC_LZ 1
+#define CHUNK_COMPRESSED 0x1u
+
+/* On-disk filter codes */
+enum {
+    CHUNK_FILTER_NONE = 0,
+    CHUNK_FILTER_SHUFFLE = 1,
+    CHUNK_FILTER_BITSHUFFLE = 2,
+    CHUNK_FILTER_DELTA = 3
+};
+
+/* Index entry of one chunk */
+typedef struct {
+    uint64_t offset;
+    uint32_t stored;
+    uint8_t filter;
+    uint8_t flags;
+    uint64_t checksum;
+} ChunkEntry;
+
+/* Chunk index of an open file */
+typedef struct {
+    TensrDType dtype;
+    size_t chunk_size;
+    size_t nchunks;
+    uint64_t data_bytes;
+    bool checksum;
+    ChunkEntry* entries;
+} ChunkIndex;
+
+/* How chunks are filtered and compressed */
+typedef struct {
+    int filters[3];   /* Candidate filter codes, tried in turn */
+    size_t nfilters;  /* 0 stores every chunk uncompressed */
+    size_t esize;
+    bool checksum;
+} ChunkCodec;
+
+/* Encoded form of one chunk */
+typedef struct {
+    const unsigned char* bytes;  /* Stored bytes (owned or pointing at the input) */
+    unsigned char* owned;        /* Freed by the caller */
+    size_t stored;
+    uint8_t filter;
+    uint8_t flags;
+    uint64_t checksum;
+    bool ok;
+} ChunkOut;
+
+/**
+ * @brief Choose the filters for a dtype from save options
+ * @param opts Codec, filter and checksum settings; TENSR_CODEC_NONE stores chunks as is
+ */
+void chunk_codec_init(ChunkCodec* c, TensrDType dtype, const TensrSaveOptions* opts);
+
+/**
+ * @brief Filter and compress one chunk, keeping the smallest candidate
+ * @param data Elements in host byte order
+ * @param len Chunk length in bytes
+ */
+void chunk_encode(const ChunkCodec* c, const void* data, size_t len, ChunkOut* out);
+
+/**
+ * @brief Size of the encoded prefix and index of nchunks chunks
+ */
+size_t chunk_index_bytes(size_t nchunks);
+
+/**
+ * @brief Encode the prefix and index of a chunk section
+ * @param out Buffer of chunk_index_bytes(idx->nchunks) bytes
+ */
+void chunk_index_encode(const ChunkIndex* idx, unsigned char* out);
+
+/**
+ * @brief Write the chunk section of a tensor at the current file position
+ * @param offset Absolute file offset of the current position
+ * @param index_hash Set to the XXH64 of the written index
+ * @return false if an option is invalid or a write fails
+ */
+bool chunk_write(FILE* f, uint64_t offset, const Tensor* t, const TensrSaveOptions* opts,
+                 uint64_t* index_hash);
+
+/**
+ * @brief Read and validate the chunk index of a chunked file
+ * @param h Decoded file header
+ * @return false if the index is malformed, points outside the file, or
+ *         fails its checksum
+ */
+bool chunk_index_read(const IoFile* f, const FmtHeader* h, ChunkIndex* idx);
+
+void chunk_index_free(ChunkIndex* idx);
+
+/**
+ * @brief Uncompressed size of chunk i in bytes
+ */
+size_t chunk_length(const ChunkIndex* idx, size_t i);
+
+/**
+ * @brief Read and decode one stored chunk
+ * @param len Uncompressed length of the chunk
+ * @param verify Check the entry's checksum
+ * @param out Buffer of len bytes; receives little-endian elements
+ * @return false on a read error, a corrupt chunk or a checksum mismatch
+ */
+bool chunk_decode(const IoFile* f, const ChunkEntry* c, size_t len, TensrDType dtype,
+                  bool verify, void* out);
+
+/**
+ * @brief Read and decode chunk i
+ * @param out Buffer of chunk_length(idx, i) bytes; receives little-endian elements
+ * @return false on a read error, a corrupt chunk or a checksum mismatch
+ */
+bool chunk_read(const IoFile* f, const ChunkIndex* idx, size_t i, void* out);
+
+/**
+ * @brief Load the whole tensor of a chunked file, decoding chunks in parallel
+ */
+Tensor* chunk_load(const IoFile* f, const FmtHeader* h);
+
+#endif /* TENSR_IO_CHUNK_H */
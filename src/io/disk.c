@@ -0,0 +1,868 @@
+/**
+ * @file disk.c
+ * @brief Disk-backed tensors streamed through a bounded chunk cache
+ * @author Muhammad Fiaz
+ *
+ * A disk tensor is a chunked tensor file (see chunk.h) kept open for reading
+ * and writing. Chunks are decoded on demand into a fixed number of cache
+ * slots and evicted least recently used first. Modified chunks are encoded
+ * again and written back when they are evicted or flushed. Streaming
+ * operations walk the leading dimension in blocks of rows, and while a block
+ * is being processed a background thread decodes the chunk after it, so
+ * decompression overlaps with computation. Memory use is bounded by the
+ * cache plus one block per operand, whatever the size of the file.
+ *
+ * A rewritten chunk goes back to its old place when it fits and is appended
+ * to the file otherwise; the space it leaves behind is not reclaimed. A new
+ * tensor starts with every chunk pointing at one shared compressed block of
+ * zeros, so creating even a very large tensor writes little more than its
+ * index.
+ */
+
+#include "tensr/tensr.h"
+#include "file.h"
+#include "format.h"
+#include "chunk.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define DISK_DEFAULT_CACHE ((size_t)64 << 20)
+#define DISK_NONE SIZE_MAX
+
+/* One cache slot */
+typedef struct {
+    size_t chunk;         /* Chunk held, or DISK_NONE */
+    unsigned char* data;  /* Elements in host byte order, allocated on first use */
+    uint64_t used;        /* Time of last use, for LRU eviction */
+    bool dirty;
+} DiskSlot;
+
+struct TensrDiskTensor {
+    IoFile file;
+    FmtHeader header;
+    ChunkIndex index;     /* Updated as dirty chunks are written back */
+    ChunkCodec codec;     /* Encoding of written-back chunks */
+    uint64_t shared_end;  /* Stored bytes below this offset may back several chunks */
+    uint64_t end;         /* End of the file, where relocated chunks are appended */
+    size_t row_bytes;
+    DiskSlot* slots;
+    size_t nslots;
+    size_t* slot_of;      /* Slot of each chunk, or DISK_NONE */
+    uint64_t clock;
+    bool index_dirty;
+
+    /* The cache above is shared with the prefetch thread and guarded by lock */
+    IoMutex lock;
+    IoCond wake;          /* Signals the thread that want or stop changed */
+    IoCond loaded;        /* Signals waiters that loading changed */
+    IoThread worker;
+    bool started;
+    unsigned char* spare; /* Buffer the thread decodes into */
+    size_t want;          /* Chunk to prefetch next, or DISK_NONE */
+    size_t loading;       /* Chunk being decoded by the thread, or DISK_NONE */
+    bool stop;
+};
+
+/* Calls an in-memory binary operation on each pair of blocks */
+typedef struct {
+    Tensor* (*op)(const Tensor* a, const Tensor* b);
+} DiskBinary;
+
+/* Whole-tensor reductions */
+typedef enum {
+    DISK_SUM,
+    DISK_MEAN,
+    DISK_MAX,
+    DISK_MIN
+} DiskReduce;
+
+/**
+ * @brief Read and decode chunk c into host byte order
+ * @param e Index entry of the chunk (a copy, so the lock need not be held)
+ */
+static bool load_chunk(const TensrDiskTensor* d, const ChunkEntry* e, size_t c,
+                       unsigned char* out) {
+    size_t len = chunk_length(&d->index, c);
+    if (!chunk_decode(&d->file, e, len, d->index.dtype, d->index.checksum, out)) return false;
+    size_t esize = tensr_dtype_size(d->index.dtype);
+    if (!fmt_host_little_endian()) fmt_swap_elements(out, len / esize, esize);
+    return true;
+}
+
+/**
+ * @brief Store an encoded chunk and point its index entry at it
+ */
+static bool place_chunk(TensrDiskTensor* d, size_t c, const ChunkOut* o) {
+    ChunkEntry* e = &d->index.entries[c];
+    bool in_place = e->offset >= d->shared_end && o->stored <= e->stored;
+    uint64_t at = in_place ? e->offset : d->end;
+    if (!o->ok || !io_pwrite(&d->file, o->bytes, o->stored, at)) return false;
+    if (!in_place) d->end += o->stored;
+    *e = (ChunkEntry){at, (uint32_t)o->stored, o->filter, o->flags, o->checksum};
+    d->index_dirty = true;
+    return true;
+}
+
+/**
+ * @brief Pick the slot to reuse: a free one, else the least recently used
+ * @param clean_only Never pick a dirty slot
+ * @return Slot index, or DISK_NONE
+ */
+static size_t pick_victim(const TensrDiskTensor* d, bool clean_only) {
+    size_t best = DISK_NONE;
+    for (size_t k = 0; k < d->nslots; k++) {
+        const DiskSlot* s = &d->slots[k];
+        if (s->chunk == DISK_NONE) return k;
+        if (clean_only && s->dirty) continue;
+        if (best == DISK_NONE || s->used < d->slots[best].used) best = k;
+    }
+    return best;
+}
+
+/**
+ * @brief Make chunk c resident, evicting another chunk if needed (lock held)
+ * @param fill Decode the stored chunk; false when the caller overwrites all of it
+ * @return Its slot, or NULL on a read, decode or write-back failure
+ */
+static DiskSlot* chunk_slot(TensrDiskTensor* d, size_t c, bool fill) {
+    /* A chunk the prefetch thread is decoding is about to arrive */
+    while (d->slot_of[c] == DISK_NONE && d->loading == c) io_cond_wait(&d->loaded, &d->lock);
+    if (d->slot_of[c] != DISK_NONE) {
+        DiskSlot* s = &d->slots[d->slot_of[c]];
+        s->used = ++d->clock;
+        return s;
+    }
+
+    size_t k = pick_victim(d, false);
+    DiskSlot* s = &d->slots[k];
+    if (!s->data) {
+        s->data = (unsigned char*)malloc(d->index.chunk_size);
+        if (!s->data) return NULL;
+    }
+    if (s->chunk != DISK_NONE) {
+        if (s->dirty) {
+            ChunkOut o;
+            chunk_encode(&d->codec, s->data, chunk_length(&d->index, s->chunk), &o);
+            bool ok = place_chunk(d, s->chunk, &o);
+            free(o.owned);
+            if (!ok) return NULL;
+        }
+        d->slot_of[s->chunk] = DISK_NONE;
+        s->chunk = DISK_NONE;
+        s->dirty = false;
+    }
+    if (fill && !load_chunk(d, &d->index.entries[c], c, s->data)) return NULL;
+    s->chunk = c;
+    s->used = ++d->clock;
+    d->slot_of[c] = k;
+    return s;
+}
+
+/**
+ * @brief Prefetch thread: decode requested chunks into clean or free slots
+ */
+static void prefetch_main(void* arg) {
+    TensrDiskTensor* d = (TensrDiskTensor*)arg;
+    io_mutex_lock(&d->lock);
+    while (!d->stop) {
+        size_t c = d->want;
+        if (c == DISK_NONE) {
+            io_cond_wait(&d->wake, &d->lock);
+            continue;
+        }
+        d->want = DISK_NONE;
+        if (d->slot_of[c] != DISK_NONE || !d->spare) continue;
+
+        /* Decode without the lock; the entry cannot change while c is not resident */
+        ChunkEntry e = d->index.entries[c];
+        d->loading = c;
+        io_mutex_unlock(&d->lock);
+        bool ok = load_chunk(d, &e, c, d->spare);
+        io_mutex_lock(&d->lock);
+        d->loading = DISK_NONE;
+
+        size_t k = ok ? pick_victim(d, true) : DISK_NONE;
+        if (k != DISK_NONE) {
+            DiskSlot* s = &d->slots[k];
+            if (s->chunk != DISK_NONE) d->slot_of[s->chunk] = DISK_NONE;
+            unsigned char* old = s->data;
+            s->data = d->spare;
+            s->chunk = c;
+            s->used = ++d->clock;
+            d->slot_of[c] = k;
+            d->spare = old ? old : (unsigned char*)malloc(d->index.chunk_size);
+        }
+        io_cond_broadcast(&d->loaded);
+    }
+    io_mutex_unlock(&d->lock);
+}
+
+/**
+ * @brief Ask the prefetch thread to decode the chunk holding a given row
+ */
+static void prefetch_row(TensrDiskTensor* d, size_t row) {
+    if (row >= d->header.shape[0] || d->index.chunk_size == 0) return;
+    size_t c = (size_t)((uint64_t)row * d->row_bytes / d->index.chunk_size);
+    io_mutex_lock(&d->lock);
+    if (c < d->index.nchunks && d->slot_of[c] == DISK_NONE && d->loading != c) {
+        d->want = c;
+        io_cond_broadcast(&d->wake);
+    }
+    io_mutex_unlock(&d->lock);
+}
+
+/**
+ * @brief Copy bytes [offset, offset + len) of the payload out of or into the cache
+ * @param write Copy buf into the tensor instead of out of it
+ */
+static bool disk_transfer(TensrDiskTensor* d, uint64_t offset, unsigned char* buf, size_t len,
+                          bool write) {
+    size_t cs = d->index.chunk_size;
+    bool ok = true;
+    io_mutex_lock(&d->lock);
+    while (ok && len > 0) {
+        size_t c = (size_t)(offset / cs), within = (size_t)(offset % cs);
+        size_t clen = chunk_length(&d->index, c);
+        size_t n = clen - within < len ? clen - within : len;
+        DiskSlot* s = chunk_slot(d, c, !write || n < clen);
+        ok = s != NULL;
+        if (ok && write) {
+            memcpy(s->data + within, buf, n);
+            s->dirty = true;
+        } else if (ok) {
+            memcpy(buf, s->data + within, n);
+        }
+        buf += n;
+        offset += n;
+        len -= n;
+    }
+    io_mutex_unlock(&d->lock);
+    return ok;
+}
+
+/**
+ * @brief Free a disk tensor without flushing it
+ */
+static void disk_free(TensrDiskTensor* d) {
+    if (d->started) {
+        io_mutex_lock(&d->lock);
+        d->stop = true;
+        io_cond_broadcast(&d->wake);
+        io_mutex_unlock(&d->lock);
+        io_thread_join(&d->worker);
+    }
+    io_mutex_destroy(&d->lock);
+    io_cond_destroy(&d->wake);
+    io_cond_destroy(&d->loaded);
+    for (size_t k = 0; d->slots && k < d->nslots; k++) free(d->slots[k].data);
+    free(d->slots);
+    free(d->slot_of);
+    free(d->spare);
+    chunk_index_free(&d->index);
+    io_file_close(&d->file);
+    free(d);
+}
+
+/**
+ * @brief Set up the cache and start the prefetch thread
+ * @return false on allocation or thread failure
+ */
+static bool disk_start(TensrDiskTensor* d, const TensrSaveOptions* opts, size_t cache_bytes) {
+    TensrSaveOptions defaults = {.codec = TENSR_CODEC_LZ, .filter = TENSR_FILTER_SHUFFLE};
+    TensrSaveOptions codec = opts ? *opts : defaults;
+    codec.checksum = d->index.checksum;
+    chunk_codec_init(&d->codec, d->index.dtype, &codec);
+
+    size_t esize = tensr_dtype_size(d->header.dtype);
+    size_t rows = d->header.shape[0];
+    d->row_bytes = rows ? (size_t)(d->header.data_bytes / rows) : esize;
+    size_t cs = d->index.chunk_size;
+    d->nslots = (cache_bytes ? cache_bytes : DISK_DEFAULT_CACHE) / cs;
+    if (d->nslots > d->index.nchunks) d->nslots = d->index.nchunks;
+    if (d->nslots < 2) d->nslots = 2;
+    d->slots = (DiskSlot*)calloc(d->nslots, sizeof(DiskSlot));
+    d->slot_of = (size_t*)malloc((d->index.nchunks ? d->index.nchunks : 1) * sizeof(size_t));
+    d->spare = (unsigned char*)malloc(cs);
+    if (!d->slots || !d->slot_of || !d->spare) return false;
+    for (size_t k = 0; k < d->nslots; k++) d->slots[k].chunk = DISK_NONE;
+    for (size_t c = 0; c < d->index.nchunks; c++) d->slot_of[c] = DISK_NONE;
+    d->want = DISK_NONE;
+    d->loading = DISK_NONE;
+    d->started = io_thread_start(&d->worker, prefetch_main, d);
+    return d->started;
+}
+
+/**
+ * @brief Allocate a disk tensor with its lock and condition variables
+ */
+static TensrDiskTensor* disk_alloc(void) {
+    TensrDiskTensor* d = (TensrDiskTensor*)calloc(1, sizeof(TensrDiskTensor));
+    if (!d) return NULL;
+    io_mutex_init(&d->lock);
+    io_cond_init(&d->wake);
+    io_cond_init(&d->loaded);
+    return d;
+}
+
+/**
+ * @brief Write the chunk index, and its checksum into the header
+ */
+static bool write_index(TensrDiskTensor* d) {
+    size_t bytes = chunk_index_bytes(d->index.nchunks);
+    unsigned char* buf = (unsigned char*)malloc(bytes);
+    if (!buf) return false;
+    chunk_index_encode(&d->index, buf);
+    bool ok = io_pwrite(&d->file, buf, bytes, d->header.data_offset);
+    if (ok && d->index.checksum) {
+        unsigned char sum[8];
+        fmt_put_u64(sum, fmt_checksum(buf, bytes));
+        ok = io_pwrite(&d->file, sum, 8, 40);
+    }
+    free(buf);
+    if (ok) d->index_dirty = false;
+    return ok;
+}
+
+/**
+ * @brief Create a disk-backed tensor filled with zeros
+ * @param filename Path of the file to create (an existing file is replaced)
+ * @param shape Shape; the first dimension is the one operations stream over
+ * @param ndim Number of dimensions (at least 1)
+ * @param dtype Element type
+ * @param opts Codec, filter, chunk size, alignment and checksum settings, or
+ *        NULL for LZ compression with the byte-shuffle filter and 1 MB chunks
+ * @param cache_bytes Memory for decoded chunks (0 = 64 MB, at least two chunks)
+ * @return Disk tensor, or NULL on failure
+ *
+ * The file is in the chunked format written by tensr_save_ex(), so after
+ * tensr_disk_close() it can be read with tensr_load(), tensr_load_mmap() or
+ * tensr_load_slice(). The chunk size is rounded down to a whole number of
+ * rows where a row fits, so each block of rows an operation processes maps
+ * onto whole chunks. With TENSR_CODEC_NONE chunks are stored uncompressed
+ * and rewritten in place.
+ *
+ * Example:
+ *   TensrDiskTensor* x = tensr_disk_create("x.tsr", (size_t[]){1u << 30, 128}, 2,
+ *                                          TENSR_FLOAT32, NULL, 256u << 20);
+ */
+TensrDiskTensor* tensr_disk_create(const char* filename, const size_t* shape, size_t ndim,
+                                   TensrDType dtype, const TensrSaveOptions* opts,
+                                   size_t cache_bytes) {
+    FmtHeader h;
+    TensrSaveOptions defaults = {.codec = TENSR_CODEC_LZ, .filter = TENSR_FILTER_SHUFFLE};
+    if (!opts) opts = &defaults;
+    if (ndim == 0 || !fmt_init_header(&h, shape, ndim, dtype, opts->alignment)) return NULL;
+    h.version = FMT_VERSION_CHUNKED;
+    h.flags = FMT_FLAG_CHUNKED | (opts->checksum ? FMT_FLAG_CHECKSUM : 0);
+
+    size_t esize = tensr_dtype_size(dtype);
+    size_t cs = opts->chunk_size ? opts->chunk_size : CHUNK_DEFAULT_SIZE;
+    if (cs > CHUNK_MAX_SIZE) return NULL;
+    uint64_t row_bytes = shape[0] ? h.data_bytes / shape[0] : 0;
+    if (row_bytes > 0 && row_bytes <= cs) cs = (size_t)(cs / row_bytes * row_bytes);
+    else cs = cs < esize ? esize : cs / esize * esize;
+
+    TensrDiskTensor* d = disk_alloc();
+    if (!d) return NULL;
+    d->header = h;
+    d->index.dtype = dtype;
+    d->index.chunk_size = cs;
+    d->index.nchunks = (size_t)((h.data_bytes + cs - 1) / cs);
+    d->index.data_bytes = h.data_bytes;
+    d->index.checksum = opts->checksum;
+    d->index.entries = (ChunkEntry*)calloc(d->index.nchunks ? d->index.nchunks : 1,
+                                           sizeof(ChunkEntry));
+    if (!d->index.entries || !io_file_open_rw(&d->file, filename, true)) {
+        chunk_index_free(&d->index);
+        io_mutex_destroy(&d->lock);
+        io_cond_destroy(&d->wake);
+        io_cond_destroy(&d->loaded);
+        free(d);
+        return NULL;
+    }
+
+    unsigned char* header = (unsigned char*)calloc(1, (size_t)h.data_offset);
+    bool ok = header != NULL;
+    if (ok) fmt_encode_header(&h, header);
+    ok = ok && io_pwrite(&d->file, header, (size_t)h.data_offset, 0);
+    free(header);
+
+    ChunkCodec codec;
+    chunk_codec_init(&codec, dtype, opts);
+    uint64_t first = h.data_offset + chunk_index_bytes(d->index.nchunks);
+    size_t nchunks = d->index.nchunks;
+    size_t last = nchunks ? chunk_length(&d->index, nchunks - 1) : 0;
+    unsigned char* zeros = (unsigned char*)calloc(1, cs);
+    ok = ok && zeros != NULL;
+    if (ok && codec.nfilters == 0) {
+        /* Uncompressed chunks each get their own place; the file starts out sparse */
+        uint64_t full_sum = opts->checksum ? fmt_checksum(zeros, cs) : 0;
+        uint64_t last_sum = opts->checksum ? fmt_checksum(zeros, last) : 0;
+        for (size_t c = 0; c < nchunks; c++) {
+            bool full = c + 1 < nchunks || last == cs;
+            d->index.entries[c] = (ChunkEntry){first + (uint64_t)c * cs,
+                                               (uint32_t)(full ? cs : last), CHUNK_FILTER_NONE,
+                                               0, full ? full_sum : last_sum};
+        }
+        d->shared_end = first;
+        d->end = first + h.data_bytes;
+        unsigned char pad = 0;
+        ok = h.data_bytes == 0 || io_pwrite(&d->file, &pad, 1, d->end - 1);
+    } else if (ok) {
+        /* Every full chunk shares one block of zeros, and a shorter last chunk another */
+        uint64_t at = first;
+        for (int z = 0; ok && z < 2; z++) {
+            bool full = z == 0;
+            size_t users = full ? nchunks - (last != cs) : (size_t)(last != cs);
+            if (nchunks == 0 || users == 0) continue;
+            ChunkOut o;
+            chunk_encode(&codec, zeros, full ? cs : last, &o);
+            ok = o.ok && io_pwrite(&d->file, o.bytes, o.stored, at);
+            ChunkEntry e = {at, (uint32_t)o.stored, o.filter, o.flags, o.checksum};
+            at += o.stored;
+            free(o.owned);
+            if (full) {
+                for (size_t c = 0; c < users; c++) d->index.entries[c] = e;
+            } else {
+                d->index.entries[nchunks - 1] = e;
+            }
+        }
+        d->shared_end = at;
+        d->end = at;
+    }
+    free(zeros);
+
+    ok = ok && write_index(d) && disk_start(d, opts, cache_bytes);
+    if (!ok) {
+        disk_free(d);
+        return NULL;
+    }
+    return d;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    uint64_t x = ((const ChunkEntry*)a)->offset, y = ((const ChunkEntry*)b)->offset;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Set shared_end past every stored block that overlaps another one
+ */
+static bool find_shared(TensrDiskTensor* d) {
+    size_t n = d->index.nchunks;
+    ChunkEntry* sorted = (ChunkEntry*)malloc((n ? n : 1) * sizeof(ChunkEntry));
+    if (!sorted) return false;
+    memcpy(sorted, d->index.entries, n * sizeof(ChunkEntry));
+    qsort(sorted, n, sizeof(ChunkEntry), compare_entries);
+    uint64_t reach = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t end = sorted[i].offset + sorted[i].stored;
+        if (i > 0 && sorted[i].offset < reach) {
+            uint64_t shared = end > reach ? end : reach;
+            if (shared > d->shared_end) d->shared_end = shared;
+        }
+        if (end > reach) reach = end;
+    }
+    free(sorted);
+    return true;
+}
+
+/**
+ * @brief Open a chunked tensor file as a disk-backed tensor
+ * @param filename File written by tensr_disk_create(), or by tensr_save_ex()
+ *        with a codec
+ * @param opts Codec and filter for chunks written back, or NULL for LZ with
+ *        the byte-shuffle filter; the file's chunk size and checksum setting
+ *        are kept
+ * @param cache_bytes Memory for decoded chunks (0 = 64 MB, at least two chunks)
+ * @return Disk tensor, or NULL if the file is missing, not chunked or corrupt
+ *
+ * Example:
+ *   TensrDiskTensor* x = tensr_disk_open("x.tsr", NULL, 0);
+ *   Tensor* total = tensr_disk_sum(x, NULL, 0, false);
+ */
+TensrDiskTensor* tensr_disk_open(const char* filename, const TensrSaveOptions* opts,
+                                 size_t cache_bytes) {
+    TensrDiskTensor* d = disk_alloc();
+    if (!d) return NULL;
+    if (!io_file_open_rw(&d->file, filename, false)) {
+        io_mutex_destroy(&d->lock);
+        io_cond_destroy(&d->wake);
+        io_cond_destroy(&d->loaded);
+        free(d);
+        return NULL;
+    }
+
+    unsigned char header[FMT_FIXED_SIZE + 8 * FMT_MAX_NDIM];
+    FmtHeader* h = &d->header;
+    bool ok = io_pread(&d->file, header, FMT_FIXED_SIZE, 0) &&
+              fmt_get_u16(header + 14) <= FMT_MAX_NDIM;
+    if (ok) {
+        size_t size = fmt_header_size(fmt_get_u16(header + 14));
+        ok = io_pread(&d->file, header, size, 0) && fmt_decode_header(header, size, h) &&
+             (h->flags & FMT_FLAG_CHUNKED) && h->ndim > 0 &&
+             chunk_index_read(&d->file, h, &d->index) && io_file_size(&d->file, &d->end);
+    }
+
+    /* Stored blocks used by more than one chunk must never be overwritten in place */
+    ok = ok && find_shared(d);
+    ok = ok && disk_start(d, opts, cache_bytes);
+    if (!ok) {
+        disk_free(d);
+        return NULL;
+    }
+    return d;
+}
+
+/**
+ * @brief Write back all modified chunks and the chunk index
+ * @param d Disk tensor
+ * @return 0 on success, -1 on failure
+ *
+ * Dirty chunks are encoded in parallel. The tensor stays open and cached.
+ */
+int tensr_disk_flush(TensrDiskTensor* d) {
+    io_mutex_lock(&d->lock);
+    size_t* dirty = (size_t*)malloc(d->nslots * sizeof(size_t));
+    ChunkOut* outs = (ChunkOut*)malloc(d->nslots * sizeof(ChunkOut));
+    bool ok = dirty && outs;
+    size_t ndirty = 0;
+    for (size_t k = 0; ok && k < d->nslots; k++) {
+        if (d->slots[k].dirty) dirty[ndirty++] = k;
+    }
+
+    ptrdiff_t n = ok ? (ptrdiff_t)ndirty : 0;
+    TENSR_PARALLEL_FOR(n > 1)
+    for (ptrdiff_t i = 0; i < n; i++) {
+        const DiskSlot* s = &d->slots[dirty[i]];
+        chunk_encode(&d->codec, s->data, chunk_length(&d->index, s->chunk), &outs[i]);
+    }
+    for (ptrdiff_t i = 0; i < n; i++) {
+        DiskSlot* s = &d->slots[dirty[i]];
+        if (ok && place_chunk(d, s->chunk, &outs[i])) s->dirty = false;
+        else ok = false;
+        free(outs[i].owned);
+    }
+    if (ok && d->index_dirty) ok = write_index(d);
+    io_mutex_unlock(&d->lock);
+    free(dirty);
+    free(outs);
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Flush and close a disk-backed tensor
+ * @param d Disk tensor (NULL is ignored)
+ * @return 0 on success, -1 if the final flush failed
+ */
+int tensr_disk_close(TensrDiskTensor* d) {
+    if (!d) return 0;
+    int status = tensr_disk_flush(d);
+    disk_free(d);
+    return status;
+}
+
+/**
+ * @brief Shape of a disk-backed tensor
+ * @param ndim Receives the number of dimensions
+ */
+const size_t* tensr_disk_shape(const TensrDiskTensor* d, size_t* ndim) {
+    *ndim = d->header.ndim;
+    return d->header.shape;
+}
+
+TensrDType tensr_disk_dtype(const TensrDiskTensor* d) {
+    return d->header.dtype;
+}
+
+/**
+ * @brief Read a block of rows into memory
+ * @param d Disk tensor
+ * @param row First index along the first dimension
+ * @param nrows Number of rows
+ * @return New tensor of shape {nrows, ...}, or NULL if the rows are out of range
+ */
+Tensor* tensr_disk_read(TensrDiskTensor* d, size_t row, size_t nrows) {
+    size_t total = d->header.shape[0];
+    if (row > total || nrows > total - row) return NULL;
+    size_t shape[FMT_MAX_NDIM];
+    memcpy(shape, d->header.shape, d->header.ndim * sizeof(size_t));
+    shape[0] = nrows;
+    Tensor* t = tensr_create(shape, d->header.ndim, d->header.dtype, TENSR_CPU);
+    if (t && !disk_transfer(d, (uint64_t)row * d->row_bytes, (unsigned char*)t->data,
+                            nrows * d->row_bytes, false)) {
+        tensr_free(t);
+        return NULL;
+    }
+    return t;
+}
+
+/**
+ * @brief Overwrite a block of rows
+ * @param d Disk tensor
+ * @param row First index along the first dimension
+ * @param rows Tensor of the same dtype and trailing dimensions
+ * @return 0 on success, -1 on a mismatch or an I/O failure
+ *
+ * The rows land in the cache and reach the file when their chunks are
+ * evicted, flushed or closed.
+ */
+int tensr_disk_write(TensrDiskTensor* d, size_t row, const Tensor* rows) {
+    const FmtHeader* h = &d->header;
+    if (rows->dtype != h->dtype || rows->ndim != h->ndim || row > h->shape[0] ||
+        rows->shape[0] > h->shape[0] - row) {
+        return -1;
+    }
+    for (size_t i = 1; i < h->ndim; i++) {
+        if (rows->shape[i] != h->shape[i]) return -1;
+    }
+    bool ok = disk_transfer(d, (uint64_t)row * d->row_bytes, (unsigned char*)rows->data,
+                            rows->shape[0] * d->row_bytes, true);
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Rows per streamed block: about one chunk of the operand with the widest rows
+ */
+static size_t block_rows(TensrDiskTensor** ds, size_t n) {
+    size_t rows = SIZE_MAX;
+    for (size_t i = 0; i < n; i++) {
+        size_t per = ds[i]->row_bytes ? ds[i]->index.chunk_size / ds[i]->row_bytes : SIZE_MAX;
+        if (per < rows) rows = per;
+    }
+    return rows ? rows : 1;
+}
+
+/**
+ * @brief Apply a function to blocks of rows, writing the results to another disk tensor
+ * @param out Output disk tensor; may also be one of the inputs
+ * @param inputs Input disk tensors with the same first dimension as out
+ * @param ninputs Number of inputs
+ * @param fn Called with one in-memory block per input, all covering the same
+ *        rows; returns a new tensor of out's dtype holding those rows of out
+ * @param ctx Passed through to fn
+ * @return 0 on success, -1 on a shape mismatch, a NULL or misshapen result,
+ *         or an I/O failure
+ *
+ * Blocks hold about one chunk each and the chunk after every block is
+ * prefetched, so any in-memory operation runs over tensors of any size in
+ * bounded memory. Operations that work row by row, such as tensr_matmul()
+ * by an in-memory matrix, work as well as elementwise ones.
+ *
+ * Example:
+ *   static Tensor* exp_block(Tensor** in, size_t n, void* ctx) {
+ *       return tensr_exp(in[0]);
+ *   }
+ *   tensr_disk_map(y, &x, 1, exp_block, NULL);
+ */
+int tensr_disk_map(TensrDiskTensor* out, TensrDiskTensor** inputs, size_t ninputs,
+                   TensrDiskMapFn fn, void* ctx) {
+    size_t nrows = out->header.shape[0];
+    for (size_t j = 0; j < ninputs; j++) {
+        if (inputs[j]->header.shape[0] != nrows) return -1;
+    }
+    TensrDiskTensor** all = (TensrDiskTensor**)malloc((ninputs + 1) * sizeof(TensrDiskTensor*));
+    Tensor** blocks = (Tensor**)calloc(ninputs ? ninputs : 1, sizeof(Tensor*));
+    int status = all && blocks ? 0 : -1;
+    size_t rows = 1;
+    if (all) {
+        memcpy(all, inputs, ninputs * sizeof(TensrDiskTensor*));
+        all[ninputs] = out;
+        rows = block_rows(all, ninputs + 1);
+    }
+
+    for (size_t row = 0; status == 0 && row < nrows; row += rows) {
+        size_t n = rows < nrows - row ? rows : nrows - row;
+        for (size_t j = 0; j < ninputs; j++) {
+            blocks[j] = status == 0 ? tensr_disk_read(inputs[j], row, n) : NULL;
+            if (!blocks[j]) status = -1;
+            prefetch_row(inputs[j], row + n);
+        }
+        Tensor* r = status == 0 ? fn(blocks, ninputs, ctx) : NULL;
+        if (!r || r->ndim == 0 || r->shape[0] != n || tensr_disk_write(out, row, r) != 0) {
+            status = -1;
+        }
+        tensr_free(r);
+        for (size_t j = 0; j < ninputs; j++) {
+            tensr_free(blocks[j]);
+            blocks[j] = NULL;
+        }
+    }
+    free(all);
+    free(blocks);
+    return status;
+}
+
+static Tensor* map_binary(Tensor** blocks, size_t n, void* ctx) {
+    (void)n;
+    return ((const DiskBinary*)ctx)->op(blocks[0], blocks[1]);
+}
+
+/**
+ * @brief Stream an in-memory binary operation over two disk tensors of one shape
+ */
+static int disk_binary(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b,
+                       Tensor* (*op)(const Tensor*, const Tensor*)) {
+    const FmtHeader* ha = &a->header;
+    const FmtHeader* hb = &b->header;
+    const FmtHeader* ho = &out->header;
+    if (ha->ndim != hb->ndim || ha->ndim != ho->ndim || ha->dtype != hb->dtype ||
+        ha->dtype != ho->dtype ||
+        memcmp(ha->shape, hb->shape, ha->ndim * sizeof(size_t)) != 0 ||
+        memcmp(ha->shape, ho->shape, ha->ndim * sizeof(size_t)) != 0) {
+        return -1;
+    }
+    DiskBinary ctx = {op};
+    TensrDiskTensor* inputs[2] = {a, b};
+    return tensr_disk_map(out, inputs, 2, map_binary, &ctx);
+}
+
+/**
+ * @brief Elementwise out = a + b over disk tensors of the same shape and dtype
+ * @return 0 on success, -1 on failure
+ *
+ * tensr_disk_sub(), tensr_disk_mul() and tensr_disk_div() work the same way.
+ * out may be a or b.
+ */
+int tensr_disk_add(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b) {
+    return disk_binary(out, a, b, tensr_add);
+}
+
+int tensr_disk_sub(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b) {
+    return disk_binary(out, a, b, tensr_sub);
+}
+
+int tensr_disk_mul(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b) {
+    return disk_binary(out, a, b, tensr_mul);
+}
+
+int tensr_disk_div(TensrDiskTensor* out, TensrDiskTensor* a, TensrDiskTensor* b) {
+    return disk_binary(out, a, b, tensr_div);
+}
+
+static Tensor* map_matmul(Tensor** blocks, size_t n, void* ctx) {
+    (void)n;
+    return tensr_matmul(blocks[0], (const Tensor*)ctx);
+}
+
+/**
+ * @brief Matrix product out = a @ b of a disk matrix and an in-memory matrix
+ * @param out Disk tensor of shape {M, N}
+ * @param a Disk tensor of shape {M, K}
+ * @param b In-memory tensor of shape {K, N}
+ * @return 0 on success, -1 on a shape or dtype mismatch or an I/O failure
+ *
+ * Streams blocks of rows of a, so M may be arbitrarily large.
+ *
+ * Example:
+ *   tensr_disk_matmul(logits, features, w);   (features {1e9, 256}, w {256, 10})
+ */
+int tensr_disk_matmul(TensrDiskTensor* out, TensrDiskTensor* a, const Tensor* b) {
+    const FmtHeader* ha = &a->header;
+    const FmtHeader* ho = &out->header;
+    if (ha->ndim != 2 || b->ndim != 2 || ho->ndim != 2 || ha->shape[1] != b->shape[0] ||
+        ho->shape[0] != ha->shape[0] || ho->shape[1] != b->shape[1] ||
+        ha->dtype != b->dtype || ho->dtype != b->dtype) {
+        return -1;
+    }
+    return tensr_disk_map(out, &a, 1, map_matmul, (void*)b);
+}
+
+/* Fold a block into a running sum, maximum or minimum; sums keep four
+   partial accumulators so consecutive additions do not wait on each other */
+#define DISK_FOLD(name, T)                                                    \
+    static double name(const T* p, size_t n, DiskReduce kind, double acc) {   \
+        size_t i = 0;                                                         \
+        if (kind == DISK_MAX) {                                               \
+            for (; i < n; i++) acc = p[i] > acc ? p[i] : acc;                 \
+        } else if (kind == DISK_MIN) {                                        \
+            for (; i < n; i++) acc = p[i] < acc ? p[i] : acc;                 \
+        } else {                                                              \
+            double s[4] = {0.0, 0.0, 0.0, 0.0};                               \
+            for (; i + 4 <= n; i += 4) {                                      \
+                for (size_t k = 0; k < 4; k++) s[k] += p[i + k];              \
+            }                                                                 \
+            for (; i < n; i++) s[0] += p[i];                                  \
+            acc += (s[0] + s[1]) + (s[2] + s[3]);                             \
+        }                                                                     \
+        return acc;                                                           \
+    }
+
+DISK_FOLD(fold_f32, float)
+DISK_FOLD(fold_f64, double)
+
+/**
+ * @brief Reduce a whole disk tensor, one block at a time
+ *
+ * Sums accumulate in double precision across the whole tensor, so a float32
+ * total stays accurate over billions of elements.
+ */
+static Tensor* disk_reduce(TensrDiskTensor* d, DiskReduce kind, size_t naxes, bool keepdims) {
+    TensrDType dtype = d->header.dtype;
+    if (naxes != 0 || (dtype != TENSR_FLOAT32 && dtype != TENSR_FLOAT64)) return NULL;
+    bool f32 = dtype == TENSR_FLOAT32;
+    double acc = kind == DISK_MAX ? -INFINITY : kind == DISK_MIN ? INFINITY : 0.0;
+
+    size_t nrows = d->header.shape[0];
+    size_t rows = block_rows(&d, 1);
+    for (size_t row = 0; row < nrows; row += rows) {
+        size_t n = rows < nrows - row ? rows : nrows - row;
+        Tensor* block = tensr_disk_read(d, row, n);
+        prefetch_row(d, row + n);
+        if (!block) return NULL;
+        if (f32) acc = fold_f32((const float*)block->data, block->size, kind, acc);
+        else acc = fold_f64((const double*)block->data, block->size, kind, acc);
+        tensr_free(block);
+    }
+    if (kind == DISK_MEAN) {
+        uint64_t count = d->header.data_bytes / tensr_dtype_size(dtype);
+        acc /= (double)count;
+    }
+
+    size_t shape[FMT_MAX_NDIM];
+    for (size_t i = 0; i < FMT_MAX_NDIM; i++) shape[i] = 1;
+    Tensor* result = tensr_create(shape, keepdims ? d->header.ndim : 1, dtype, TENSR_CPU);
+    if (!result) return NULL;
+    if (f32) ((float*)result->data)[0] = (float)acc;
+    else ((double*)result->data)[0] = acc;
+    return result;
+}
+
+/**
+ * @brief Sum of all elements of a disk tensor
+ * @param d Disk tensor of float32 or float64
+ * @param axes Axes to reduce (only NULL, for all axes, is supported)
+ * @param naxes Number of axes (0 for all)
+ * @param keepdims Keep every dimension with size 1
+ * @return New in-memory tensor holding the sum, or NULL on failure
+ *
+ * The tensor is streamed through the cache in blocks of rows, so this runs
+ * in bounded memory however large the file is. tensr_disk_mean(),
+ * tensr_disk_max() and tensr_disk_min() work the same way.
+ *
+ * Example:
+ *   TensrDiskTensor* x = tensr_disk_open("huge.tsr", NULL, 0);
+ *   Tensor* total = tensr_disk_sum(x, NULL, 0, false);
+ */
+Tensor* tensr_disk_sum(TensrDiskTensor* d, int* axes, size_t naxes, bool keepdims) {
+    (void)axes;
+    return disk_reduce(d, DISK_SUM, naxes, keepdims);
+}
+
+Tensor* tensr_disk_mean(TensrDiskTensor* d, int* axes, size_t naxes, bool keepdims) {
+    (void)axes;
+    return disk_reduce(d, DISK_MEAN, naxes, keepdims);
+}
+
+Tensor* tensr_disk_max(TensrDiskTensor* d, int* axes, size_t naxes, bool keepdims) {
+    (void)axes;
+    return disk_reduce(d, DISK_MAX, naxes, keepdims);
+}
+
+Tensor* tensr_disk_min(TensrDiskTensor* d, int* axes, size_t naxes, bool keepdims) {
+    (void)axes;
+    return disk_reduce(d, DISK_MIN, naxes, keepdims);
+}
@@ -0,0 +1,338 @@
+/**
+ * @file file.c
+ * @brief Portable memory mappings shared by mapped tensors
+ * @author Muhammad Fiaz
+ *
+ * Mapped tensors are tracked in a small registry keyed by the Tensor pointer,
+ * so tensr_free() can tell them apart from views, which also do not own
+ * their data. Pages are faulted in on demand, and read-only mappings share
+ * the page cache with every other process that maps the same file.
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "file.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct IoMapping {
+    void* base;
+    size_t size;
+    size_t refs;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+};
+
+/* Registry entry linking a mapped tensor to its mapping */
+typedef struct MappedTensor {
+    const Tensor* tensor;
+    IoMapping* mapping;
+    struct MappedTensor* next;
+} MappedTensor;
+
+static IoMutex registry_lock = IO_MUTEX_INIT;
+static MappedTensor* registry = NULL;
+
+bool io_fseek(FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool io_file_open(IoFile* f, const char* path) {
+#ifdef _WIN32
+    f->handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+    return f->handle != INVALID_HANDLE_VALUE;
+#else
+    f->fd = open(path, O_RDONLY);
+    return f->fd >= 0;
+#endif
+}
+
+bool io_file_open_rw(IoFile* f, const char* path, bool create) {
+#ifdef _WIN32
+    f->handle = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                            create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    return f->handle != INVALID_HANDLE_VALUE;
+#else
+    f->fd = open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+    return f->fd >= 0;
+#endif
+}
+
+bool io_file_size(const IoFile* f, uint64_t* size) {
+#ifdef _WIN32
+    LARGE_INTEGER s;
+    if (!GetFileSizeEx(f->handle, &s)) return false;
+    *size = (uint64_t)s.QuadPart;
+#else
+    struct stat st;
+    if (fstat(f->fd, &st) != 0) return false;
+    *size = (uint64_t)st.st_size;
+#endif
+    return true;
+}
+
+/* Largest single read or write request; larger transfers are split */
+#define IO_MAX_TRANSFER ((size_t)1 << 30)
+
+bool io_pread(const IoFile* f, void* buf, size_t len, uint64_t offset) {
+    unsigned char* p = (unsigned char*)buf;
+    while (len > 0) {
+        size_t want = len < IO_MAX_TRANSFER ? len : IO_MAX_TRANSFER;
+#ifdef _WIN32
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD got = 0;
+        if (!ReadFile(f->handle, p, (DWORD)want, &got, &ov) || got == 0) return false;
+#else
+        ssize_t got = pread(f->fd, p, want, (off_t)offset);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+#endif
+        p += got;
+        len -= (size_t)got;
+        offset += (uint64_t)got;
+    }
+    return true;
+}
+
+bool io_pwrite(const IoFile* f, const void* buf, size_t len, uint64_t offset) {
+    const unsigned char* p = (const unsigned char*)buf;
+    while (len > 0) {
+        size_t want = len < IO_MAX_TRANSFER ? len : IO_MAX_TRANSFER;
+#ifdef _WIN32
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD put = 0;
+        if (!WriteFile(f->handle, p, (DWORD)want, &put, &ov) || put == 0) return false;
+#else
+        ssize_t put = pwrite(f->fd, p, want, (off_t)offset);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) return false;
+#endif
+        p += put;
+        len -= (size_t)put;
+        offset += (uint64_t)put;
+    }
+    return true;
+}
+
+void io_file_close(IoFile* f) {
+#ifdef _WIN32
+    CloseHandle(f->handle);
+#else
+    close(f->fd);
+#endif
+}
+
+#ifdef _WIN32
+typedef struct {
+    void (*fn)(void);
+} OnceFn;
+
+static BOOL CALLBACK once_main(PINIT_ONCE once, PVOID arg, PVOID* ctx) {
+    (void)once;
+    (void)ctx;
+    ((OnceFn*)arg)->fn();
+    return TRUE;
+}
+
+void io_once(IoOnce* once, void (*fn)(void)) {
+    OnceFn f = {fn};
+    InitOnceExecuteOnce(once, once_main, &f, NULL);
+}
+#else
+void io_once(IoOnce* once, void (*fn)(void)) {
+    pthread_once(once, fn);
+}
+#endif
+
+#ifdef _WIN32
+static DWORD WINAPI thread_main(LPVOID arg) {
+    IoThread* t = (IoThread*)arg;
+    t->fn(t->arg);
+    return 0;
+}
+#else
+static void* thread_main(void* arg) {
+    IoThread* t = (IoThread*)arg;
+    t->fn(t->arg);
+    return NULL;
+}
+#endif
+
+bool io_thread_start(IoThread* t, void (*fn)(void* arg), void* arg) {
+    t->fn = fn;
+    t->arg = arg;
+#ifdef _WIN32
+    t->handle = CreateThread(NULL, 0, thread_main, t, 0, NULL);
+    return t->handle != NULL;
+#else
+    return pthread_create(&t->thread, NULL, thread_main, t) == 0;
+#endif
+}
+
+void io_thread_join(IoThread* t) {
+#ifdef _WIN32
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+#else
+    pthread_join(t->thread, NULL);
+#endif
+}
+
+IoMapping* io_map_file(const char* path, TensrMapMode mode) {
+    IoMapping* m = (IoMapping*)calloc(1, sizeof(IoMapping));
+    if (!m) return NULL;
+    m->refs = 1;
+#ifdef _WIN32
+    bool cow = mode == TENSR_MAP_COPY_ON_WRITE;
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        free(m);
+        return NULL;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        free(m);
+        return NULL;
+    }
+    m->size = (size_t)size.QuadPart;
+    m->mapping = CreateFileMappingA(file, NULL, cow ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!m->mapping) {
+        free(m);
+        return NULL;
+    }
+    m->base = MapViewOfFile(m->mapping, cow ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (!m->base) {
+        CloseHandle(m->mapping);
+        free(m);
+        return NULL;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        free(m);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        free(m);
+        return NULL;
+    }
+    m->size = (size_t)st.st_size;
+    if (mode == TENSR_MAP_COPY_ON_WRITE) {
+        m->base = mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    } else {
+        m->base = mmap(NULL, m->size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (m->base == MAP_FAILED) {
+        free(m);
+        return NULL;
+    }
+#endif
+    return m;
+}
+
+const unsigned char* io_mapping_data(const IoMapping* m) {
+    return (const unsigned char*)m->base;
+}
+
+size_t io_mapping_size(const IoMapping* m) {
+    return m->size;
+}
+
+void io_mapping_unref(IoMapping* m) {
+    io_mutex_lock(&registry_lock);
+    bool last = --m->refs == 0;
+    io_mutex_unlock(&registry_lock);
+    if (!last) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m->base);
+    CloseHandle(m->mapping);
+#else
+    munmap(m->base, m->size);
+#endif
+    free(m);
+}
+
+Tensor* io_tensor_from_mapping(IoMapping* m, size_t offset, const size_t* shape, size_t ndim,
+                               TensrDType dtype) {
+    MappedTensor* entry = (MappedTensor*)malloc(sizeof(MappedTensor));
+    Tensor* t = (Tensor*)malloc(sizeof(Tensor));
+    size_t* sh = (size_t*)malloc((ndim ? ndim : 1) * sizeof(size_t));
+    size_t* st = (size_t*)malloc((ndim ? ndim : 1) * sizeof(size_t));
+    if (!entry || !t || !sh || !st) {
+        free(entry);
+        free(t);
+        free(sh);
+        free(st);
+        return NULL;
+    }
+
+    size_t size = 1;
+    for (size_t i = ndim; i-- > 0;) {
+        sh[i] = shape[i];
+        st[i] = size;
+        size *= shape[i];
+    }
+    t->data = (void*)(io_mapping_data(m) + offset);
+    t->shape = sh;
+    t->strides = st;
+    t->ndim = ndim;
+    t->size = size;
+    t->dtype = dtype;
+    t->device = TENSR_CPU;
+    t->device_id = 0;
+    t->owns_data = false;
+    t->requires_grad = false;
+    t->grad = NULL;
+    t->autograd = NULL;
+
+    entry->tensor = t;
+    entry->mapping = m;
+    io_mutex_lock(&registry_lock);
+    m->refs++;
+    entry->next = registry;
+    registry = entry;
+    io_mutex_unlock(&registry_lock);
+    return t;
+}
+
+bool io_release_mapped(Tensor* t) {
+    io_mutex_lock(&registry_lock);
+    MappedTensor** link = &registry;
+    while (*link && (*link)->tensor != t) link = &(*link)->next;
+    MappedTensor* entry = *link;
+    if (entry) *link = entry->next;
+    io_mutex_unlock(&registry_lock);
+    if (!entry) return false;
+    io_mapping_unref(entry->mapping);
+    free(entry);
+    return true;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file file.h
+ * @brief Internal portable file access, memory mappings and threads for tensor I/O
+ * @author Muhammad Fiaz
+ *
+ * Wraps the POSIX and Windows APIs for opening files and mapping them into
+ * memory. A mapping is reference counted and can back any number of tensors.
+ * Tensors created by io_tensor_from_mapping() do not own their data.
+ * tensr_free() hands them to io_release_mapped(), which drops the tensor's
+ * reference and unmaps the file when the last tensor goes away.
+ */
+
+#ifndef TENSR_IO_FILE_H
+#define TENSR_IO_FILE_H
+
+#include "tensr/tensr.h"
+#include <stdio.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef SRWLOCK IoMutex;
+#define IO_MUTEX_INIT SRWLOCK_INIT
+#define io_mutex_init(m) InitializeSRWLock(m)
+#define io_mutex_destroy(m) ((void)(m))
+#define io_mutex_lock(m) AcquireSRWLockExclusive(m)
+#define io_mutex_unlock(m) ReleaseSRWLockExclusive(m)
+typedef CONDITION_VARIABLE IoCond;
+#define io_cond_init(c) InitializeConditionVariable(c)
+#define io_cond_destroy(c) ((void)(c))
+#define io_cond_wait(c, m) SleepConditionVariableSRW((c), (m), INFINITE, 0)
+#define io_cond_broadcast(c) WakeAllConditionVariable(c)
+typedef INIT_ONCE IoOnce;
+#define IO_ONCE_INIT INIT_ONCE_STATIC_INIT
+#else
+#include <pthread.h>
+typedef pthread_mutex_t IoMutex;
+#define IO_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#define io_mutex_init(m) pthread_mutex_init((m), NULL)
+#define io_mutex_destroy(m) pthread_mutex_destroy(m)
+#define io_mutex_lock(m) pthread_mutex_lock(m)
+#define io_mutex_unlock(m) pthread_mutex_unlock(m)
+typedef pthread_cond_t IoCond;
+#define io_cond_init(c) pthread_cond_init((c), NULL)
+#define io_cond_destroy(c) pthread_cond_destroy(c)
+#define io_cond_wait(c, m) pthread_cond_wait((c), (m))
+#define io_cond_broadcast(c) pthread_cond_broadcast(c)
+typedef pthread_once_t IoOnce;
+#define IO_ONCE_INIT PTHREAD_ONCE_INIT
+#endif
+
+/**
+ * @brief Run fn exactly once per IoOnce; concurrent callers wait until it returns
+ */
+void io_once(IoOnce* once, void (*fn)(void));
+
+/* Background thread running fn(arg) */
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t thread;
+#endif
+    void (*fn)(void* arg);
+    void* arg;
+} IoThread;
+
+/**
+ * @brief Start a thread
+ * @param t Thread record; must stay valid until io_thread_join()
+ * @return true on success
+ */
+bool io_thread_start(IoThread* t, void (*fn)(void* arg), void* arg);
+
+/**
+ * @brief Wait for a thread started by io_thread_start() to return
+ */
+void io_thread_join(IoThread* t);
+
+/**
+ * @brief Seek a stdio stream to an absolute 64-bit offset
+ * @return true on success
+ */
+bool io_fseek(FILE* f, uint64_t offset);
+
+/* File handle for positional reads, safe to share between threads */
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif
+} IoFile;
+
+/**
+ * @brief Open a file for positional reads
+ * @return true on success
+ */
+bool io_file_open(IoFile* f, const char* path);
+
+/**
+ * @brief Open a file for positional reads and writes
+ * @param create Create the file, or truncate it if it exists
+ * @return true on success
+ */
+bool io_file_open_rw(IoFile* f, const char* path, bool create);
+
+/**
+ * @brief Size of an open file in bytes
+ */
+bool io_file_size(const IoFile* f, uint64_t* size);
+
+/**
+ * @brief Read exactly len bytes at an absolute offset without moving any file position
+ * @return false on error or end of file
+ */
+bool io_pread(const IoFile* f, void* buf, size_t len, uint64_t offset);
+
+/**
+ * @brief Write exactly len bytes at an absolute offset, extending the file if needed
+ * @return false on error
+ */
+bool io_pwrite(const IoFile* f, const void* buf, size_t len, uint64_t offset);
+
+void io_file_close(IoFile* f);
+
+/* A whole file mapped into memory, shared by the tensors that point into it */
+typedef struct IoMapping IoMapping;
+
+/**
+ * @brief Map a whole file
+ * @param path File to map
+ * @param mode TENSR_MAP_READONLY (shared, read-only pages) or
+ *        TENSR_MAP_COPY_ON_WRITE (private pages, writes never reach the file)
+ * @return Mapping with one reference held by the caller, or NULL on failure
+ */
+IoMapping* io_map_file(const char* path, TensrMapMode mode);
+
+/**
+ * @brief Start of the mapped bytes
+ */
+const unsigned char* io_mapping_data(const IoMapping* m);
+
+/**
+ * @brief Length of the mapping in bytes (the file size)
+ */
+size_t io_mapping_size(const IoMapping* m);
+
+/**
+ * @brief Drop one reference and unmap when none are left
+ */
+void io_mapping_unref(IoMapping* m);
+
+/**
+ * @brief Create a tensor whose data points into a mapping
+ * @param m Mapping; the tensor takes its own reference
+ * @param offset Byte offset of the first element
+ * @return Tensor with owns_data = false, or NULL on failure
+ */
+Tensor* io_tensor_from_mapping(IoMapping* m, size_t offset, const size_t* shape, size_t ndim,
+                               TensrDType dtype);
+
+/**
+ * @brief Release the mapping behind a tensor created by io_tensor_from_mapping()
+ * @param t Tensor passed to tensr_free()
+ * @return true if t was a mapped tensor (its reference has been dropped)
+ */
+bool io_release_mapped(Tensor* t);
+
+#endif /* TENSR_IO_FILE_H */
@@ -0,0 +1,260 @@
+/**
+ * @file format.c
+ * @brief Header encoding, byte order and checksums for the tensor file format
+ * @author Muhammad Fiaz
+ *
+ * The checksum is XXH64 (seed 0), which runs at memory bandwidth, so
+ * verifying a payload costs about as much as reading it.
+ */
+
+#include "format.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define XXH_P1 0x9E3779B185EBCA87ull
+#define XXH_P2 0xC2B2AE3D27D4EB4Full
+#define XXH_P3 0x165667B19E3779F9ull
+#define XXH_P4 0x85EBCA77C2B2AE63ull
+#define XXH_P5 0x27D4EB2F165667C5ull
+
+/* On-disk dtype codes, independent of the TensrDType enum values */
+enum {
+    FMT_DTYPE_FLOAT32 = 1,
+    FMT_DTYPE_FLOAT64 = 2,
+    FMT_DTYPE_INT32 = 3,
+    FMT_DTYPE_INT64 = 4,
+    FMT_DTYPE_UINT8 = 5,
+    FMT_DTYPE_BOOL = 6
+};
+
+int fmt_dtype_code(TensrDType dtype) {
+    switch (dtype) {
+        case TENSR_FLOAT32: return FMT_DTYPE_FLOAT32;
+        case TENSR_FLOAT64: return FMT_DTYPE_FLOAT64;
+        case TENSR_INT32: return FMT_DTYPE_INT32;
+        case TENSR_INT64: return FMT_DTYPE_INT64;
+        case TENSR_UINT8: return FMT_DTYPE_UINT8;
+        case TENSR_BOOL: return FMT_DTYPE_BOOL;
+        default: return 0;
+    }
+}
+
+bool fmt_dtype_from_code(int code, TensrDType* dtype) {
+    switch (code) {
+        case FMT_DTYPE_FLOAT32: *dtype = TENSR_FLOAT32; return true;
+        case FMT_DTYPE_FLOAT64: *dtype = TENSR_FLOAT64; return true;
+        case FMT_DTYPE_INT32: *dtype = TENSR_INT32; return true;
+        case FMT_DTYPE_INT64: *dtype = TENSR_INT64; return true;
+        case FMT_DTYPE_UINT8: *dtype = TENSR_UINT8; return true;
+        case FMT_DTYPE_BOOL: *dtype = TENSR_BOOL; return true;
+        default: return false;
+    }
+}
+
+bool fmt_has_magic(const unsigned char* p, size_t len) {
+    return len >= FMT_MAGIC_SIZE && memcmp(p, FMT_MAGIC, FMT_MAGIC_SIZE) == 0;
+}
+
+size_t fmt_header_size(size_t ndim) {
+    return FMT_FIXED_SIZE + 8 * ndim;
+}
+
+bool fmt_init_header(FmtHeader* h, const size_t* shape, size_t ndim, TensrDType dtype,
+                     size_t alignment) {
+    if (alignment == 0) alignment = FMT_DEFAULT_ALIGNMENT;
+    if (alignment & (alignment - 1) || alignment < 8 || alignment > FMT_MAX_ALIGNMENT) return false;
+    if (ndim > FMT_MAX_NDIM || fmt_dtype_code(dtype) == 0) return false;
+
+    memset(h, 0, sizeof(*h));
+    h->version = FMT_VERSION;
+    h->dtype = dtype;
+    h->ndim = ndim;
+    h->alignment = (uint32_t)alignment;
+    uint64_t count = 1;
+    for (size_t i = 0; i < ndim; i++) {
+        h->shape[i] = shape[i];
+        count *= shape[i];
+    }
+    h->data_bytes = count * tensr_dtype_size(dtype);
+    h->data_offset = (fmt_header_size(ndim) + alignment - 1) / alignment * alignment;
+    return true;
+}
+
+void fmt_encode_header(const FmtHeader* h, unsigned char* out) {
+    memset(out, 0, FMT_FIXED_SIZE);
+    memcpy(out, FMT_MAGIC, FMT_MAGIC_SIZE);
+    fmt_put_u16(out + 8, h->version);
+    fmt_put_u16(out + 10, h->flags);
+    out[12] = (unsigned char)fmt_dtype_code(h->dtype);
+    fmt_put_u16(out + 14, (uint16_t)h->ndim);
+    fmt_put_u32(out + 16, h->alignment);
+    fmt_put_u64(out + 24, h->data_offset);
+    fmt_put_u64(out + 32, h->data_bytes);
+    fmt_put_u64(out + 40, h->checksum);
+    for (size_t i = 0; i < h->ndim; i++) fmt_put_u64(out + FMT_FIXED_SIZE + 8 * i, h->shape[i]);
+}
+
+bool fmt_decode_header(const unsigned char* p, size_t len, FmtHeader* h) {
+    if (len < FMT_FIXED_SIZE || !fmt_has_magic(p, len)) return false;
+    memset(h, 0, sizeof(*h));
+    h->version = fmt_get_u16(p + 8);
+    h->flags = fmt_get_u16(p + 10);
+    h->ndim = fmt_get_u16(p + 14);
+    h->alignment = fmt_get_u32(p + 16);
+    h->data_offset = fmt_get_u64(p + 24);
+    h->data_bytes = fmt_get_u64(p + 32);
+    h->checksum = fmt_get_u64(p + 40);
+    bool chunked = (h->flags & FMT_FLAG_CHUNKED) != 0;
+    if (h->version != (chunked ? FMT_VERSION_CHUNKED : FMT_VERSION)) return false;
+    if (!fmt_dtype_from_code(p[12], &h->dtype)) return false;
+    if (h->ndim > FMT_MAX_NDIM || len < fmt_header_size(h->ndim)) return false;
+    if (h->alignment == 0 || (h->alignment & (h->alignment - 1))) return false;
+    if (h->data_offset < fmt_header_size(h->ndim) || h->data_offset % h->alignment) return false;
+
+    uint64_t count = 1;
+    for (size_t i = 0; i < h->ndim; i++) {
+        uint64_t d = fmt_get_u64(p + FMT_FIXED_SIZE + 8 * i);
+        if (d > SIZE_MAX) return false;
+        h->shape[i] = (size_t)d;
+        if (d != 0 && count > UINT64_MAX / d) return false;
+        count *= d;
+    }
+    size_t esize = tensr_dtype_size(h->dtype);
+    return count <= UINT64_MAX / esize && h->data_bytes == count * esize;
+}
+
+bool fmt_host_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const unsigned char*)&probe == 1;
+}
+
+void fmt_swap_elements(void* data, size_t n, size_t esize) {
+    unsigned char* p = (unsigned char*)data;
+    for (size_t i = 0; i < n; i++, p += esize) {
+        for (size_t a = 0, b = esize - 1; a < b; a++, b--) {
+            unsigned char tmp = p[a];
+            p[a] = p[b];
+            p[b] = tmp;
+        }
+    }
+}
+
+/* Bytes staged per write when the payload has to be byte-swapped */
+#define FMT_SWAP_CHUNK (1u << 20)
+
+bool fmt_write_payload(FILE* f, const void* data, size_t n, size_t esize, FmtHash* hash) {
+    const unsigned char* p = (const unsigned char*)data;
+    size_t bytes = n * esize;
+    if (fmt_host_little_endian() || esize == 1) {
+        if (hash) fmt_hash_update(hash, p, bytes);
+        return fwrite(p, 1, bytes, f) == bytes;
+    }
+    unsigned char* buf = (unsigned char*)malloc(FMT_SWAP_CHUNK);
+    if (!buf) return false;
+    bool ok = true;
+    size_t step = FMT_SWAP_CHUNK / esize * esize;
+    for (size_t off = 0; ok && off < bytes; off += step) {
+        size_t len = bytes - off < step ? bytes - off : step;
+        memcpy(buf, p + off, len);
+        fmt_swap_elements(buf, len / esize, esize);
+        if (hash) fmt_hash_update(hash, buf, len);
+        ok = fwrite(buf, 1, len, f) == len;
+    }
+    free(buf);
+    return ok;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_P2;
+    return rotl64(acc, 31) * XXH_P1;
+}
+
+static inline uint64_t xxh_merge(uint64_t acc, uint64_t v) {
+    acc ^= xxh_round(0, v);
+    return acc * XXH_P1 + XXH_P4;
+}
+
+void fmt_hash_init(FmtHash* s) {
+    s->v[0] = XXH_P1 + XXH_P2;
+    s->v[1] = XXH_P2;
+    s->v[2] = 0;
+    s->v[3] = 0 - XXH_P1;
+    s->total = 0;
+    s->buffered = 0;
+}
+
+void fmt_hash_update(FmtHash* s, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    s->total += len;
+    if (s->buffered + len < 32) {
+        memcpy(s->buf + s->buffered, p, len);
+        s->buffered += len;
+        return;
+    }
+    if (s->buffered) {
+        size_t fill = 32 - s->buffered;
+        memcpy(s->buf + s->buffered, p, fill);
+        for (int i = 0; i < 4; i++) s->v[i] = xxh_round(s->v[i], fmt_get_u64(s->buf + 8 * i));
+        p += fill;
+        len -= fill;
+        s->buffered = 0;
+    }
+    uint64_t v0 = s->v[0], v1 = s->v[1], v2 = s->v[2], v3 = s->v[3];
+    for (; len >= 32; p += 32, len -= 32) {
+        v0 = xxh_round(v0, fmt_get_u64(p));
+        v1 = xxh_round(v1, fmt_get_u64(p + 8));
+        v2 = xxh_round(v2, fmt_get_u64(p + 16));
+        v3 = xxh_round(v3, fmt_get_u64(p + 24));
+    }
+    s->v[0] = v0;
+    s->v[1] = v1;
+    s->v[2] = v2;
+    s->v[3] = v3;
+    memcpy(s->buf, p, len);
+    s->buffered = len;
+}
+
+uint64_t fmt_hash_digest(const FmtHash* s) {
+    uint64_t h;
+    if (s->total >= 32) {
+        h = rotl64(s->v[0], 1) + rotl64(s->v[1], 7) + rotl64(s->v[2], 12) + rotl64(s->v[3], 18);
+        for (int i = 0; i < 4; i++) h = xxh_merge(h, s->v[i]);
+    } else {
+        h = XXH_P5;
+    }
+    h += s->total;
+
+    const unsigned char* p = s->buf;
+    size_t len = s->buffered;
+    for (; len >= 8; p += 8, len -= 8) {
+        h ^= xxh_round(0, fmt_get_u64(p));
+        h = rotl64(h, 27) * XXH_P1 + XXH_P4;
+    }
+    if (len >= 4) {
+        h ^= (uint64_t)fmt_get_u32(p) * XXH_P1;
+        h = rotl64(h, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len > 0; p++, len--) {
+        h ^= *p * XXH_P5;
+        h = rotl64(h, 11) * XXH_P1;
+    }
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t fmt_checksum(const void* data, size_t len) {
+    FmtHash s;
+    fmt_hash_init(&s);
+    fmt_hash_update(&s, data, len);
+    return fmt_hash_digest(&s);
+}
@@ -0,0 +1,173 @@
+/**
+ * @file format.h
+ * @brief Internal encoding of the versioned on-disk tensor format
+ * @author Muhammad Fiaz
+ *
+ * Layout (all integers little-endian):
+ *
+ *   offset  size  field
+ *        0     8  magic "TENSR\r\n\x1a"
+ *        8     2  format version
+ *       10     2  flags (FMT_FLAG_CHECKSUM, FMT_FLAG_CHUNKED)
+ *       12     1  dtype code (FMT_DTYPE_*)
+ *       13     1  reserved, 0
+ *       14     2  ndim
+ *       16     4  payload alignment in bytes
+ *       20     4  reserved, 0
+ *       24     8  payload offset (a multiple of the alignment)
+ *       32     8  payload size in bytes
+ *       40     8  XXH64 of the payload (0 when FMT_FLAG_CHECKSUM is clear)
+ *       48  8*nd  shape
+ *
+ * Zero padding follows up to the payload offset. The payload is the row-major
+ * elements, also little-endian. The \r\n\x1a in the magic catch files
+ * mangled by text-mode transfers.
+ *
+ * Files with FMT_FLAG_CHUNKED store compressed chunks at the payload offset
+ * instead (see chunk.h) and are written as version 2, so that readers which
+ * only know version 1 reject them. The payload size is still the
+ * uncompressed size.
+ */
+
+#ifndef TENSR_IO_FORMAT_H
+#define TENSR_IO_FORMAT_H
+
+#include "tensr/tensr.h"
+#include <stdio.h>
+
+#define FMT_MAGIC "TENSR\r\n\x1a"
+#define FMT_MAGIC_SIZE 8
+#define FMT_VERSION 1
+#define FMT_VERSION_CHUNKED 2
+#define FMT_FIXED_SIZE 48
+#define FMT_MAX_NDIM 32
+#define FMT_DEFAULT_ALIGNMENT 64
+#define FMT_MAX_ALIGNMENT (1u << 20)
+
+#define FMT_FLAG_CHECKSUM 0x1u
+#define FMT_FLAG_CHUNKED 0x2u
+
+/* Decoded header of a tensor file */
+typedef struct {
+    uint16_t version;
+    uint16_t flags;
+    TensrDType dtype;
+    size_t ndim;
+    uint32_t alignment;
+    uint64_t data_offset;
+    uint64_t data_bytes;
+    uint64_t checksum;
+    size_t shape[FMT_MAX_NDIM];
+} FmtHeader;
+
+/* Streaming XXH64 state */
+typedef struct {
+    uint64_t v[4];
+    uint64_t total;
+    unsigned char buf[32];
+    size_t buffered;
+} FmtHash;
+
+/**
+ * @brief On-disk code of a dtype (0 if the dtype cannot be stored)
+ */
+int fmt_dtype_code(TensrDType dtype);
+
+/**
+ * @brief Dtype of an on-disk code
+ * @return false for unknown codes
+ */
+bool fmt_dtype_from_code(int code, TensrDType* dtype);
+
+/**
+ * @brief Check whether a buffer starts with the format magic
+ */
+bool fmt_has_magic(const unsigned char* p, size_t len);
+
+/**
+ * @brief Fill a header for a tensor's shape and dtype
+ * @param alignment Payload alignment, a power of two (0 for the default)
+ * @return false if the tensor or alignment cannot be represented
+ */
+bool fmt_init_header(FmtHeader* h, const size_t* shape, size_t ndim, TensrDType dtype,
+                     size_t alignment);
+
+/**
+ * @brief Number of bytes of the encoded header without padding
+ */
+size_t fmt_header_size(size_t ndim);
+
+/**
+ * @brief Encode a header
+ * @param out Buffer of at least fmt_header_size(h->ndim) bytes
+ */
+void fmt_encode_header(const FmtHeader* h, unsigned char* out);
+
+/**
+ * @brief Decode and validate a header
+ * @param p Start of the file
+ * @param len Number of bytes available at p
+ * @return false if the magic, version, dtype or sizes are invalid, or if
+ *         len is too short to hold the shape
+ */
+bool fmt_decode_header(const unsigned char* p, size_t len, FmtHeader* h);
+
+/**
+ * @brief True when the host stores integers little-endian
+ */
+bool fmt_host_little_endian(void);
+
+/**
+ * @brief Reverse the bytes of n elements of esize bytes in place
+ */
+void fmt_swap_elements(void* data, size_t n, size_t esize);
+
+void fmt_hash_init(FmtHash* s);
+void fmt_hash_update(FmtHash* s, const void* data, size_t len);
+uint64_t fmt_hash_digest(const FmtHash* s);
+
+/**
+ * @brief Write n elements in little-endian order, hashing the written bytes
+ * @param hash Running checksum, or NULL
+ * @return true if every byte was written
+ */
+bool fmt_write_payload(FILE* f, const void* data, size_t n, size_t esize, FmtHash* hash);
+
+/**
+ * @brief XXH64 (seed 0) of a buffer
+ */
+uint64_t fmt_checksum(const void* data, size_t len);
+
+/**
+ * @brief Little-endian integer helpers
+ */
+static inline void fmt_put_u16(unsigned char* p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static inline void fmt_put_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static inline void fmt_put_u64(unsigned char* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static inline uint16_t fmt_get_u16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t fmt_get_u32(const unsigned char* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline uint64_t fmt_get_u64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+#endif /* TENSR_IO_FORMAT_H */
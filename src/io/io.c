@@ -8,8 +8,80 @@
  */
 
 #include "tensr/tensr.h"
+#include "file.h"
+#include "format.h"
+#include "chunk.h"
+#include "../core/parallel.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/**
+ * @brief Save tensor to binary file with explicit options
+ * @param filename Path to output file
+ * @param t Tensor to save
+ * @param opts Options, or NULL for the defaults (64-byte alignment, no checksum)
+ * @return 0 on success, -1 on failure
+ *
+ * Writes the versioned tensr format: a magic number, little-endian
+ * fixed-width header fields and the payload at an aligned offset, so the
+ * file can be memory-mapped directly on any platform. With opts->checksum
+ * an XXH64 checksum of the payload is stored and verified by tensr_load().
+ *
+ * With opts->codec = TENSR_CODEC_LZ the payload is split into chunks of
+ * opts->chunk_size bytes, each filtered and compressed independently and in
+ * parallel, behind a chunk index (see chunk.c). Such files are smaller and
+ * still support tensr_load_slice(), but tensr_load_mmap() has to decompress
+ * them. With checksums, every chunk and the index get their own XXH64.
+ *
+ * Example:
+ *   TensrSaveOptions opts = {.alignment = 4096, .checksum = true};
+ *   tensr_save_ex("weights.bin", w, &opts);
+ *   TensrSaveOptions packed = {.checksum = true, .codec = TENSR_CODEC_LZ};
+ *   tensr_save_ex("activations.bin", acts, &packed);
+ */
+int tensr_save_ex(const char* filename, const Tensor* t, const TensrSaveOptions* opts) {
+    FmtHeader h;
+    size_t alignment = opts ? opts->alignment : 0;
+    if (!fmt_init_header(&h, t->shape, t->ndim, t->dtype, alignment)) return -1;
+    bool checksum = opts && opts->checksum;
+    bool chunked = opts && opts->codec != TENSR_CODEC_NONE;
+    if (checksum) h.flags |= FMT_FLAG_CHECKSUM;
+    if (chunked) {
+        h.version = FMT_VERSION_CHUNKED;
+        h.flags |= FMT_FLAG_CHUNKED;
+    }
+
+    unsigned char* header = (unsigned char*)calloc(1, (size_t)h.data_offset);
+    if (!header) return -1;
+    fmt_encode_header(&h, header);
+
+    FILE* f = fopen(filename, "wb");
+    if (!f) {
+        free(header);
+        return -1;
+    }
+    FmtHash hash;
+    fmt_hash_init(&hash);
+    uint64_t index_hash = 0;
+    bool ok = fwrite(header, 1, (size_t)h.data_offset, f) == h.data_offset;
+    if (chunked) {
+        ok = ok && chunk_write(f, h.data_offset, t, opts, &index_hash);
+    } else {
+        ok = ok && fmt_write_payload(f, t->data, t->size, tensr_dtype_size(t->dtype),
+                                     checksum ? &hash : NULL);
+    }
+    if (ok && checksum) {
+        /* The checksum is only known after the payload pass; patch it in place */
+        unsigned char sum[8];
+        fmt_put_u64(sum, chunked ? index_hash : fmt_hash_digest(&hash));
+        ok = io_fseek(f, 40) && fwrite(sum, 1, 8, f) == 8;
+    }
+    free(header);
+    if (fclose(f) != 0) ok = false;
+    return ok ? 0 : -1;
+}
 
 /**
  * @brief Save tensor to binary file
@@ -17,25 +89,97 @@
  * @param t Tensor to save
  * @return 0 on success, -1 on failure
  * 
- * Saves tensor metadata (shape, dtype, size) and data to a binary file.
- * The file can be loaded later with tensr_load().
+ * Saves tensor metadata (shape, dtype, size) and data to a binary file in the
+ * versioned tensr format with default options (see tensr_save_ex()).
+ * The file can be loaded later with tensr_load() or tensr_load_mmap().
  * 
  * Example:
  *   Tensor* t = tensr_ones((size_t[]){3, 3}, 2, TENSR_FLOAT32, TENSR_CPU);
  *   tensr_save("tensor.bin", t);
  */
 int tensr_save(const char* filename, const Tensor* t) {
-    FILE* f = fopen(filename, "wb");
-    if (!f) return -1;
+    return tensr_save_ex(filename, t, NULL);
+}
+
+/**
+ * @brief Load a tensor in the versioned format
+ * @param f File positioned after the FMT_FIXED_SIZE bytes in fixed
+ * @param fixed First FMT_FIXED_SIZE bytes of the file
+ */
+static Tensor* load_versioned(FILE* f, const unsigned char* fixed) {
+    unsigned char header[FMT_FIXED_SIZE + 8 * FMT_MAX_NDIM];
+    memcpy(header, fixed, FMT_FIXED_SIZE);
+    size_t ndim = fmt_get_u16(fixed + 14);
+    if (ndim > FMT_MAX_NDIM) return NULL;
+    if (fread(header + FMT_FIXED_SIZE, 8, ndim, f) != ndim) return NULL;
 
-    fwrite(&t->ndim, sizeof(size_t), 1, f);
-    fwrite(&t->dtype, sizeof(TensrDType), 1, f);
-    fwrite(&t->size, sizeof(size_t), 1, f);
-    fwrite(t->shape, sizeof(size_t), t->ndim, f);
-    fwrite(t->data, tensr_dtype_size(t->dtype), t->size, f);
+    FmtHeader h;
+    if (!fmt_decode_header(header, fmt_header_size(ndim), &h)) return NULL;
+    if (!io_fseek(f, h.data_offset)) return NULL;
 
-    fclose(f);
-    return 0;
+    Tensor* t = tensr_create(h.shape, h.ndim, h.dtype, TENSR_CPU);
+    if (!t) return NULL;
+    size_t esize = tensr_dtype_size(h.dtype);
+    if (fread(t->data, esize, t->size, f) != t->size ||
+        ((h.flags & FMT_FLAG_CHECKSUM) &&
+         fmt_checksum(t->data, (size_t)h.data_bytes) != h.checksum)) {
+        tensr_free(t);
+        return NULL;
+    }
+    if (!fmt_host_little_endian()) fmt_swap_elements(t->data, t->size, esize);
+    return t;
+}
+
+/**
+ * @brief Load a tensor whose payload is stored in compressed chunks
+ */
+static Tensor* load_chunked(const char* filename) {
+    IoFile f;
+    if (!io_file_open(&f, filename)) return NULL;
+    unsigned char header[FMT_FIXED_SIZE + 8 * FMT_MAX_NDIM];
+    FmtHeader h;
+    Tensor* t = NULL;
+    if (io_pread(&f, header, FMT_FIXED_SIZE, 0)) {
+        size_t ndim = fmt_get_u16(header + 14);
+        if (ndim <= FMT_MAX_NDIM && io_pread(&f, header, fmt_header_size(ndim), 0) &&
+            fmt_decode_header(header, fmt_header_size(ndim), &h)) {
+            t = chunk_load(&f, &h);
+        }
+    }
+    io_file_close(&f);
+    return t;
+}
+
+/**
+ * @brief Load a tensor in the legacy format (raw native size_t and enum fields)
+ * @param f File positioned at the start
+ */
+static Tensor* load_legacy(FILE* f) {
+    size_t ndim, size;
+    TensrDType dtype;
+
+    if (fread(&ndim, sizeof(size_t), 1, f) != 1) return NULL;
+    if (fread(&dtype, sizeof(TensrDType), 1, f) != 1) return NULL;
+    if (fread(&size, sizeof(size_t), 1, f) != 1) return NULL;
+    if (tensr_dtype_size(dtype) == 0 || ndim == 0 || ndim > FMT_MAX_NDIM) return NULL;
+
+    size_t* shape = (size_t*)malloc(ndim * sizeof(size_t));
+    if (!shape) return NULL;
+    if (fread(shape, sizeof(size_t), ndim, f) != ndim) {
+        free(shape);
+        return NULL;
+    }
+
+    Tensor* t = tensr_create(shape, ndim, dtype, TENSR_CPU);
+    free(shape);
+
+    if (t) {
+        if (t->size != size || fread(t->data, tensr_dtype_size(dtype), size, f) != size) {
+            tensr_free(t);
+            return NULL;
+        }
+    }
+    return t;
 }
 
 /**
@@ -43,7 +187,10 @@ int tensr_save(const char* filename, const Tensor* t) {
  * @param filename Path to input file
  * @return Loaded tensor, or NULL on failure
  * 
- * Loads a tensor that was previously saved with tensr_save().
+ * Loads a tensor that was previously saved with tensr_save(). Files in the
+ * versioned format are recognized by their magic number; anything else is
+ * read as the legacy format of earlier releases. A stored checksum is
+ * verified, and a mismatch returns NULL.
  * 
  * Example:
  *   Tensor* t = tensr_load("tensor.bin");
@@ -56,32 +203,401 @@ Tensor* tensr_load(const char* filename) {
     FILE* f = fopen(filename, "rb");
     if (!f) return NULL;
 
-    size_t ndim, size;
-    TensrDType dtype;
+    unsigned char fixed[FMT_FIXED_SIZE];
+    size_t got = fread(fixed, 1, FMT_FIXED_SIZE, f);
+    Tensor* t;
+    if (fmt_has_magic(fixed, got)) {
+        if (got == FMT_FIXED_SIZE && (fmt_get_u16(fixed + 10) & FMT_FLAG_CHUNKED)) {
+            fclose(f);
+            return load_chunked(filename);
+        }
+        t = got == FMT_FIXED_SIZE ? load_versioned(f, fixed) : NULL;
+    } else {
+        rewind(f);
+        t = load_legacy(f);
+    }
 
-    if (fread(&ndim, sizeof(size_t), 1, f) != 1) { fclose(f); return NULL; }
-    if (fread(&dtype, sizeof(TensrDType), 1, f) != 1) { fclose(f); return NULL; }
-    if (fread(&size, sizeof(size_t), 1, f) != 1) { fclose(f); return NULL; }
+    fclose(f);
+    return t;
+}
 
-    size_t* shape = (size_t*)malloc(ndim * sizeof(size_t));
-    if (fread(shape, sizeof(size_t), ndim, f) != ndim) {
-        free(shape);
-        fclose(f);
+/**
+ * @brief Parse the legacy header written by earlier tensr_save() versions
+ * @param p Start of the file
+ * @param len File size in bytes
+ * @param shape Output shape, allocated with malloc (caller frees)
+ * @param offset Output byte offset of the payload
+ * @return true if the header is valid and the payload fits in the file
+ */
+static bool parse_legacy_header(const unsigned char* p, size_t len, size_t* ndim,
+                                TensrDType* dtype, size_t** shape, size_t* offset) {
+    size_t fixed = 2 * sizeof(size_t) + sizeof(TensrDType);
+    size_t size;
+    if (len < fixed) return false;
+    memcpy(ndim, p, sizeof(size_t));
+    memcpy(dtype, p + sizeof(size_t), sizeof(TensrDType));
+    memcpy(&size, p + sizeof(size_t) + sizeof(TensrDType), sizeof(size_t));
+    size_t esize = tensr_dtype_size(*dtype);
+    if (esize == 0 || *ndim == 0 || *ndim > (len - fixed) / sizeof(size_t)) return false;
+
+    *offset = fixed + *ndim * sizeof(size_t);
+    *shape = (size_t*)malloc(*ndim * sizeof(size_t));
+    if (!*shape) return false;
+    memcpy(*shape, p + fixed, *ndim * sizeof(size_t));
+    size_t count = 1;
+    for (size_t i = 0; i < *ndim; i++) {
+        if ((*shape)[i] != 0 && count > SIZE_MAX / (*shape)[i]) count = SIZE_MAX;
+        else count *= (*shape)[i];
+    }
+    if (count != size || size > (len - *offset) / esize) {
+        free(*shape);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Load a tensor by memory-mapping the file instead of reading it
+ * @param filename Path to a file written by tensr_save()
+ * @param mode TENSR_MAP_READONLY or TENSR_MAP_COPY_ON_WRITE
+ * @return Tensor whose data points into the mapping, or NULL on failure
+ *
+ * Nothing is read up front: pages are faulted in from the page cache when
+ * they are first touched. With TENSR_MAP_READONLY the pages are shared with
+ * every process mapping the same file, and writing to the tensor crashes.
+ * With TENSR_MAP_COPY_ON_WRITE the tensor is writable, and modified pages
+ * become private copies that are never written back to the file.
+ *
+ * The file is unmapped when the tensor is freed with tensr_free(). Views
+ * such as tensr_reshape() results must be freed before it. Payloads of the
+ * versioned format are always aligned and are mapped without copying; the
+ * checksum is not verified, since that would read the whole file. Legacy
+ * payloads that are not aligned for their dtype are copied into an ordinary
+ * tensor, as are payloads on big-endian hosts. Compressed files are
+ * decompressed with tensr_load().
+ *
+ * Example:
+ *   Tensor* w = tensr_load_mmap("weights.bin", TENSR_MAP_READONLY);
+ *   Tensor* y = tensr_matmul(x, w);
+ *   tensr_free(w);
+ */
+Tensor* tensr_load_mmap(const char* filename, TensrMapMode mode) {
+    IoMapping* m = io_map_file(filename, mode);
+    if (!m) return NULL;
+
+    const unsigned char* base = io_mapping_data(m);
+    size_t len = io_mapping_size(m);
+    size_t ndim, offset;
+    TensrDType dtype;
+    size_t* shape = NULL;
+    FmtHeader h;
+    bool swap = false;
+    if (fmt_has_magic(base, len)) {
+        if (fmt_decode_header(base, len, &h) && (h.flags & FMT_FLAG_CHUNKED)) {
+            /* Compressed chunks cannot be used in place */
+            io_mapping_unref(m);
+            return load_chunked(filename);
+        }
+        if (!fmt_decode_header(base, len, &h) || h.data_offset > len ||
+            h.data_bytes > len - h.data_offset) {
+            io_mapping_unref(m);
+            return NULL;
+        }
+        ndim = h.ndim;
+        dtype = h.dtype;
+        shape = h.shape;
+        offset = (size_t)h.data_offset;
+        swap = !fmt_host_little_endian();
+    } else if (!parse_legacy_header(base, len, &ndim, &dtype, &shape, &offset)) {
+        io_mapping_unref(m);
         return NULL;
     }
 
-    Tensor* t = tensr_create(shape, ndim, dtype, TENSR_CPU);
-    free(shape);
+    Tensor* t;
+    size_t esize = tensr_dtype_size(dtype);
+    if (!swap && (uintptr_t)(base + offset) % esize == 0) {
+        t = io_tensor_from_mapping(m, offset, shape, ndim, dtype);
+    } else {
+        t = tensr_create(shape, ndim, dtype, TENSR_CPU);
+        if (t) {
+            memcpy(t->data, base + offset, t->size * esize);
+            if (swap) fmt_swap_elements(t->data, t->size, esize);
+        }
+    }
+    if (shape != h.shape) free(shape);
+    io_mapping_unref(m);
+    return t;
+}
 
-    if (t) {
-        if (fread(t->data, tensr_dtype_size(dtype), size, f) != size) {
-            tensr_free(t);
-            fclose(f);
+/* Gaps up to this many bytes between runs are read through rather than skipped */
+#define SLICE_GAP (64u * 1024)
+/* Upper bound on a single coalesced read */
+#define SLICE_READ_MAX (4u * 1024 * 1024)
+
+/* Selected region of a stored tensor, decomposed into equal contiguous runs */
+typedef struct {
+    size_t ndim;            /* Dimensions that vary between runs */
+    size_t start[FMT_MAX_NDIM];
+    size_t step[FMT_MAX_NDIM];
+    size_t len[FMT_MAX_NDIM];
+    uint64_t stride[FMT_MAX_NDIM];  /* File stride in bytes */
+    uint64_t base;          /* File offset of the first run */
+    size_t run_bytes;       /* Bytes per run */
+    size_t nruns;
+} SlicePlan;
+
+/* One pread covering runs [first, first + count) */
+typedef struct {
+    uint64_t offset;
+    uint64_t span;
+    size_t first;
+    size_t count;
+    bool ok;
+} SliceRead;
+
+/**
+ * @brief File offset of run j
+ */
+static uint64_t slice_run_offset(const SlicePlan* p, size_t j) {
+    uint64_t off = p->base;
+    for (size_t k = p->ndim; k-- > 0;) {
+        size_t idx = j % p->len[k];
+        j /= p->len[k];
+        off += (uint64_t)(p->start[k] + idx * p->step[k]) * p->stride[k];
+    }
+    return off;
+}
+
+/**
+ * @brief Read the header of a saved tensor without reading its payload
+ * @param h Output header; legacy files fill in the shape, dtype and payload fields
+ * @param swap Set when the payload must be byte-swapped for this host
+ */
+static bool read_stored_header(const IoFile* f, FmtHeader* h, bool* swap) {
+    uint64_t file_size;
+    unsigned char header[FMT_FIXED_SIZE + 8 * FMT_MAX_NDIM];
+    if (!io_file_size(f, &file_size)) return false;
+    size_t got = file_size < FMT_FIXED_SIZE ? (size_t)file_size : FMT_FIXED_SIZE;
+    if (!io_pread(f, header, got, 0)) return false;
+    if (fmt_has_magic(header, got)) {
+        size_t n = fmt_get_u16(header + 14);
+        if (got < FMT_FIXED_SIZE || n > FMT_MAX_NDIM ||
+            !io_pread(f, header, fmt_header_size(n), 0) ||
+            !fmt_decode_header(header, fmt_header_size(n), h) || h->data_offset > file_size) {
+            return false;
+        }
+        *swap = !fmt_host_little_endian();
+        /* Chunked payloads are validated against the file by their index */
+        return (h->flags & FMT_FLAG_CHUNKED) || h->data_bytes <= file_size - h->data_offset;
+    }
+
+    /* Legacy: the header is the native ndim, dtype, size and shape fields */
+    size_t fixed = 2 * sizeof(size_t) + sizeof(TensrDType), n, off;
+    size_t* legacy_shape;
+    if (got < fixed) return false;
+    memcpy(&n, header, sizeof(size_t));
+    memset(h, 0, sizeof(*h));
+    if (n == 0 || n > FMT_MAX_NDIM || !io_pread(f, header, fixed + n * sizeof(size_t), 0) ||
+        !parse_legacy_header(header, (size_t)file_size, &h->ndim, &h->dtype, &legacy_shape,
+                             &off)) {
+        return false;
+    }
+    memcpy(h->shape, legacy_shape, n * sizeof(size_t));
+    free(legacy_shape);
+    h->data_offset = off;
+    *swap = false;
+    return true;
+}
+
+/**
+ * @brief Read the runs of a slice from a plain payload
+ * @param dst Output buffer, runs stored back to back
+ */
+static bool slice_plain(const IoFile* f, const SlicePlan* plan, unsigned char* dst) {
+    SliceRead* reads = (SliceRead*)malloc(plan->nruns * sizeof(SliceRead));
+    if (!reads) return false;
+
+    /* Run offsets increase monotonically, so neighbours are merged greedily */
+    size_t nreads = 0;
+    for (size_t j = 0; j < plan->nruns; j++) {
+        uint64_t off = slice_run_offset(plan, j);
+        SliceRead* r = nreads ? &reads[nreads - 1] : NULL;
+        if (r && off - (r->offset + r->span) <= SLICE_GAP &&
+            off + plan->run_bytes - r->offset <= SLICE_READ_MAX) {
+            r->span = off + plan->run_bytes - r->offset;
+            r->count++;
+        } else {
+            reads[nreads++] = (SliceRead){off, plan->run_bytes, j, 1, false};
+        }
+    }
+
+    ptrdiff_t n = (ptrdiff_t)nreads;
+    TENSR_PARALLEL_FOR(nreads > 1)
+    for (ptrdiff_t i = 0; i < n; i++) {
+        SliceRead* r = &reads[i];
+        unsigned char* out = dst + r->first * plan->run_bytes;
+        if (r->count == 1 || r->span == (uint64_t)r->count * plan->run_bytes) {
+            r->ok = io_pread(f, out, (size_t)r->span, r->offset);
+            continue;
+        }
+        unsigned char* buf = (unsigned char*)malloc((size_t)r->span);
+        r->ok = buf && io_pread(f, buf, (size_t)r->span, r->offset);
+        for (size_t j = 0; r->ok && j < r->count; j++) {
+            uint64_t off = slice_run_offset(plan, r->first + j) - r->offset;
+            memcpy(out + j * plan->run_bytes, buf + off, plan->run_bytes);
+        }
+        free(buf);
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < nreads; i++) ok = ok && reads[i].ok;
+    free(reads);
+    return ok;
+}
+
+/**
+ * @brief Read the runs of a slice from a chunked payload
+ *
+ * Only the chunks the runs touch are read and decoded, in parallel; run
+ * offsets in the plan are positions in the uncompressed payload.
+ */
+static bool slice_chunked(const IoFile* f, const FmtHeader* h, const SlicePlan* plan,
+                          unsigned char* dst) {
+    ChunkIndex idx;
+    if (!chunk_index_read(f, h, &idx)) return false;
+    size_t cs = idx.chunk_size;
+    unsigned char** cache = (unsigned char**)calloc(idx.nchunks, sizeof(unsigned char*));
+    size_t* wanted = (size_t*)malloc(idx.nchunks * sizeof(size_t));
+    bool* done = (bool*)calloc(idx.nchunks, sizeof(bool));
+    bool ok = cache && wanted && done;
+
+    /* Offsets increase, so each touched chunk is listed once, in order */
+    size_t nwanted = 0;
+    for (size_t j = 0; ok && j < plan->nruns; j++) {
+        uint64_t off = slice_run_offset(plan, j);
+        size_t last = (size_t)((off + plan->run_bytes - 1) / cs);
+        for (size_t c = (size_t)(off / cs); c <= last; c++) {
+            if (nwanted == 0 || wanted[nwanted - 1] < c) wanted[nwanted++] = c;
+        }
+    }
+
+    ptrdiff_t n = ok ? (ptrdiff_t)nwanted : 0;
+    TENSR_PARALLEL_FOR(n > 1)
+    for (ptrdiff_t i = 0; i < n; i++) {
+        size_t c = wanted[i];
+        cache[c] = (unsigned char*)malloc(chunk_length(&idx, c));
+        done[i] = cache[c] && chunk_read(f, &idx, c, cache[c]);
+    }
+    for (ptrdiff_t i = 0; i < n; i++) ok = ok && done[i];
+
+    for (size_t j = 0; ok && j < plan->nruns; j++) {
+        uint64_t off = slice_run_offset(plan, j);
+        unsigned char* out = dst + j * plan->run_bytes;
+        for (size_t copied = 0; copied < plan->run_bytes;) {
+            size_t c = (size_t)(off / cs), within = (size_t)(off % cs);
+            size_t len = chunk_length(&idx, c) - within;
+            if (len > plan->run_bytes - copied) len = plan->run_bytes - copied;
+            memcpy(out + copied, cache[c] + within, len);
+            copied += len;
+            off += len;
+        }
+    }
+
+    for (size_t i = 0; cache && i < idx.nchunks; i++) free(cache[i]);
+    free(cache);
+    free(wanted);
+    free(done);
+    chunk_index_free(&idx);
+    return ok;
+}
+
+/**
+ * @brief Load a rectangular region of a saved tensor, reading only that region
+ * @param filename Path to a file written by tensr_save()
+ * @param start First index along each dimension
+ * @param stop One past the last index along each dimension (clamped to the shape)
+ * @param step Stride along each dimension, or NULL for all ones
+ * @param ndim Number of dimensions given; later dimensions are taken whole
+ * @return Tensor of shape ceil((stop - start) / step) per dimension, or NULL if
+ *         the file is invalid or a range is empty
+ *
+ * The region is split into runs of elements that are contiguous in the
+ * file. Trailing dimensions that are selected whole merge into a single
+ * run. Runs separated by small gaps are coalesced into one read, and the
+ * reads are issued in parallel with positional I/O. The checksum of a
+ * plain versioned file covers the whole payload and is not verified. For
+ * compressed (chunked) files only the chunks holding the region are
+ * decoded, and their checksums are verified.
+ *
+ * Example:
+ *   (rows 24 * 180 to 24 * 181 of an [8760, 512] hourly series)
+ *   Tensor* day = tensr_load_slice("series.bin", (size_t[]){4320},
+ *                                  (size_t[]){4344}, NULL, 1);
+ */
+Tensor* tensr_load_slice(const char* filename, const size_t* start, const size_t* stop,
+                         const size_t* step, size_t ndim) {
+    IoFile f;
+    if (!io_file_open(&f, filename)) return NULL;
+    FmtHeader h;
+    size_t out_shape[FMT_MAX_NDIM];
+    bool swap;
+    if (!read_stored_header(&f, &h, &swap) || ndim > h.ndim) {
+        io_file_close(&f);
+        return NULL;
+    }
+
+    size_t a[FMT_MAX_NDIM], s[FMT_MAX_NDIM];
+    for (size_t k = 0; k < h.ndim; k++) {
+        size_t lo = k < ndim ? start[k] : 0;
+        size_t hi = k < ndim && stop[k] < h.shape[k] ? stop[k] : h.shape[k];
+        size_t st = k < ndim && step ? step[k] : 1;
+        if (st == 0 || lo >= hi) {
+            io_file_close(&f);
             return NULL;
         }
+        a[k] = lo;
+        s[k] = st;
+        out_shape[k] = (hi - lo + st - 1) / st;
     }
 
-    fclose(f);
+    /* Trailing dimensions taken whole form the contiguous inner block */
+    bool chunked = (h.flags & FMT_FLAG_CHUNKED) != 0;
+    size_t esize = tensr_dtype_size(h.dtype);
+    size_t c = h.ndim;
+    uint64_t stride = esize;
+    while (c > 0 && a[c - 1] == 0 && s[c - 1] == 1 && out_shape[c - 1] == h.shape[c - 1]) {
+        stride *= h.shape[--c];
+    }
+    SlicePlan plan;
+    plan.base = chunked ? 0 : h.data_offset;
+    plan.run_bytes = (size_t)stride;
+    /* A unit-step dimension just outside the block extends every run */
+    size_t outer = c;
+    if (c > 0 && s[c - 1] == 1) {
+        outer = c - 1;
+        plan.base += (uint64_t)a[outer] * stride;
+        plan.run_bytes *= out_shape[outer];
+    }
+    plan.ndim = outer;
+    plan.nruns = 1;
+    for (size_t k = outer; k-- > 0;) {
+        if (k + 1 < c) stride *= h.shape[k + 1];
+        plan.start[k] = a[k];
+        plan.step[k] = s[k];
+        plan.len[k] = out_shape[k];
+        plan.stride[k] = stride;
+        plan.nruns *= out_shape[k];
+    }
+
+    Tensor* t = tensr_create(out_shape, h.ndim, h.dtype, TENSR_CPU);
+    bool ok = t && (chunked ? slice_chunked(&f, &h, &plan, (unsigned char*)t->data)
+                            : slice_plain(&f, &plan, (unsigned char*)t->data));
+    io_file_close(&f);
+    if (!ok) {
+        tensr_free(t);
+        return NULL;
+    }
+    if (swap) fmt_swap_elements(t->data, t->size, esize);
     return t;
 }
 
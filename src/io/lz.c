@@ -0,0 +1,171 @@
+/**
+ * @file lz.c
+ * @brief LZ77 block compression in the LZ4 block format
+ * @author Muhammad Fiaz
+ */
+
+#include "lz.h"
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_HASH_BITS 14
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+/* The format ends every block with at least 5 literals, and the last match
+   starts at least 12 bytes before the end */
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+
+static inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+size_t lz_bound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+/**
+ * @brief Write a length continuation (runs of 255 then the remainder)
+ */
+static unsigned char* put_length(unsigned char* op, size_t len) {
+    for (; len >= 255; len -= 255) *op++ = 255;
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+/**
+ * @brief Emit one sequence: literals [anchor, anchor + lit) then a match, if mlen > 0
+ * @return New output position, or NULL if it would overrun oend
+ */
+static unsigned char* put_sequence(unsigned char* op, unsigned char* oend,
+                                   const unsigned char* anchor, size_t lit, size_t offset,
+                                   size_t mlen) {
+    size_t need = 1 + lit + lit / 255 + 1 + (mlen ? 2 + mlen / 255 + 1 : 0);
+    if ((size_t)(oend - op) < need) return NULL;
+    unsigned char* token = op++;
+    *token = (unsigned char)((lit < 15 ? lit : 15) << 4);
+    if (lit >= 15) op = put_length(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+    if (mlen) {
+        op[0] = (unsigned char)offset;
+        op[1] = (unsigned char)(offset >> 8);
+        op += 2;
+        size_t m = mlen - LZ_MIN_MATCH;
+        *token |= (unsigned char)(m < 15 ? m : 15);
+        if (m >= 15) op = put_length(op, m - 15);
+    }
+    return op;
+}
+
+size_t lz_compress(const unsigned char* src, size_t n, unsigned char* dst, size_t cap) {
+    uint32_t table[1u << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+    const unsigned char* ip = src;
+    const unsigned char* anchor = src;
+    const unsigned char* end = src + n;
+    unsigned char* op = dst;
+    unsigned char* oend = dst + cap;
+
+    if (n > LZ_MATCH_LIMIT) {
+        const unsigned char* mflimit = end - LZ_MATCH_LIMIT;
+        const unsigned char* matchlimit = end - LZ_LAST_LITERALS;
+        ip++;
+        while (ip <= mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = lz_hash(seq);
+            const unsigned char* ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+            if (ref >= ip || ip - ref > LZ_MAX_OFFSET || read32(ref) != seq) {
+                /* Skip faster through incompressible data */
+                ip += 1 + ((size_t)(ip - anchor) >> 6);
+                continue;
+            }
+            /* Extend backwards over pending literals, then forwards */
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            size_t len = LZ_MIN_MATCH;
+            while (ip + len + 8 <= matchlimit && read64(ip + len) == read64(ref + len)) len += 8;
+            while (ip + len < matchlimit && ip[len] == ref[len]) len++;
+            op = put_sequence(op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), len);
+            if (!op) return 0;
+            ip += len;
+            anchor = ip;
+            if (ip <= mflimit) table[lz_hash(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+    op = put_sequence(op, oend, anchor, (size_t)(end - anchor), 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+/**
+ * @brief Read a length continuation
+ * @return false if the input ends first
+ */
+static bool get_length(const unsigned char** ip, const unsigned char* iend, size_t* len) {
+    unsigned char b;
+    do {
+        if (*ip >= iend) return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+bool lz_decompress(const unsigned char* src, size_t n, unsigned char* dst, size_t out_n) {
+    const unsigned char* ip = src;
+    const unsigned char* iend = src + n;
+    unsigned char* op = dst;
+    unsigned char* oend = dst + out_n;
+
+    while (ip < iend) {
+        unsigned char token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15 && !get_length(&ip, iend, &lit)) return false;
+        if ((size_t)(iend - ip) < lit || (size_t)(oend - op) < lit) return false;
+        memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return false;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t mlen = token & 15;
+        if (mlen == 15 && !get_length(&ip, iend, &mlen)) return false;
+        mlen += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(oend - op) < mlen) {
+            return false;
+        }
+        const unsigned char* ref = op - offset;
+        if (offset >= mlen) {
+            memcpy(op, ref, mlen);
+            op += mlen;
+        } else {
+            /* Overlapping match repeats the last offset bytes; doubling the
+               copied span each step keeps every memcpy non-overlapping */
+            for (size_t done = 0; done < mlen;) {
+                size_t span = (size_t)(op - ref);
+                if (span > mlen - done) span = mlen - done;
+                memcpy(op, ref, span);
+                op += span;
+                done += span;
+            }
+        }
+    }
+    return op == oend;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file lz.h
+ * @brief Internal LZ77 block codec used by chunked tensor files
+ * @author Muhammad Fiaz
+ *
+ * Blocks use the LZ4 block format: a token byte splitting into literal and
+ * match lengths, the literals, then a 16-bit little-endian match offset.
+ * Compression is a single greedy pass over a hash table of 4-byte
+ * sequences, and decompression is a bounds-checked copy loop, so both run
+ * at several hundred MB/s per thread.
+ */
+
+#ifndef TENSR_IO_LZ_H
+#define TENSR_IO_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Largest compressed size of n input bytes
+ */
+size_t lz_bound(size_t n);
+
+/**
+ * @brief Compress a block
+ * @param cap Capacity of dst
+ * @return Compressed size, or 0 if the result would not fit in cap
+ */
+size_t lz_compress(const unsigned char* src, size_t n, unsigned char* dst, size_t cap);
+
+/**
+ * @brief Decompress a block
+ * @param out_n Exact decompressed size
+ * @return false if the block is malformed or does not decode to out_n bytes
+ */
+bool lz_decompress(const unsigned char* src, size_t n, unsigned char* dst, size_t out_n);
+
+#endif /* TENSR_IO_LZ_H */
@@ -0,0 +1,776 @@
+/**
+ * @file npy.c
+ * @brief NumPy .npy and .npz reading and writing
+ * @author Muhammad Fiaz
+ *
+ * .npy files are a magic string, a version, a Python dict literal giving the
+ * dtype descriptor, memory order and shape, and then the raw elements. NumPy
+ * pads the header so the data starts on a 64-byte boundary, which lets it be
+ * memory-mapped in place. .npz files are ZIP archives of .npy members.
+ * Stored (uncompressed) members are read or mapped straight out of the
+ * archive; deflate-compressed members (np.savez_compressed) are not
+ * supported.
+ *
+ * Supported descriptors are f4, f8, i4, i8, u1 and b1, in either byte
+ * order. Big-endian data is converted on load. Fortran-ordered arrays with
+ * two or more dimensions are reordered to row-major, both on load and when
+ * mapped, because tensor operations assume row-major data.
+ */
+
+#include "tensr/tensr.h"
+#include "file.h"
+#include "format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NPY_MAGIC "\x93NUMPY"
+#define NPY_MAGIC_SIZE 6
+#define NPY_ALIGNMENT 64
+
+#define ZIP_LOCAL_SIG 0x04034b50u
+#define ZIP_CENTRAL_SIG 0x02014b50u
+#define ZIP_END_SIG 0x06054b50u
+#define ZIP64_END_SIG 0x06064b50u
+#define ZIP64_LOCATOR_SIG 0x07064b50u
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_END_SIZE 22
+#define ZIP64_END_SIZE 56
+#define ZIP64_LOCATOR_SIZE 20
+#define ZIP_MAX_COMMENT 65535
+#define ZIP32_LIMIT 0xFFFFFFFFu
+
+/* Parsed .npy header */
+typedef struct {
+    TensrDType dtype;
+    bool swap;     /* Stored in the opposite byte order from the host */
+    bool fortran;  /* Column-major element order */
+    size_t ndim;
+    size_t shape[FMT_MAX_NDIM];
+    size_t size;
+    size_t data_offset;  /* Bytes from the start of the .npy data to the elements */
+} NpyInfo;
+
+/* ---------------------------------------------------------------------- */
+/* Header parsing                                                          */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * @brief Find the value following 'key': in a header dict
+ * @return Pointer to the first non-space character of the value, or NULL
+ */
+static const char* dict_value(const char* dict, const char* end, const char* key) {
+    size_t klen = strlen(key);
+    for (const char* p = dict; p + klen + 2 < end; p++) {
+        if ((*p == '\'' || *p == '"') && strncmp(p + 1, key, klen) == 0 && p[klen + 1] == *p) {
+            p += klen + 2;
+            while (p < end && (*p == ' ' || *p == ':')) p++;
+            return p < end ? p : NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Map a descriptor such as '<f4' to a dtype and byte order
+ */
+static bool parse_descr(const char* p, const char* end, NpyInfo* info) {
+    char quote = *p;
+    if (quote != '\'' && quote != '"') return false;
+    p++;
+    const char* close = memchr(p, quote, (size_t)(end - p));
+    if (!close || close - p < 2 || close - p > 4) return false;
+
+    char order = '=';
+    if (*p == '<' || *p == '>' || *p == '|' || *p == '=') order = *p++;
+    size_t len = (size_t)(close - p);
+    if (len == 2 && strncmp(p, "f4", 2) == 0) info->dtype = TENSR_FLOAT32;
+    else if (len == 2 && strncmp(p, "f8", 2) == 0) info->dtype = TENSR_FLOAT64;
+    else if (len == 2 && strncmp(p, "i4", 2) == 0) info->dtype = TENSR_INT32;
+    else if (len == 2 && strncmp(p, "i8", 2) == 0) info->dtype = TENSR_INT64;
+    else if (len == 2 && strncmp(p, "u1", 2) == 0) info->dtype = TENSR_UINT8;
+    else if (len == 2 && strncmp(p, "b1", 2) == 0) info->dtype = TENSR_BOOL;
+    else return false;
+
+    bool little = fmt_host_little_endian();
+    info->swap = tensr_dtype_size(info->dtype) > 1 &&
+                 ((order == '<' && !little) || (order == '>' && little));
+    return true;
+}
+
+/**
+ * @brief Parse a shape tuple such as (3, 4) or (5,)
+ */
+static bool parse_shape(const char* p, const char* end, NpyInfo* info) {
+    if (*p != '(') return false;
+    p++;
+    info->ndim = 0;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == ',')) p++;
+        if (p < end && *p == ')') break;
+        if (p >= end || *p < '0' || *p > '9' || info->ndim == FMT_MAX_NDIM) return false;
+        size_t v = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            size_t digit = (size_t)(*p++ - '0');
+            if (v > (SIZE_MAX - digit) / 10) return false;
+            v = v * 10 + digit;
+        }
+        info->shape[info->ndim++] = v;
+    }
+    if (p >= end) return false;
+    /* Tensors have at least one dimension; a 0-d array becomes shape (1,) */
+    if (info->ndim == 0) info->shape[info->ndim++] = 1;
+    return true;
+}
+
+/**
+ * @brief Length of the .npy preamble (magic, version and header length field)
+ * @param p At least NPY_MAGIC_SIZE + 2 bytes
+ * @return 10 or 12, or 0 if p is not a supported .npy file
+ */
+static size_t npy_preamble(const unsigned char* p) {
+    if (memcmp(p, NPY_MAGIC, NPY_MAGIC_SIZE) != 0) return 0;
+    if (p[6] == 1) return 10;
+    if (p[6] == 2 || p[6] == 3) return 12;
+    return 0;
+}
+
+/**
+ * @brief Parse the header of a .npy file
+ * @param p Start of the .npy data
+ * @param len Bytes available at p (at least the preamble, ideally the whole header)
+ * @param need Set to the number of bytes required when len is too short
+ */
+static bool parse_npy(const unsigned char* p, size_t len, NpyInfo* info, size_t* need) {
+    *need = 0;
+    if (len < 12) {
+        *need = 12;
+        return false;
+    }
+    size_t pre = npy_preamble(p);
+    if (pre == 0) return false;
+    size_t hlen = pre == 10 ? fmt_get_u16(p + 8) : fmt_get_u32(p + 8);
+    if (len < pre + hlen) {
+        *need = pre + hlen;
+        return false;
+    }
+    const char* dict = (const char*)p + pre;
+    const char* end = dict + hlen;
+
+    memset(info, 0, sizeof(*info));
+    const char* descr = dict_value(dict, end, "descr");
+    const char* order = dict_value(dict, end, "fortran_order");
+    const char* shape = dict_value(dict, end, "shape");
+    if (!descr || !order || !shape) return false;
+    if (!parse_descr(descr, end, info) || !parse_shape(shape, end, info)) return false;
+    if (end - order >= 4 && strncmp(order, "True", 4) == 0) info->fortran = true;
+    else if (!(end - order >= 5 && strncmp(order, "False", 5) == 0)) return false;
+
+    uint64_t count = 1;
+    for (size_t i = 0; i < info->ndim; i++) {
+        if (info->shape[i] != 0 && count > SIZE_MAX / info->shape[i]) return false;
+        count *= info->shape[i];
+    }
+    if (count > SIZE_MAX / tensr_dtype_size(info->dtype)) return false;
+    info->size = (size_t)count;
+    info->data_offset = pre + hlen;
+    return true;
+}
+
+/**
+ * @brief Payload size in bytes
+ */
+static size_t npy_bytes(const NpyInfo* info) {
+    return info->size * tensr_dtype_size(info->dtype);
+}
+
+/**
+ * @brief Column-major strides of a shape, in elements
+ */
+static void fortran_strides(const size_t* shape, size_t ndim, size_t* strides) {
+    size_t s = 1;
+    for (size_t i = 0; i < ndim; i++) {
+        strides[i] = s;
+        s *= shape[i];
+    }
+}
+
+/**
+ * @brief Build a row-major tensor from .npy elements
+ * @param src Elements in file order and byte order
+ */
+static Tensor* tensor_from_npy(const NpyInfo* info, const void* src) {
+    Tensor* t = tensr_create((size_t*)info->shape, info->ndim, info->dtype, TENSR_CPU);
+    if (!t) return NULL;
+    size_t esize = tensr_dtype_size(info->dtype);
+    if (!info->fortran || info->ndim < 2) {
+        memcpy(t->data, src, info->size * esize);
+    } else {
+        /* Walk the C-order index and track the matching column-major offset */
+        size_t fstr[FMT_MAX_NDIM], idx[FMT_MAX_NDIM] = {0};
+        fortran_strides(info->shape, info->ndim, fstr);
+        const unsigned char* s = (const unsigned char*)src;
+        unsigned char* d = (unsigned char*)t->data;
+        size_t off = 0;
+        for (size_t i = 0; i < info->size; i++) {
+            memcpy(d + i * esize, s + off * esize, esize);
+            for (size_t k = info->ndim; k-- > 0;) {
+                off += fstr[k];
+                if (++idx[k] < info->shape[k]) break;
+                off -= idx[k] * fstr[k];
+                idx[k] = 0;
+            }
+        }
+    }
+    if (info->swap) fmt_swap_elements(t->data, t->size, esize);
+    return t;
+}
+
+/**
+ * @brief Wrap mapped .npy elements in a tensor, copying only when necessary
+ * @param offset Byte offset of the elements in the mapping
+ */
+static Tensor* tensor_from_mapping(IoMapping* m, size_t offset, const NpyInfo* info) {
+    const unsigned char* data = io_mapping_data(m) + offset;
+    if (info->swap || (info->fortran && info->ndim >= 2) ||
+        (uintptr_t)data % tensr_dtype_size(info->dtype) != 0) {
+        return tensor_from_npy(info, data);
+    }
+    return io_tensor_from_mapping(m, offset, info->shape, info->ndim, info->dtype);
+}
+
+/* ---------------------------------------------------------------------- */
+/* .npy files                                                              */
+/* ---------------------------------------------------------------------- */
+
+/**
+ * @brief Read and parse the header of a .npy stream starting at offset
+ */
+static bool read_npy_header(const IoFile* f, uint64_t offset, NpyInfo* info) {
+    unsigned char pre[12];
+    size_t need;
+    if (!io_pread(f, pre, sizeof(pre), offset)) return false;
+    if (parse_npy(pre, sizeof(pre), info, &need)) return true;
+    if (need == 0) return false;
+    unsigned char* header = (unsigned char*)malloc(need);
+    if (!header) return false;
+    bool ok = io_pread(f, header, need, offset) && parse_npy(header, need, info, &need);
+    free(header);
+    return ok;
+}
+
+/**
+ * @brief Load a NumPy .npy file
+ * @param filename Path to the .npy file
+ * @return Row-major tensor, or NULL if the file is missing, malformed or of
+ *         an unsupported dtype
+ *
+ * Example:
+ *   Tensor* x = tensr_load_npy("features.npy");
+ */
+Tensor* tensr_load_npy(const char* filename) {
+    IoFile f;
+    if (!io_file_open(&f, filename)) return NULL;
+    NpyInfo info;
+    uint64_t file_size = 0;
+    Tensor* t = NULL;
+    if (read_npy_header(&f, 0, &info) && io_file_size(&f, &file_size) &&
+        info.data_offset + npy_bytes(&info) <= file_size) {
+        void* raw = malloc(npy_bytes(&info) ? npy_bytes(&info) : 1);
+        if (raw && io_pread(&f, raw, npy_bytes(&info), info.data_offset)) {
+            t = tensor_from_npy(&info, raw);
+        }
+        free(raw);
+    }
+    io_file_close(&f);
+    return t;
+}
+
+/**
+ * @brief Memory-map a NumPy .npy file
+ * @param filename Path to the .npy file
+ * @param mode TENSR_MAP_READONLY or TENSR_MAP_COPY_ON_WRITE
+ * @return Tensor pointing into the mapping, or NULL on failure
+ *
+ * Arrays saved by NumPy are 64-byte aligned and are mapped without copying.
+ * Big-endian, misaligned and multi-dimensional Fortran-ordered data is
+ * copied into a row-major tensor instead.
+ */
+Tensor* tensr_load_npy_mmap(const char* filename, TensrMapMode mode) {
+    IoMapping* m = io_map_file(filename, mode);
+    if (!m) return NULL;
+    NpyInfo info;
+    size_t need;
+    Tensor* t = NULL;
+    size_t len = io_mapping_size(m);
+    if (parse_npy(io_mapping_data(m), len, &info, &need) &&
+        info.data_offset + npy_bytes(&info) <= len) {
+        t = tensor_from_mapping(m, info.data_offset, &info);
+    }
+    io_mapping_unref(m);
+    return t;
+}
+
+/**
+ * @brief Build the .npy header for a tensor, padded so the data is 64-byte aligned
+ * @param out Buffer of at least NPY_HEADER_MAX bytes
+ * @return Header length in bytes
+ */
+#define NPY_HEADER_MAX (NPY_ALIGNMENT * 16)
+
+static size_t npy_header(const Tensor* t, unsigned char* out) {
+    static const char* descr[] = {"<f4", "<f8", "<i4", "<i8", "|u1", "|b1"};
+    const char* d;
+    switch (t->dtype) {
+        case TENSR_FLOAT32: d = descr[0]; break;
+        case TENSR_FLOAT64: d = descr[1]; break;
+        case TENSR_INT32: d = descr[2]; break;
+        case TENSR_INT64: d = descr[3]; break;
+        case TENSR_UINT8: d = descr[4]; break;
+        case TENSR_BOOL: d = descr[5]; break;
+        default: return 0;
+    }
+    char dict[NPY_HEADER_MAX];
+    int n = snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (", d);
+    for (size_t i = 0; i < t->ndim && n > 0 && (size_t)n < sizeof(dict); i++) {
+        n += snprintf(dict + n, sizeof(dict) - (size_t)n, "%zu,%s", t->shape[i],
+                      i + 1 < t->ndim ? " " : "");
+    }
+    if (n <= 0 || (size_t)n >= sizeof(dict)) return 0;
+    n += snprintf(dict + n, sizeof(dict) - (size_t)n, "), }");
+    /* Version 1.0 preamble is 10 bytes; pad with spaces and end with a newline */
+    size_t total = (10 + (size_t)n + 1 + NPY_ALIGNMENT - 1) / NPY_ALIGNMENT * NPY_ALIGNMENT;
+    if (total > NPY_HEADER_MAX) return 0;
+    memcpy(out, NPY_MAGIC, NPY_MAGIC_SIZE);
+    out[6] = 1;
+    out[7] = 0;
+    fmt_put_u16(out + 8, (uint16_t)(total - 10));
+    memcpy(out + 10, dict, (size_t)n);
+    memset(out + 10 + n, ' ', total - 10 - (size_t)n - 1);
+    out[total - 1] = '\n';
+    return total;
+}
+
+/**
+ * @brief Save a tensor as a NumPy .npy file
+ * @param filename Path to output file
+ * @param t Tensor to save
+ * @return 0 on success, -1 on failure
+ *
+ * Writes format version 1.0 with little-endian elements in C order, readable
+ * by np.load() (including mmap_mode).
+ */
+int tensr_save_npy(const char* filename, const Tensor* t) {
+    unsigned char header[NPY_HEADER_MAX];
+    size_t hlen = npy_header(t, header);
+    if (hlen == 0) return -1;
+    FILE* f = fopen(filename, "wb");
+    if (!f) return -1;
+    bool ok = fwrite(header, 1, hlen, f) == hlen &&
+              fmt_write_payload(f, t->data, t->size, tensr_dtype_size(t->dtype), NULL);
+    if (fclose(f) != 0) ok = false;
+    return ok ? 0 : -1;
+}
+
+/* ---------------------------------------------------------------------- */
+/* .npz archives                                                           */
+/* ---------------------------------------------------------------------- */
+
+static uint32_t crc_table[8][256];
+static IoOnce crc_once = IO_ONCE_INIT;
+
+static void crc_build(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1u)));
+        crc_table[0][i] = c;
+    }
+    for (int s = 1; s < 8; s++) {
+        for (int i = 0; i < 256; i++) {
+            crc_table[s][i] = (crc_table[s - 1][i] >> 8) ^ crc_table[0][crc_table[s - 1][i] & 0xFF];
+        }
+    }
+}
+
+static void crc_init(void) {
+    io_once(&crc_once, crc_build);
+}
+
+/**
+ * @brief Update a ZIP CRC-32 (slicing by 8)
+ */
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint32_t lo = crc ^ fmt_get_u32(p);
+        uint32_t hi = fmt_get_u32(p + 4);
+        crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+              crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+    }
+    for (; len > 0; p++, len--) crc = (crc >> 8) ^ crc_table[0][(crc ^ *p) & 0xFF];
+    return ~crc;
+}
+
+/* Location of a stored member inside an .npz file */
+typedef struct {
+    uint64_t data_offset;
+    uint64_t size;
+    uint32_t crc;
+} ZipMember;
+
+/**
+ * @brief Check whether a ZIP member name is name or name.npy
+ */
+static bool member_matches(const unsigned char* member, size_t len, const char* name) {
+    size_t n = strlen(name);
+    if (len == n && memcmp(member, name, n) == 0) return true;
+    return len == n + 4 && memcmp(member, name, n) == 0 && memcmp(member + n, ".npy", 4) == 0;
+}
+
+/**
+ * @brief Find a stored member through the ZIP central directory
+ */
+static bool find_member(const IoFile* f, const char* name, ZipMember* out) {
+    uint64_t file_size;
+    if (!io_file_size(f, &file_size) || file_size < ZIP_END_SIZE) return false;
+
+    /* The end record sits in the last 22 bytes plus an optional comment */
+    size_t tail = (size_t)(file_size < ZIP_END_SIZE + ZIP_MAX_COMMENT + ZIP64_LOCATOR_SIZE
+                               ? file_size
+                               : ZIP_END_SIZE + ZIP_MAX_COMMENT + ZIP64_LOCATOR_SIZE);
+    unsigned char* buf = (unsigned char*)malloc(tail);
+    if (!buf || !io_pread(f, buf, tail, file_size - tail)) {
+        free(buf);
+        return false;
+    }
+    size_t end = tail - ZIP_END_SIZE + 1;
+    while (end-- > 0 && fmt_get_u32(buf + end) != ZIP_END_SIG) {}
+    if (end == (size_t)-1) {
+        free(buf);
+        return false;
+    }
+    uint64_t entries = fmt_get_u16(buf + end + 10);
+    uint64_t cd_size = fmt_get_u32(buf + end + 12);
+    uint64_t cd_offset = fmt_get_u32(buf + end + 16);
+    if (end >= ZIP64_LOCATOR_SIZE &&
+        fmt_get_u32(buf + end - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR_SIG) {
+        unsigned char z[ZIP64_END_SIZE];
+        uint64_t z_offset = fmt_get_u64(buf + end - ZIP64_LOCATOR_SIZE + 8);
+        if (!io_pread(f, z, ZIP64_END_SIZE, z_offset) || fmt_get_u32(z) != ZIP64_END_SIG) {
+            free(buf);
+            return false;
+        }
+        entries = fmt_get_u64(z + 32);
+        cd_size = fmt_get_u64(z + 40);
+        cd_offset = fmt_get_u64(z + 48);
+    }
+    free(buf);
+    if (cd_offset > file_size || cd_size > file_size - cd_offset) return false;
+
+    unsigned char* cd = (unsigned char*)malloc(cd_size ? (size_t)cd_size : 1);
+    if (!cd || !io_pread(f, cd, (size_t)cd_size, cd_offset)) {
+        free(cd);
+        return false;
+    }
+    bool found = false;
+    size_t at = 0;
+    for (uint64_t i = 0; i < entries && !found; i++) {
+        if (cd_size - at < ZIP_CENTRAL_SIZE || fmt_get_u32(cd + at) != ZIP_CENTRAL_SIG) break;
+        const unsigned char* e = cd + at;
+        size_t name_len = fmt_get_u16(e + 28), extra_len = fmt_get_u16(e + 30);
+        size_t entry = ZIP_CENTRAL_SIZE + name_len + extra_len + fmt_get_u16(e + 32);
+        if (cd_size - at < entry) break;
+        if (member_matches(e + ZIP_CENTRAL_SIZE, name_len, name)) {
+            uint16_t method = fmt_get_u16(e + 10);
+            uint64_t comp = fmt_get_u32(e + 20), size = fmt_get_u32(e + 24);
+            uint64_t local = fmt_get_u32(e + 42);
+            /* ZIP64 extra field holds the 32-bit fields that overflowed, in order */
+            const unsigned char* x = e + ZIP_CENTRAL_SIZE + name_len;
+            const unsigned char* xend = x + extra_len;
+            while (xend - x >= 4) {
+                uint16_t id = fmt_get_u16(x), len = fmt_get_u16(x + 2);
+                if (xend - x - 4 < len) break;
+                if (id == 0x0001) {
+                    const unsigned char* v = x + 4;
+                    const unsigned char* vend = v + len;
+                    if (size == ZIP32_LIMIT && vend - v >= 8) size = fmt_get_u64(v), v += 8;
+                    if (comp == ZIP32_LIMIT && vend - v >= 8) comp = fmt_get_u64(v), v += 8;
+                    if (local == ZIP32_LIMIT && vend - v >= 8) local = fmt_get_u64(v);
+                }
+                x += 4 + len;
+            }
+            unsigned char lh[ZIP_LOCAL_SIZE];
+            if (method == 0 && comp == size && io_pread(f, lh, ZIP_LOCAL_SIZE, local) &&
+                fmt_get_u32(lh) == ZIP_LOCAL_SIG) {
+                out->data_offset = local + ZIP_LOCAL_SIZE + fmt_get_u16(lh + 26) +
+                                   fmt_get_u16(lh + 28);
+                out->size = size;
+                out->crc = fmt_get_u32(e + 16);
+                found = out->data_offset <= file_size && size <= file_size - out->data_offset;
+            }
+            break;
+        }
+        at += entry;
+    }
+    free(cd);
+    return found;
+}
+
+/**
+ * @brief Load one array from a NumPy .npz archive
+ * @param filename Path to the .npz file
+ * @param name Array name as passed to np.savez (".npy" suffix optional)
+ * @return Row-major tensor, or NULL if the member is missing, compressed,
+ *         corrupt (CRC mismatch) or of an unsupported dtype
+ *
+ * Only the requested member is read.
+ *
+ * Example:
+ *   Tensor* labels = tensr_load_npz("batch.npz", "labels");
+ */
+Tensor* tensr_load_npz(const char* filename, const char* name) {
+    IoFile f;
+    if (!io_file_open(&f, filename)) return NULL;
+    ZipMember zm;
+    NpyInfo info;
+    Tensor* t = NULL;
+    if (find_member(&f, name, &zm) && read_npy_header(&f, zm.data_offset, &info) &&
+        info.data_offset + npy_bytes(&info) <= zm.size) {
+        unsigned char* raw = (unsigned char*)malloc((size_t)zm.size);
+        if (raw && io_pread(&f, raw, (size_t)zm.size, zm.data_offset)) {
+            crc_init();
+            if (crc32_update(0, raw, (size_t)zm.size) == zm.crc) {
+                t = tensor_from_npy(&info, raw + info.data_offset);
+            }
+        }
+        free(raw);
+    }
+    io_file_close(&f);
+    return t;
+}
+
+/**
+ * @brief Memory-map one array of a NumPy .npz archive
+ * @param filename Path to the .npz file
+ * @param name Array name (".npy" suffix optional)
+ * @param mode TENSR_MAP_READONLY or TENSR_MAP_COPY_ON_WRITE
+ * @return Tensor pointing into the archive, or NULL on failure
+ *
+ * The member must be stored (np.savez, not np.savez_compressed). ZIP does
+ * not align members, so elements that are misaligned for their dtype are
+ * copied; tensr_save_npz() writes aligned members. The CRC is not verified.
+ */
+Tensor* tensr_load_npz_mmap(const char* filename, const char* name, TensrMapMode mode) {
+    IoFile f;
+    if (!io_file_open(&f, filename)) return NULL;
+    ZipMember zm;
+    NpyInfo info;
+    bool ok = find_member(&f, name, &zm) && read_npy_header(&f, zm.data_offset, &info) &&
+              info.data_offset + npy_bytes(&info) <= zm.size;
+    io_file_close(&f);
+    if (!ok) return NULL;
+
+    IoMapping* m = io_map_file(filename, mode);
+    if (!m) return NULL;
+    Tensor* t = NULL;
+    if (zm.data_offset + zm.size <= io_mapping_size(m)) {
+        t = tensor_from_mapping(m, (size_t)(zm.data_offset + info.data_offset), &info);
+    }
+    io_mapping_unref(m);
+    return t;
+}
+
+/* Central directory record of a member written by tensr_save_npz() */
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t crc;
+} NpzEntry;
+
+/**
+ * @brief Write a ZIP local header, with a ZIP64 extra field when needed
+ * @param pad Bytes of padding in an extra field so the member data is aligned
+ */
+static bool write_local_header(FILE* f, const char* name, size_t name_len, uint64_t size,
+                               uint32_t crc, bool zip64, uint16_t pad) {
+    unsigned char h[ZIP_LOCAL_SIZE + 20];
+    fmt_put_u32(h, ZIP_LOCAL_SIG);
+    fmt_put_u16(h + 4, zip64 ? 45 : 20);
+    fmt_put_u16(h + 6, 0);
+    fmt_put_u16(h + 8, 0);   /* stored */
+    fmt_put_u16(h + 10, 0);  /* time */
+    fmt_put_u16(h + 12, 0x21);  /* 1980-01-01 */
+    fmt_put_u32(h + 14, crc);
+    fmt_put_u32(h + 18, zip64 ? ZIP32_LIMIT : (uint32_t)size);
+    fmt_put_u32(h + 22, zip64 ? ZIP32_LIMIT : (uint32_t)size);
+    fmt_put_u16(h + 26, (uint16_t)name_len);
+    fmt_put_u16(h + 28, (uint16_t)((zip64 ? 20 : 0) + pad));
+    size_t n = ZIP_LOCAL_SIZE;
+    if (zip64) {
+        fmt_put_u16(h + n, 0x0001);
+        fmt_put_u16(h + n + 2, 16);
+        fmt_put_u64(h + n + 4, size);
+        fmt_put_u64(h + n + 12, size);
+        n += 20;
+    }
+    static const unsigned char zeros[NPY_ALIGNMENT + 4];
+    unsigned char pad_header[4];
+    bool ok = fwrite(h, 1, ZIP_LOCAL_SIZE, f) == ZIP_LOCAL_SIZE &&
+              fwrite(name, 1, name_len, f) == name_len &&
+              fwrite(h + ZIP_LOCAL_SIZE, 1, n - ZIP_LOCAL_SIZE, f) == n - ZIP_LOCAL_SIZE;
+    if (ok && pad) {
+        /* Padding goes in an unregistered extra field (id 0xCAFE) */
+        fmt_put_u16(pad_header, 0xCAFE);
+        fmt_put_u16(pad_header + 2, (uint16_t)(pad - 4));
+        ok = fwrite(pad_header, 1, 4, f) == 4 && fwrite(zeros, 1, pad - 4u, f) == pad - 4u;
+    }
+    return ok;
+}
+
+/**
+ * @brief Save tensors as a NumPy .npz archive (uncompressed, like np.savez)
+ * @param filename Path to output file
+ * @param names Array names; "<name>.npy" members are written
+ * @param tensors Tensors to store
+ * @param n Number of tensors
+ * @return 0 on success, -1 on failure
+ *
+ * Members are stored uncompressed with their data 64-byte aligned, so the
+ * archive can be mapped with tensr_load_npz_mmap() or np.load(mmap_mode=...)
+ * on the extracted members. ZIP64 records are used for members or archives
+ * larger than 4 GB.
+ *
+ * Example:
+ *   const char* names[] = {"x", "y"};
+ *   Tensor* arrays[] = {x, y};
+ *   tensr_save_npz("data.npz", names, arrays, 2);
+ */
+int tensr_save_npz(const char* filename, const char** names, Tensor** tensors, size_t n) {
+    NpzEntry* entries = (NpzEntry*)calloc(n ? n : 1, sizeof(NpzEntry));
+    FILE* f = entries ? fopen(filename, "wb") : NULL;
+    if (!f) {
+        free(entries);
+        return -1;
+    }
+    crc_init();
+    bool ok = true;
+    uint64_t pos = 0;
+    char member[FMT_MAX_NDIM * 8 + 256];
+    unsigned char header[NPY_HEADER_MAX];
+    for (size_t i = 0; ok && i < n; i++) {
+        const Tensor* t = tensors[i];
+        int name_len = snprintf(member, sizeof(member), "%s.npy", names[i]);
+        size_t hlen = npy_header(t, header);
+        if (name_len <= 4 || (size_t)name_len >= sizeof(member) || hlen == 0) {
+            ok = false;
+            break;
+        }
+        uint64_t bytes = (uint64_t)t->size * tensr_dtype_size(t->dtype);
+        uint64_t size = hlen + bytes;
+        bool zip64 = size >= ZIP32_LIMIT || pos >= ZIP32_LIMIT;
+        size_t fixed = ZIP_LOCAL_SIZE + (size_t)name_len + (zip64 ? 20 : 0);
+        /* Align the array elements (after the .npy header) to 64 bytes */
+        uint16_t pad = (uint16_t)((NPY_ALIGNMENT - (pos + fixed + hlen) % NPY_ALIGNMENT) %
+                                  NPY_ALIGNMENT);
+        if (pad != 0 && pad < 4) pad += NPY_ALIGNMENT;
+
+        uint32_t crc = crc32_update(0, header, hlen);
+        if (fmt_host_little_endian()) {
+            crc = crc32_update(crc, t->data, (size_t)bytes);
+        } else {
+            unsigned char* tmp = (unsigned char*)malloc((size_t)bytes ? (size_t)bytes : 1);
+            if (!tmp) {
+                ok = false;
+                break;
+            }
+            memcpy(tmp, t->data, (size_t)bytes);
+            fmt_swap_elements(tmp, t->size, tensr_dtype_size(t->dtype));
+            crc = crc32_update(crc, tmp, (size_t)bytes);
+            free(tmp);
+        }
+        entries[i].offset = pos;
+        entries[i].size = size;
+        entries[i].crc = crc;
+        ok = write_local_header(f, member, (size_t)name_len, size, crc, zip64, pad) &&
+             fwrite(header, 1, hlen, f) == hlen &&
+             fmt_write_payload(f, t->data, t->size, tensr_dtype_size(t->dtype), NULL);
+        pos += fixed + pad + size;
+    }
+
+    /* Central directory */
+    uint64_t cd_offset = pos;
+    for (size_t i = 0; ok && i < n; i++) {
+        int name_len = snprintf(member, sizeof(member), "%s.npy", names[i]);
+        bool big_size = entries[i].size >= ZIP32_LIMIT;
+        bool big_offset = entries[i].offset >= ZIP32_LIMIT;
+        size_t extra = (big_size ? 16 : 0) + (big_offset ? 8 : 0);
+        unsigned char c[ZIP_CENTRAL_SIZE + 28];
+        memset(c, 0, sizeof(c));
+        fmt_put_u32(c, ZIP_CENTRAL_SIG);
+        fmt_put_u16(c + 4, extra ? 45 : 20);
+        fmt_put_u16(c + 6, extra ? 45 : 20);
+        fmt_put_u16(c + 14, 0x21);
+        fmt_put_u32(c + 16, entries[i].crc);
+        fmt_put_u32(c + 20, big_size ? ZIP32_LIMIT : (uint32_t)entries[i].size);
+        fmt_put_u32(c + 24, big_size ? ZIP32_LIMIT : (uint32_t)entries[i].size);
+        fmt_put_u16(c + 28, (uint16_t)name_len);
+        fmt_put_u16(c + 30, (uint16_t)(extra ? extra + 4 : 0));
+        fmt_put_u32(c + 42, big_offset ? ZIP32_LIMIT : (uint32_t)entries[i].offset);
+        size_t x = ZIP_CENTRAL_SIZE;
+        if (extra) {
+            fmt_put_u16(c + x, 0x0001);
+            fmt_put_u16(c + x + 2, (uint16_t)extra);
+            x += 4;
+            if (big_size) {
+                fmt_put_u64(c + x, entries[i].size);
+                fmt_put_u64(c + x + 8, entries[i].size);
+                x += 16;
+            }
+            if (big_offset) {
+                fmt_put_u64(c + x, entries[i].offset);
+                x += 8;
+            }
+        }
+        ok = fwrite(c, 1, ZIP_CENTRAL_SIZE, f) == ZIP_CENTRAL_SIZE &&
+             fwrite(member, 1, (size_t)name_len, f) == (size_t)name_len &&
+             fwrite(c + ZIP_CENTRAL_SIZE, 1, x - ZIP_CENTRAL_SIZE, f) == x - ZIP_CENTRAL_SIZE;
+        pos += x + (size_t)name_len;
+    }
+    uint64_t cd_size = pos - cd_offset;
+
+    /* End records, with ZIP64 versions when any field overflows */
+    bool zip64 = n >= 0xFFFF || cd_offset >= ZIP32_LIMIT || cd_size >= ZIP32_LIMIT;
+    if (ok && zip64) {
+        unsigned char z[ZIP64_END_SIZE + ZIP64_LOCATOR_SIZE];
+        memset(z, 0, sizeof(z));
+        fmt_put_u32(z, ZIP64_END_SIG);
+        fmt_put_u64(z + 4, ZIP64_END_SIZE - 12);
+        fmt_put_u16(z + 12, 45);
+        fmt_put_u16(z + 14, 45);
+        fmt_put_u64(z + 24, n);
+        fmt_put_u64(z + 32, n);
+        fmt_put_u64(z + 40, cd_size);
+        fmt_put_u64(z + 48, cd_offset);
+        fmt_put_u32(z + ZIP64_END_SIZE, ZIP64_LOCATOR_SIG);
+        fmt_put_u64(z + ZIP64_END_SIZE + 8, pos);
+        fmt_put_u32(z + ZIP64_END_SIZE + 16, 1);
+        ok = fwrite(z, 1, sizeof(z), f) == sizeof(z);
+    }
+    if (ok) {
+        unsigned char e[ZIP_END_SIZE];
+        memset(e, 0, sizeof(e));
+        fmt_put_u32(e, ZIP_END_SIG);
+        fmt_put_u16(e + 8, zip64 ? 0xFFFF : (uint16_t)n);
+        fmt_put_u16(e + 10, zip64 ? 0xFFFF : (uint16_t)n);
+        fmt_put_u32(e + 12, zip64 ? ZIP32_LIMIT : (uint32_t)cd_size);
+        fmt_put_u32(e + 16, zip64 ? ZIP32_LIMIT : (uint32_t)cd_offset);
+        ok = fwrite(e, 1, ZIP_END_SIZE, f) == ZIP_END_SIZE;
+    }
+    free(entries);
+    if (fclose(f) != 0) ok = false;
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file writer.c
+ * @brief Append-mode writer for tensors that grow along their first axis
+ * @author Muhammad Fiaz
+ *
+ * The writer produces the versioned format of tensr_save(). The header goes
+ * out first with zero rows, and the row count, payload size and checksum
+ * are patched in whenever the writer is flushed or closed. The file is
+ * therefore a valid tensor holding every row up to the last flush, even if
+ * the producer dies before closing it. Small appends are gathered into one
+ * large buffer and written together; appends larger than the buffer go
+ * straight to the file.
+ */
+
+#include "tensr/tensr.h"
+#include "file.h"
+#include "format.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define WRITER_BUFFER ((size_t)4 << 20)
+
+struct TensrWriter {
+    FILE* file;
+    FmtHeader header;     /* shape[0] and data_bytes count the rows appended so far */
+    FmtHash hash;
+    unsigned char* buf;   /* Pending little-endian payload bytes */
+    size_t buffered;
+    bool failed;          /* A write failed; every later call fails too */
+};
+
+/**
+ * @brief Write out the buffered bytes
+ */
+static bool write_buffer(TensrWriter* w) {
+    if (w->buffered == 0) return true;
+    if (w->header.flags & FMT_FLAG_CHECKSUM) fmt_hash_update(&w->hash, w->buf, w->buffered);
+    bool ok = fwrite(w->buf, 1, w->buffered, w->file) == w->buffered;
+    w->buffered = 0;
+    return ok;
+}
+
+/**
+ * @brief Open a file for writing a tensor row block by row block
+ * @param filename Path to output file (an existing file is replaced)
+ * @param dtype Element type
+ * @param inner_shape Shape of one row, i.e. every dimension after the first
+ * @param inner_ndim Number of dimensions in inner_shape (0 writes a 1-D tensor)
+ * @param opts Alignment and checksum settings, or NULL for the defaults;
+ *        compression is not supported
+ * @return Writer, or NULL if the file cannot be created or opts->codec is set
+ *
+ * Rows appended with tensr_writer_append() are stored along a growing first
+ * dimension. The result is an ordinary tensor file for tensr_load(),
+ * tensr_load_mmap() and tensr_load_slice(), so datasets of any size can be
+ * produced in bounded memory.
+ *
+ * Example:
+ *   TensrWriter* w = tensr_writer_open("features.bin", TENSR_FLOAT32,
+ *                                      (size_t[]){128}, 1, NULL);
+ *   while (next_batch(&batch)) tensr_writer_append(w, batch);   (batch: {n, 128})
+ *   tensr_writer_close(w);
+ */
+TensrWriter* tensr_writer_open(const char* filename, TensrDType dtype, const size_t* inner_shape,
+                               size_t inner_ndim, const TensrSaveOptions* opts) {
+    size_t shape[FMT_MAX_NDIM];
+    if (inner_ndim >= FMT_MAX_NDIM || (opts && opts->codec != TENSR_CODEC_NONE)) return NULL;
+    shape[0] = 0;
+    if (inner_ndim > 0) memcpy(shape + 1, inner_shape, inner_ndim * sizeof(size_t));
+
+    TensrWriter* w = (TensrWriter*)calloc(1, sizeof(TensrWriter));
+    if (!w) return NULL;
+    if (!fmt_init_header(&w->header, shape, inner_ndim + 1, dtype, opts ? opts->alignment : 0)) {
+        free(w);
+        return NULL;
+    }
+    if (opts && opts->checksum) w->header.flags |= FMT_FLAG_CHECKSUM;
+    fmt_hash_init(&w->hash);
+
+    unsigned char* header = (unsigned char*)calloc(1, (size_t)w->header.data_offset);
+    w->buf = (unsigned char*)malloc(WRITER_BUFFER);
+    w->file = header && w->buf ? fopen(filename, "wb") : NULL;
+    bool ok = w->file != NULL;
+    if (ok) {
+        fmt_encode_header(&w->header, header);
+        ok = fwrite(header, 1, (size_t)w->header.data_offset, w->file) == w->header.data_offset;
+    }
+    free(header);
+    if (!ok) {
+        if (w->file) fclose(w->file);
+        free(w->buf);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+/**
+ * @brief Append rows to a writer
+ * @param w Writer
+ * @param t Block of rows with shape {n, inner_shape...}, or a single row
+ *        with shape inner_shape; its dtype must match the writer's
+ * @return 0 on success, -1 on a mismatch or a write error
+ */
+int tensr_writer_append(TensrWriter* w, const Tensor* t) {
+    const FmtHeader* h = &w->header;
+    size_t inner = h->ndim - 1;
+    bool single = inner > 0 && t->ndim == inner;
+    if (w->failed || t->dtype != h->dtype || (!single && t->ndim != h->ndim)) return -1;
+    const size_t* tail = single ? t->shape : t->shape + 1;
+    for (size_t i = 0; i < inner; i++) {
+        if (tail[i] != h->shape[i + 1]) return -1;
+    }
+
+    size_t esize = tensr_dtype_size(t->dtype);
+    size_t bytes = t->size * esize;
+    bool ok = true;
+    if (bytes > WRITER_BUFFER - w->buffered) ok = write_buffer(w);
+    if (ok && bytes >= WRITER_BUFFER) {
+        FmtHash* hash = (h->flags & FMT_FLAG_CHECKSUM) ? &w->hash : NULL;
+        ok = fmt_write_payload(w->file, t->data, t->size, esize, hash);
+    } else if (ok) {
+        unsigned char* dst = w->buf + w->buffered;
+        memcpy(dst, t->data, bytes);
+        if (!fmt_host_little_endian()) fmt_swap_elements(dst, t->size, esize);
+        w->buffered += bytes;
+    }
+    if (!ok) {
+        w->failed = true;
+        return -1;
+    }
+    w->header.shape[0] += single ? 1 : t->shape[0];
+    w->header.data_bytes += bytes;
+    return 0;
+}
+
+/**
+ * @brief Number of rows appended so far
+ */
+size_t tensr_writer_rows(const TensrWriter* w) {
+    return w->header.shape[0];
+}
+
+/**
+ * @brief Write buffered rows and patch the header to cover them
+ * @param w Writer
+ * @return 0 on success, -1 on a write error
+ *
+ * After a flush, readers opening the file see every row appended so far.
+ */
+int tensr_writer_flush(TensrWriter* w) {
+    unsigned char header[FMT_FIXED_SIZE + 8 * FMT_MAX_NDIM];
+    FmtHeader* h = &w->header;
+    bool ok = !w->failed && write_buffer(w);
+    if (ok) {
+        if (h->flags & FMT_FLAG_CHECKSUM) h->checksum = fmt_hash_digest(&w->hash);
+        fmt_encode_header(h, header);
+        size_t size = fmt_header_size(h->ndim);
+        ok = io_fseek(w->file, 0) && fwrite(header, 1, size, w->file) == size &&
+             io_fseek(w->file, h->data_offset + h->data_bytes) && fflush(w->file) == 0;
+    }
+    if (!ok) w->failed = true;
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Flush and close a writer
+ * @param w Writer (NULL is ignored)
+ * @return 0 if every row reached the file, -1 otherwise
+ */
+int tensr_writer_close(TensrWriter* w) {
+    if (!w) return 0;
+    int status = tensr_writer_flush(w);
+    if (fclose(w->file) != 0) status = -1;
+    free(w->buf);
+    free(w);
+    return status;
+}
@@ -8,6 +8,7 @@
  */
 
 #include "tensr/tensr.h"
+#include "../autograd/autograd.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -100,6 +101,7 @@ Tensor* tensr_matmul(const Tensor* a, const Tensor* b) {
             }
         }
     }
+    autograd_record(AG_MATMUL, result, a, b, 0.0);
     return result;
 }
 
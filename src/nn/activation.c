@@ -0,0 +1,174 @@
+/**
+ * @file activation.c
+ * @brief Fused activation functions (ReLU, GELU, SiLU, sigmoid, tanh)
+ * @author Muhammad Fiaz
+ *
+ * Implements activation functions as single-pass kernels with allocating,
+ * in-place (trailing underscore) and caller-provided output (_out) forms,
+ * plus a fused bias + activation kernel for the epilogue of a matmul.
+ */
+
+#include "tensr/tensr.h"
+#include "../core/parallel.h"
+#include "../autograd/autograd.h"
+#include <stdlib.h>
+#include <math.h>
+
+/* Elements per parallel task when no bias row structure is given */
+#define ACT_BLOCK 4096
+
+/**
+ * @brief Macro to generate typed activation kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ * @param EXP Exponential function matching T
+ * @param TANH Hyperbolic tangent matching T
+ * @param ERF Error function matching T
+ *
+ * The input is split into rows of cols elements. When bias is non-NULL it has
+ * cols elements and is added to every row before the activation. The switch
+ * is hoisted out of the element loop so each inner loop is a straight-line
+ * expression the compiler can vectorize. x and y may alias (in-place).
+ */
+#define ACT_KERNELS(suffix, T, EXP, TANH, ERF) \
+static void act_##suffix(TensrActivation act, const T* x, const T* bias, T* y, \
+                         size_t n, size_t cols) { \
+    size_t rows = (n + cols - 1) / cols; \
+    TENSR_PARALLEL_FOR(n >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t r = 0; r < (ptrdiff_t)rows; r++) { \
+        size_t start = (size_t)r * cols; \
+        size_t len = n - start < cols ? n - start : cols; \
+        const T* xr = x + start; \
+        T* yr = y + start; \
+        switch (act) { \
+            case TENSR_ACT_RELU: \
+                for (size_t j = 0; j < len; j++) { \
+                    T v = xr[j] + (bias ? bias[j] : (T)0); \
+                    yr[j] = v > (T)0 ? v : (T)0; \
+                } \
+                break; \
+            case TENSR_ACT_GELU: \
+                for (size_t j = 0; j < len; j++) { \
+                    T v = xr[j] + (bias ? bias[j] : (T)0); \
+                    yr[j] = (T)0.5 * v * ((T)1 + ERF(v * (T)0.70710678118654752440)); \
+                } \
+                break; \
+            case TENSR_ACT_SILU: \
+                for (size_t j = 0; j < len; j++) { \
+                    T v = xr[j] + (bias ? bias[j] : (T)0); \
+                    yr[j] = v / ((T)1 + EXP(-v)); \
+                } \
+                break; \
+            case TENSR_ACT_SIGMOID: \
+                for (size_t j = 0; j < len; j++) { \
+                    T v = xr[j] + (bias ? bias[j] : (T)0); \
+                    yr[j] = (T)1 / ((T)1 + EXP(-v)); \
+                } \
+                break; \
+            case TENSR_ACT_TANH: \
+                for (size_t j = 0; j < len; j++) { \
+                    T v = xr[j] + (bias ? bias[j] : (T)0); \
+                    yr[j] = TANH(v); \
+                } \
+                break; \
+            default: \
+                for (size_t j = 0; j < len; j++) { \
+                    yr[j] = xr[j] + (bias ? bias[j] : (T)0); \
+                } \
+                break; \
+        } \
+    } \
+}
+
+ACT_KERNELS(f32, float, expf, tanhf, erff)
+ACT_KERNELS(f64, double, exp, tanh, erf)
+
+/**
+ * @brief Apply an activation (optionally after a bias add) into out
+ * @param act Activation to apply
+ * @param x Input tensor
+ * @param bias Optional bias broadcast over the last dimension (NULL for none)
+ * @param out Output tensor (may be x for in-place operation)
+ * @return 0 on success, -1 on shape or dtype mismatch
+ */
+static int apply_activation(TensrActivation act, const Tensor* x, const Tensor* bias, Tensor* out) {
+    if (out->size != x->size || out->dtype != x->dtype) return -1;
+
+    size_t cols = ACT_BLOCK;
+    if (bias) {
+        if (x->ndim == 0 || bias->dtype != x->dtype) return -1;
+        cols = x->shape[x->ndim - 1];
+        if (bias->size != cols) return -1;
+    }
+    if (x->size == 0 || cols == 0) return 0;
+
+    if (x->dtype == TENSR_FLOAT32) {
+        act_f32(act, (const float*)x->data, bias ? (const float*)bias->data : NULL,
+                (float*)out->data, x->size, cols);
+    } else if (x->dtype == TENSR_FLOAT64) {
+        act_f64(act, (const double*)x->data, bias ? (const double*)bias->data : NULL,
+                (double*)out->data, x->size, cols);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Macro to generate allocating, in-place and _out activation functions
+ * @param name Activation name
+ * @param act TensrActivation value
+ * @param grad_op Autograd operation recorded by the allocating form
+ *
+ * Generates tensr_<name>(t), tensr_<name>_(t) and tensr_<name>_out(t, out).
+ * The in-place and _out forms return the tensor they wrote to, or NULL if the
+ * dtype is unsupported or the shapes do not match. Only the allocating form
+ * is recorded for autograd.
+ */
+#define ACTIVATION_FUNC(name, act, grad_op) \
+Tensor* tensr_##name(const Tensor* t) { \
+    Tensor* result = tensr_create(t->shape, t->ndim, t->dtype, t->device); \
+    if (!result) return NULL; \
+    if (apply_activation(act, t, NULL, result) != 0) { \
+        tensr_free(result); \
+        return NULL; \
+    } \
+    autograd_record(grad_op, result, t, NULL, 0.0); \
+    return result; \
+} \
+Tensor* tensr_##name##_(Tensor* t) { \
+    return apply_activation(act, t, NULL, t) == 0 ? t : NULL; \
+} \
+Tensor* tensr_##name##_out(const Tensor* t, Tensor* out) { \
+    return apply_activation(act, t, NULL, out) == 0 ? out : NULL; \
+}
+
+ACTIVATION_FUNC(relu, TENSR_ACT_RELU, AG_RELU)
+ACTIVATION_FUNC(gelu, TENSR_ACT_GELU, AG_GELU)
+ACTIVATION_FUNC(silu, TENSR_ACT_SILU, AG_SILU)
+ACTIVATION_FUNC(sigmoid, TENSR_ACT_SIGMOID, AG_SIGMOID)
+ACTIVATION_FUNC(tanh, TENSR_ACT_TANH, AG_TANH)
+
+/**
+ * @brief Fused bias add and activation
+ * @param x Input tensor, typically the output of a matmul
+ * @param bias Bias with one element per entry of the last dimension (NULL for none)
+ * @param act Activation to apply after the bias (TENSR_ACT_NONE for bias only)
+ * @return New tensor with act(x + bias), or NULL on invalid arguments
+ *
+ * Computes the common linear-layer epilogue in a single pass instead of a
+ * separate add followed by an activation.
+ *
+ * Example:
+ *   Tensor* h = tensr_matmul(x, w);
+ *   Tensor* y = tensr_bias_act(h, b, TENSR_ACT_GELU);
+ */
+Tensor* tensr_bias_act(const Tensor* x, const Tensor* bias, TensrActivation act) {
+    Tensor* result = tensr_create(x->shape, x->ndim, x->dtype, x->device);
+    if (!result) return NULL;
+    if (apply_activation(act, x, bias, result) != 0) {
+        tensr_free(result);
+        return NULL;
+    }
+    return result;
+}
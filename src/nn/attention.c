@@ -0,0 +1,225 @@
+/**
+ * @file attention.c
+ * @brief Memory-efficient scaled dot-product attention
+ * @author Muhammad Fiaz
+ *
+ * Implements attention in the tiled "flash attention" style: keys and values
+ * are visited one tile at a time while a running maximum and running sum per
+ * query row implement an online softmax. The full (seq x seq) score matrix is
+ * never materialized, so memory use is O(seq * head_dim) instead of O(seq^2).
+ */
+
+#include "tensr/tensr.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Query rows processed together by one task */
+#define ATTN_BLOCK_Q 32
+/* Keys visited per tile; the score tile is ATTN_BLOCK_Q x ATTN_BLOCK_K */
+#define ATTN_BLOCK_K 64
+
+/**
+ * @brief Mask layout resolved from the mask tensor
+ */
+typedef struct {
+    const void* data;   /* NULL when there is no mask */
+    TensrDType dtype;   /* TENSR_BOOL for keep-masks, float for additive bias */
+    size_t batch_stride; /* 0 when one mask is shared by every batch entry */
+} AttnMask;
+
+/**
+ * @brief Macro to generate typed tiled attention kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ * @param EXP Exponential function matching T
+ *
+ * The two tile products (Q * K^T and P * V) are small register-friendly GEMM
+ * micro-kernels: the first is a row-by-row dot product because keys are
+ * stored row-major, the second accumulates rows of V with an i-p-j loop
+ * order so the innermost loop is contiguous and vectorizes.
+ */
+#define ATTENTION_KERNELS(suffix, T, EXP) \
+static void attn_scores_##suffix(const T* q, const T* k, T* s, size_t nq, size_t nk, \
+                                 size_t d, T scale) { \
+    for (size_t i = 0; i < nq; i++) { \
+        const T* qi = q + i * d; \
+        for (size_t j = 0; j < nk; j++) { \
+            const T* kj = k + j * d; \
+            T dot = 0; \
+            for (size_t p = 0; p < d; p++) dot += qi[p] * kj[p]; \
+            s[i * ATTN_BLOCK_K + j] = dot * scale; \
+        } \
+    } \
+} \
+static void attn_accumulate_##suffix(const T* p, const T* v, T* acc, size_t nq, size_t nk, \
+                                     size_t dv) { \
+    for (size_t i = 0; i < nq; i++) { \
+        T* ai = acc + i * dv; \
+        for (size_t j = 0; j < nk; j++) { \
+            T pij = p[i * ATTN_BLOCK_K + j]; \
+            if (pij == 0) continue; \
+            const T* vj = v + j * dv; \
+            for (size_t c = 0; c < dv; c++) ai[c] += pij * vj[c]; \
+        } \
+    } \
+} \
+static void attention_##suffix(const T* q, const T* k, const T* v, const AttnMask* mask, \
+                               T* out, size_t batch, size_t lq, size_t lk, size_t d, \
+                               size_t dv, T scale, bool causal) { \
+    size_t nqb = (lq + ATTN_BLOCK_Q - 1) / ATTN_BLOCK_Q; \
+    size_t tasks = batch * nqb; \
+    /* Causal alignment: query i sees keys j <= i + (lk - lq) */ \
+    ptrdiff_t offset = (ptrdiff_t)lk - (ptrdiff_t)lq; \
+    TENSR_PARALLEL_FOR(batch * lq * lk * d >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t task = 0; task < (ptrdiff_t)tasks; task++) { \
+        size_t b = (size_t)task / nqb; \
+        size_t q0 = ((size_t)task % nqb) * ATTN_BLOCK_Q; \
+        size_t nq = lq - q0 < ATTN_BLOCK_Q ? lq - q0 : ATTN_BLOCK_Q; \
+        const T* qb = q + (b * lq + q0) * d; \
+        const T* kb = k + b * lk * d; \
+        const T* vb = v + b * lk * dv; \
+        T* ob = out + (b * lq + q0) * dv; \
+        T* s = (T*)malloc((ATTN_BLOCK_Q * ATTN_BLOCK_K + 2 * ATTN_BLOCK_Q) * sizeof(T)); \
+        T* acc = (T*)calloc(nq * dv, sizeof(T)); \
+        if (!s || !acc) { \
+            free(s); \
+            free(acc); \
+            memset(ob, 0, nq * dv * sizeof(T)); \
+            continue; \
+        } \
+        T* m = s + ATTN_BLOCK_Q * ATTN_BLOCK_K; \
+        T* l = m + ATTN_BLOCK_Q; \
+        for (size_t i = 0; i < nq; i++) { \
+            m[i] = (T)-INFINITY; \
+            l[i] = 0; \
+        } \
+        for (size_t k0 = 0; k0 < lk; k0 += ATTN_BLOCK_K) { \
+            if (causal && (ptrdiff_t)k0 > (ptrdiff_t)(q0 + nq - 1) + offset) break; \
+            size_t nk = lk - k0 < ATTN_BLOCK_K ? lk - k0 : ATTN_BLOCK_K; \
+            attn_scores_##suffix(qb, kb + k0 * d, s, nq, nk, d, scale); \
+            for (size_t i = 0; i < nq; i++) { \
+                T* si = s + i * ATTN_BLOCK_K; \
+                size_t qi = q0 + i; \
+                if (mask->data) { \
+                    size_t base = b * mask->batch_stride + qi * lk + k0; \
+                    if (mask->dtype == TENSR_BOOL) { \
+                        const bool* mk = (const bool*)mask->data + base; \
+                        for (size_t j = 0; j < nk; j++) if (!mk[j]) si[j] = (T)-INFINITY; \
+                    } else { \
+                        const T* mk = (const T*)mask->data + base; \
+                        for (size_t j = 0; j < nk; j++) si[j] += mk[j]; \
+                    } \
+                } \
+                if (causal) { \
+                    for (size_t j = 0; j < nk; j++) { \
+                        if ((ptrdiff_t)(k0 + j) > (ptrdiff_t)qi + offset) si[j] = (T)-INFINITY; \
+                    } \
+                } \
+                T tile_max = (T)-INFINITY; \
+                for (size_t j = 0; j < nk; j++) if (si[j] > tile_max) tile_max = si[j]; \
+                T new_m = tile_max > m[i] ? tile_max : m[i]; \
+                if (new_m == (T)-INFINITY) { \
+                    for (size_t j = 0; j < nk; j++) si[j] = 0; \
+                    continue; \
+                } \
+                T alpha = m[i] == (T)-INFINITY ? (T)0 : EXP(m[i] - new_m); \
+                T row_sum = 0; \
+                for (size_t j = 0; j < nk; j++) { \
+                    si[j] = EXP(si[j] - new_m); \
+                    row_sum += si[j]; \
+                } \
+                l[i] = l[i] * alpha + row_sum; \
+                m[i] = new_m; \
+                if (alpha != (T)1) { \
+                    T* ai = acc + i * dv; \
+                    for (size_t c = 0; c < dv; c++) ai[c] *= alpha; \
+                } \
+            } \
+            attn_accumulate_##suffix(s, vb + k0 * dv, acc, nq, nk, dv); \
+        } \
+        for (size_t i = 0; i < nq; i++) { \
+            T inv = l[i] > 0 ? (T)1 / l[i] : (T)0; \
+            for (size_t c = 0; c < dv; c++) ob[i * dv + c] = acc[i * dv + c] * inv; \
+        } \
+        free(s); \
+        free(acc); \
+    } \
+}
+
+ATTENTION_KERNELS(f32, float, expf)
+ATTENTION_KERNELS(f64, double, exp)
+
+/**
+ * @brief Scaled dot-product attention without materializing the score matrix
+ * @param q Queries of shape (..., Lq, D)
+ * @param k Keys of shape (..., Lk, D)
+ * @param v Values of shape (..., Lk, Dv)
+ * @param mask Optional mask (NULL for none) of shape (Lq, Lk) or (..., Lq, Lk).
+ *             A TENSR_BOOL mask keeps positions that are true; a mask with the
+ *             same dtype as q is added to the scores.
+ * @param scale Score scale factor (<= 0 selects 1/sqrt(D))
+ * @param causal Whether query i may only attend to keys j <= i + (Lk - Lq)
+ * @return New tensor of shape (..., Lq, Dv), or NULL on invalid arguments
+ *
+ * Computes softmax(q * k^T * scale + mask) * v with a tiled online softmax.
+ * Leading dimensions are treated as independent batch/head entries and must
+ * match between q, k and v. Query rows whose keys are all masked produce zeros.
+ *
+ * Example:
+ *   Tensor* q = tensr_randn((size_t[]){8, 1024, 64}, 3, TENSR_CPU);
+ *   Tensor* out = tensr_attention(q, k, v, NULL, 0.0, true);
+ */
+Tensor* tensr_attention(const Tensor* q, const Tensor* k, const Tensor* v, const Tensor* mask,
+                        double scale, bool causal) {
+    if (q->ndim < 2 || k->ndim != q->ndim || v->ndim != q->ndim) return NULL;
+    if (q->dtype != k->dtype || q->dtype != v->dtype) return NULL;
+    if (q->dtype != TENSR_FLOAT32 && q->dtype != TENSR_FLOAT64) return NULL;
+
+    size_t nd = q->ndim;
+    size_t lq = q->shape[nd - 2];
+    size_t d = q->shape[nd - 1];
+    size_t lk = k->shape[nd - 2];
+    size_t dv = v->shape[nd - 1];
+    if (k->shape[nd - 1] != d || v->shape[nd - 2] != lk) return NULL;
+
+    size_t batch = 1;
+    for (size_t i = 0; i < nd - 2; i++) {
+        if (k->shape[i] != q->shape[i] || v->shape[i] != q->shape[i]) return NULL;
+        batch *= q->shape[i];
+    }
+
+    AttnMask am = {NULL, TENSR_BOOL, 0};
+    if (mask) {
+        if (mask->dtype != TENSR_BOOL && mask->dtype != q->dtype) return NULL;
+        if (mask->size == lq * lk) {
+            am.batch_stride = 0;
+        } else if (mask->size == batch * lq * lk) {
+            am.batch_stride = lq * lk;
+        } else {
+            return NULL;
+        }
+        am.data = mask->data;
+        am.dtype = mask->dtype;
+    }
+
+    if (scale <= 0.0) scale = d > 0 ? 1.0 / sqrt((double)d) : 1.0;
+
+    size_t* shape = (size_t*)malloc(nd * sizeof(size_t));
+    if (!shape) return NULL;
+    memcpy(shape, q->shape, nd * sizeof(size_t));
+    shape[nd - 1] = dv;
+    Tensor* result = tensr_create(shape, nd, q->dtype, q->device);
+    free(shape);
+    if (!result) return NULL;
+
+    if (q->dtype == TENSR_FLOAT32) {
+        attention_f32((const float*)q->data, (const float*)k->data, (const float*)v->data, &am,
+                      (float*)result->data, batch, lq, lk, d, dv, (float)scale, causal);
+    } else {
+        attention_f64((const double*)q->data, (const double*)k->data, (const double*)v->data, &am,
+                      (double*)result->data, batch, lq, lk, d, dv, scale, causal);
+    }
+    return result;
+}
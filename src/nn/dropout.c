@@ -0,0 +1,141 @@
+/**
+ * @file dropout.c
+ * @brief Fused dropout with a bit-packed keep mask
+ * @author Muhammad Fiaz
+ *
+ * Dropout draws one Philox word per element, compares it against an integer
+ * threshold, scales the kept elements and packs the keep bits, all in a
+ * single pass. No random or mask tensor of the input's size is materialized.
+ * Element i uses word i % 4 of counter block i / 4, so results do not depend
+ * on the thread count.
+ */
+
+#include "tensr/tensr.h"
+#include "../random/rng.h"
+#include "../core/parallel.h"
+#include <math.h>
+
+/**
+ * @brief Integer keep threshold: an element is kept when its word is >= this
+ *
+ * p = 1 gives 2^32, which no 32-bit word reaches.
+ */
+static uint64_t drop_threshold(double p) {
+    return (uint64_t)llround(p * 4294967296.0);
+}
+
+/**
+ * @brief Generate dropout kernels for one dtype
+ *
+ * Each iteration handles eight elements (two Philox blocks) and writes one
+ * mask byte, so threads never share a mask byte.
+ */
+#define DROPOUT_KERNEL(suffix, T) \
+static void dropout_##suffix(const PhiloxState* s, const T* x, T* y, uint8_t* mask, size_t n, \
+                             uint64_t threshold, T scale) { \
+    size_t groups = (n + 7) / 8; \
+    TENSR_PARALLEL_FOR(n >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t g = 0; g < (ptrdiff_t)groups; g++) { \
+        uint32_t r[8]; \
+        size_t i = (size_t)g * 8; \
+        philox_block(s, (uint64_t)g * 2, r); \
+        philox_block(s, (uint64_t)g * 2 + 1, r + 4); \
+        uint8_t bits = 0; \
+        for (size_t l = 0; l < 8 && i + l < n; l++) { \
+            bool keep = r[l] >= threshold; \
+            y[i + l] = keep ? x[i + l] * scale : (T)0; \
+            bits |= (uint8_t)keep << l; \
+        } \
+        if (mask) mask[g] = bits; \
+    } \
+}
+
+DROPOUT_KERNEL(f32, float)
+DROPOUT_KERNEL(f64, double)
+
+/**
+ * @brief Apply dropout in one pass
+ * @param x Input tensor (float32 or float64)
+ * @param p Probability of zeroing an element, in [0, 1]
+ * @param gen Generator (NULL for the default generator)
+ * @param out_mask If not NULL, receives a UINT8 tensor of shape ((size + 7) / 8)
+ *        where bit i % 8 of byte i / 8 is set when element i was kept
+ * @return New tensor with kept elements scaled by 1 / (1 - p), or NULL on invalid input
+ *
+ * Example:
+ *   Tensor* mask = NULL;
+ *   Tensor* h = tensr_dropout(x, 0.1, gen, &mask);
+ *   Tensor* dx = tensr_dropout_backward(dy, mask, 0.1);
+ */
+Tensor* tensr_dropout(const Tensor* x, double p, TensrGenerator* gen, Tensor** out_mask) {
+    if (out_mask) *out_mask = NULL;
+    if (!x || (x->dtype != TENSR_FLOAT32 && x->dtype != TENSR_FLOAT64)) return NULL;
+    if (!(p >= 0.0 && p <= 1.0)) return NULL;
+
+    Tensor* y = tensr_create(x->shape, x->ndim, x->dtype, x->device);
+    if (!y) return NULL;
+    uint8_t* mask = NULL;
+    if (out_mask) {
+        size_t mshape[] = {(x->size + 7) / 8};
+        *out_mask = tensr_create(mshape, 1, TENSR_UINT8, x->device);
+        if (!*out_mask) {
+            tensr_free(y);
+            return NULL;
+        }
+        mask = (uint8_t*)(*out_mask)->data;
+    }
+
+    PhiloxState s = rng_reserve(gen, x->size);
+    uint64_t threshold = drop_threshold(p);
+    double scale = p < 1.0 ? 1.0 / (1.0 - p) : 0.0;
+    if (x->dtype == TENSR_FLOAT32) {
+        dropout_f32(&s, (const float*)x->data, (float*)y->data, mask, x->size, threshold,
+                    (float)scale);
+    } else {
+        dropout_f64(&s, (const double*)x->data, (double*)y->data, mask, x->size, threshold,
+                    scale);
+    }
+    return y;
+}
+
+#define DROPOUT_BACKWARD_KERNEL(suffix, T) \
+static void dropout_backward_##suffix(const T* dy, T* dx, const uint8_t* mask, size_t n, \
+                                      T scale) { \
+    TENSR_PARALLEL_FOR(n >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)n; i++) { \
+        bool keep = (mask[i >> 3] >> (i & 7)) & 1; \
+        dx[i] = keep ? dy[i] * scale : (T)0; \
+    } \
+}
+
+DROPOUT_BACKWARD_KERNEL(f32, float)
+DROPOUT_BACKWARD_KERNEL(f64, double)
+
+/**
+ * @brief Gradient of dropout from the bit-packed mask
+ * @param grad Gradient with respect to the dropout output (float32 or float64)
+ * @param mask Mask produced by tensr_dropout() for an input of the same size
+ * @param p Drop probability used in the forward pass
+ * @return New tensor holding grad * mask / (1 - p), or NULL on invalid input
+ *
+ * Can also be used to apply the same mask to another tensor.
+ */
+Tensor* tensr_dropout_backward(const Tensor* grad, const Tensor* mask, double p) {
+    if (!grad || !mask) return NULL;
+    if (grad->dtype != TENSR_FLOAT32 && grad->dtype != TENSR_FLOAT64) return NULL;
+    if (mask->dtype != TENSR_UINT8 || mask->size != (grad->size + 7) / 8) return NULL;
+    if (!(p >= 0.0 && p <= 1.0)) return NULL;
+
+    Tensor* dx = tensr_create(grad->shape, grad->ndim, grad->dtype, grad->device);
+    if (!dx) return NULL;
+    double scale = p < 1.0 ? 1.0 / (1.0 - p) : 0.0;
+    const uint8_t* m = (const uint8_t*)mask->data;
+    if (grad->dtype == TENSR_FLOAT32) {
+        dropout_backward_f32((const float*)grad->data, (float*)dx->data, m, grad->size,
+                             (float)scale);
+    } else {
+        dropout_backward_f64((const double*)grad->data, (double*)dx->data, m, grad->size,
+                             scale);
+    }
+    return dx;
+}
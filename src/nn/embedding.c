@@ -0,0 +1,176 @@
+/**
+ * @file embedding.c
+ * @brief Embedding lookup and pooled embedding bags
+ * @author Muhammad Fiaz
+ *
+ * Implements row gathers from an embedding table. Embedding bags reduce the
+ * gathered rows of each bag directly into the output, so the (n_indices x dim)
+ * intermediate is never materialized. Upcoming table rows are prefetched to
+ * hide the latency of random accesses into large tables.
+ */
+
+#include "tensr/tensr.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EMBED_PREFETCH(p) __builtin_prefetch((p), 0, 0)
+#else
+#define EMBED_PREFETCH(p) ((void)(p))
+#endif
+
+/* How many lookups ahead to prefetch table rows */
+#define EMBED_PREFETCH_DISTANCE 4
+
+/**
+ * @brief Read index i from an int32 or int64 index tensor
+ */
+static int64_t index_at(const Tensor* idx, size_t i) {
+    if (idx->dtype == TENSR_INT32) return ((const int32_t*)idx->data)[i];
+    return ((const int64_t*)idx->data)[i];
+}
+
+/**
+ * @brief Check that every index refers to a row of the table
+ * @param idx Index tensor (int32 or int64)
+ * @param rows Number of rows in the table
+ * @return true if all indices are in [0, rows)
+ */
+static bool indices_ok(const Tensor* idx, size_t rows) {
+    if (idx->dtype != TENSR_INT32 && idx->dtype != TENSR_INT64) return false;
+    for (size_t i = 0; i < idx->size; i++) {
+        int64_t r = index_at(idx, i);
+        if (r < 0 || (uint64_t)r >= rows) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Look up rows of an embedding table
+ * @param table Embedding table of shape (num_embeddings, dim)
+ * @param indices Integer tensor (int32 or int64) of any shape
+ * @return New tensor of shape indices.shape + (dim), or NULL on invalid input
+ *
+ * Gathers table[indices[i]] for every index. Works for any table dtype.
+ *
+ * Example:
+ *   Tensor* ids = tensr_randint(0, 1000, (size_t[]){32, 16}, 2, TENSR_CPU);
+ *   Tensor* emb = tensr_embedding(table, ids);  (shape {32, 16, dim})
+ */
+Tensor* tensr_embedding(const Tensor* table, const Tensor* indices) {
+    if (table->ndim != 2 || !indices_ok(indices, table->shape[0])) return NULL;
+
+    size_t dim = table->shape[1];
+    size_t row_bytes = dim * tensr_dtype_size(table->dtype);
+
+    size_t* shape = (size_t*)malloc((indices->ndim + 1) * sizeof(size_t));
+    if (!shape) return NULL;
+    memcpy(shape, indices->shape, indices->ndim * sizeof(size_t));
+    shape[indices->ndim] = dim;
+    Tensor* result = tensr_create(shape, indices->ndim + 1, table->dtype, table->device);
+    free(shape);
+    if (!result) return NULL;
+
+    const char* src = (const char*)table->data;
+    char* dst = (char*)result->data;
+    size_t n = indices->size;
+
+    TENSR_PARALLEL_FOR(n * dim >= TENSR_PARALLEL_GRAIN)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)n; i++) {
+        if ((size_t)i + EMBED_PREFETCH_DISTANCE < n) {
+            EMBED_PREFETCH(src + (size_t)index_at(indices, (size_t)i + EMBED_PREFETCH_DISTANCE) * row_bytes);
+        }
+        memcpy(dst + (size_t)i * row_bytes, src + (size_t)index_at(indices, (size_t)i) * row_bytes, row_bytes);
+    }
+    return result;
+}
+
+/**
+ * @brief Macro to generate typed embedding-bag kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ *
+ * Each bag is reduced straight into its output row. Bags are independent and
+ * run in parallel; within a bag the next rows are prefetched.
+ */
+#define EMBEDDING_BAG_KERNEL(suffix, T) \
+static void embedding_bag_##suffix(const T* table, size_t dim, const Tensor* indices, \
+                                   const Tensor* offsets, TensrEmbeddingMode mode, T* out) { \
+    size_t nbags = offsets->size; \
+    size_t n = indices->size; \
+    TENSR_PARALLEL_FOR(n * dim >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t b = 0; b < (ptrdiff_t)nbags; b++) { \
+        size_t start = (size_t)index_at(offsets, (size_t)b); \
+        size_t stop = (size_t)b + 1 < nbags ? (size_t)index_at(offsets, (size_t)b + 1) : n; \
+        T* yr = out + (size_t)b * dim; \
+        if (start >= stop) { \
+            memset(yr, 0, dim * sizeof(T)); \
+            continue; \
+        } \
+        const T* first = table + (size_t)index_at(indices, start) * dim; \
+        memcpy(yr, first, dim * sizeof(T)); \
+        for (size_t i = start + 1; i < stop; i++) { \
+            if (i + EMBED_PREFETCH_DISTANCE < stop) { \
+                EMBED_PREFETCH(table + (size_t)index_at(indices, i + EMBED_PREFETCH_DISTANCE) * dim); \
+            } \
+            const T* row = table + (size_t)index_at(indices, i) * dim; \
+            if (mode == TENSR_EMBED_MAX) { \
+                for (size_t j = 0; j < dim; j++) if (row[j] > yr[j]) yr[j] = row[j]; \
+            } else { \
+                for (size_t j = 0; j < dim; j++) yr[j] += row[j]; \
+            } \
+        } \
+        if (mode == TENSR_EMBED_MEAN) { \
+            T inv = (T)1 / (T)(stop - start); \
+            for (size_t j = 0; j < dim; j++) yr[j] *= inv; \
+        } \
+    } \
+}
+
+EMBEDDING_BAG_KERNEL(f32, float)
+EMBEDDING_BAG_KERNEL(f64, double)
+
+/**
+ * @brief Pooled embedding lookup over variable-length bags
+ * @param table Embedding table of shape (num_embeddings, dim), float32 or float64
+ * @param indices 1D integer tensor (int32 or int64) of all lookups, bag after bag
+ * @param offsets 1D integer tensor with the start position of each bag in indices
+ * @param mode Pooling mode (TENSR_EMBED_SUM, TENSR_EMBED_MEAN or TENSR_EMBED_MAX)
+ * @return New tensor of shape (num_bags, dim), or NULL on invalid input
+ *
+ * Bag b covers indices[offsets[b] : offsets[b + 1]] (the last bag runs to the
+ * end of indices). Empty bags produce zero rows. Offsets must be
+ * non-decreasing and start at or after 0.
+ *
+ * Example:
+ *   Tensor* pooled = tensr_embedding_bag(table, ids, offsets, TENSR_EMBED_MEAN);
+ */
+Tensor* tensr_embedding_bag(const Tensor* table, const Tensor* indices, const Tensor* offsets,
+                            TensrEmbeddingMode mode) {
+    if (table->ndim != 2 || indices->ndim != 1 || offsets->ndim != 1) return NULL;
+    if (table->dtype != TENSR_FLOAT32 && table->dtype != TENSR_FLOAT64) return NULL;
+    if (!indices_ok(indices, table->shape[0])) return NULL;
+    if (offsets->dtype != TENSR_INT32 && offsets->dtype != TENSR_INT64) return NULL;
+
+    int64_t prev = 0;
+    for (size_t b = 0; b < offsets->size; b++) {
+        int64_t o = index_at(offsets, b);
+        if (o < prev || (uint64_t)o > indices->size) return NULL;
+        prev = o;
+    }
+
+    size_t dim = table->shape[1];
+    size_t shape[2] = {offsets->size, dim};
+    Tensor* result = tensr_create(shape, 2, table->dtype, table->device);
+    if (!result) return NULL;
+
+    if (table->dtype == TENSR_FLOAT32) {
+        embedding_bag_f32((const float*)table->data, dim, indices, offsets, mode,
+                          (float*)result->data);
+    } else {
+        embedding_bag_f64((const double*)table->data, dim, indices, offsets, mode,
+                          (double*)result->data);
+    }
+    return result;
+}
@@ -0,0 +1,256 @@
+/**
+ * @file normalization.c
+ * @brief Fused normalization kernels (layer norm, RMS norm, batch norm)
+ * @author Muhammad Fiaz
+ *
+ * Implements normalization layers as single fused kernels. Each row (or
+ * channel plane) is read from memory once and written once, with the
+ * statistics computed while the row is still in cache. Rows are independent
+ * and are processed in parallel when OpenMP is enabled.
+ */
+
+#include "tensr/tensr.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+#include <math.h>
+
+/**
+ * @brief Split a tensor into (rows, cols) around a normalization axis
+ * @param x Input tensor
+ * @param axis First normalized axis (negative counts from the end)
+ * @param rows Output: number of independent rows
+ * @param cols Output: number of elements normalized together
+ * @return 0 on success, -1 if the axis is out of range
+ *
+ * All dimensions from axis to the last one are normalized together, matching
+ * the normalized_shape convention of common deep learning frameworks.
+ */
+static int split_rows(const Tensor* x, int axis, size_t* rows, size_t* cols) {
+    if (axis < 0) axis += (int)x->ndim;
+    if (axis < 0 || (size_t)axis >= x->ndim) return -1;
+
+    *rows = 1;
+    *cols = 1;
+    for (size_t i = 0; i < (size_t)axis; i++) *rows *= x->shape[i];
+    for (size_t i = (size_t)axis; i < x->ndim; i++) *cols *= x->shape[i];
+    return 0;
+}
+
+/**
+ * @brief Check that an optional affine parameter matches the input
+ * @param p Parameter tensor (may be NULL)
+ * @param x Input tensor
+ * @param n Required number of elements
+ * @return true if p is NULL or has the right size and dtype
+ */
+static bool param_ok(const Tensor* p, const Tensor* x, size_t n) {
+    return p == NULL || (p->size == n && p->dtype == x->dtype);
+}
+
+/**
+ * @brief Macro to generate typed fused normalization row kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ *
+ * Statistics are accumulated in double precision for both float32 and
+ * float64 inputs so that long rows do not lose accuracy.
+ */
+#define NORM_KERNELS(suffix, T) \
+static void layer_norm_##suffix(const T* x, const T* gamma, const T* beta, T* out, \
+                                size_t rows, size_t cols, double eps) { \
+    TENSR_PARALLEL_FOR(rows * cols >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t r = 0; r < (ptrdiff_t)rows; r++) { \
+        const T* xr = x + (size_t)r * cols; \
+        T* yr = out + (size_t)r * cols; \
+        double sum = 0.0; \
+        for (size_t j = 0; j < cols; j++) sum += xr[j]; \
+        double mean = sum / (double)cols; \
+        double var = 0.0; \
+        for (size_t j = 0; j < cols; j++) { \
+            double d = xr[j] - mean; \
+            var += d * d; \
+        } \
+        T inv_std = (T)(1.0 / sqrt(var / (double)cols + eps)); \
+        T m = (T)mean; \
+        for (size_t j = 0; j < cols; j++) { \
+            T v = (xr[j] - m) * inv_std; \
+            if (gamma) v *= gamma[j]; \
+            if (beta) v += beta[j]; \
+            yr[j] = v; \
+        } \
+    } \
+} \
+static void rms_norm_##suffix(const T* x, const T* gamma, T* out, \
+                              size_t rows, size_t cols, double eps) { \
+    TENSR_PARALLEL_FOR(rows * cols >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t r = 0; r < (ptrdiff_t)rows; r++) { \
+        const T* xr = x + (size_t)r * cols; \
+        T* yr = out + (size_t)r * cols; \
+        double sumsq = 0.0; \
+        for (size_t j = 0; j < cols; j++) sumsq += (double)xr[j] * xr[j]; \
+        T inv_rms = (T)(1.0 / sqrt(sumsq / (double)cols + eps)); \
+        for (size_t j = 0; j < cols; j++) { \
+            T v = xr[j] * inv_rms; \
+            if (gamma) v *= gamma[j]; \
+            yr[j] = v; \
+        } \
+    } \
+} \
+static void batch_norm_##suffix(const T* x, const double* scale, const double* shift, \
+                                T* out, size_t planes, size_t channels, size_t inner) { \
+    TENSR_PARALLEL_FOR(planes * inner >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t p = 0; p < (ptrdiff_t)planes; p++) { \
+        size_t c = (size_t)p % channels; \
+        T a = (T)scale[c]; \
+        T b = (T)shift[c]; \
+        const T* xp = x + (size_t)p * inner; \
+        T* yp = out + (size_t)p * inner; \
+        for (size_t j = 0; j < inner; j++) yp[j] = xp[j] * a + b; \
+    } \
+}
+
+NORM_KERNELS(f32, float)
+NORM_KERNELS(f64, double)
+
+/**
+ * @brief Layer normalization over trailing dimensions
+ * @param x Input tensor (float32 or float64)
+ * @param gamma Optional scale with one element per normalized value (NULL for none)
+ * @param beta Optional shift with one element per normalized value (NULL for none)
+ * @param eps Small constant added to the variance for numerical stability
+ * @param axis First normalized axis (-1 normalizes only the last dimension)
+ * @return New normalized tensor, or NULL on invalid arguments
+ *
+ * Computes y = (x - mean) / sqrt(var + eps) * gamma + beta where mean and
+ * var are taken over all dimensions from axis to the end. The whole
+ * operation is one fused kernel instead of a chain of mean/sub/mul/sqrt/div.
+ *
+ * Example:
+ *   Tensor* x = tensr_randn((size_t[]){32, 768}, 2, TENSR_CPU);
+ *   Tensor* y = tensr_layer_norm(x, gamma, beta, 1e-5, -1);
+ */
+Tensor* tensr_layer_norm(const Tensor* x, const Tensor* gamma, const Tensor* beta, double eps, int axis) {
+    size_t rows, cols;
+    if (split_rows(x, axis, &rows, &cols) != 0) return NULL;
+    if (!param_ok(gamma, x, cols) || !param_ok(beta, x, cols)) return NULL;
+
+    Tensor* result = tensr_create(x->shape, x->ndim, x->dtype, x->device);
+    if (!result) return NULL;
+
+    if (x->dtype == TENSR_FLOAT32) {
+        layer_norm_f32((const float*)x->data,
+                       gamma ? (const float*)gamma->data : NULL,
+                       beta ? (const float*)beta->data : NULL,
+                       (float*)result->data, rows, cols, eps);
+    } else if (x->dtype == TENSR_FLOAT64) {
+        layer_norm_f64((const double*)x->data,
+                       gamma ? (const double*)gamma->data : NULL,
+                       beta ? (const double*)beta->data : NULL,
+                       (double*)result->data, rows, cols, eps);
+    } else {
+        tensr_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+/**
+ * @brief Root-mean-square normalization over trailing dimensions
+ * @param x Input tensor (float32 or float64)
+ * @param gamma Optional scale with one element per normalized value (NULL for none)
+ * @param eps Small constant added to the mean square for numerical stability
+ * @param axis First normalized axis (-1 normalizes only the last dimension)
+ * @return New normalized tensor, or NULL on invalid arguments
+ *
+ * Computes y = x / sqrt(mean(x^2) + eps) * gamma in a single fused pass.
+ *
+ * Example:
+ *   Tensor* y = tensr_rms_norm(x, gamma, 1e-6, -1);
+ */
+Tensor* tensr_rms_norm(const Tensor* x, const Tensor* gamma, double eps, int axis) {
+    size_t rows, cols;
+    if (split_rows(x, axis, &rows, &cols) != 0) return NULL;
+    if (!param_ok(gamma, x, cols)) return NULL;
+
+    Tensor* result = tensr_create(x->shape, x->ndim, x->dtype, x->device);
+    if (!result) return NULL;
+
+    if (x->dtype == TENSR_FLOAT32) {
+        rms_norm_f32((const float*)x->data,
+                     gamma ? (const float*)gamma->data : NULL,
+                     (float*)result->data, rows, cols, eps);
+    } else if (x->dtype == TENSR_FLOAT64) {
+        rms_norm_f64((const double*)x->data,
+                     gamma ? (const double*)gamma->data : NULL,
+                     (double*)result->data, rows, cols, eps);
+    } else {
+        tensr_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+/**
+ * @brief Read element i of a float tensor as double
+ */
+static double param_at(const Tensor* p, size_t i) {
+    if (p->dtype == TENSR_FLOAT32) return ((const float*)p->data)[i];
+    return ((const double*)p->data)[i];
+}
+
+/**
+ * @brief Inference-mode batch normalization
+ * @param x Input tensor of shape (N, C, ...) (float32 or float64)
+ * @param running_mean Per-channel mean (C elements)
+ * @param running_var Per-channel variance (C elements)
+ * @param gamma Optional per-channel scale (NULL for none)
+ * @param beta Optional per-channel shift (NULL for none)
+ * @param eps Small constant added to the variance for numerical stability
+ * @return New normalized tensor, or NULL on invalid arguments
+ *
+ * Folds the running statistics and affine parameters into one scale and
+ * shift per channel, then applies y = x * scale + shift in a single pass.
+ *
+ * Example:
+ *   Tensor* y = tensr_batch_norm(x, mean, var, gamma, beta, 1e-5);
+ */
+Tensor* tensr_batch_norm(const Tensor* x, const Tensor* running_mean, const Tensor* running_var,
+                         const Tensor* gamma, const Tensor* beta, double eps) {
+    if (x->ndim < 2 || !running_mean || !running_var) return NULL;
+    if (x->dtype != TENSR_FLOAT32 && x->dtype != TENSR_FLOAT64) return NULL;
+
+    size_t channels = x->shape[1];
+    size_t inner = 1;
+    for (size_t i = 2; i < x->ndim; i++) inner *= x->shape[i];
+    size_t planes = x->shape[0] * channels;
+
+    if (!param_ok(running_mean, x, channels) || !param_ok(running_var, x, channels) ||
+        !param_ok(gamma, x, channels) || !param_ok(beta, x, channels)) {
+        return NULL;
+    }
+
+    double* scale = (double*)malloc(2 * channels * sizeof(double));
+    if (!scale) return NULL;
+    double* shift = scale + channels;
+
+    for (size_t c = 0; c < channels; c++) {
+        double s = 1.0 / sqrt(param_at(running_var, c) + eps);
+        if (gamma) s *= param_at(gamma, c);
+        scale[c] = s;
+        shift[c] = (beta ? param_at(beta, c) : 0.0) - param_at(running_mean, c) * s;
+    }
+
+    Tensor* result = tensr_create(x->shape, x->ndim, x->dtype, x->device);
+    if (result) {
+        if (x->dtype == TENSR_FLOAT32) {
+            batch_norm_f32((const float*)x->data, scale, shift, (float*)result->data,
+                           planes, channels, inner);
+        } else {
+            batch_norm_f64((const double*)x->data, scale, shift, (double*)result->data,
+                           planes, channels, inner);
+        }
+    }
+
+    free(scale);
+    return result;
+}
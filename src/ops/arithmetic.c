@@ -9,6 +9,7 @@
  */
 
 #include "tensr/tensr.h"
+#include "../autograd/autograd.h"
 #include <stdlib.h>
 #include <math.h>
 
@@ -16,11 +17,12 @@
  * @brief Macro to generate element-wise binary operations
  * @param name Operation name
  * @param op C operator to apply
+ * @param grad_op Autograd operation recorded for the result
  * 
  * Generates functions for element-wise binary operations that work across
  * all supported data types (float32, float64, int32, int64).
  */
-#define BINARY_OP(name, op) \
+#define BINARY_OP(name, op, grad_op) \
 Tensor* tensr_##name(const Tensor* a, const Tensor* b) { \
     if (a->size != b->size || a->dtype != b->dtype) return NULL; \
     Tensor* result = tensr_create(a->shape, a->ndim, a->dtype, a->device); \
@@ -46,23 +48,25 @@ Tensor* tensr_##name(const Tensor* a, const Tensor* b) { \
         int64_t* rr = (int64_t*)result->data; \
         for (size_t i = 0; i < a->size; i++) rr[i] = ra[i] op rb[i]; \
     } \
+    autograd_record(grad_op, result, a, b, 0.0); \
     return result; \
 }
 
-BINARY_OP(add, +)
-BINARY_OP(sub, -)
-BINARY_OP(mul, *)
-BINARY_OP(div, /)
+BINARY_OP(add, +, AG_ADD)
+BINARY_OP(sub, -, AG_SUB)
+BINARY_OP(mul, *, AG_MUL)
+BINARY_OP(div, /, AG_DIV)
 
 /**
  * @brief Macro to generate element-wise unary mathematical functions
  * @param name Function name
  * @param func C math function to apply
+ * @param grad_op Autograd operation recorded for the result (AG_NONE if not differentiable)
  * 
  * Generates functions for element-wise unary operations using standard
  * C math library functions (sqrt, exp, log, sin, cos, tan, etc.).
  */
-#define UNARY_FUNC(name, func) \
+#define UNARY_FUNC(name, func, grad_op) \
 Tensor* tensr_##name(const Tensor* t) { \
     Tensor* result = tensr_create(t->shape, t->ndim, t->dtype, t->device); \
     if (!result) return NULL; \
@@ -75,19 +79,20 @@ Tensor* tensr_##name(const Tensor* t) { \
         double* rr = (double*)result->data; \
         for (size_t i = 0; i < t->size; i++) rr[i] = func(rt[i]); \
     } \
+    autograd_record(grad_op, result, t, NULL, 0.0); \
     return result; \
 }
 
-UNARY_FUNC(sqrt, sqrt)
-UNARY_FUNC(exp, exp)
-UNARY_FUNC(log, log)
-UNARY_FUNC(abs, fabs)
-UNARY_FUNC(sin, sin)
-UNARY_FUNC(cos, cos)
-UNARY_FUNC(tan, tan)
-UNARY_FUNC(arcsin, asin)
-UNARY_FUNC(arccos, acos)
-UNARY_FUNC(arctan, atan)
+UNARY_FUNC(sqrt, sqrt, AG_SQRT)
+UNARY_FUNC(exp, exp, AG_EXP)
+UNARY_FUNC(log, log, AG_LOG)
+UNARY_FUNC(abs, fabs, AG_ABS)
+UNARY_FUNC(sin, sin, AG_SIN)
+UNARY_FUNC(cos, cos, AG_COS)
+UNARY_FUNC(tan, tan, AG_NONE)
+UNARY_FUNC(arcsin, asin, AG_NONE)
+UNARY_FUNC(arccos, acos, AG_NONE)
+UNARY_FUNC(arctan, atan, AG_NONE)
 
 /**
  * @brief Raise tensor elements to a power
@@ -114,6 +119,7 @@ Tensor* tensr_pow(const Tensor* a, double exponent) {
         double* rr = (double*)result->data;
         for (size_t i = 0; i < a->size; i++) rr[i] = pow(ra[i], exponent);
     }
+    autograd_record(AG_POW, result, a, NULL, exponent);
     return result;
 }
 
@@ -149,6 +155,7 @@ Tensor* tensr_neg(const Tensor* t) {
         int64_t* rr = (int64_t*)result->data;
         for (size_t i = 0; i < t->size; i++) rr[i] = -rt[i];
     }
+    autograd_record(AG_NEG, result, t, NULL, 0.0);
     return result;
 }
 
@@ -8,25 +8,23 @@
  */
 
 #include "tensr/tensr.h"
+#include "../autograd/autograd.h"
 #include <stdlib.h>
 #include <float.h>
 #include <math.h>
 
 /**
- * @brief Sum of tensor elements
+ * @brief Sum of tensor elements without autograd recording
  * @param t Input tensor
  * @param axes Array of axes to reduce over (NULL for all)
  * @param naxes Number of axes (0 for all)
  * @param keepdims Whether to keep reduced dimensions
  * @return New tensor with sum values
- * 
- * Computes the sum of tensor elements along specified axes.
- * 
- * Example:
- *   Tensor* t = tensr_ones((size_t[]){2, 3}, 2, TENSR_FLOAT32, TENSR_CPU);
- *   Tensor* sum = tensr_sum(t, NULL, 0, false);
+ *
+ * Shared by tensr_sum() and tensr_mean() so that each records exactly one
+ * operation for its result.
  */
-Tensor* tensr_sum(const Tensor* t, int* axes, size_t naxes, bool keepdims) {
+static Tensor* sum_impl(const Tensor* t, int* axes, size_t naxes, bool keepdims) {
     if (naxes == 0) {
         size_t shape[1] = {1};
         Tensor* result = tensr_create(shape, keepdims ? t->ndim : 1, t->dtype, t->device);
@@ -48,6 +46,26 @@ Tensor* tensr_sum(const Tensor* t, int* axes, size_t naxes, bool keepdims) {
     return NULL;
 }
 
+/**
+ * @brief Sum of tensor elements
+ * @param t Input tensor
+ * @param axes Array of axes to reduce over (NULL for all)
+ * @param naxes Number of axes (0 for all)
+ * @param keepdims Whether to keep reduced dimensions
+ * @return New tensor with sum values
+ * 
+ * Computes the sum of tensor elements along specified axes.
+ * 
+ * Example:
+ *   Tensor* t = tensr_ones((size_t[]){2, 3}, 2, TENSR_FLOAT32, TENSR_CPU);
+ *   Tensor* sum = tensr_sum(t, NULL, 0, false);
+ */
+Tensor* tensr_sum(const Tensor* t, int* axes, size_t naxes, bool keepdims) {
+    Tensor* result = sum_impl(t, axes, naxes, keepdims);
+    autograd_record(AG_SUM, result, t, NULL, 0.0);
+    return result;
+}
+
 /**
  * @brief Mean of tensor elements
  * @param t Input tensor
@@ -63,7 +81,7 @@ Tensor* tensr_sum(const Tensor* t, int* axes, size_t naxes, bool keepdims) {
  *   Tensor* mean = tensr_mean(t, NULL, 0, false);
  */
 Tensor* tensr_mean(const Tensor* t, int* axes, size_t naxes, bool keepdims) {
-    Tensor* sum_result = tensr_sum(t, axes, naxes, keepdims);
+    Tensor* sum_result = sum_impl(t, axes, naxes, keepdims);
     if (!sum_result) return NULL;
 
     if (t->dtype == TENSR_FLOAT32) {
@@ -73,6 +91,7 @@ Tensor* tensr_mean(const Tensor* t, int* axes, size_t naxes, bool keepdims) {
         double* data = (double*)sum_result->data;
         data[0] /= (double)t->size;
     }
+    autograd_record(AG_MEAN, sum_result, t, NULL, 0.0);
     return sum_result;
 }
 
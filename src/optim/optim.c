@@ -0,0 +1,293 @@
+/**
+ * @file optim.c
+ * @brief Fused multi-tensor optimizer updates (SGD, Adam, AdamW)
+ * @author Muhammad Fiaz
+ *
+ * Implements optimizer steps that update parameters, gradients and moment
+ * buffers in place in a single pass. Every call takes lists of tensors: all
+ * tensors are cut into fixed-size chunks and the chunks of the whole list are
+ * processed in one parallel loop, so thousands of small parameters cost one
+ * launch instead of one pass per tensor per operation.
+ */
+
+#include "tensr/tensr.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+#include <math.h>
+
+/* Elements per work item in a multi-tensor update */
+#define OPTIM_CHUNK 16384
+
+/**
+ * @brief A contiguous slice of one tensor in a multi-tensor update
+ */
+typedef struct {
+    size_t tensor;
+    size_t start;
+    size_t len;
+} OptimChunk;
+
+/**
+ * @brief Hyperparameters shared by all optimizer kernels
+ */
+typedef struct {
+    double lr;
+    double momentum;
+    double weight_decay;
+    bool nesterov;
+    double beta1;
+    double beta2;
+    double eps;
+    double bias_correction1;
+    double bias_correction2;
+    bool decoupled;
+} OptimParams;
+
+/**
+ * @brief Check that a state tensor list matches the parameters
+ * @param params Parameter tensors
+ * @param state State tensors (gradients or moment buffers)
+ * @param n Number of tensors
+ * @return true if every state tensor has the size and dtype of its parameter
+ */
+static bool state_ok(Tensor** params, Tensor** state, size_t n) {
+    if (!state) return false;
+    for (size_t i = 0; i < n; i++) {
+        if (!state[i] || state[i]->size != params[i]->size ||
+            state[i]->dtype != params[i]->dtype) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Split a list of tensors into fixed-size chunks
+ * @param params Parameter tensors
+ * @param n Number of tensors
+ * @param nchunks Output: number of chunks
+ * @return Newly allocated chunk array (caller frees), or NULL on failure
+ */
+static OptimChunk* make_chunks(Tensor** params, size_t n, size_t* nchunks) {
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) total += (params[i]->size + OPTIM_CHUNK - 1) / OPTIM_CHUNK;
+
+    OptimChunk* chunks = (OptimChunk*)malloc((total ? total : 1) * sizeof(OptimChunk));
+    if (!chunks) return NULL;
+
+    size_t c = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t start = 0; start < params[i]->size; start += OPTIM_CHUNK) {
+            size_t left = params[i]->size - start;
+            chunks[c].tensor = i;
+            chunks[c].start = start;
+            chunks[c].len = left < OPTIM_CHUNK ? left : OPTIM_CHUNK;
+            c++;
+        }
+    }
+    *nchunks = total;
+    return chunks;
+}
+
+/**
+ * @brief Macro to generate typed fused optimizer kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ * @param SQRT Square root function matching T
+ */
+#define OPTIM_KERNELS(suffix, T, SQRT) \
+static void sgd_##suffix(T* p, const T* g, T* buf, size_t n, const OptimParams* hp) { \
+    T lr = (T)hp->lr, mu = (T)hp->momentum, wd = (T)hp->weight_decay; \
+    for (size_t i = 0; i < n; i++) { \
+        T d = g[i] + wd * p[i]; \
+        if (buf) { \
+            T b = mu * buf[i] + d; \
+            buf[i] = b; \
+            d = hp->nesterov ? d + mu * b : b; \
+        } \
+        p[i] -= lr * d; \
+    } \
+} \
+static void adam_##suffix(T* p, const T* g, T* m, T* v, size_t n, const OptimParams* hp) { \
+    T lr = (T)hp->lr, wd = (T)hp->weight_decay; \
+    T b1 = (T)hp->beta1, b2 = (T)hp->beta2, eps = (T)hp->eps; \
+    T step = (T)(hp->lr / hp->bias_correction1); \
+    T inv_bc2 = (T)(1.0 / sqrt(hp->bias_correction2)); \
+    T decay = hp->decoupled ? (T)1 - lr * wd : (T)1; \
+    T l2 = hp->decoupled ? (T)0 : wd; \
+    for (size_t i = 0; i < n; i++) { \
+        T gi = g[i] + l2 * p[i]; \
+        T mi = b1 * m[i] + ((T)1 - b1) * gi; \
+        T vi = b2 * v[i] + ((T)1 - b2) * gi * gi; \
+        m[i] = mi; \
+        v[i] = vi; \
+        p[i] = p[i] * decay - step * mi / (SQRT(vi) * inv_bc2 + eps); \
+    } \
+}
+
+OPTIM_KERNELS(f32, float, sqrtf)
+OPTIM_KERNELS(f64, double, sqrt)
+
+/**
+ * @brief Run an SGD or Adam-family update over all chunks of a tensor list
+ * @param adam Whether to run the Adam kernel (otherwise SGD)
+ * @param params Parameter tensors
+ * @param grads Gradient tensors
+ * @param s1 Momentum buffers (SGD, may be NULL) or first moments (Adam)
+ * @param s2 Second moments (Adam only)
+ * @param n Number of tensors
+ * @param hp Hyperparameters
+ * @return 0 on success, -1 on failure
+ */
+static int multi_tensor_step(bool adam, Tensor** params, Tensor** grads, Tensor** s1, Tensor** s2,
+                             size_t n, const OptimParams* hp) {
+    size_t nchunks;
+    OptimChunk* chunks = make_chunks(params, n, &nchunks);
+    if (!chunks) return -1;
+
+    TENSR_PARALLEL_FOR(nchunks > 1)
+    for (ptrdiff_t c = 0; c < (ptrdiff_t)nchunks; c++) {
+        const OptimChunk* ch = &chunks[c];
+        size_t t = ch->tensor;
+        size_t off = ch->start;
+        if (params[t]->dtype == TENSR_FLOAT32) {
+            float* p = (float*)params[t]->data + off;
+            const float* g = (const float*)grads[t]->data + off;
+            if (adam) {
+                adam_f32(p, g, (float*)s1[t]->data + off, (float*)s2[t]->data + off, ch->len, hp);
+            } else {
+                sgd_f32(p, g, s1 ? (float*)s1[t]->data + off : NULL, ch->len, hp);
+            }
+        } else {
+            double* p = (double*)params[t]->data + off;
+            const double* g = (const double*)grads[t]->data + off;
+            if (adam) {
+                adam_f64(p, g, (double*)s1[t]->data + off, (double*)s2[t]->data + off, ch->len, hp);
+            } else {
+                sgd_f64(p, g, s1 ? (double*)s1[t]->data + off : NULL, ch->len, hp);
+            }
+        }
+    }
+
+    free(chunks);
+    return 0;
+}
+
+/**
+ * @brief Check that all parameters are float32 or float64
+ */
+static bool params_ok(Tensor** params, size_t n) {
+    if (!params) return false;
+    for (size_t i = 0; i < n; i++) {
+        if (!params[i]) return false;
+        if (params[i]->dtype != TENSR_FLOAT32 && params[i]->dtype != TENSR_FLOAT64) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Fused SGD step over a list of parameters
+ * @param params Parameter tensors, updated in place
+ * @param grads Gradient tensors (same sizes and dtypes as params)
+ * @param momentum_bufs Momentum buffers, updated in place (NULL when momentum is 0).
+ *                      Buffers should start zeroed.
+ * @param n Number of parameter tensors
+ * @param lr Learning rate
+ * @param momentum Momentum factor
+ * @param weight_decay L2 penalty added to the gradient
+ * @param nesterov Whether to use Nesterov momentum
+ * @return 0 on success, -1 on failure
+ *
+ * Computes d = g + weight_decay * p, buf = momentum * buf + d,
+ * p -= lr * (nesterov ? d + momentum * buf : buf) in a single pass.
+ *
+ * Example:
+ *   tensr_sgd_step(params, grads, bufs, nparams, 0.01, 0.9, 0.0, false);
+ */
+int tensr_sgd_step(Tensor** params, Tensor** grads, Tensor** momentum_bufs, size_t n,
+                   double lr, double momentum, double weight_decay, bool nesterov) {
+    if (!params_ok(params, n) || !state_ok(params, grads, n)) return -1;
+    if (momentum != 0.0 && !state_ok(params, momentum_bufs, n)) return -1;
+
+    OptimParams hp = {0};
+    hp.lr = lr;
+    hp.momentum = momentum;
+    hp.weight_decay = weight_decay;
+    hp.nesterov = nesterov;
+    return multi_tensor_step(false, params, grads, momentum != 0.0 ? momentum_bufs : NULL, NULL,
+                             n, &hp);
+}
+
+/**
+ * @brief Shared implementation of Adam and AdamW
+ */
+static int adam_step(Tensor** params, Tensor** grads, Tensor** exp_avg, Tensor** exp_avg_sq,
+                     size_t n, double lr, double beta1, double beta2, double eps,
+                     double weight_decay, int64_t step, bool decoupled) {
+    if (step < 1) return -1;
+    if (!params_ok(params, n) || !state_ok(params, grads, n) ||
+        !state_ok(params, exp_avg, n) || !state_ok(params, exp_avg_sq, n)) {
+        return -1;
+    }
+
+    OptimParams hp = {0};
+    hp.lr = lr;
+    hp.weight_decay = weight_decay;
+    hp.beta1 = beta1;
+    hp.beta2 = beta2;
+    hp.eps = eps;
+    hp.bias_correction1 = 1.0 - pow(beta1, (double)step);
+    hp.bias_correction2 = 1.0 - pow(beta2, (double)step);
+    hp.decoupled = decoupled;
+    return multi_tensor_step(true, params, grads, exp_avg, exp_avg_sq, n, &hp);
+}
+
+/**
+ * @brief Fused Adam step over a list of parameters
+ * @param params Parameter tensors, updated in place
+ * @param grads Gradient tensors
+ * @param exp_avg First moment estimates, updated in place (start zeroed)
+ * @param exp_avg_sq Second moment estimates, updated in place (start zeroed)
+ * @param n Number of parameter tensors
+ * @param lr Learning rate
+ * @param beta1 First moment decay rate
+ * @param beta2 Second moment decay rate
+ * @param eps Term added to the denominator for numerical stability
+ * @param weight_decay L2 penalty added to the gradient
+ * @param step 1-based step number used for bias correction
+ * @return 0 on success, -1 on failure
+ *
+ * Example:
+ *   tensr_adam_step(params, grads, m, v, nparams, 1e-3, 0.9, 0.999, 1e-8, 0.0, step);
+ */
+int tensr_adam_step(Tensor** params, Tensor** grads, Tensor** exp_avg, Tensor** exp_avg_sq,
+                    size_t n, double lr, double beta1, double beta2, double eps,
+                    double weight_decay, int64_t step) {
+    return adam_step(params, grads, exp_avg, exp_avg_sq, n, lr, beta1, beta2, eps,
+                     weight_decay, step, false);
+}
+
+/**
+ * @brief Fused AdamW step over a list of parameters
+ * @param params Parameter tensors, updated in place
+ * @param grads Gradient tensors
+ * @param exp_avg First moment estimates, updated in place (start zeroed)
+ * @param exp_avg_sq Second moment estimates, updated in place (start zeroed)
+ * @param n Number of parameter tensors
+ * @param lr Learning rate
+ * @param beta1 First moment decay rate
+ * @param beta2 Second moment decay rate
+ * @param eps Term added to the denominator for numerical stability
+ * @param weight_decay Decoupled weight decay (p *= 1 - lr * weight_decay)
+ * @param step 1-based step number used for bias correction
+ * @return 0 on success, -1 on failure
+ *
+ * Same as tensr_adam_step() except that weight decay is applied directly to
+ * the parameters instead of being added to the gradient.
+ */
+int tensr_adamw_step(Tensor** params, Tensor** grads, Tensor** exp_avg, Tensor** exp_avg_sq,
+                     size_t n, double lr, double beta1, double beta2, double eps,
+                     double weight_decay, int64_t step) {
+    return adam_step(params, grads, exp_avg, exp_avg_sq, n, lr, beta1, beta2, eps,
+                     weight_decay, step, true);
+}
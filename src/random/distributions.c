@@ -0,0 +1,500 @@
+/**
+ * @file distributions.c
+ * @brief Bernoulli, exponential, gamma, beta, Poisson, binomial and categorical sampling
+ * @author Muhammad Fiaz
+ *
+ * Every sampler writes straight into the requested dtype in a single pass.
+ * Each element owns one Philox counter block and reads its random words from
+ * that block and then its spill stream, so rejection samplers may consume any
+ * number of words without breaking reproducibility across thread counts.
+ */
+
+#include "tensr/tensr.h"
+#include "rng.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+#include <math.h>
+
+/* Elements per thread below which a fill is not split (samplers are heavier than copies) */
+#define DIST_PARALLEL_GRAIN (TENSR_PARALLEL_GRAIN / 8)
+
+/* Below this mean, Poisson and binomial samplers use inversion */
+#define DIST_INVERSION_MEAN 10.0
+
+typedef enum {
+    DIST_BERNOULLI,
+    DIST_EXPONENTIAL,
+    DIST_GAMMA,
+    DIST_BETA,
+    DIST_POISSON,
+    DIST_BINOMIAL
+} DistKind;
+
+/**
+ * @brief A distribution with its parameters and precomputed constants
+ */
+typedef struct {
+    DistKind kind;
+    double a;
+    double b;
+    double c[8];
+} Dist;
+
+/**
+ * @brief log(k!) for k >= 0 (thread-safe replacement for lgamma(k + 1))
+ */
+static double log_factorial(double k) {
+    static const double table[10] = {
+        0.0, 0.0, 0.69314718055994531, 1.79175946922805500, 3.17805383034794562,
+        4.78749174278204599, 6.57925121201010100, 8.52516136106541430,
+        10.60460290274525023, 12.80182748008146961
+    };
+    if (k < 10.0) return table[(int)k];
+    double x = k + 1.0;
+    double x2 = x * x;
+    return (x - 0.5) * log(x) - x + 0.91893853320467274 +
+           (1.0 / 12.0 - (1.0 / 360.0 - 1.0 / (1260.0 * x2)) / x2) / x;
+}
+
+/**
+ * @brief Gamma(k, 1) sample (Marsaglia-Tsang; boosted for k < 1)
+ */
+static double sample_gamma(PhiloxSpill* sp, double k) {
+    double boost = 1.0;
+    if (k < 1.0) {
+        boost = pow(rng_uniform_open0(sp), 1.0 / k);
+        k += 1.0;
+    }
+    double d = k - 1.0 / 3.0;
+    double c = 1.0 / sqrt(9.0 * d);
+    for (;;) {
+        double x, v;
+        do {
+            x = rng_normal(sp);
+            v = 1.0 + c * x;
+        } while (v <= 0.0);
+        v = v * v * v;
+        double u = rng_uniform_open0(sp);
+        double x2 = x * x;
+        if (u < 1.0 - 0.0331 * x2 * x2) return d * v * boost;
+        if (log(u) < 0.5 * x2 + d * (1.0 - v + log(v))) return d * v * boost;
+    }
+}
+
+/**
+ * @brief Poisson sample: sequential inversion for small means, PTRS otherwise
+ *
+ * PTRS is Hoermann's transformed rejection with squeeze; c[] holds its
+ * constants (see dist_prepare).
+ */
+static double sample_poisson(PhiloxSpill* sp, const Dist* d) {
+    double lam = d->a;
+    if (lam < DIST_INVERSION_MEAN) {
+        double u = rng_uniform(sp);
+        double p = d->c[0];
+        double k = 0.0;
+        while (u > p && k < 1000.0) {
+            u -= p;
+            k += 1.0;
+            p *= lam / k;
+        }
+        return k;
+    }
+    double b = d->c[0], a = d->c[1], inv_alpha = d->c[2], vr = d->c[3], log_lam = d->c[4];
+    for (;;) {
+        double u = rng_uniform(sp) - 0.5;
+        double v = rng_uniform_open0(sp);
+        double us = 0.5 - fabs(u);
+        double k = floor((2.0 * a / us + b) * u + lam + 0.43);
+        if (us >= 0.07 && v <= vr) return k;
+        if (k < 0.0 || (us < 0.013 && v > us)) continue;
+        if (log(v) + log(inv_alpha) - log(a / (us * us) + b) <=
+            -lam + k * log_lam - log_factorial(k)) {
+            return k;
+        }
+    }
+}
+
+/**
+ * @brief Binomial sample: inversion for small n*p, BTRS otherwise
+ *
+ * Samples with p' = min(p, 1 - p) and reflects, so both branches see p' <= 0.5.
+ */
+static double sample_binomial(PhiloxSpill* sp, const Dist* d) {
+    double n = d->a;
+    double p = d->c[0];
+    double k;
+    if (n * p < DIST_INVERSION_MEAN) {
+        double q = 1.0 - p;
+        double bound = fmin(n, n * p + 10.0 * sqrt(n * p * q + 1.0));
+        for (;;) {
+            double u = rng_uniform(sp);
+            double px = d->c[1];
+            k = 0.0;
+            while (u > px) {
+                u -= px;
+                k += 1.0;
+                if (k > bound) break;
+                px *= (n - k + 1.0) * p / (k * q);
+            }
+            if (k <= bound) break;
+        }
+    } else {
+        double b = d->c[2], a = d->c[3], c = d->c[4];
+        double vr = d->c[5], alpha = d->c[6], lpq = d->c[7];
+        double m = floor((n + 1.0) * p);
+        double h = log_factorial(m) + log_factorial(n - m);
+        for (;;) {
+            double u = rng_uniform(sp) - 0.5;
+            double v = rng_uniform_open0(sp);
+            double us = 0.5 - fabs(u);
+            k = floor((2.0 * a / us + b) * u + c);
+            if (k < 0.0 || k > n) continue;
+            if (us >= 0.07 && v <= vr) break;
+            v = log(v * alpha / (a / (us * us) + b));
+            if (v <= h - log_factorial(k) - log_factorial(n - k) + (k - m) * lpq) break;
+        }
+    }
+    return d->b > 0.5 ? n - k : k;
+}
+
+/**
+ * @brief Draw one sample of a distribution from an element stream
+ */
+static double sample_one(const Dist* d, PhiloxSpill* sp) {
+    switch (d->kind) {
+        case DIST_BERNOULLI:
+            return rng_uniform(sp) < d->a ? 1.0 : 0.0;
+        case DIST_EXPONENTIAL:
+            return -log(rng_uniform_open0(sp)) * d->c[0];
+        case DIST_GAMMA:
+            return sample_gamma(sp, d->a) * d->b;
+        case DIST_BETA: {
+            double x = sample_gamma(sp, d->a);
+            double y = sample_gamma(sp, d->b);
+            if (x + y > 0.0) return x / (x + y);
+            /* Both underflowed (tiny a and b): the limit is Bernoulli(a / (a + b)) */
+            return rng_uniform(sp) < d->a / (d->a + d->b) ? 1.0 : 0.0;
+        }
+        case DIST_POISSON:
+            return sample_poisson(sp, d);
+        case DIST_BINOMIAL:
+            return sample_binomial(sp, d);
+    }
+    return 0.0;
+}
+
+/**
+ * @brief Precompute per-distribution constants
+ */
+static void dist_prepare(Dist* d) {
+    switch (d->kind) {
+        case DIST_EXPONENTIAL:
+            d->c[0] = 1.0 / d->a;
+            break;
+        case DIST_POISSON:
+            if (d->a < DIST_INVERSION_MEAN) {
+                d->c[0] = exp(-d->a);
+            } else {
+                double slam = sqrt(d->a);
+                double b = 0.931 + 2.53 * slam;
+                d->c[0] = b;
+                d->c[1] = -0.059 + 0.02483 * b;
+                d->c[2] = 1.1239 + 1.1328 / (b - 3.4);
+                d->c[3] = 0.9277 - 3.6224 / (b - 2.0);
+                d->c[4] = log(d->a);
+            }
+            break;
+        case DIST_BINOMIAL: {
+            double n = d->a;
+            double p = d->b > 0.5 ? 1.0 - d->b : d->b;
+            double q = 1.0 - p;
+            d->c[0] = p;
+            if (n * p < DIST_INVERSION_MEAN) {
+                d->c[1] = pow(q, n);
+            } else {
+                double spq = sqrt(n * p * q);
+                double b = 1.15 + 2.53 * spq;
+                d->c[1] = spq;
+                d->c[2] = b;
+                d->c[3] = -0.0873 + 0.0248 * b + 0.01 * p;
+                d->c[4] = n * p + 0.5;
+                d->c[5] = 0.92 - 4.2 / b;
+                d->c[6] = (2.83 + 5.1 / b) * spq;
+                d->c[7] = log(p / q);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Macro to generate typed distribution fill kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ * @param MAXV Largest value representable in T (samples are clamped to it)
+ */
+#define DIST_KERNEL(suffix, T, MAXV) \
+static void dist_fill_##suffix(const PhiloxState* s, const Dist* d, T* data, size_t n) { \
+    TENSR_PARALLEL_FOR(n >= DIST_PARALLEL_GRAIN) \
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)n; i++) { \
+        PhiloxSpill sp; \
+        rng_stream_init(&sp, s, (uint64_t)i); \
+        double v = sample_one(d, &sp); \
+        data[i] = v >= (double)(MAXV) ? (T)(MAXV) : (T)v; \
+    } \
+}
+
+DIST_KERNEL(f32, float, HUGE_VALF)
+DIST_KERNEL(f64, double, HUGE_VAL)
+DIST_KERNEL(i32, int32_t, INT32_MAX)
+DIST_KERNEL(i64, int64_t, INT64_MAX)
+DIST_KERNEL(u8, uint8_t, UINT8_MAX)
+DIST_KERNEL(bool, bool, 1)
+
+/**
+ * @brief Create a tensor and fill it with samples of a distribution
+ * @param gen Generator (NULL for the default generator)
+ * @param d Distribution (constants are computed here)
+ * @param discrete Whether integer and bool dtypes are allowed
+ * @return New tensor, or NULL on invalid dtype or allocation failure
+ */
+static Tensor* dist_sample(TensrGenerator* gen, Dist* d, bool discrete, size_t* shape,
+                           size_t ndim, TensrDType dtype, TensrDevice device) {
+    if (!discrete && dtype != TENSR_FLOAT32 && dtype != TENSR_FLOAT64) return NULL;
+    dist_prepare(d);
+
+    Tensor* t = tensr_create(shape, ndim, dtype, device);
+    if (!t) return NULL;
+
+    PhiloxState s = rng_reserve(gen, 4 * t->size);
+    switch (dtype) {
+        case TENSR_FLOAT32: dist_fill_f32(&s, d, (float*)t->data, t->size); break;
+        case TENSR_FLOAT64: dist_fill_f64(&s, d, (double*)t->data, t->size); break;
+        case TENSR_INT32: dist_fill_i32(&s, d, (int32_t*)t->data, t->size); break;
+        case TENSR_INT64: dist_fill_i64(&s, d, (int64_t*)t->data, t->size); break;
+        case TENSR_UINT8: dist_fill_u8(&s, d, (uint8_t*)t->data, t->size); break;
+        case TENSR_BOOL: dist_fill_bool(&s, d, (bool*)t->data, t->size); break;
+    }
+    return t;
+}
+
+/**
+ * @brief Create a tensor of Bernoulli(p) samples (1 with probability p, else 0)
+ * @param gen Generator (NULL for the default generator)
+ * @param p Success probability in [0, 1]
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype Any dtype
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL on invalid arguments
+ *
+ * Example:
+ *   Tensor* mask = tensr_bernoulli(gen, 0.9, shape, 2, TENSR_BOOL, TENSR_CPU);
+ */
+Tensor* tensr_bernoulli(TensrGenerator* gen, double p, size_t* shape, size_t ndim,
+                        TensrDType dtype, TensrDevice device) {
+    if (!(p >= 0.0 && p <= 1.0)) return NULL;
+    Dist d = {DIST_BERNOULLI, p, 0.0, {0}};
+    return dist_sample(gen, &d, true, shape, ndim, dtype, device);
+}
+
+/**
+ * @brief Create a tensor of exponential samples with the given rate
+ * @param gen Generator (NULL for the default generator)
+ * @param rate Rate lambda > 0 (mean 1 / lambda)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype TENSR_FLOAT32 or TENSR_FLOAT64
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL on invalid arguments
+ *
+ * Uses the inverse CDF -log(u) / lambda with u in (0, 1].
+ */
+Tensor* tensr_exponential(TensrGenerator* gen, double rate, size_t* shape, size_t ndim,
+                          TensrDType dtype, TensrDevice device) {
+    if (!(rate > 0.0)) return NULL;
+    Dist d = {DIST_EXPONENTIAL, rate, 0.0, {0}};
+    return dist_sample(gen, &d, false, shape, ndim, dtype, device);
+}
+
+/**
+ * @brief Create a tensor of gamma samples
+ * @param gen Generator (NULL for the default generator)
+ * @param k Shape parameter > 0
+ * @param theta Scale parameter > 0 (mean k * theta)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype TENSR_FLOAT32 or TENSR_FLOAT64
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL on invalid arguments
+ *
+ * Uses Marsaglia and Tsang's rejection method, with the u^(1/k) boost for
+ * k < 1.
+ */
+Tensor* tensr_gamma(TensrGenerator* gen, double k, double theta, size_t* shape, size_t ndim,
+                    TensrDType dtype, TensrDevice device) {
+    if (!(k > 0.0) || !(theta > 0.0)) return NULL;
+    Dist d = {DIST_GAMMA, k, theta, {0}};
+    return dist_sample(gen, &d, false, shape, ndim, dtype, device);
+}
+
+/**
+ * @brief Create a tensor of beta(a, b) samples
+ * @param gen Generator (NULL for the default generator)
+ * @param a First shape parameter > 0
+ * @param b Second shape parameter > 0
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype TENSR_FLOAT32 or TENSR_FLOAT64
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL on invalid arguments
+ *
+ * Computed as X / (X + Y) with X ~ Gamma(a), Y ~ Gamma(b).
+ */
+Tensor* tensr_beta(TensrGenerator* gen, double a, double b, size_t* shape, size_t ndim,
+                   TensrDType dtype, TensrDevice device) {
+    if (!(a > 0.0) || !(b > 0.0)) return NULL;
+    Dist d = {DIST_BETA, a, b, {0}};
+    return dist_sample(gen, &d, false, shape, ndim, dtype, device);
+}
+
+/**
+ * @brief Create a tensor of Poisson(lambda) samples
+ * @param gen Generator (NULL for the default generator)
+ * @param lambda Mean >= 0
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype Any dtype (integer dtypes saturate at their maximum)
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL on invalid arguments
+ *
+ * Uses inversion for lambda < 10 and Hoermann's PTRS transformed rejection
+ * above, so the cost per sample does not grow with lambda.
+ *
+ * Example:
+ *   Tensor* counts = tensr_poisson(gen, 3.5, shape, 1, TENSR_INT64, TENSR_CPU);
+ */
+Tensor* tensr_poisson(TensrGenerator* gen, double lambda, size_t* shape, size_t ndim,
+                      TensrDType dtype, TensrDevice device) {
+    if (!(lambda >= 0.0) || isinf(lambda)) return NULL;
+    Dist d = {DIST_POISSON, lambda, 0.0, {0}};
+    return dist_sample(gen, &d, true, shape, ndim, dtype, device);
+}
+
+/**
+ * @brief Create a tensor of binomial(n, p) samples
+ * @param gen Generator (NULL for the default generator)
+ * @param n Number of trials >= 0
+ * @param p Success probability in [0, 1]
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype Any dtype (integer dtypes saturate at their maximum)
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL on invalid arguments
+ *
+ * Uses inversion when n * min(p, 1 - p) < 10 and Hoermann's BTRS
+ * transformed rejection otherwise.
+ */
+Tensor* tensr_binomial(TensrGenerator* gen, int64_t n, double p, size_t* shape, size_t ndim,
+                       TensrDType dtype, TensrDevice device) {
+    if (n < 0 || !(p >= 0.0 && p <= 1.0)) return NULL;
+    Dist d = {DIST_BINOMIAL, (double)n, p, {0}};
+    return dist_sample(gen, &d, true, shape, ndim, dtype, device);
+}
+
+/**
+ * @brief Read element i of a float32 or float64 tensor as double
+ */
+static double prob_at(const Tensor* t, size_t i) {
+    if (t->dtype == TENSR_FLOAT32) return ((const float*)t->data)[i];
+    return ((const double*)t->data)[i];
+}
+
+/**
+ * @brief Macro to generate typed categorical fill kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ */
+#define CATEGORICAL_KERNEL(suffix, T) \
+static void categorical_##suffix(const PhiloxState* s, const double* cdf, size_t rows, \
+                                 size_t k, size_t num_samples, T* out) { \
+    size_t n = rows * num_samples; \
+    TENSR_PARALLEL_FOR(n >= DIST_PARALLEL_GRAIN) \
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)n; i++) { \
+        const double* row = cdf + ((size_t)i / num_samples) * k; \
+        PhiloxSpill sp; \
+        rng_stream_init(&sp, s, (uint64_t)i); \
+        double u = rng_uniform(&sp) * row[k - 1]; \
+        size_t lo = 0, hi = k - 1; \
+        while (lo < hi) { \
+            size_t mid = (lo + hi) / 2; \
+            if (row[mid] > u) hi = mid; else lo = mid + 1; \
+        } \
+        out[i] = (T)lo; \
+    } \
+}
+
+CATEGORICAL_KERNEL(i32, int32_t)
+CATEGORICAL_KERNEL(i64, int64_t)
+
+/**
+ * @brief Draw category indices from (unnormalized) probabilities
+ * @param gen Generator (NULL for the default generator)
+ * @param probs float32/float64 weights of shape (k) or (rows, k); non-negative,
+ *              each row with a positive sum
+ * @param num_samples Samples per row (drawn with replacement)
+ * @param dtype TENSR_INT32 or TENSR_INT64
+ * @return Tensor of shape (num_samples) or (rows, num_samples), or NULL on invalid input
+ *
+ * Builds each row's cumulative distribution once and inverts it with a
+ * binary search per sample.
+ *
+ * Example:
+ *   Tensor* next_tokens = tensr_categorical(gen, softmax_probs, 1, TENSR_INT64);
+ */
+Tensor* tensr_categorical(TensrGenerator* gen, const Tensor* probs, size_t num_samples,
+                          TensrDType dtype) {
+    if (probs->ndim < 1 || probs->ndim > 2) return NULL;
+    if (probs->dtype != TENSR_FLOAT32 && probs->dtype != TENSR_FLOAT64) return NULL;
+    if (dtype != TENSR_INT32 && dtype != TENSR_INT64) return NULL;
+
+    size_t k = probs->shape[probs->ndim - 1];
+    size_t rows = probs->ndim == 2 ? probs->shape[0] : 1;
+    if (k == 0) return NULL;
+
+    double* cdf = (double*)malloc(rows * k * sizeof(double));
+    if (!cdf) return NULL;
+    for (size_t r = 0; r < rows; r++) {
+        double acc = 0.0;
+        for (size_t j = 0; j < k; j++) {
+            double w = prob_at(probs, r * k + j);
+            if (!(w >= 0.0) || isinf(w)) {
+                free(cdf);
+                return NULL;
+            }
+            acc += w;
+            cdf[r * k + j] = acc;
+        }
+        if (!(acc > 0.0)) {
+            free(cdf);
+            return NULL;
+        }
+    }
+
+    size_t shape[2] = {rows, num_samples};
+    Tensor* t = probs->ndim == 2 ? tensr_create(shape, 2, dtype, probs->device)
+                                 : tensr_create(&shape[1], 1, dtype, probs->device);
+    if (t) {
+        PhiloxState s = rng_reserve(gen, 4 * t->size);
+        if (dtype == TENSR_INT32) {
+            categorical_i32(&s, cdf, rows, k, num_samples, (int32_t*)t->data);
+        } else {
+            categorical_i64(&s, cdf, rows, k, num_samples, (int64_t*)t->data);
+        }
+    }
+    free(cdf);
+    return t;
+}
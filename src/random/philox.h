@@ -0,0 +1,171 @@
+/**
+ * @file philox.h
+ * @brief Internal Philox4x32-10 counter-based random number generator
+ * @author Muhammad Fiaz
+ *
+ * Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3")
+ * maps a 128-bit counter and a 64-bit key to four independent 32-bit outputs.
+ * Because every block is a pure function of (key, counter), any element of a
+ * random tensor can be computed without generating the ones before it, which
+ * is what makes reproducible parallel generation possible.
+ */
+
+#ifndef TENSR_PHILOX_H
+#define TENSR_PHILOX_H
+
+#include <stdint.h>
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+/* Key tweak for spill blocks, so they never coincide with regular blocks */
+#define PHILOX_SPILL0 0x243F6A88u
+#define PHILOX_SPILL1 0x85A308D3u
+
+/**
+ * @brief Generator state: a key and a position in the counter space
+ *
+ * The 128-bit counter of block b is {lo(counter + b), hi(counter + b),
+ * lo(stream), hi(stream)}, so different streams never share blocks.
+ */
+typedef struct {
+    uint32_t key[2];
+    uint64_t counter;
+    uint64_t stream;
+} PhiloxState;
+
+/**
+ * @brief 32x32 -> 64 bit multiply split into high and low words
+ */
+static inline uint32_t philox_mulhilo(uint32_t a, uint32_t b, uint32_t* hi) {
+    uint64_t p = (uint64_t)a * b;
+    *hi = (uint32_t)(p >> 32);
+    return (uint32_t)p;
+}
+
+/**
+ * @brief Run the ten Philox rounds on one counter block
+ * @param ctr 128-bit counter as four words
+ * @param key 64-bit key as two words
+ * @param out Four 32-bit random outputs
+ */
+static inline void philox4x32_10(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int r = 0; r < 10; r++) {
+        uint32_t hi0, hi1;
+        uint32_t lo0 = philox_mulhilo(PHILOX_M0, c0, &hi0);
+        uint32_t lo1 = philox_mulhilo(PHILOX_M1, c2, &hi1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/**
+ * @brief Generate block number `block` relative to the state's counter
+ */
+static inline void philox_block(const PhiloxState* s, uint64_t block, uint32_t out[4]) {
+    uint64_t c = s->counter + block;
+    uint32_t ctr[4] = {(uint32_t)c, (uint32_t)(c >> 32), (uint32_t)s->stream,
+                       (uint32_t)(s->stream >> 32)};
+    philox4x32_10(ctr, s->key, out);
+}
+
+/**
+ * @brief Extra random words for one lane of a block
+ *
+ * Rejection samplers consume a variable number of words. Element lane of
+ * block draws its first words from the block itself and the rest from this
+ * private spill stream. The spill stream is keyed by block and lane and not
+ * by position, so results still do not depend on how blocks are split
+ * across threads.
+ *
+ * Spill blocks use the full counter of their block, stream included, so
+ * generators on different streams never share spill words. The lane is
+ * mixed into the first key word and the spill block index is added to the
+ * second. Tweaking the key this way keeps spill blocks apart from each other
+ * and from regular blocks, which use the untweaked key.
+ */
+typedef struct {
+    uint32_t ctr[4];
+    uint32_t key[2];
+    uint32_t buf[4];
+    int pos;
+} PhiloxSpill;
+
+/**
+ * @brief Start the spill stream of lane `lane` of block `block`
+ */
+static inline void philox_spill_init(PhiloxSpill* sp, const PhiloxState* s, uint64_t block,
+                                     uint32_t lane) {
+    uint64_t c = s->counter + block;
+    sp->ctr[0] = (uint32_t)c;
+    sp->ctr[1] = (uint32_t)(c >> 32);
+    sp->ctr[2] = (uint32_t)s->stream;
+    sp->ctr[3] = (uint32_t)(s->stream >> 32);
+    sp->key[0] = s->key[0] ^ PHILOX_SPILL0 ^ lane;
+    sp->key[1] = s->key[1] ^ PHILOX_SPILL1;
+    sp->pos = 4;
+}
+
+/**
+ * @brief Next 32 random bits of a spill stream
+ */
+static inline uint32_t philox_spill_next(PhiloxSpill* sp) {
+    if (sp->pos == 4) {
+        philox4x32_10(sp->ctr, sp->key, sp->buf);
+        sp->key[1] += 1;
+        sp->pos = 0;
+    }
+    return sp->buf[sp->pos++];
+}
+
+/**
+ * @brief Next 64 random bits of a spill stream (low word drawn first)
+ */
+static inline uint64_t philox_spill_next64(PhiloxSpill* sp) {
+    uint32_t lo = philox_spill_next(sp);
+    return ((uint64_t)philox_spill_next(sp) << 32) | lo;
+}
+
+/**
+ * @brief Map 32 random bits to a float in [0, 1)
+ */
+static inline float philox_float01(uint32_t x) {
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief Map 32 random bits to a float in (0, 1], safe as an argument to log
+ */
+static inline float philox_float_open0(uint32_t x) {
+    return (float)((x >> 8) + 1) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief Map 64 random bits to a double in [0, 1)
+ */
+static inline double philox_double01(uint32_t lo, uint32_t hi) {
+    uint64_t x = ((uint64_t)hi << 32) | lo;
+    return (double)(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Map 64 random bits to a double in (0, 1], safe as an argument to log
+ */
+static inline double philox_double_open0(uint32_t lo, uint32_t hi) {
+    uint64_t x = ((uint64_t)hi << 32) | lo;
+    return (double)((x >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+#endif /* TENSR_PHILOX_H */
@@ -0,0 +1,306 @@
+/**
+ * @file qrng.c
+ * @brief Quasi-random low-discrepancy sequences (Sobol and Halton)
+ * @author Muhammad Fiaz
+ *
+ * Sobol points are generated in Gray-code order with 32-bit direction
+ * numbers: consecutive points differ by one XOR per dimension. Any point can
+ * also be computed directly from its index, which lets threads skip ahead to
+ * the start of their chunk. Halton points are radical inverses in the first
+ * `dim` prime bases and are computed independently per point.
+ *
+ * Scrambling uses the generator. Sobol applies a random linear matrix
+ * scramble and a digital shift, and Halton applies random digit
+ * permutations. In both cases the randomness is drawn once per dimension,
+ * so scrambled points stay reproducible and do not depend on the thread count.
+ */
+
+#include "tensr/tensr.h"
+#include "rng.h"
+#include "sobol_table.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+
+/* Points generated per parallel chunk; each chunk seeds its state by skip-ahead */
+#define QRNG_CHUNK 1024
+
+/* Bits of precision of the Sobol direction numbers */
+#define SOBOL_BITS 32
+
+/* Largest Halton denominator b^k kept exact (2^53, the double mantissa) */
+#define HALTON_EXACT_LIMIT ((uint64_t)1 << 53)
+
+/**
+ * @brief Store a value in [0, 1) given as a 32-bit binary fraction
+ *
+ * float32 keeps the top 24 bits so the result never rounds up to 1.
+ */
+static inline void qrng_store(void* data, TensrDType dtype, size_t i, uint32_t x) {
+    if (dtype == TENSR_FLOAT32) ((float*)data)[i] = (float)(x >> 8) * (1.0f / 16777216.0f);
+    else ((double*)data)[i] = (double)x * (1.0 / 4294967296.0);
+}
+
+/**
+ * @brief Parity of the set bits of a word
+ */
+static inline uint32_t parity32(uint32_t x) {
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1u;
+}
+
+/**
+ * @brief Build the direction numbers of one dimension
+ * @param d Dimension index (0 is the van der Corput sequence)
+ * @param v Output, SOBOL_BITS direction numbers (v[k] is bit k of the index)
+ */
+static void sobol_directions(size_t d, uint32_t* v) {
+    if (d == 0) {
+        for (int k = 0; k < SOBOL_BITS; k++) v[k] = 1u << (SOBOL_BITS - 1 - k);
+        return;
+    }
+    uint32_t poly = sobol_poly[d - 1];
+    int s = 0;
+    while ((poly >> (s + 1)) != 0) s++;
+    /* Coefficients a_1 .. a_{s-1}, excluding the leading and constant terms */
+    uint32_t a = (poly >> 1) & ((1u << (s - 1)) - 1u);
+    for (int k = 0; k < s && k < SOBOL_BITS; k++) {
+        v[k] = (uint32_t)sobol_minit[d - 1][k] << (SOBOL_BITS - 1 - k);
+    }
+    for (int k = s; k < SOBOL_BITS; k++) {
+        uint32_t x = v[k - s] ^ (v[k - s] >> s);
+        for (int i = 1; i < s; i++) {
+            if ((a >> (s - 1 - i)) & 1u) x ^= v[k - i];
+        }
+        v[k] = x;
+    }
+}
+
+/**
+ * @brief Apply a random lower-triangular (unit diagonal) matrix to the digits
+ *        of every direction number, and draw a random digital shift
+ *
+ * Digit r (bit SOBOL_BITS - 1 - r) of the result is the parity of the
+ * digits 0..r of the input selected by row r of the matrix.
+ */
+static uint32_t sobol_scramble(PhiloxSpill* sp, uint32_t* v) {
+    uint32_t rows[SOBOL_BITS];
+    for (int r = 0; r < SOBOL_BITS; r++) {
+        uint32_t diag = 1u << (SOBOL_BITS - 1 - r);
+        uint32_t above = r == 0 ? 0u : ~((diag << 1) - 1u);
+        rows[r] = diag | (philox_spill_next(sp) & above);
+    }
+    for (int k = 0; k < SOBOL_BITS; k++) {
+        uint32_t x = 0;
+        for (int r = 0; r < SOBOL_BITS; r++) {
+            x |= parity32(v[k] & rows[r]) << (SOBOL_BITS - 1 - r);
+        }
+        v[k] = x;
+    }
+    return philox_spill_next(sp);
+}
+
+/**
+ * @brief Generate points of a Sobol sequence
+ * @param gen Generator used for scrambling (NULL for the default generator)
+ * @param n Number of points
+ * @param dim Number of dimensions (1 to 1024)
+ * @param scramble Apply a random linear matrix scramble and digital shift
+ * @param skip Index of the first point; skip + n must not exceed 2^32
+ * @param dtype TENSR_FLOAT32 or TENSR_FLOAT64
+ * @return Tensor of shape (n, dim) with values in [0, 1), or NULL on invalid input
+ *
+ * Points come in Gray-code order, so every power-of-two prefix starting at
+ * index 0 is a complete (t, m, s)-net. Unscrambled point 0 is the origin.
+ *
+ * Example:
+ *   Tensor* pts = tensr_sobol(gen, 4096, 8, true, 0, TENSR_FLOAT64);
+ */
+Tensor* tensr_sobol(TensrGenerator* gen, size_t n, size_t dim, bool scramble, uint64_t skip,
+                    TensrDType dtype) {
+    if (dtype != TENSR_FLOAT32 && dtype != TENSR_FLOAT64) return NULL;
+    if (dim == 0 || dim > SOBOL_MAX_DIM) return NULL;
+    if (skip > ((uint64_t)1 << SOBOL_BITS) || n > ((uint64_t)1 << SOBOL_BITS) - skip) return NULL;
+
+    uint32_t* v = (uint32_t*)malloc(dim * SOBOL_BITS * sizeof(uint32_t));
+    uint32_t* shift = (uint32_t*)calloc(dim, sizeof(uint32_t));
+    if (!v || !shift) {
+        free(v);
+        free(shift);
+        return NULL;
+    }
+    PhiloxState s;
+    if (scramble) s = rng_reserve(gen, 4 * dim);
+    for (size_t d = 0; d < dim; d++) {
+        sobol_directions(d, v + d * SOBOL_BITS);
+        if (scramble) {
+            PhiloxSpill sp;
+            rng_stream_init(&sp, &s, (uint64_t)d);
+            shift[d] = sobol_scramble(&sp, v + d * SOBOL_BITS);
+        }
+    }
+
+    size_t shape[] = {n, dim};
+    Tensor* result = tensr_create(shape, 2, dtype, TENSR_CPU);
+    if (!result) {
+        free(v);
+        free(shift);
+        return NULL;
+    }
+
+    size_t nchunks = (n + QRNG_CHUNK - 1) / QRNG_CHUNK;
+    bool ok = true;
+    TENSR_PARALLEL_FOR(n * dim >= TENSR_PARALLEL_GRAIN)
+    for (ptrdiff_t c = 0; c < (ptrdiff_t)nchunks; c++) {
+        uint32_t* x = (uint32_t*)malloc(dim * sizeof(uint32_t));
+        if (!x) {
+            ok = false;
+            continue;
+        }
+        size_t start = (size_t)c * QRNG_CHUNK;
+        size_t end = start + QRNG_CHUNK < n ? start + QRNG_CHUNK : n;
+        /* Skip ahead: point i is the XOR of the direction numbers of gray(i) */
+        uint64_t idx = skip + start;
+        uint64_t gray = idx ^ (idx >> 1);
+        for (size_t d = 0; d < dim; d++) {
+            const uint32_t* vd = v + d * SOBOL_BITS;
+            uint32_t acc = shift[d];
+            for (int k = 0; k < SOBOL_BITS; k++) {
+                if ((gray >> k) & 1u) acc ^= vd[k];
+            }
+            x[d] = acc;
+        }
+        for (size_t i = start; i < end; i++, idx++) {
+            for (size_t d = 0; d < dim; d++) qrng_store(result->data, dtype, i * dim + d, x[d]);
+            if (i + 1 < end) {
+                /* Gray-code update: flip the direction of the lowest zero bit of idx */
+                int bit = 0;
+                while ((idx >> bit) & 1u) bit++;
+                for (size_t d = 0; d < dim; d++) x[d] ^= v[d * SOBOL_BITS + bit];
+            }
+        }
+        free(x);
+    }
+    free(v);
+    free(shift);
+    if (!ok) {
+        tensr_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+/**
+ * @brief Fill bases with the first dim primes
+ */
+static void first_primes(uint32_t* bases, size_t dim) {
+    size_t count = 0;
+    for (uint32_t p = 2; count < dim; p++) {
+        bool prime = true;
+        for (size_t i = 0; i < count && bases[i] * bases[i] <= p; i++) {
+            if (p % bases[i] == 0) {
+                prime = false;
+                break;
+            }
+        }
+        if (prime) bases[count++] = p;
+    }
+}
+
+/**
+ * @brief Generate points of a Halton sequence
+ * @param gen Generator used for scrambling (NULL for the default generator)
+ * @param n Number of points
+ * @param dim Number of dimensions; dimension d uses the (d + 1)-th prime as its base
+ * @param scramble Apply a random permutation to the nonzero digits of each base
+ * @param skip Index of the first point
+ * @param dtype TENSR_FLOAT32 or TENSR_FLOAT64
+ * @return Tensor of shape (n, dim) with values in [0, 1), or NULL on invalid input
+ *
+ * Unscrambled Halton points correlate badly in high dimensions with large
+ * bases. Scrambling fixes this, so use it for more than about ten dimensions.
+ *
+ * Example:
+ *   Tensor* pts = tensr_halton(gen, 1000, 3, true, 1, TENSR_FLOAT32);
+ */
+Tensor* tensr_halton(TensrGenerator* gen, size_t n, size_t dim, bool scramble, uint64_t skip,
+                     TensrDType dtype) {
+    if (dtype != TENSR_FLOAT32 && dtype != TENSR_FLOAT64) return NULL;
+    if (dim == 0 || skip > UINT64_MAX - n) return NULL;
+
+    uint32_t* bases = (uint32_t*)malloc(dim * sizeof(uint32_t));
+    size_t* offsets = (size_t*)malloc((dim + 1) * sizeof(size_t));
+    if (!bases || !offsets) {
+        free(bases);
+        free(offsets);
+        return NULL;
+    }
+    first_primes(bases, dim);
+    offsets[0] = 0;
+    for (size_t d = 0; d < dim; d++) offsets[d + 1] = offsets[d] + bases[d];
+
+    /* Digit permutations of every base; 0 stays fixed so trailing zeros add nothing */
+    uint32_t* perms = (uint32_t*)malloc(offsets[dim] * sizeof(uint32_t));
+    if (!perms) {
+        free(bases);
+        free(offsets);
+        return NULL;
+    }
+    PhiloxState s;
+    if (scramble) s = rng_reserve(gen, 4 * dim);
+    for (size_t d = 0; d < dim; d++) {
+        uint32_t* perm = perms + offsets[d];
+        for (uint32_t j = 0; j < bases[d]; j++) perm[j] = j;
+        if (scramble) {
+            PhiloxSpill sp;
+            rng_stream_init(&sp, &s, (uint64_t)d);
+            for (uint32_t j = bases[d] - 1; j > 1; j--) {
+                uint32_t k = 1 + (uint32_t)rng_bounded(&sp, j);
+                uint32_t tmp = perm[j];
+                perm[j] = perm[k];
+                perm[k] = tmp;
+            }
+        }
+    }
+
+    size_t shape[] = {n, dim};
+    Tensor* result = tensr_create(shape, 2, dtype, TENSR_CPU);
+    if (result) {
+        TENSR_PARALLEL_FOR(n * dim >= TENSR_PARALLEL_GRAIN)
+        for (ptrdiff_t i = 0; i < (ptrdiff_t)n; i++) {
+            for (size_t d = 0; d < dim; d++) {
+                const uint32_t* perm = perms + offsets[d];
+                uint64_t b = bases[d];
+                uint64_t idx = skip + (uint64_t)i;
+                /* Exact numerator over b^k while it fits in a double, then a float tail */
+                uint64_t num = 0, den = 1;
+                while (idx > 0 && den <= HALTON_EXACT_LIMIT / b) {
+                    num = num * b + perm[idx % b];
+                    den *= b;
+                    idx /= b;
+                }
+                double x = (double)num / (double)den;
+                double inv = 1.0 / (double)b, f = inv / (double)den;
+                while (idx > 0) {
+                    x += perm[idx % b] * f;
+                    idx /= b;
+                    f *= inv;
+                }
+                size_t at = (size_t)i * dim + d;
+                if (dtype == TENSR_FLOAT32) {
+                    float xf = (float)x;
+                    ((float*)result->data)[at] = xf < 1.0f ? xf : 0x1.fffffep-1f;
+                } else {
+                    ((double*)result->data)[at] = x < 1.0 ? x : 0x1.fffffffffffffp-1;
+                }
+            }
+        }
+    }
+    free(bases);
+    free(offsets);
+    free(perms);
+    return result;
+}
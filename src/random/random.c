@@ -5,10 +5,15 @@
  * 
  * Provides random number generation functions for creating tensors with
  * uniform and normal distributions, similar to numpy.random functionality.
+ * All sampling is driven by the counter-based Philox4x32-10 generator in
+ * philox.h.
  */
 
 #include "tensr/tensr.h"
+#include "rng.h"
+#include "../core/parallel.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 
@@ -16,7 +21,84 @@
 #define M_PI 3.14159265358979323846
 #endif
 
-static unsigned int rng_state = 0;
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+typedef INIT_ONCE RngOnce;
+#define RNG_ONCE_INIT INIT_ONCE_STATIC_INIT
+
+typedef struct {
+    void (*fn)(void);
+} RngOnceFn;
+
+static BOOL CALLBACK once_thunk(PINIT_ONCE once, PVOID arg, PVOID* ctx) {
+    (void)once;
+    (void)ctx;
+    ((RngOnceFn*)arg)->fn();
+    return TRUE;
+}
+
+static void rng_once(RngOnce* once, void (*fn)(void)) {
+    RngOnceFn f = {fn};
+    InitOnceExecuteOnce(once, once_thunk, &f, NULL);
+}
+#else
+#include <pthread.h>
+typedef pthread_once_t RngOnce;
+#define RNG_ONCE_INIT PTHREAD_ONCE_INIT
+#define rng_once(once, fn) pthread_once((once), (fn))
+#endif
+
+/**
+ * @brief Generator handle: Philox key, stream and next free counter block
+ */
+struct TensrGenerator {
+    PhiloxState state;
+};
+
+/* Process-wide generator used when NULL is passed as the generator */
+static TensrGenerator default_gen;
+static RngOnce default_once = RNG_ONCE_INIT;
+
+/**
+ * @brief Atomically add to a 64-bit counter
+ * @return Value of the counter before the addition
+ */
+static uint64_t atomic_fetch_add_u64(uint64_t* p, uint64_t v) {
+#if defined(_MSC_VER)
+    return (uint64_t)_InterlockedExchangeAdd64((volatile __int64*)p, (__int64)v);
+#else
+    return __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+/**
+ * @brief Reset a generator to the start of stream 0 for a seed
+ */
+static void generator_init(TensrGenerator* gen, uint64_t seed) {
+    gen->state.key[0] = (uint32_t)seed;
+    gen->state.key[1] = (uint32_t)(seed >> 32);
+    gen->state.counter = 0;
+    gen->state.stream = 0;
+}
+
+static void default_seed(void) {
+    generator_init(&default_gen, (uint64_t)time(NULL));
+}
+
+/**
+ * @brief The default generator, seeded from the clock exactly once
+ *
+ * Concurrent first calls all see the finished seed, so their counter
+ * reservations never overlap.
+ */
+static TensrGenerator* default_generator(void) {
+    rng_once(&default_once, default_seed);
+    return &default_gen;
+}
 
 /**
  * @brief Set the random seed for reproducible random number generation
@@ -24,32 +106,351 @@ static unsigned int rng_state = 0;
  * 
  * Sets the seed for the random number generator. Use the same seed to get
  * reproducible results across runs. Similar to numpy.random.seed().
+ * The seed becomes the Philox key and the counter restarts at zero.
+ * Only the default generator is affected; see tensr_generator_create().
  */
 void tensr_seed(unsigned int seed) {
-    rng_state = seed;
-    srand(seed);
+    generator_init(default_generator(), seed);
 }
 
 /**
- * @brief Generate a random number from uniform distribution [0, 1)
- * @return Random double in range [0, 1)
+ * @brief Get the default generator used by functions without a _gen suffix
+ * @return Process-wide generator (never NULL, must not be freed)
  */
-static double rand_uniform() {
-    return (double)rand() / (double)RAND_MAX;
+TensrGenerator* tensr_default_generator(void) {
+    return default_generator();
 }
 
 /**
- * @brief Generate a random number from standard normal distribution
- * @return Random double from N(0, 1) distribution
- * 
- * Uses Box-Muller transform to generate normally distributed random numbers.
+ * @brief Create an independent random number generator
+ * @param seed Seed value
+ * @return New generator positioned at the start of stream 0, or NULL on failure
+ *
+ * Generators are not shared between threads: give each worker its own
+ * generator (or a tensr_generator_split() of a common one) to get a
+ * reproducible stream per thread.
+ *
+ * Example:
+ *   TensrGenerator* gen = tensr_generator_create(1234);
+ *   Tensor* t = tensr_randn_gen(gen, shape, 2, TENSR_CPU);
+ *   tensr_generator_free(gen);
+ */
+TensrGenerator* tensr_generator_create(uint64_t seed) {
+    TensrGenerator* gen = (TensrGenerator*)malloc(sizeof(TensrGenerator));
+    if (!gen) return NULL;
+    generator_init(gen, seed);
+    return gen;
+}
+
+/**
+ * @brief Free a generator created by tensr_generator_create() or tensr_generator_split()
+ * @param gen Generator to free (NULL and the default generator are ignored)
+ */
+void tensr_generator_free(TensrGenerator* gen) {
+    if (gen && gen != &default_gen) free(gen);
+}
+
+/**
+ * @brief Reseed a generator
+ * @param gen Generator (NULL for the default generator)
+ * @param seed New seed
+ */
+void tensr_generator_seed(TensrGenerator* gen, uint64_t seed) {
+    generator_init(gen ? gen : default_generator(), seed);
+}
+
+/**
+ * @brief Reserve counter blocks for n outputs of a random tensor
+ * @param gen Generator (NULL for the default generator)
+ * @param n Number of 32-bit outputs needed
+ * @return State positioned at the first reserved block
+ *
+ * Samplers map each element to a fixed block and lane by its index, so every
+ * element is a pure function of the returned state and its index. The
+ * reservation is atomic, so concurrent calls on one generator never overlap.
+ */
+PhiloxState rng_reserve(TensrGenerator* gen, size_t n) {
+    if (!gen) gen = default_generator();
+    PhiloxState s = gen->state;
+    s.counter = atomic_fetch_add_u64(&gen->state.counter, (n + 3) / 4);
+    return s;
+}
+
+/**
+ * @brief Derive a generator with an independent stream
+ * @param gen Parent generator (NULL for the default generator)
+ * @return New generator, or NULL on failure
+ *
+ * The child keeps the parent's seed and switches to a stream number drawn
+ * from the parent, which advances the parent by one block. Splitting is
+ * deterministic: the same parent state always yields the same child.
+ *
+ * Example:
+ *   TensrGenerator* workers[8];
+ *   for (int i = 0; i < 8; i++) workers[i] = tensr_generator_split(root);
+ */
+TensrGenerator* tensr_generator_split(TensrGenerator* gen) {
+    PhiloxState s = rng_reserve(gen, 4);
+    uint32_t r[4];
+    philox_block(&s, 0, r);
+
+    TensrGenerator* child = (TensrGenerator*)malloc(sizeof(TensrGenerator));
+    if (!child) return NULL;
+    child->state.key[0] = s.key[0];
+    child->state.key[1] = s.key[1];
+    child->state.counter = 0;
+    child->state.stream = ((uint64_t)r[1] << 32) | r[0];
+    return child;
+}
+
+/**
+ * @brief Skip ahead in a generator's stream
+ * @param gen Generator (NULL for the default generator)
+ * @param blocks Number of counter blocks to skip
+ *
+ * Each block supplies four 32-bit values: a float32 or int32 tensor of n
+ * elements consumes (n + 3) / 4 blocks. Jumping is O(1).
  */
-static double rand_normal() {
-    double u1 = rand_uniform();
-    double u2 = rand_uniform();
-    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+void tensr_generator_jump(TensrGenerator* gen, uint64_t blocks) {
+    if (!gen) gen = default_generator();
+    atomic_fetch_add_u64(&gen->state.counter, blocks);
 }
 
+/**
+ * @brief Save a generator's position
+ * @param gen Generator (NULL for the default generator)
+ * @param state Output snapshot
+ */
+void tensr_generator_get_state(const TensrGenerator* gen, TensrGeneratorState* state) {
+    if (!gen) gen = default_generator();
+    state->seed = ((uint64_t)gen->state.key[1] << 32) | gen->state.key[0];
+    state->stream = gen->state.stream;
+    state->counter = gen->state.counter;
+}
+
+/**
+ * @brief Restore a generator's position
+ * @param gen Generator (NULL for the default generator)
+ * @param state Snapshot from tensr_generator_get_state()
+ *
+ * Example:
+ *   TensrGeneratorState saved;
+ *   tensr_generator_get_state(gen, &saved);
+ *   Tensor* a = tensr_rand_gen(gen, shape, 1, TENSR_CPU);
+ *   tensr_generator_set_state(gen, &saved);
+ *   Tensor* b = tensr_rand_gen(gen, shape, 1, TENSR_CPU);  (same values as a)
+ */
+void tensr_generator_set_state(TensrGenerator* gen, const TensrGeneratorState* state) {
+    if (!gen) gen = default_generator();
+    generator_init(gen, state->seed);
+    gen->state.stream = state->stream;
+    gen->state.counter = state->counter;
+}
+
+/**
+ * @brief Macro to generate typed uniform fill kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ * @param PER_BLOCK Elements produced per Philox block
+ * @param UNIT Expression mapping lane l of block r to [0, 1)
+ *
+ * Writes low + scale * u. Blocks are independent, so they are split across
+ * threads; element i always comes from block i / PER_BLOCK, whatever the
+ * thread count.
+ */
+#define UNIFORM_KERNEL(suffix, T, PER_BLOCK, UNIT) \
+static void fill_uniform_##suffix(const PhiloxState* s, T* data, size_t n, T low, T scale) { \
+    size_t nblocks = (n + PER_BLOCK - 1) / PER_BLOCK; \
+    TENSR_PARALLEL_FOR(n >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t b = 0; b < (ptrdiff_t)nblocks; b++) { \
+        uint32_t r[4]; \
+        size_t i = (size_t)b * PER_BLOCK; \
+        philox_block(s, (uint64_t)b, r); \
+        for (size_t l = 0; l < PER_BLOCK && i + l < n; l++) { \
+            data[i + l] = low + scale * (UNIT); \
+        } \
+    } \
+}
+
+UNIFORM_KERNEL(f32, float, 4, philox_float01(r[l]))
+UNIFORM_KERNEL(f64, double, 2, philox_double01(r[2 * l], r[2 * l + 1]))
+
+/* Ziggurat for the standard normal: 128 layers of equal area (Marsaglia-Tsang) */
+#define ZIG_LAYERS 128
+#define ZIG_R 3.442619855899
+#define ZIG_V 9.91256303526217e-3
+
+/* zig_x[i] is the right edge of layer i (zig_x[0] is the base strip's
+ * equivalent width), zig_f[i] = exp(-zig_x[i]^2 / 2). zig_k24/zig_k53 hold
+ * zig_x[i + 1] / zig_x[i] scaled to 24- and 53-bit integers so the fast path
+ * is one compare; zig_w24/zig_w53 scale those integers back to x. */
+static double zig_x[ZIG_LAYERS + 1];
+static double zig_f[ZIG_LAYERS + 1];
+static uint32_t zig_k24[ZIG_LAYERS];
+static uint64_t zig_k53[ZIG_LAYERS];
+static float zig_w24[ZIG_LAYERS];
+static double zig_w53[ZIG_LAYERS];
+static RngOnce zig_once = RNG_ONCE_INIT;
+
+static void zig_build(void) {
+    double f_r = exp(-0.5 * ZIG_R * ZIG_R);
+    zig_x[0] = ZIG_V / f_r;
+    zig_x[1] = ZIG_R;
+    for (int i = 1; i < ZIG_LAYERS - 1; i++) {
+        zig_x[i + 1] = sqrt(-2.0 * log(ZIG_V / zig_x[i] + exp(-0.5 * zig_x[i] * zig_x[i])));
+    }
+    zig_x[ZIG_LAYERS] = 0.0;
+    for (int i = 0; i <= ZIG_LAYERS; i++) zig_f[i] = exp(-0.5 * zig_x[i] * zig_x[i]);
+    for (int i = 0; i < ZIG_LAYERS; i++) {
+        double ratio = zig_x[i + 1] / zig_x[i];
+        zig_k24[i] = (uint32_t)(ratio * 16777216.0);
+        zig_k53[i] = (uint64_t)(ratio * 9007199254740992.0);
+        zig_w24[i] = (float)(zig_x[i] / 16777216.0);
+        zig_w53[i] = zig_x[i] / 9007199254740992.0;
+    }
+}
+
+/**
+ * @brief Build the Ziggurat tables on first use
+ *
+ * Threads that lose the race wait for the build, so no sampler reads a
+ * partly written table.
+ */
+static void zig_init(void) {
+    rng_once(&zig_once, zig_build);
+}
+
+/**
+ * @brief Ziggurat slow path: wedge test, tail, and redraws
+ * @param sp Spill stream of the element
+ * @param layer Layer chosen by the first draw
+ * @param x Candidate magnitude from the first draw
+ * @return Magnitude of a standard normal sample (the sign is applied by the caller)
+ *
+ * Taken with probability of about 1.2%. The tail beyond ZIG_R uses
+ * Marsaglia's exponential method, so no sample is ever clipped.
+ */
+static double zig_slow(PhiloxSpill* sp, uint32_t layer, double x) {
+    for (;;) {
+        if (layer == 0) {
+            double xt, yt;
+            do {
+                uint32_t a = philox_spill_next(sp), b = philox_spill_next(sp);
+                uint32_t c = philox_spill_next(sp), d = philox_spill_next(sp);
+                xt = -log(philox_double_open0(a, b)) / ZIG_R;
+                yt = -log(philox_double_open0(c, d));
+            } while (yt + yt < xt * xt);
+            return ZIG_R + xt;
+        }
+        uint32_t a = philox_spill_next(sp), b = philox_spill_next(sp);
+        double y = zig_f[layer] + philox_double01(a, b) * (zig_f[layer + 1] - zig_f[layer]);
+        if (y < exp(-0.5 * x * x)) return x;
+
+        uint64_t u = philox_spill_next64(sp);
+        layer = (uint32_t)(u & (ZIG_LAYERS - 1));
+        uint64_t m = u >> 11;
+        x = (double)m * zig_w53[layer];
+        if (m < zig_k53[layer]) return x;
+    }
+}
+
+/**
+ * @brief Macro to generate typed Ziggurat normal fill kernels
+ * @param suffix Function name suffix
+ * @param T Element C type
+ * @param PER_BLOCK Elements produced per Philox block
+ * @param WORD Expression giving the random word for lane l of block r
+ * @param WTYPE Unsigned type of a word
+ * @param BITS Magnitude bits taken from the top of a word
+ * @param K Acceptance table for BITS-bit magnitudes
+ * @param W Scale table for BITS-bit magnitudes
+ *
+ * Writes mean + std * z. Low 7 bits of a word pick the layer, bit 7 the sign
+ * and the top BITS bits the magnitude, so the three never share bits. About 98.8% of samples take
+ * the fast path: a table compare and one multiply.
+ */
+#define ZIGGURAT_KERNEL(suffix, T, PER_BLOCK, WORD, WTYPE, BITS, K, W) \
+static void fill_normal_##suffix(const PhiloxState* s, T* data, size_t n, T mean, T std) { \
+    zig_init(); \
+    size_t nblocks = (n + PER_BLOCK - 1) / PER_BLOCK; \
+    TENSR_PARALLEL_FOR(n >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t b = 0; b < (ptrdiff_t)nblocks; b++) { \
+        uint32_t r[4]; \
+        size_t i = (size_t)b * PER_BLOCK; \
+        philox_block(s, (uint64_t)b, r); \
+        for (size_t l = 0; l < PER_BLOCK && i + l < n; l++) { \
+            WTYPE u = (WORD); \
+            uint32_t layer = (uint32_t)(u & (ZIG_LAYERS - 1)); \
+            WTYPE m = u >> (sizeof(WTYPE) * 8 - BITS); \
+            T z = (T)m * W[layer]; \
+            if (m >= K[layer]) { \
+                PhiloxSpill sp; \
+                philox_spill_init(&sp, s, (uint64_t)b, (uint32_t)l); \
+                z = (T)zig_slow(&sp, layer, ldexp((double)m, -BITS) * zig_x[layer]); \
+            } \
+            data[i + l] = mean + std * ((u & ZIG_LAYERS) ? -z : z); \
+        } \
+    } \
+}
+
+ZIGGURAT_KERNEL(f32, float, 4, r[l], uint32_t, 24, zig_k24, zig_w24)
+ZIGGURAT_KERNEL(f64, double, 2, ((uint64_t)r[2 * l + 1] << 32) | r[2 * l], uint64_t, 53,
+                zig_k53, zig_w53)
+
+double rng_normal(PhiloxSpill* sp) {
+    zig_init();
+    uint64_t u = philox_spill_next64(sp);
+    uint32_t layer = (uint32_t)(u & (ZIG_LAYERS - 1));
+    uint64_t m = u >> 11;
+    double z = (double)m * zig_w53[layer];
+    if (m >= zig_k53[layer]) z = zig_slow(sp, layer, z);
+    return (u & ZIG_LAYERS) ? -z : z;
+}
+
+/**
+ * @brief Macro to generate typed bounded-integer fill kernels (Lemire's method)
+ * @param suffix Function name suffix
+ * @param T Signed element type
+ * @param U Unsigned type of the same width
+ * @param PER_BLOCK Elements produced per Philox block
+ * @param WORD Expression giving the random word for lane l of block r
+ * @param SPILL_WORD Expression giving the next word of spill stream sp
+ * @param MULHI Widening multiply returning the high half
+ *
+ * The high half of word * range is uniform on [0, range) once products whose
+ * low half falls below 2^bits mod range are rejected. The rejection threshold
+ * is computed once per call, so the loop has no division; a word is redrawn
+ * from the element's spill stream with probability below range / 2^bits.
+ */
+#define RANDINT_KERNEL(suffix, T, U, PER_BLOCK, WORD, SPILL_WORD, MULHI) \
+static void fill_randint_##suffix(const PhiloxState* s, T* data, size_t n, T low, U range) { \
+    U threshold = (U)(0 - range) % range; \
+    size_t nblocks = (n + PER_BLOCK - 1) / PER_BLOCK; \
+    TENSR_PARALLEL_FOR(n >= TENSR_PARALLEL_GRAIN) \
+    for (ptrdiff_t b = 0; b < (ptrdiff_t)nblocks; b++) { \
+        uint32_t r[4]; \
+        size_t i = (size_t)b * PER_BLOCK; \
+        philox_block(s, (uint64_t)b, r); \
+        for (size_t l = 0; l < PER_BLOCK && i + l < n; l++) { \
+            U x = (WORD), lo; \
+            U hi = MULHI(x, range, &lo); \
+            if (lo < threshold) { \
+                PhiloxSpill sp; \
+                philox_spill_init(&sp, s, (uint64_t)b, (uint32_t)l); \
+                do { \
+                    x = (SPILL_WORD); \
+                    hi = MULHI(x, range, &lo); \
+                } while (lo < threshold); \
+            } \
+            data[i + l] = (T)((U)low + hi); \
+        } \
+    } \
+}
+
+RANDINT_KERNEL(i32, int32_t, uint32_t, 4, r[l], philox_spill_next(&sp), mul_hi_u32)
+RANDINT_KERNEL(i64, int64_t, uint64_t, 2, ((uint64_t)r[2 * l + 1] << 32) | r[2 * l],
+               philox_spill_next64(&sp), mul_hi_u64)
+
 /**
  * @brief Create a tensor with random values from uniform distribution [0, 1)
  * @param shape Array of dimension sizes
@@ -58,22 +459,31 @@ static double rand_normal() {
  * @return Pointer to newly created tensor with random values
  * 
  * Creates a tensor filled with random values from a uniform distribution
- * in the range [0, 1). Similar to numpy.random.rand().
+ * in the range [0, 1). Similar to numpy.random.rand(). Values use the top
+ * 24 bits of each Philox output, so 1.0 is never produced.
  * 
  * Example:
  *   size_t shape[] = {3, 3};
  *   Tensor* t = tensr_rand(shape, 2, TENSR_CPU);
  */
 Tensor* tensr_rand(size_t* shape, size_t ndim, TensrDevice device) {
-    if (rng_state == 0) tensr_seed((unsigned int)time(NULL));
+    return tensr_rand_gen(NULL, shape, ndim, device);
+}
 
+/**
+ * @brief Uniform [0, 1) random tensor drawn from a specific generator
+ * @param gen Generator (NULL for the default generator)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor with random values
+ */
+Tensor* tensr_rand_gen(TensrGenerator* gen, size_t* shape, size_t ndim, TensrDevice device) {
     Tensor* t = tensr_create(shape, ndim, TENSR_FLOAT32, device);
     if (!t) return NULL;
 
-    float* data = (float*)t->data;
-    for (size_t i = 0; i < t->size; i++) {
-        data[i] = (float)rand_uniform();
-    }
+    PhiloxState s = rng_reserve(gen, t->size);
+    fill_uniform_f32(&s, (float*)t->data, t->size, 0.0f, 1.0f);
     return t;
 }
 
@@ -85,21 +495,56 @@ Tensor* tensr_rand(size_t* shape, size_t ndim, TensrDevice device) {
  * @return Pointer to newly created tensor with random values
  * 
  * Creates a tensor filled with random values from a standard normal
- * distribution (mean=0, std=1). Similar to numpy.random.randn().
+ * distribution (mean=0, std=1). Similar to numpy.random.randn(). Samples
+ * come from a Ziggurat sampler with exact tail handling.
  * 
  * Example:
  *   size_t shape[] = {3, 3};
  *   Tensor* t = tensr_randn(shape, 2, TENSR_CPU);
  */
 Tensor* tensr_randn(size_t* shape, size_t ndim, TensrDevice device) {
-    if (rng_state == 0) tensr_seed((unsigned int)time(NULL));
+    return tensr_randn_gen(NULL, shape, ndim, device);
+}
 
-    Tensor* t = tensr_create(shape, ndim, TENSR_FLOAT32, device);
+/**
+ * @brief Standard normal random tensor drawn from a specific generator
+ * @param gen Generator (NULL for the default generator)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor with random values
+ */
+Tensor* tensr_randn_gen(TensrGenerator* gen, size_t* shape, size_t ndim, TensrDevice device) {
+    return tensr_standard_normal(gen, shape, ndim, TENSR_FLOAT32, device);
+}
+
+/**
+ * @brief Standard normal random tensor of a given floating-point dtype
+ * @param gen Generator (NULL for the default generator)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype TENSR_FLOAT32 or TENSR_FLOAT64
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL for other dtypes
+ *
+ * float64 samples use 53 random bits per value, so they are not rounded
+ * float32 samples. Similar to numpy's Generator.standard_normal().
+ *
+ * Example:
+ *   Tensor* z = tensr_standard_normal(gen, shape, 2, TENSR_FLOAT64, TENSR_CPU);
+ */
+Tensor* tensr_standard_normal(TensrGenerator* gen, size_t* shape, size_t ndim, TensrDType dtype,
+                              TensrDevice device) {
+    if (dtype != TENSR_FLOAT32 && dtype != TENSR_FLOAT64) return NULL;
+    Tensor* t = tensr_create(shape, ndim, dtype, device);
     if (!t) return NULL;
 
-    float* data = (float*)t->data;
-    for (size_t i = 0; i < t->size; i++) {
-        data[i] = (float)rand_normal();
+    if (dtype == TENSR_FLOAT32) {
+        PhiloxState s = rng_reserve(gen, t->size);
+        fill_normal_f32(&s, (float*)t->data, t->size, 0.0f, 1.0f);
+    } else {
+        PhiloxState s = rng_reserve(gen, 2 * t->size);
+        fill_normal_f64(&s, (double*)t->data, t->size, 0.0, 1.0);
     }
     return t;
 }
@@ -115,21 +560,271 @@ Tensor* tensr_randn(size_t* shape, size_t ndim, TensrDevice device) {
  * 
  * Creates a tensor filled with random integers from the discrete uniform
  * distribution in the range [low, high). Similar to numpy.random.randint().
+ * Sampling is unbiased (Lemire's method); returns NULL if high <= low.
  * 
  * Example:
  *   size_t shape[] = {3, 3};
  *   Tensor* t = tensr_randint(0, 10, shape, 2, TENSR_CPU);
  */
 Tensor* tensr_randint(int low, int high, size_t* shape, size_t ndim, TensrDevice device) {
-    if (rng_state == 0) tensr_seed((unsigned int)time(NULL));
+    return tensr_randint_gen(NULL, low, high, shape, ndim, device);
+}
 
+/**
+ * @brief Random integers in [low, high) drawn from a specific generator
+ * @param gen Generator (NULL for the default generator)
+ * @param low Lower bound (inclusive)
+ * @param high Upper bound (exclusive)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor with random integers
+ */
+Tensor* tensr_randint_gen(TensrGenerator* gen, int low, int high, size_t* shape, size_t ndim,
+                          TensrDevice device) {
+    if (high <= low) return NULL;
     Tensor* t = tensr_create(shape, ndim, TENSR_INT32, device);
     if (!t) return NULL;
 
-    int32_t* data = (int32_t*)t->data;
-    int range = high - low;
-    for (size_t i = 0; i < t->size; i++) {
-        data[i] = low + (rand() % range);
+    PhiloxState s = rng_reserve(gen, t->size);
+    fill_randint_i32(&s, (int32_t*)t->data, t->size, low, (uint32_t)((int64_t)high - low));
+    return t;
+}
+
+/**
+ * @brief Create a tensor with random 64-bit integers in range [low, high)
+ * @param gen Generator (NULL for the default generator)
+ * @param low Lower bound (inclusive)
+ * @param high Upper bound (exclusive, must be greater than low)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param device Device to create tensor on
+ * @return Pointer to newly created INT64 tensor, or NULL on invalid arguments
+ *
+ * Uses Lemire's multiply-and-reject method on 64-bit words, so every value in
+ * [low, high) is exactly equally likely for any range up to 2^64 - 1.
+ *
+ * Example:
+ *   Tensor* ids = tensr_randint64(NULL, 0, INT64_C(1) << 40, shape, 1, TENSR_CPU);
+ */
+Tensor* tensr_randint64(TensrGenerator* gen, int64_t low, int64_t high, size_t* shape,
+                        size_t ndim, TensrDevice device) {
+    if (high <= low) return NULL;
+    Tensor* t = tensr_create(shape, ndim, TENSR_INT64, device);
+    if (!t) return NULL;
+
+    PhiloxState s = rng_reserve(gen, 2 * t->size);
+    fill_randint_i64(&s, (int64_t*)t->data, t->size, low, (uint64_t)high - (uint64_t)low);
+    return t;
+}
+
+/**
+ * @brief Check that a dtype is float32 or float64
+ */
+static bool is_float_dtype(TensrDType dtype) {
+    return dtype == TENSR_FLOAT32 || dtype == TENSR_FLOAT64;
+}
+
+/**
+ * @brief Create a tensor with values from the uniform distribution [low, high)
+ * @param gen Generator (NULL for the default generator)
+ * @param low Lower bound (inclusive)
+ * @param high Upper bound (exclusive)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype TENSR_FLOAT32 or TENSR_FLOAT64
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL on invalid arguments
+ *
+ * The bounds are applied while sampling, with no extra pass over the data.
+ * Similar to numpy.random.uniform().
+ *
+ * Example:
+ *   Tensor* w = tensr_uniform(NULL, -0.1, 0.1, shape, 2, TENSR_FLOAT64, TENSR_CPU);
+ */
+Tensor* tensr_uniform(TensrGenerator* gen, double low, double high, size_t* shape, size_t ndim,
+                      TensrDType dtype, TensrDevice device) {
+    if (!is_float_dtype(dtype) || !(high > low)) return NULL;
+    Tensor* t = tensr_create(shape, ndim, dtype, device);
+    if (!t) return NULL;
+
+    if (dtype == TENSR_FLOAT32) {
+        PhiloxState s = rng_reserve(gen, t->size);
+        fill_uniform_f32(&s, (float*)t->data, t->size, (float)low, (float)(high - low));
+    } else {
+        PhiloxState s = rng_reserve(gen, 2 * t->size);
+        fill_uniform_f64(&s, (double*)t->data, t->size, low, high - low);
     }
     return t;
 }
+
+/**
+ * @brief Create a tensor with values from the normal distribution N(mean, std^2)
+ * @param gen Generator (NULL for the default generator)
+ * @param mean Mean of the distribution
+ * @param std Standard deviation (must be >= 0)
+ * @param shape Array of dimension sizes
+ * @param ndim Number of dimensions
+ * @param dtype TENSR_FLOAT32 or TENSR_FLOAT64
+ * @param device Device to create tensor on
+ * @return Pointer to newly created tensor, or NULL on invalid arguments
+ *
+ * Similar to numpy.random.normal().
+ *
+ * Example:
+ *   Tensor* w = tensr_normal(gen, 0.0, 0.02, shape, 2, TENSR_FLOAT32, TENSR_CPU);
+ */
+Tensor* tensr_normal(TensrGenerator* gen, double mean, double std, size_t* shape, size_t ndim,
+                     TensrDType dtype, TensrDevice device) {
+    if (!is_float_dtype(dtype) || !(std >= 0.0)) return NULL;
+    Tensor* t = tensr_create(shape, ndim, dtype, device);
+    if (!t) return NULL;
+
+    if (dtype == TENSR_FLOAT32) {
+        PhiloxState s = rng_reserve(gen, t->size);
+        fill_normal_f32(&s, (float*)t->data, t->size, (float)mean, (float)std);
+    } else {
+        PhiloxState s = rng_reserve(gen, 2 * t->size);
+        fill_normal_f64(&s, (double*)t->data, t->size, mean, std);
+    }
+    return t;
+}
+
+/* Elements generated per chunk when filling a strided view */
+#define RAND_VIEW_CHUNK 4096
+/* Most dimensions of a strided view filled in place (as in the file format) */
+#define RAND_VIEW_MAX_NDIM 32
+
+typedef enum {
+    FILL_UNIFORM,
+    FILL_NORMAL
+} FillKind;
+
+/**
+ * @brief Fill n contiguous float32/float64 values
+ * @param a Lower bound (uniform) or mean (normal)
+ * @param b Range (uniform) or standard deviation (normal)
+ */
+static void fill_contiguous(FillKind kind, const PhiloxState* s, void* data, TensrDType dtype,
+                            size_t n, double a, double b) {
+    if (dtype == TENSR_FLOAT32) {
+        if (kind == FILL_UNIFORM) fill_uniform_f32(s, (float*)data, n, (float)a, (float)b);
+        else fill_normal_f32(s, (float*)data, n, (float)a, (float)b);
+    } else {
+        if (kind == FILL_UNIFORM) fill_uniform_f64(s, (double*)data, n, a, b);
+        else fill_normal_f64(s, (double*)data, n, a, b);
+    }
+}
+
+/**
+ * @brief Check whether a tensor's strides describe a dense row-major layout
+ */
+static bool is_contiguous(const Tensor* t) {
+    size_t expected = 1;
+    for (size_t d = t->ndim; d-- > 0;) {
+        if (t->shape[d] != 1 && t->strides[d] != expected) return false;
+        expected *= t->shape[d];
+    }
+    return true;
+}
+
+/**
+ * @brief Copy len elements into a strided tensor starting at logical index start
+ * @param idx Scratch multi-index of t->ndim entries
+ */
+static void scatter_strided(Tensor* t, size_t start, size_t len, const char* src, size_t esize,
+                            size_t* idx) {
+    size_t rem = start, offset = 0;
+    for (size_t d = t->ndim; d-- > 0;) {
+        idx[d] = rem % t->shape[d];
+        rem /= t->shape[d];
+        offset += idx[d] * t->strides[d];
+    }
+    char* base = (char*)t->data;
+    for (size_t k = 0; k < len; k++) {
+        memcpy(base + offset * esize, src + k * esize, esize);
+        for (size_t d = t->ndim; d-- > 0;) {
+            offset += t->strides[d];
+            if (++idx[d] < t->shape[d]) break;
+            offset -= idx[d] * t->strides[d];
+            idx[d] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Fill an existing tensor (contiguous or strided view) with random values
+ *
+ * Element i in row-major order gets the value it would have in a freshly
+ * allocated tensor of the same shape, so views and dense tensors agree.
+ * Views are generated in fixed chunks into a stack buffer and scattered, so
+ * nothing is allocated.
+ */
+static Tensor* fill_inplace(TensrGenerator* gen, Tensor* t, FillKind kind, double a, double b) {
+    if (!t || !is_float_dtype(t->dtype)) return NULL;
+    if (!is_contiguous(t) && t->ndim > RAND_VIEW_MAX_NDIM) return NULL;
+    size_t per_block = t->dtype == TENSR_FLOAT32 ? 4 : 2;
+    PhiloxState s = rng_reserve(gen, (4 / per_block) * t->size);
+
+    if (is_contiguous(t)) {
+        fill_contiguous(kind, &s, t->data, t->dtype, t->size, a, b);
+        return t;
+    }
+
+    size_t esize = tensr_dtype_size(t->dtype);
+    size_t nchunks = (t->size + RAND_VIEW_CHUNK - 1) / RAND_VIEW_CHUNK;
+    TENSR_PARALLEL_FOR(t->size >= TENSR_PARALLEL_GRAIN)
+    for (ptrdiff_t c = 0; c < (ptrdiff_t)nchunks; c++) {
+        double buf[RAND_VIEW_CHUNK];
+        size_t idx[RAND_VIEW_MAX_NDIM];
+        size_t start = (size_t)c * RAND_VIEW_CHUNK;
+        size_t len = t->size - start < RAND_VIEW_CHUNK ? t->size - start : RAND_VIEW_CHUNK;
+        PhiloxState cs = s;
+        cs.counter += start / per_block;
+        fill_contiguous(kind, &cs, buf, t->dtype, len, a, b);
+        scatter_strided(t, start, len, (const char*)buf, esize, idx);
+    }
+    return t;
+}
+
+/**
+ * @brief Fill an existing tensor with uniform [0, 1) values in place
+ * @param gen Generator (NULL for the default generator)
+ * @param t float32 or float64 tensor, may be a strided view of up to 32 dimensions
+ * @return t on success, NULL on unsupported dtype or view
+ *
+ * No memory is allocated for contiguous tensors. Values match those of
+ * tensr_rand_gen() for the same generator state and shape.
+ *
+ * Example:
+ *   tensr_rand_(gen, noise);  (refresh a noise buffer every step)
+ */
+Tensor* tensr_rand_(TensrGenerator* gen, Tensor* t) {
+    return fill_inplace(gen, t, FILL_UNIFORM, 0.0, 1.0);
+}
+
+/**
+ * @brief Fill an existing tensor with standard normal values in place
+ * @param gen Generator (NULL for the default generator)
+ * @param t float32 or float64 tensor, may be a strided view of up to 32 dimensions
+ * @return t on success, NULL on unsupported dtype or view
+ */
+Tensor* tensr_randn_(TensrGenerator* gen, Tensor* t) {
+    return fill_inplace(gen, t, FILL_NORMAL, 0.0, 1.0);
+}
+
+/**
+ * @brief Fill an existing tensor with uniform [low, high) values in place
+ * @param gen Generator (NULL for the default generator)
+ * @param t float32 or float64 tensor, may be a strided view of up to 32 dimensions
+ * @param low Lower bound (inclusive)
+ * @param high Upper bound (exclusive, must be greater than low)
+ * @return t on success, NULL on invalid arguments
+ *
+ * Example:
+ *   tensr_uniform_(gen, weight_slice, -bound, bound);  (re-initialize part of a layer)
+ */
+Tensor* tensr_uniform_(TensrGenerator* gen, Tensor* t, double low, double high) {
+    if (!(high > low)) return NULL;
+    return fill_inplace(gen, t, FILL_UNIFORM, low, high - low);
+}
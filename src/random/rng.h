@@ -0,0 +1,101 @@
+/**
+ * @file rng.h
+ * @brief Internal interface shared by the random number modules
+ * @author Muhammad Fiaz
+ *
+ * Samplers reserve a range of Philox counter blocks from a generator and then
+ * compute every element from its block index, so results do not depend on
+ * the thread count. Samplers that consume a variable number of random words
+ * give each element a stream: its own block first, then its spill stream.
+ */
+
+#ifndef TENSR_RNG_H
+#define TENSR_RNG_H
+
+#include "tensr/tensr.h"
+#include "philox.h"
+
+/**
+ * @brief Reserve counter blocks for n 32-bit random words
+ * @param gen Generator (NULL for the default generator)
+ * @param n Number of words needed; (n + 3) / 4 blocks are reserved
+ * @return State positioned at the first reserved block
+ */
+PhiloxState rng_reserve(TensrGenerator* gen, size_t n);
+
+/**
+ * @brief Draw a standard normal sample from an element stream (Ziggurat)
+ */
+double rng_normal(PhiloxSpill* sp);
+
+/**
+ * @brief Start the word stream of the element that owns block `block`
+ *
+ * The first four words come from the block itself, later ones from its
+ * spill stream.
+ */
+static inline void rng_stream_init(PhiloxSpill* sp, const PhiloxState* s, uint64_t block) {
+    philox_spill_init(sp, s, block, 0);
+    philox_block(s, block, sp->buf);
+    sp->pos = 0;
+}
+
+/**
+ * @brief 32x32 -> 64 bit multiply returning the high word
+ */
+static inline uint32_t mul_hi_u32(uint32_t a, uint32_t b, uint32_t* lo) {
+    uint64_t p = (uint64_t)a * b;
+    *lo = (uint32_t)p;
+    return (uint32_t)(p >> 32);
+}
+
+/**
+ * @brief 64x64 -> 128 bit multiply returning the high word
+ */
+static inline uint64_t mul_hi_u64(uint64_t a, uint64_t b, uint64_t* lo) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = (unsigned __int128)a * b;
+    *lo = (uint64_t)p;
+    return (uint64_t)(p >> 64);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    *lo = (mid << 32) | (uint32_t)ll;
+    return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+/**
+ * @brief Unbiased integer in [0, range) from an element stream (Lemire's method)
+ * @param sp Element stream
+ * @param range Upper bound, must be >= 1
+ */
+static inline uint64_t rng_bounded(PhiloxSpill* sp, uint64_t range) {
+    uint64_t lo;
+    uint64_t hi = mul_hi_u64(philox_spill_next64(sp), range, &lo);
+    if (lo < range) {
+        uint64_t threshold = (0 - range) % range;
+        while (lo < threshold) hi = mul_hi_u64(philox_spill_next64(sp), range, &lo);
+    }
+    return hi;
+}
+
+/**
+ * @brief Uniform double in [0, 1) from an element stream
+ */
+static inline double rng_uniform(PhiloxSpill* sp) {
+    uint32_t lo = philox_spill_next(sp);
+    return philox_double01(lo, philox_spill_next(sp));
+}
+
+/**
+ * @brief Uniform double in (0, 1] from an element stream
+ */
+static inline double rng_uniform_open0(PhiloxSpill* sp) {
+    uint32_t lo = philox_spill_next(sp);
+    return philox_double_open0(lo, philox_spill_next(sp));
+}
+
+#endif /* TENSR_RNG_H */
@@ -0,0 +1,501 @@
+/**
+ * @file sampling.c
+ * @brief Random permutations, shuffling and sampling from tensors
+ * @author Muhammad Fiaz
+ *
+ * Permutations use a two-level block shuffle: every row is sent to a random
+ * bucket, the buckets are laid out one after another, and each bucket is then
+ * Fisher-Yates shuffled on its own. Buckets are sized to stay in cache and
+ * are shuffled in parallel. The bucket of each row and the stream of each
+ * bucket come from the counter-based generator, and the chunking does not
+ * depend on the thread count, so results are reproducible.
+ *
+ * Sampling without replacement uses Floyd's algorithm when k is small
+ * compared to n, and weighted sampling uses alias tables (with replacement)
+ * or Efraimidis-Spirakis keys with a size-k heap (without replacement).
+ */
+
+#include "tensr/tensr.h"
+#include "rng.h"
+#include "../core/parallel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Target rows per bucket of the block shuffle */
+#define PERM_BUCKET (1u << 16)
+
+/* Maximum number of scatter chunks; fixed so results do not depend on threads */
+#define PERM_MAX_CHUNKS 64
+
+/* Floyd's algorithm is used when k * FLOYD_RATIO <= n */
+#define FLOYD_RATIO 16
+
+/**
+ * @brief Bucket of row i: unbiased integer in [0, nbuckets) from block i / 4, lane i % 4
+ * @param r Cached words of the last block generated
+ * @param cached Index of the block held in r (UINT64_MAX when empty)
+ */
+static uint32_t bucket_of(const PhiloxState* s, size_t i, uint32_t nbuckets, uint32_t r[4],
+                          uint64_t* cached) {
+    uint64_t block = (uint64_t)(i / 4);
+    if (*cached != block) {
+        philox_block(s, block, r);
+        *cached = block;
+    }
+    uint32_t lo;
+    uint32_t hi = mul_hi_u32(r[i % 4], nbuckets, &lo);
+    if (lo < nbuckets) {
+        uint32_t threshold = (0u - nbuckets) % nbuckets;
+        if (lo < threshold) {
+            PhiloxSpill sp;
+            philox_spill_init(&sp, s, block, (uint32_t)(i % 4));
+            do {
+                hi = mul_hi_u32(philox_spill_next(&sp), nbuckets, &lo);
+            } while (lo < threshold);
+        }
+    }
+    return hi;
+}
+
+/**
+ * @brief Swap two rows of row_bytes bytes
+ */
+static void swap_rows(char* a, char* b, size_t row_bytes) {
+    char tmp[256];
+    while (row_bytes > 0) {
+        size_t c = row_bytes < sizeof(tmp) ? row_bytes : sizeof(tmp);
+        memcpy(tmp, a, c);
+        memcpy(a, b, c);
+        memcpy(b, tmp, c);
+        a += c;
+        b += c;
+        row_bytes -= c;
+    }
+}
+
+/**
+ * @brief Fisher-Yates shuffle of n rows using one element stream
+ */
+static void fisher_yates(PhiloxSpill* sp, char* rows, size_t n, size_t row_bytes) {
+    for (size_t i = n; i > 1; i--) {
+        size_t j = (size_t)rng_bounded(sp, i);
+        if (j != i - 1) swap_rows(rows + j * row_bytes, rows + (i - 1) * row_bytes, row_bytes);
+    }
+}
+
+/**
+ * @brief Write a uniformly random permutation of n rows into dst
+ * @param gen Generator (NULL for the default generator)
+ * @param src Source rows, or NULL to write the row indices 0..n-1 as int64
+ * @param dst Destination (n rows, must not overlap src)
+ * @param n Number of rows
+ * @param row_bytes Bytes per row (8 when src is NULL)
+ * @return 0 on success, -1 on allocation failure
+ *
+ * Bucket sizes follow a multinomial distribution and every bucket is
+ * uniformly shuffled, which makes the whole permutation uniform.
+ */
+static int block_shuffle(TensrGenerator* gen, const char* src, char* dst, size_t n,
+                         size_t row_bytes) {
+    size_t nbuckets = (n + PERM_BUCKET - 1) / PERM_BUCKET;
+    if (nbuckets == 0) nbuckets = 1;
+    size_t nchunks = nbuckets < PERM_MAX_CHUNKS ? nbuckets : PERM_MAX_CHUNKS;
+    size_t chunk = (n + nchunks - 1) / nchunks;
+
+    size_t* offsets = (size_t*)calloc(nchunks * nbuckets + nbuckets + 1, sizeof(size_t));
+    if (!offsets) return -1;
+    size_t* starts = offsets + nchunks * nbuckets;
+
+    PhiloxState route = rng_reserve(gen, nbuckets > 1 ? n : 0);
+    PhiloxState local = rng_reserve(gen, 4 * nbuckets);
+
+    /* Count rows per (chunk, bucket) */
+    if (nbuckets > 1) {
+        TENSR_PARALLEL_FOR(nchunks > 1)
+        for (ptrdiff_t c = 0; c < (ptrdiff_t)nchunks; c++) {
+            size_t* h = offsets + (size_t)c * nbuckets;
+            size_t stop = ((size_t)c + 1) * chunk < n ? ((size_t)c + 1) * chunk : n;
+            uint32_t r[4];
+            uint64_t cached = UINT64_MAX;
+            for (size_t i = (size_t)c * chunk; i < stop; i++) {
+                h[bucket_of(&route, i, (uint32_t)nbuckets, r, &cached)]++;
+            }
+        }
+    } else {
+        offsets[0] = n;
+    }
+
+    /* Exclusive prefix sum in bucket-major order */
+    size_t pos = 0;
+    for (size_t b = 0; b < nbuckets; b++) {
+        starts[b] = pos;
+        for (size_t c = 0; c < nchunks; c++) {
+            size_t cnt = offsets[c * nbuckets + b];
+            offsets[c * nbuckets + b] = pos;
+            pos += cnt;
+        }
+    }
+    starts[nbuckets] = n;
+
+    /* Scatter rows to their buckets, preserving order within a chunk */
+    TENSR_PARALLEL_FOR(nchunks > 1)
+    for (ptrdiff_t c = 0; c < (ptrdiff_t)nchunks; c++) {
+        size_t* o = offsets + (size_t)c * nbuckets;
+        size_t stop = ((size_t)c + 1) * chunk < n ? ((size_t)c + 1) * chunk : n;
+        uint32_t r[4];
+        uint64_t cached = UINT64_MAX;
+        for (size_t i = (size_t)c * chunk; i < stop; i++) {
+            uint32_t b = nbuckets > 1 ? bucket_of(&route, i, (uint32_t)nbuckets, r, &cached) : 0;
+            char* d = dst + (o[b]++) * row_bytes;
+            if (src) {
+                memcpy(d, src + i * row_bytes, row_bytes);
+            } else {
+                int64_t v = (int64_t)i;
+                memcpy(d, &v, sizeof(v));
+            }
+        }
+    }
+
+    /* Shuffle each bucket in cache */
+    TENSR_PARALLEL_FOR(nbuckets > 1)
+    for (ptrdiff_t b = 0; b < (ptrdiff_t)nbuckets; b++) {
+        PhiloxSpill sp;
+        rng_stream_init(&sp, &local, (uint64_t)b);
+        fisher_yates(&sp, dst + starts[b] * row_bytes, starts[b + 1] - starts[b], row_bytes);
+    }
+
+    free(offsets);
+    return 0;
+}
+
+/**
+ * @brief Create a random permutation of 0..n-1
+ * @param gen Generator (NULL for the default generator)
+ * @param n Number of elements
+ * @return New INT64 tensor of shape (n), or NULL on failure
+ *
+ * Similar to numpy.random.permutation(n).
+ *
+ * Example:
+ *   Tensor* order = tensr_permutation(gen, num_rows);
+ */
+Tensor* tensr_permutation(TensrGenerator* gen, size_t n) {
+    Tensor* t = tensr_create(&n, 1, TENSR_INT64, TENSR_CPU);
+    if (!t) return NULL;
+    if (block_shuffle(gen, NULL, (char*)t->data, n, sizeof(int64_t)) != 0) {
+        tensr_free(t);
+        return NULL;
+    }
+    return t;
+}
+
+/**
+ * @brief Shuffle a tensor in place along an axis
+ * @param gen Generator (NULL for the default generator)
+ * @param t Tensor to shuffle
+ * @param axis Axis whose slices are permuted (negative counts from the end)
+ * @return 0 on success, -1 on failure
+ *
+ * All slices along the axis are moved by the same permutation, like
+ * numpy.random.shuffle (which shuffles axis 0). Shuffling axis 0 routes the
+ * rows directly through the block shuffle with one temporary copy.
+ *
+ * Example:
+ *   tensr_shuffle(gen, dataset, 0);  (shuffle the rows of a (N, features) tensor)
+ */
+int tensr_shuffle(TensrGenerator* gen, Tensor* t, int axis) {
+    if (axis < 0) axis += (int)t->ndim;
+    if (axis < 0 || (size_t)axis >= t->ndim) return -1;
+
+    size_t n = t->shape[axis];
+    size_t outer = 1, inner = tensr_dtype_size(t->dtype);
+    for (int i = 0; i < axis; i++) outer *= t->shape[i];
+    for (size_t i = (size_t)axis + 1; i < t->ndim; i++) inner *= t->shape[i];
+    size_t slab = n * inner;
+    if (n < 2 || slab == 0) return 0;
+
+    char* tmp = (char*)malloc(slab);
+    if (!tmp) return -1;
+
+    if (outer == 1) {
+        int rc = block_shuffle(gen, (const char*)t->data, tmp, n, inner);
+        if (rc == 0) memcpy(t->data, tmp, slab);
+        free(tmp);
+        return rc;
+    }
+
+    Tensor* perm = tensr_permutation(gen, n);
+    if (!perm) {
+        free(tmp);
+        return -1;
+    }
+    const int64_t* p = (const int64_t*)perm->data;
+    for (size_t o = 0; o < outer; o++) {
+        char* base = (char*)t->data + o * slab;
+        TENSR_PARALLEL_FOR(slab >= TENSR_PARALLEL_GRAIN)
+        for (ptrdiff_t i = 0; i < (ptrdiff_t)n; i++) {
+            memcpy(tmp + (size_t)i * inner, base + (size_t)p[i] * inner, inner);
+        }
+        memcpy(base, tmp, slab);
+    }
+    tensr_free(perm);
+    free(tmp);
+    return 0;
+}
+
+/**
+ * @brief Floyd's algorithm: k distinct indices from [0, n) in random order
+ *
+ * Uses an open-addressing hash set of size O(k), so memory does not grow
+ * with n. Step j draws from its own counter block.
+ */
+static int floyd_sample(TensrGenerator* gen, size_t n, size_t k, int64_t* out) {
+    size_t cap = 1;
+    while (cap < 2 * k) cap <<= 1;
+    int64_t* set = (int64_t*)malloc(cap * sizeof(int64_t));
+    if (!set) return -1;
+    for (size_t i = 0; i < cap; i++) set[i] = -1;
+
+    PhiloxState s = rng_reserve(gen, 4 * (k + 1));
+    for (size_t j = 0; j < k; j++) {
+        PhiloxSpill sp;
+        rng_stream_init(&sp, &s, (uint64_t)j);
+        size_t top = n - k + j;
+        int64_t v = (int64_t)rng_bounded(&sp, top + 1);
+        size_t h = ((uint64_t)v * 0x9E3779B97F4A7C15ull) >> 32 & (cap - 1);
+        while (set[h] != -1 && set[h] != v) h = (h + 1) & (cap - 1);
+        if (set[h] == v) {
+            v = (int64_t)top;
+            h = ((uint64_t)v * 0x9E3779B97F4A7C15ull) >> 32 & (cap - 1);
+            while (set[h] != -1) h = (h + 1) & (cap - 1);
+        }
+        set[h] = v;
+        out[j] = v;
+    }
+    free(set);
+
+    /* Floyd's selection is uniform as a set; shuffle to make the order uniform too */
+    PhiloxSpill sp;
+    rng_stream_init(&sp, &s, (uint64_t)k);
+    fisher_yates(&sp, (char*)out, k, sizeof(int64_t));
+    return 0;
+}
+
+/**
+ * @brief Build a Walker/Vose alias table for weights w[0..n-1]
+ * @param prob Output: acceptance probability per column
+ * @param alias Output: alias index per column
+ * @return 0 on success, -1 on allocation failure
+ */
+static int alias_build(const double* w, double total, size_t n, double* prob, int64_t* alias) {
+    size_t* small = (size_t*)malloc(2 * n * sizeof(size_t));
+    if (!small) return -1;
+    size_t* large = small + n;
+    size_t ns = 0, nl = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        prob[i] = w[i] * (double)n / total;
+        alias[i] = (int64_t)i;
+        if (prob[i] < 1.0) small[ns++] = i; else large[nl++] = i;
+    }
+    while (ns > 0 && nl > 0) {
+        size_t s = small[--ns];
+        size_t l = large[--nl];
+        alias[s] = (int64_t)l;
+        prob[l] -= 1.0 - prob[s];
+        if (prob[l] < 1.0) small[ns++] = l; else large[nl++] = l;
+    }
+    /* Leftovers are 1 up to rounding */
+    while (nl > 0) prob[large[--nl]] = 1.0;
+    while (ns > 0) prob[small[--ns]] = 1.0;
+    free(small);
+    return 0;
+}
+
+/**
+ * @brief Min-heap sift-down on (key, index) pairs
+ */
+static void heap_sift(double* key, int64_t* idx, size_t n, size_t i) {
+    for (;;) {
+        size_t m = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && key[l] < key[m]) m = l;
+        if (r < n && key[r] < key[m]) m = r;
+        if (m == i) return;
+        double tk = key[i]; key[i] = key[m]; key[m] = tk;
+        int64_t ti = idx[i]; idx[i] = idx[m]; idx[m] = ti;
+        i = m;
+    }
+}
+
+/**
+ * @brief Weighted sampling without replacement (Efraimidis-Spirakis)
+ *
+ * Each item gets the key log(u) / w; the k largest keys form the sample, and
+ * sorting them by decreasing key gives the order of successive draws. A
+ * size-k min-heap keeps this a single O(n log k) pass.
+ */
+static int weighted_without_replacement(TensrGenerator* gen, const double* w, size_t n, size_t k,
+                                        int64_t* out) {
+    double* key = (double*)malloc(k * sizeof(double));
+    int64_t* idx = (int64_t*)malloc(k * sizeof(int64_t));
+    if (!key || !idx) {
+        free(key);
+        free(idx);
+        return -1;
+    }
+
+    PhiloxState s = rng_reserve(gen, 2 * n);
+    size_t filled = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (w[i] <= 0.0) continue;
+        uint32_t r[4];
+        philox_block(&s, (uint64_t)(i / 2), r);
+        size_t l = 2 * (i % 2);
+        double ki = log(philox_double_open0(r[l], r[l + 1])) / w[i];
+        if (filled < k) {
+            key[filled] = ki;
+            idx[filled] = (int64_t)i;
+            if (++filled == k) {
+                for (size_t h = k / 2; h-- > 0;) heap_sift(key, idx, k, h);
+            }
+        } else if (ki > key[0]) {
+            key[0] = ki;
+            idx[0] = (int64_t)i;
+            heap_sift(key, idx, k, 0);
+        }
+    }
+
+    /* Pop the heap: smallest key first, so fill out[] from the back */
+    for (size_t m = k; m > 0; m--) {
+        out[m - 1] = idx[0];
+        key[0] = key[m - 1];
+        idx[0] = idx[m - 1];
+        heap_sift(key, idx, m - 1, 0);
+    }
+    free(key);
+    free(idx);
+    return 0;
+}
+
+/**
+ * @brief Sample rows of a tensor
+ * @param gen Generator (NULL for the default generator)
+ * @param t Tensor to sample from; rows are slices along axis 0
+ * @param k Number of rows to draw
+ * @param replace Whether a row may be drawn more than once
+ * @param weights Optional float32/float64 tensor of shape (t->shape[0]) with
+ *                non-negative, not necessarily normalized weights (NULL for uniform)
+ * @return New tensor of shape (k, t->shape[1:]...), or NULL on invalid input
+ *
+ * Without replacement k must not exceed the number of rows (with positive
+ * weight). Similar to numpy.random.choice(a, k, replace, p).
+ *
+ * Example:
+ *   Tensor* batch = tensr_choice(gen, dataset, 256, false, NULL);
+ *   Tensor* resampled = tensr_choice(gen, particles, n, true, particle_weights);
+ */
+Tensor* tensr_choice(TensrGenerator* gen, const Tensor* t, size_t k, bool replace,
+                     const Tensor* weights) {
+    if (t->ndim < 1) return NULL;
+    size_t n = t->shape[0];
+    if (n == 0 && k > 0) return NULL;
+    if (!replace && k > n) return NULL;
+
+    double* w = NULL;
+    double total = 0.0;
+    size_t positive = 0;
+    if (weights) {
+        if (weights->ndim != 1 || weights->size != n) return NULL;
+        if (weights->dtype != TENSR_FLOAT32 && weights->dtype != TENSR_FLOAT64) return NULL;
+        w = (double*)malloc((n ? n : 1) * sizeof(double));
+        if (!w) return NULL;
+        for (size_t i = 0; i < n; i++) {
+            w[i] = weights->dtype == TENSR_FLOAT32 ? ((const float*)weights->data)[i]
+                                                   : ((const double*)weights->data)[i];
+            if (!(w[i] >= 0.0) || isinf(w[i])) {
+                free(w);
+                return NULL;
+            }
+            if (w[i] > 0.0) positive++;
+            total += w[i];
+        }
+        if ((k > 0 && !(total > 0.0)) || (!replace && k > positive)) {
+            free(w);
+            return NULL;
+        }
+    }
+
+    int64_t* idx = (int64_t*)malloc((k ? k : 1) * sizeof(int64_t));
+    if (!idx) {
+        free(w);
+        return NULL;
+    }
+
+    int rc = 0;
+    if (k == 0) {
+        rc = 0;
+    } else if (replace && w) {
+        double* prob = (double*)malloc(n * sizeof(double));
+        int64_t* alias = (int64_t*)malloc(n * sizeof(int64_t));
+        rc = (prob && alias) ? alias_build(w, total, n, prob, alias) : -1;
+        if (rc == 0) {
+            PhiloxState s = rng_reserve(gen, 4 * k);
+            TENSR_PARALLEL_FOR(k >= TENSR_PARALLEL_GRAIN)
+            for (ptrdiff_t i = 0; i < (ptrdiff_t)k; i++) {
+                PhiloxSpill sp;
+                rng_stream_init(&sp, &s, (uint64_t)i);
+                size_t col = (size_t)rng_bounded(&sp, n);
+                idx[i] = rng_uniform(&sp) < prob[col] ? (int64_t)col : alias[col];
+            }
+        }
+        free(prob);
+        free(alias);
+    } else if (replace) {
+        PhiloxState s = rng_reserve(gen, 4 * k);
+        TENSR_PARALLEL_FOR(k >= TENSR_PARALLEL_GRAIN)
+        for (ptrdiff_t i = 0; i < (ptrdiff_t)k; i++) {
+            PhiloxSpill sp;
+            rng_stream_init(&sp, &s, (uint64_t)i);
+            idx[i] = (int64_t)rng_bounded(&sp, n);
+        }
+    } else if (w) {
+        rc = weighted_without_replacement(gen, w, n, k, idx);
+    } else if (k * FLOYD_RATIO <= n) {
+        rc = floyd_sample(gen, n, k, idx);
+    } else {
+        Tensor* perm = tensr_permutation(gen, n);
+        if (perm) {
+            memcpy(idx, perm->data, k * sizeof(int64_t));
+            tensr_free(perm);
+        } else {
+            rc = -1;
+        }
+    }
+    free(w);
+    if (rc != 0) {
+        free(idx);
+        return NULL;
+    }
+
+    size_t* shape = (size_t*)malloc(t->ndim * sizeof(size_t));
+    if (!shape) {
+        free(idx);
+        return NULL;
+    }
+    memcpy(shape, t->shape, t->ndim * sizeof(size_t));
+    shape[0] = k;
+    Tensor* result = tensr_create(shape, t->ndim, t->dtype, t->device);
+    free(shape);
+    if (result) {
+        size_t row_bytes = (n ? t->size / n : 0) * tensr_dtype_size(t->dtype);
+        const char* src = (const char*)t->data;
+        char* dst = (char*)result->data;
+        TENSR_PARALLEL_FOR(k * row_bytes >= TENSR_PARALLEL_GRAIN)
+        for (ptrdiff_t i = 0; i < (ptrdiff_t)k; i++) {
+            memcpy(dst + (size_t)i * row_bytes, src + (size_t)idx[i] * row_bytes, row_bytes);
+        }
+    }
+    free(idx);
+    return result;
+}
@@ -5,9 +5,13 @@
  */
 
 #include "tensr/tensr.h"
+#include "../src/io/format.h"
+#include "../src/random/philox.h"
 #include <stdio.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
+#include <stdlib.h>
 
 void test_create() {
     printf("Testing tensor creation...\n");
@@ -131,6 +135,368 @@ void test_matmul() {
     printf("✓ Matrix multiplication test passed\n");
 }
 
+void test_activation() {
+    printf("Testing activation functions...\n");
+    Tensor* x = tensr_linspace(-3.0, 3.0, 7, TENSR_FLOAT32, TENSR_CPU);
+    
+    Tensor* relu = tensr_relu(x);
+    Tensor* gelu = tensr_gelu(x);
+    Tensor* sig = tensr_sigmoid(x);
+    assert(relu != NULL && gelu != NULL && sig != NULL);
+    float* dx = (float*)x->data;
+    for (size_t i = 0; i < x->size; i++) {
+        float v = dx[i];
+        assert(fabs(((float*)relu->data)[i] - (v > 0 ? v : 0)) < 1e-6);
+        assert(fabs(((float*)gelu->data)[i] - 0.5f * v * (1.0f + erff(v / sqrtf(2.0f)))) < 1e-5);
+        assert(fabs(((float*)sig->data)[i] - 1.0f / (1.0f + expf(-v))) < 1e-6);
+    }
+    
+    Tensor* out = tensr_zeros(x->shape, x->ndim, TENSR_FLOAT32, TENSR_CPU);
+    assert(tensr_silu_out(x, out) == out);
+    assert(fabs(((float*)out->data)[6] - 3.0f / (1.0f + expf(-3.0f))) < 1e-5);
+    assert(tensr_tanh_(x) == x);
+    assert(fabs(dx[0] - tanhf(-3.0f)) < 1e-6);
+    
+    size_t shape[] = {2, 3};
+    Tensor* h = tensr_full(shape, 2, -1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* b = tensr_arange(0.0, 3.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* y = tensr_bias_act(h, b, TENSR_ACT_RELU);
+    assert(y != NULL);
+    float* dy = (float*)y->data;
+    assert(dy[0] == 0.0f && dy[1] == 0.0f && dy[2] == 1.0f && dy[5] == 1.0f);
+    
+    tensr_free(x);
+    tensr_free(relu);
+    tensr_free(gelu);
+    tensr_free(sig);
+    tensr_free(out);
+    tensr_free(h);
+    tensr_free(b);
+    tensr_free(y);
+    printf("✓ Activation functions test passed\n");
+}
+
+void test_normalization() {
+    printf("Testing normalization operations...\n");
+    size_t shape[] = {2, 4};
+    Tensor* x = tensr_arange(0.0, 8.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* x2 = tensr_reshape(x, shape, 2);
+    
+    Tensor* ln = tensr_layer_norm(x2, NULL, NULL, 1e-5, -1);
+    assert(ln != NULL);
+    float* ln_data = (float*)ln->data;
+    for (size_t r = 0; r < 2; r++) {
+        float mean = 0.0f;
+        for (size_t j = 0; j < 4; j++) mean += ln_data[r * 4 + j];
+        assert(fabs(mean) < 1e-5);
+    }
+    assert(fabs(ln_data[0] + 1.3416f) < 1e-3);
+    
+    Tensor* rms = tensr_rms_norm(x2, NULL, 0.0, -1);
+    assert(rms != NULL);
+    float* rms_data = (float*)rms->data;
+    assert(fabs(rms_data[3] - 3.0f / sqrtf(3.5f)) < 1e-5);
+    
+    size_t ch_shape[] = {2};
+    Tensor* mean = tensr_full(ch_shape, 1, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* var = tensr_full(ch_shape, 1, 4.0, TENSR_FLOAT32, TENSR_CPU);
+    size_t bn_shape[] = {1, 2, 4};
+    Tensor* x3 = tensr_reshape(x, bn_shape, 3);
+    Tensor* bn = tensr_batch_norm(x3, mean, var, NULL, NULL, 0.0);
+    assert(bn != NULL);
+    float* bn_data = (float*)bn->data;
+    for (size_t i = 0; i < bn->size; i++) {
+        assert(fabs(bn_data[i] - ((float)i - 1.0f) / 2.0f) < 1e-6);
+    }
+    
+    tensr_free(x);
+    tensr_free(x2);
+    tensr_free(x3);
+    tensr_free(ln);
+    tensr_free(rms);
+    tensr_free(mean);
+    tensr_free(var);
+    tensr_free(bn);
+    printf("✓ Normalization operations test passed\n");
+}
+
+void test_attention() {
+    printf("Testing attention...\n");
+    size_t lq = 40, lk = 70, d = 8;
+    size_t q_shape[] = {2, lq, d};
+    size_t k_shape[] = {2, lk, d};
+    
+    tensr_seed(7);
+    Tensor* q = tensr_randn(q_shape, 3, TENSR_CPU);
+    Tensor* k = tensr_randn(k_shape, 3, TENSR_CPU);
+    Tensor* v = tensr_randn(k_shape, 3, TENSR_CPU);
+    
+    for (int causal = 0; causal <= 1; causal++) {
+        Tensor* out = tensr_attention(q, k, v, NULL, 0.0, causal);
+        assert(out != NULL);
+        assert(out->shape[1] == lq && out->shape[2] == d);
+        
+        float* dq = (float*)q->data;
+        float* dk = (float*)k->data;
+        float* dv = (float*)v->data;
+        float* dout = (float*)out->data;
+        double scores[70];
+        for (size_t b = 0; b < 2; b++) {
+            for (size_t i = 0; i < lq; i++) {
+                size_t last = causal ? i + (lk - lq) : lk - 1;
+                double max_s = -INFINITY, total = 0.0;
+                for (size_t j = 0; j <= last; j++) {
+                    double dot = 0.0;
+                    for (size_t p = 0; p < d; p++) {
+                        dot += dq[(b * lq + i) * d + p] * dk[(b * lk + j) * d + p];
+                    }
+                    scores[j] = dot / sqrt((double)d);
+                    if (scores[j] > max_s) max_s = scores[j];
+                }
+                for (size_t j = 0; j <= last; j++) {
+                    scores[j] = exp(scores[j] - max_s);
+                    total += scores[j];
+                }
+                for (size_t c = 0; c < d; c++) {
+                    double ref = 0.0;
+                    for (size_t j = 0; j <= last; j++) ref += scores[j] * dv[(b * lk + j) * d + c];
+                    assert(fabs(dout[(b * lq + i) * d + c] - ref / total) < 1e-4);
+                }
+            }
+        }
+        tensr_free(out);
+    }
+    
+    tensr_free(q);
+    tensr_free(k);
+    tensr_free(v);
+    printf("✓ Attention test passed\n");
+}
+
+void test_embedding() {
+    printf("Testing embedding lookup...\n");
+    size_t table_shape[] = {4, 2};
+    Tensor* flat = tensr_arange(0.0, 8.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* table = tensr_reshape(flat, table_shape, 2);
+    
+    size_t idx_shape[] = {5};
+    Tensor* idx = tensr_create(idx_shape, 1, TENSR_INT64, TENSR_CPU);
+    int64_t* di = (int64_t*)idx->data;
+    di[0] = 3; di[1] = 0; di[2] = 1; di[3] = 1; di[4] = 2;
+    
+    Tensor* emb = tensr_embedding(table, idx);
+    assert(emb != NULL);
+    assert(emb->ndim == 2 && emb->shape[0] == 5 && emb->shape[1] == 2);
+    float* de = (float*)emb->data;
+    assert(de[0] == 6.0f && de[1] == 7.0f && de[8] == 4.0f);
+    
+    size_t off_shape[] = {3};
+    Tensor* offsets = tensr_create(off_shape, 1, TENSR_INT64, TENSR_CPU);
+    int64_t* doff = (int64_t*)offsets->data;
+    doff[0] = 0; doff[1] = 2; doff[2] = 2;
+    
+    Tensor* sum = tensr_embedding_bag(table, idx, offsets, TENSR_EMBED_SUM);
+    Tensor* mean = tensr_embedding_bag(table, idx, offsets, TENSR_EMBED_MEAN);
+    Tensor* max = tensr_embedding_bag(table, idx, offsets, TENSR_EMBED_MAX);
+    assert(sum != NULL && mean != NULL && max != NULL);
+    float* ds = (float*)sum->data;
+    assert(ds[0] == 6.0f && ds[1] == 8.0f);
+    assert(ds[2] == 0.0f && ds[3] == 0.0f);
+    assert(ds[4] == 8.0f && ds[5] == 11.0f);
+    assert(fabs(((float*)mean->data)[4] - 8.0f / 3.0f) < 1e-6);
+    assert(((float*)max->data)[5] == 5.0f);
+    
+    di[0] = 4;
+    assert(tensr_embedding(table, idx) == NULL);
+    
+    tensr_free(flat);
+    tensr_free(table);
+    tensr_free(idx);
+    tensr_free(emb);
+    tensr_free(offsets);
+    tensr_free(sum);
+    tensr_free(mean);
+    tensr_free(max);
+    printf("✓ Embedding lookup test passed\n");
+}
+
+void test_dropout() {
+    printf("Testing dropout...\n");
+    TensrGenerator* gen = tensr_generator_create(41);
+    size_t shape[] = {1001};
+    Tensor* x = tensr_ones(shape, 1, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* mask = NULL;
+    Tensor* y = tensr_dropout(x, 0.25, gen, &mask);
+    assert(y && mask && mask->dtype == TENSR_UINT8 && mask->size == 126);
+    
+    /* Kept elements are scaled, dropped ones are zero, and the mask agrees */
+    float* yd = (float*)y->data;
+    uint8_t* md = (uint8_t*)mask->data;
+    size_t kept = 0;
+    for (size_t i = 0; i < 1001; i++) {
+        bool bit = (md[i / 8] >> (i % 8)) & 1;
+        assert(bit ? fabsf(yd[i] - 4.0f / 3.0f) < 1e-6f : yd[i] == 0.0f);
+        kept += bit;
+    }
+    assert(kept > 690 && kept < 810);
+    
+    /* Same generator state gives the same mask */
+    tensr_generator_seed(gen, 41);
+    Tensor* y2 = tensr_dropout(x, 0.25, gen, NULL);
+    assert(memcmp(y->data, y2->data, 1001 * sizeof(float)) == 0);
+    
+    Tensor* dx = tensr_dropout_backward(x, mask, 0.25);
+    assert(memcmp(dx->data, y->data, 1001 * sizeof(float)) == 0);
+    
+    Tensor* all = tensr_dropout(x, 0.0, gen, NULL);
+    Tensor* none = tensr_dropout(x, 1.0, gen, NULL);
+    for (size_t i = 0; i < 1001; i++) {
+        assert(((float*)all->data)[i] == 1.0f && ((float*)none->data)[i] == 0.0f);
+    }
+    assert(tensr_dropout(x, 1.5, gen, NULL) == NULL);
+    
+    Tensor* ts[] = {x, mask, y, y2, dx, all, none};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    tensr_generator_free(gen);
+    printf("✓ Dropout test passed\n");
+}
+
+void test_optimizers() {
+    printf("Testing optimizer updates...\n");
+    size_t shape_a[] = {3};
+    size_t shape_b[] = {20000};
+    Tensor* params[2] = {tensr_ones(shape_a, 1, TENSR_FLOAT32, TENSR_CPU),
+                         tensr_ones(shape_b, 1, TENSR_FLOAT32, TENSR_CPU)};
+    Tensor* grads[2] = {tensr_full(shape_a, 1, 0.5, TENSR_FLOAT32, TENSR_CPU),
+                        tensr_full(shape_b, 1, 0.5, TENSR_FLOAT32, TENSR_CPU)};
+    Tensor* m[2] = {tensr_zeros(shape_a, 1, TENSR_FLOAT32, TENSR_CPU),
+                    tensr_zeros(shape_b, 1, TENSR_FLOAT32, TENSR_CPU)};
+    Tensor* v[2] = {tensr_zeros(shape_a, 1, TENSR_FLOAT32, TENSR_CPU),
+                    tensr_zeros(shape_b, 1, TENSR_FLOAT32, TENSR_CPU)};
+    
+    /* SGD with momentum: buf = 0.5, p = 1 - 0.1 * 0.5 */
+    assert(tensr_sgd_step(params, grads, m, 2, 0.1, 0.9, 0.0, false) == 0);
+    assert(fabs(((float*)params[0]->data)[0] - 0.95f) < 1e-6);
+    assert(fabs(((float*)params[1]->data)[19999] - 0.95f) < 1e-6);
+    for (size_t i = 0; i < 2; i++) {
+        memset(m[i]->data, 0, m[i]->size * sizeof(float));
+    }
+    
+    /* First Adam step moves every parameter by lr (bias-corrected m / sqrt(v) = 1) */
+    assert(tensr_adam_step(params, grads, m, v, 2, 0.01, 0.9, 0.999, 0.0, 0.0, 1) == 0);
+    assert(fabs(((float*)params[1]->data)[0] - 0.94f) < 1e-5);
+    
+    /* AdamW applies decay to the parameter directly */
+    for (size_t i = 0; i < 2; i++) {
+        memset(m[i]->data, 0, m[i]->size * sizeof(float));
+        memset(v[i]->data, 0, v[i]->size * sizeof(float));
+    }
+    float before = ((float*)params[0]->data)[0];
+    assert(tensr_adamw_step(params, grads, m, v, 2, 0.01, 0.9, 0.999, 0.0, 0.1, 1) == 0);
+    assert(fabs(((float*)params[0]->data)[0] - (before * (1.0f - 0.001f) - 0.01f)) < 1e-5);
+    
+    assert(tensr_adam_step(params, grads, m, v, 2, 0.01, 0.9, 0.999, 1e-8, 0.0, 0) == -1);
+    
+    for (size_t i = 0; i < 2; i++) {
+        tensr_free(params[i]);
+        tensr_free(grads[i]);
+        tensr_free(m[i]);
+        tensr_free(v[i]);
+    }
+    printf("✓ Optimizer updates test passed\n");
+}
+
+static Tensor* square_gelu(Tensor** inputs, size_t ninputs, void* ctx) {
+    (void)ninputs;
+    (void)ctx;
+    Tensor* sq = tensr_mul(inputs[0], inputs[0]);
+    Tensor* out = tensr_gelu(sq);
+    tensr_free(sq);
+    return out;
+}
+
+static Tensor* unstable_segment(Tensor** inputs, size_t ninputs, void* ctx) {
+    /* Recomputes to a different shape, so checkpoint backward must fail */
+    int* calls = (int*)ctx;
+    if ((*calls)++ == 0) return square_gelu(inputs, ninputs, NULL);
+    return tensr_ones((size_t[]){2}, 1, TENSR_FLOAT64, TENSR_CPU);
+}
+
+void test_autograd() {
+    printf("Testing autograd...\n");
+    Tensor* x = tensr_linspace(-1.0, 1.0, 5, TENSR_FLOAT64, TENSR_CPU);
+    tensr_requires_grad(x, true);
+    
+    Tensor* sq = tensr_mul(x, x);
+    Tensor* sig = tensr_sigmoid(x);
+    Tensor* y = tensr_add(sq, sig);
+    Tensor* loss = tensr_sum(y, NULL, 0, false);
+    assert(loss->requires_grad);
+    tensr_free(sq);  /* Still referenced by the tape */
+    assert(tensr_backward(loss) == 0);
+    assert(x->grad != NULL);
+    double* dx = (double*)x->data;
+    double* gx = (double*)x->grad->data;
+    for (size_t i = 0; i < x->size; i++) {
+        double s = 1.0 / (1.0 + exp(-dx[i]));
+        assert(fabs(gx[i] - (2.0 * dx[i] + s * (1.0 - s))) < 1e-12);
+    }
+    tensr_free(sig);
+    tensr_free(y);
+    tensr_free(loss);
+    
+    size_t shape_a[] = {2, 3};
+    size_t shape_b[] = {3, 2};
+    Tensor* a = tensr_ones(shape_a, 2, TENSR_FLOAT64, TENSR_CPU);
+    Tensor* bflat = tensr_arange(0.0, 6.0, 1.0, TENSR_FLOAT64, TENSR_CPU);
+    Tensor* b = tensr_reshape(bflat, shape_b, 2);
+    tensr_requires_grad(a, true);
+    Tensor* c = tensr_matmul(a, b);
+    Tensor* mean = tensr_mean(c, NULL, 0, false);
+    assert(tensr_backward(mean) == 0);
+    double* ga = (double*)a->grad->data;
+    assert(fabs(ga[0] - 0.25) < 1e-12 && fabs(ga[2] - 2.25) < 1e-12 && fabs(ga[5] - 2.25) < 1e-12);
+    tensr_free(c);
+    tensr_free(mean);
+    
+    /* Checkpointed segment gives the same gradient as the plain graph */
+    tensr_zero_grad(x);
+    Tensor* seg = tensr_checkpoint(square_gelu, &x, 1, NULL);
+    assert(seg != NULL && seg->requires_grad);
+    Tensor* seg_loss = tensr_sum(seg, NULL, 0, false);
+    assert(tensr_backward(seg_loss) == 0);
+    gx = (double*)x->grad->data;
+    for (size_t i = 0; i < x->size; i++) {
+        double u = dx[i] * dx[i];
+        double cdf = 0.5 * (1.0 + erf(u / sqrt(2.0)));
+        double pdf = exp(-0.5 * u * u) * 0.3989422804014327;
+        assert(fabs(gx[i] - (cdf + u * pdf) * 2.0 * dx[i]) < 1e-12);
+    }
+    tensr_free(seg);
+    tensr_free(seg_loss);
+    
+    /* A failed recompute reports an error and releases what it built */
+    int calls = 0;
+    Tensor* bad = tensr_checkpoint(unstable_segment, &x, 1, &calls);
+    Tensor* bad_loss = tensr_sum(bad, NULL, 0, false);
+    assert(tensr_backward(bad_loss) == -1 && calls == 2);
+    tensr_free(bad);
+    tensr_free(bad_loss);
+    
+    tensr_set_grad_enabled(false);
+    Tensor* no_grad = tensr_mul(x, x);
+    assert(!no_grad->requires_grad);
+    tensr_set_grad_enabled(true);
+    tensr_free(no_grad);
+    
+    tensr_free(x);
+    tensr_free(a);
+    tensr_free(bflat);
+    tensr_free(b);
+    tensr_tape_clear();
+    printf("✓ Autograd test passed\n");
+}
+
 void test_random() {
     printf("Testing random operations...\n");
     size_t shape[] = {10, 10};
@@ -143,19 +509,545 @@ void test_random() {
     float* data = (float*)t->data;
     for (size_t i = 0; i < t->size; i++) {
         assert(data[i] >= 0.0f && data[i] <= 1.0f);
+        assert(data[i] < 1.0f);
+    }
+    
+    /* Random123 known-answer vectors for Philox4x32-10 */
+    static const struct {
+        PhiloxState s;
+        uint32_t want[4];
+    } kat[] = {
+        {{{0, 0}, 0, 0}, {0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}},
+        {{{0xffffffffu, 0xffffffffu}, UINT64_MAX, UINT64_MAX},
+         {0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}},
+        {{{0xa4093822u, 0x299f31d0u}, 0x85a308d3243f6a88u, 0x0370734413198a2eu},
+         {0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}},
+    };
+    for (size_t k = 0; k < sizeof(kat) / sizeof(kat[0]); k++) {
+        uint32_t r[4];
+        philox_block(&kat[k].s, 0, r);
+        for (int l = 0; l < 4; l++) assert(r[l] == kat[k].want[l]);
+    }
+    /* Streams that agree when folded to 32 bits still get distinct spill words */
+    PhiloxState sa = {{7, 9}, 0, 0}, sb = {{7, 9}, 0, 0x0000000500000005ull};
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        PhiloxSpill pa, pb;
+        philox_spill_init(&pa, &sa, 3, lane);
+        philox_spill_init(&pb, &sb, 3, lane);
+        for (int k = 0; k < 8; k++) assert(philox_spill_next(&pa) != philox_spill_next(&pb));
+    }
+    
+    /* A generator seeded with 0 starts at the first vector */
+    TensrGenerator* g0 = tensr_generator_create(0);
+    Tensor* u0 = tensr_rand_gen(g0, (size_t[]){4}, 1, TENSR_CPU);
+    for (int l = 0; l < 4; l++) assert(((float*)u0->data)[l] == philox_float01(kat[0].want[l]));
+    tensr_free(u0);
+    tensr_generator_free(g0);
+    
+    /* Same seed reproduces the same stream, later draws continue it */
+    tensr_seed(42);
+    Tensor* again = tensr_rand(shape, 2, TENSR_CPU);
+    Tensor* next = tensr_rand(shape, 2, TENSR_CPU);
+    assert(memcmp(again->data, t->data, t->size * sizeof(float)) == 0);
+    assert(memcmp(next->data, t->data, t->size * sizeof(float)) != 0);
+    
+    size_t big[] = {4099};
+    Tensor* n = tensr_randn(big, 1, TENSR_CPU);
+    double mean = 0.0, var = 0.0;
+    for (size_t i = 0; i < n->size; i++) mean += ((float*)n->data)[i];
+    mean /= (double)n->size;
+    for (size_t i = 0; i < n->size; i++) {
+        double d = ((float*)n->data)[i] - mean;
+        var += d * d;
+    }
+    var /= (double)n->size;
+    assert(fabs(mean) < 0.1 && fabs(var - 1.0) < 0.1);
+    
+    Tensor* ints = tensr_randint(-3, 4, big, 1, TENSR_CPU);
+    for (size_t i = 0; i < ints->size; i++) {
+        int32_t v = ((int32_t*)ints->data)[i];
+        assert(v >= -3 && v < 4);
     }
     
     tensr_free(t);
+    tensr_free(again);
+    tensr_free(next);
+    tensr_free(n);
+    tensr_free(ints);
     printf("✓ Random operations test passed\n");
 }
 
+void test_generators() {
+    printf("Testing random generators...\n");
+    size_t shape[] = {100};
+    
+    TensrGenerator* a = tensr_generator_create(7);
+    TensrGenerator* b = tensr_generator_create(7);
+    Tensor* ta = tensr_randn_gen(a, shape, 1, TENSR_CPU);
+    Tensor* tb = tensr_randn_gen(b, shape, 1, TENSR_CPU);
+    assert(memcmp(ta->data, tb->data, 100 * sizeof(float)) == 0);
+    
+    /* Jumping 25 blocks skips exactly one 100-element float tensor */
+    TensrGeneratorState saved;
+    tensr_generator_get_state(a, &saved);
+    Tensor* drawn = tensr_rand_gen(a, shape, 1, TENSR_CPU);
+    Tensor* after = tensr_rand_gen(a, shape, 1, TENSR_CPU);
+    tensr_generator_set_state(b, &saved);
+    Tensor* replay = tensr_rand_gen(b, shape, 1, TENSR_CPU);
+    assert(memcmp(replay->data, drawn->data, 100 * sizeof(float)) == 0);
+    tensr_generator_set_state(b, &saved);
+    tensr_generator_jump(b, 25);
+    Tensor* jumped = tensr_rand_gen(b, shape, 1, TENSR_CPU);
+    assert(memcmp(jumped->data, after->data, 100 * sizeof(float)) == 0);
+    
+    /* Split streams are deterministic and distinct */
+    tensr_generator_set_state(b, &saved);
+    TensrGenerator* c1 = tensr_generator_split(a);
+    TensrGenerator* c2 = tensr_generator_split(a);
+    Tensor* s1 = tensr_rand_gen(c1, shape, 1, TENSR_CPU);
+    Tensor* s2 = tensr_rand_gen(c2, shape, 1, TENSR_CPU);
+    assert(memcmp(s1->data, s2->data, 100 * sizeof(float)) != 0);
+    
+    /* Generators do not disturb the default stream */
+    tensr_seed(3);
+    Tensor* d1 = tensr_rand(shape, 1, TENSR_CPU);
+    tensr_seed(3);
+    Tensor* other = tensr_rand_gen(a, shape, 1, TENSR_CPU);
+    Tensor* d2 = tensr_rand(shape, 1, TENSR_CPU);
+    assert(memcmp(d1->data, d2->data, 100 * sizeof(float)) == 0);
+    
+    Tensor* ts[] = {ta, tb, drawn, after, replay, jumped, s1, s2, d1, other, d2};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    tensr_generator_free(a);
+    tensr_generator_free(b);
+    tensr_generator_free(c1);
+    tensr_generator_free(c2);
+    printf("✓ Random generators test passed\n");
+}
+
+void test_random_parallel() {
+    printf("Testing parallel random generation...\n");
+    size_t shape[] = {100003};
+    int threads = tensr_get_num_threads();
+    Tensor* serial[3];
+    Tensor* parallel[3];
+    
+    tensr_set_num_threads(1);
+    TensrGenerator* gen = tensr_generator_create(99);
+    serial[0] = tensr_rand_gen(gen, shape, 1, TENSR_CPU);
+    serial[1] = tensr_randn_gen(gen, shape, 1, TENSR_CPU);
+    serial[2] = tensr_randint_gen(gen, -50, 50, shape, 1, TENSR_CPU);
+    
+    tensr_set_num_threads(4);
+    tensr_generator_seed(gen, 99);
+    parallel[0] = tensr_rand_gen(gen, shape, 1, TENSR_CPU);
+    parallel[1] = tensr_randn_gen(gen, shape, 1, TENSR_CPU);
+    parallel[2] = tensr_randint_gen(gen, -50, 50, shape, 1, TENSR_CPU);
+    tensr_set_num_threads(threads);
+    
+    for (int k = 0; k < 3; k++) {
+        assert(memcmp(serial[k]->data, parallel[k]->data, shape[0] * 4) == 0);
+        tensr_free(serial[k]);
+        tensr_free(parallel[k]);
+    }
+    tensr_generator_free(gen);
+    printf("✓ Parallel random generation test passed\n");
+}
+
+void test_normal_sampler() {
+    printf("Testing normal sampler...\n");
+    size_t shape[] = {400000};
+    TensrGenerator* gen = tensr_generator_create(2024);
+    TensrDType dtypes[] = {TENSR_FLOAT32, TENSR_FLOAT64};
+    
+    for (int d = 0; d < 2; d++) {
+        Tensor* z = tensr_standard_normal(gen, shape, 1, dtypes[d], TENSR_CPU);
+        assert(z != NULL && z->dtype == dtypes[d]);
+        double mean = 0.0, m2 = 0.0, m4 = 0.0;
+        size_t beyond3 = 0, beyond_r = 0;
+        for (size_t i = 0; i < z->size; i++) {
+            double v = dtypes[d] == TENSR_FLOAT32 ? ((float*)z->data)[i] : ((double*)z->data)[i];
+            assert(isfinite(v));
+            mean += v;
+            m2 += v * v;
+            m4 += v * v * v * v;
+            if (fabs(v) > 3.0) beyond3++;
+            if (fabs(v) > 3.5) beyond_r++;
+        }
+        double n = (double)z->size;
+        mean /= n;
+        m2 /= n;
+        m4 /= n;
+        assert(fabs(mean) < 0.01);
+        assert(fabs(m2 - 1.0) < 0.01);
+        assert(fabs(m4 - 3.0) < 0.1);
+        /* P(|z| > 3) = 0.0027 and P(|z| > 3.5) = 4.65e-4: the tail is sampled, not clipped */
+        assert(beyond3 > 950 && beyond3 < 1210);
+        assert(beyond_r > 130 && beyond_r < 250);
+        tensr_free(z);
+    }
+    
+    assert(tensr_standard_normal(gen, shape, 1, TENSR_INT32, TENSR_CPU) == NULL);
+    tensr_generator_free(gen);
+    printf("✓ Normal sampler test passed\n");
+}
+
+static double sample_mean(const Tensor* t, double* var) {
+    double sum = 0.0, sq = 0.0;
+    for (size_t i = 0; i < t->size; i++) {
+        double v;
+        switch (t->dtype) {
+            case TENSR_FLOAT32: v = ((float*)t->data)[i]; break;
+            case TENSR_FLOAT64: v = ((double*)t->data)[i]; break;
+            case TENSR_INT32: v = ((int32_t*)t->data)[i]; break;
+            case TENSR_INT64: v = (double)((int64_t*)t->data)[i]; break;
+            default: v = ((uint8_t*)t->data)[i]; break;
+        }
+        sum += v;
+        sq += v * v;
+    }
+    double mean = sum / (double)t->size;
+    if (var) *var = sq / (double)t->size - mean * mean;
+    return mean;
+}
+
+void test_distributions() {
+    printf("Testing distributions...\n");
+    size_t shape[] = {100000};
+    TensrGenerator* gen = tensr_generator_create(11);
+    double var;
+    
+    Tensor* u = tensr_uniform(gen, -2.0, 3.0, shape, 1, TENSR_FLOAT64, TENSR_CPU);
+    for (size_t i = 0; i < u->size; i++) {
+        double v = ((double*)u->data)[i];
+        assert(v >= -2.0 && v < 3.0);
+    }
+    assert(fabs(sample_mean(u, &var) - 0.5) < 0.05 && fabs(var - 25.0 / 12.0) < 0.05);
+    
+    Tensor* nrm = tensr_normal(gen, 5.0, 2.0, shape, 1, TENSR_FLOAT32, TENSR_CPU);
+    assert(fabs(sample_mean(nrm, &var) - 5.0) < 0.05 && fabs(var - 4.0) < 0.1);
+    
+    Tensor* bern = tensr_bernoulli(gen, 0.3, shape, 1, TENSR_UINT8, TENSR_CPU);
+    assert(bern->dtype == TENSR_UINT8);
+    assert(fabs(sample_mean(bern, NULL) - 0.3) < 0.01);
+    
+    Tensor* ex = tensr_exponential(gen, 4.0, shape, 1, TENSR_FLOAT64, TENSR_CPU);
+    assert(fabs(sample_mean(ex, &var) - 0.25) < 0.01 && fabs(var - 0.0625) < 0.005);
+    
+    /* Gamma on both sides of k = 1 */
+    Tensor* g1 = tensr_gamma(gen, 0.5, 2.0, shape, 1, TENSR_FLOAT64, TENSR_CPU);
+    assert(fabs(sample_mean(g1, &var) - 1.0) < 0.03 && fabs(var - 2.0) < 0.1);
+    Tensor* g2 = tensr_gamma(gen, 9.0, 0.5, shape, 1, TENSR_FLOAT32, TENSR_CPU);
+    assert(fabs(sample_mean(g2, &var) - 4.5) < 0.03 && fabs(var - 2.25) < 0.1);
+    
+    Tensor* be = tensr_beta(gen, 2.0, 5.0, shape, 1, TENSR_FLOAT64, TENSR_CPU);
+    assert(fabs(sample_mean(be, &var) - 2.0 / 7.0) < 0.005);
+    assert(fabs(var - 10.0 / (49.0 * 8.0)) < 0.002);
+    
+    /* Poisson and binomial through both the inversion and rejection branches */
+    Tensor* p1 = tensr_poisson(gen, 3.0, shape, 1, TENSR_INT64, TENSR_CPU);
+    assert(fabs(sample_mean(p1, &var) - 3.0) < 0.05 && fabs(var - 3.0) < 0.1);
+    Tensor* p2 = tensr_poisson(gen, 250.0, shape, 1, TENSR_INT32, TENSR_CPU);
+    assert(fabs(sample_mean(p2, &var) - 250.0) < 0.5 && fabs(var - 250.0) < 8.0);
+    Tensor* b1 = tensr_binomial(gen, 20, 0.1, shape, 1, TENSR_INT64, TENSR_CPU);
+    assert(fabs(sample_mean(b1, &var) - 2.0) < 0.05 && fabs(var - 1.8) < 0.06);
+    Tensor* b2 = tensr_binomial(gen, 1000, 0.7, shape, 1, TENSR_FLOAT64, TENSR_CPU);
+    assert(fabs(sample_mean(b2, &var) - 700.0) < 0.5 && fabs(var - 210.0) < 7.0);
+    
+    double w[] = {1.0, 0.0, 3.0};
+    Tensor* probs = tensr_create((size_t[]){3}, 1, TENSR_FLOAT64, TENSR_CPU);
+    memcpy(probs->data, w, sizeof(w));
+    Tensor* cat = tensr_categorical(gen, probs, 40000, TENSR_INT64);
+    size_t counts[3] = {0, 0, 0};
+    for (size_t i = 0; i < cat->size; i++) counts[((int64_t*)cat->data)[i]]++;
+    assert(counts[1] == 0);
+    assert(fabs((double)counts[2] / 40000.0 - 0.75) < 0.015);
+    
+    /* Invalid parameters and dtypes */
+    assert(tensr_uniform(gen, 1.0, 1.0, shape, 1, TENSR_FLOAT32, TENSR_CPU) == NULL);
+    assert(tensr_bernoulli(gen, 1.5, shape, 1, TENSR_BOOL, TENSR_CPU) == NULL);
+    assert(tensr_gamma(gen, 1.0, 1.0, shape, 1, TENSR_INT32, TENSR_CPU) == NULL);
+    assert(tensr_binomial(gen, -1, 0.5, shape, 1, TENSR_INT32, TENSR_CPU) == NULL);
+    
+    Tensor* ts[] = {u, nrm, bern, ex, g1, g2, be, p1, p2, b1, b2, probs, cat};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    tensr_generator_free(gen);
+    printf("✓ Distributions test passed\n");
+}
+
+void test_randint_bounded() {
+    printf("Testing bounded integer sampling...\n");
+    size_t shape[] = {60000};
+    TensrGenerator* gen = tensr_generator_create(5);
+    
+    /* Each of 6 values should appear about 10000 times */
+    Tensor* dice = tensr_randint_gen(gen, 1, 7, shape, 1, TENSR_CPU);
+    size_t counts[7] = {0};
+    for (size_t i = 0; i < dice->size; i++) {
+        int32_t v = ((int32_t*)dice->data)[i];
+        assert(v >= 1 && v <= 6);
+        counts[v]++;
+    }
+    for (int v = 1; v <= 6; v++) assert(counts[v] > 9500 && counts[v] < 10500);
+    
+    /* Full int32 span and ranges beyond 32 bits */
+    Tensor* wide = tensr_randint_gen(gen, INT32_MIN, INT32_MAX, shape, 1, TENSR_CPU);
+    assert(wide != NULL);
+    int64_t lo = -(INT64_C(1) << 62), hi = INT64_C(1) << 62;
+    Tensor* big = tensr_randint64(gen, lo, hi, shape, 1, TENSR_CPU);
+    assert(big->dtype == TENSR_INT64);
+    size_t negative = 0, beyond32 = 0;
+    for (size_t i = 0; i < big->size; i++) {
+        int64_t v = ((int64_t*)big->data)[i];
+        assert(v >= lo && v < hi);
+        if (v < 0) negative++;
+        if (v > INT64_C(0xFFFFFFFF) || v < -INT64_C(0xFFFFFFFF)) beyond32++;
+    }
+    assert(negative > 29000 && negative < 31000);
+    assert(beyond32 > 59000);
+    
+    Tensor* one = tensr_randint64(gen, 41, 42, shape, 1, TENSR_CPU);
+    for (size_t i = 0; i < one->size; i++) assert(((int64_t*)one->data)[i] == 41);
+    assert(tensr_randint64(gen, 5, 5, shape, 1, TENSR_CPU) == NULL);
+    assert(tensr_randint_gen(gen, 3, 2, shape, 1, TENSR_CPU) == NULL);
+    
+    tensr_free(dice);
+    tensr_free(wide);
+    tensr_free(big);
+    tensr_free(one);
+    tensr_generator_free(gen);
+    printf("✓ Bounded integer sampling test passed\n");
+}
+
+static bool is_permutation(const int64_t* p, size_t n) {
+    unsigned char* seen = (unsigned char*)calloc(n, 1);
+    bool ok = true;
+    for (size_t i = 0; i < n && ok; i++) {
+        if (p[i] < 0 || (size_t)p[i] >= n || seen[p[i]]) ok = false;
+        else seen[p[i]] = 1;
+    }
+    free(seen);
+    return ok;
+}
+
+void test_sampling() {
+    printf("Testing permutation and sampling...\n");
+    TensrGenerator* gen = tensr_generator_create(21);
+    int threads = tensr_get_num_threads();
+    
+    /* Multi-bucket permutation, identical for 1 and 4 threads */
+    size_t n = 300000;
+    tensr_set_num_threads(1);
+    Tensor* p1 = tensr_permutation(gen, n);
+    tensr_set_num_threads(4);
+    tensr_generator_seed(gen, 21);
+    Tensor* p2 = tensr_permutation(gen, n);
+    tensr_set_num_threads(threads);
+    assert(is_permutation((int64_t*)p1->data, n));
+    assert(memcmp(p1->data, p2->data, n * sizeof(int64_t)) == 0);
+    size_t fixed = 0;
+    for (size_t i = 0; i < n; i++) fixed += ((int64_t*)p1->data)[i] == (int64_t)i;
+    assert(fixed < 10);
+    
+    /* All 6 orders of 3 elements are equally likely */
+    size_t orders[9] = {0};
+    for (int trial = 0; trial < 6000; trial++) {
+        Tensor* p = tensr_permutation(gen, 3);
+        int64_t* v = (int64_t*)p->data;
+        orders[v[0] * 3 + v[1]]++;
+        tensr_free(p);
+    }
+    for (int a = 0; a < 3; a++) {
+        for (int b = 0; b < 3; b++) {
+            if (a != b) assert(orders[a * 3 + b] > 850 && orders[a * 3 + b] < 1150);
+        }
+    }
+    
+    /* Shuffle keeps rows intact on both axes */
+    Tensor* m = tensr_arange(0.0, 12.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* m2 = tensr_reshape(m, (size_t[]){4, 3}, 2);
+    assert(tensr_shuffle(gen, m2, 0) == 0);
+    float* d = (float*)m2->data;
+    float total = 0.0f;
+    for (int r = 0; r < 4; r++) {
+        assert(d[r * 3 + 1] == d[r * 3] + 1.0f && d[r * 3 + 2] == d[r * 3] + 2.0f);
+        total += d[r * 3];
+    }
+    assert(total == 18.0f);
+    assert(tensr_shuffle(gen, m2, -1) == 0);
+    /* Every row moved its columns by the same permutation */
+    for (int r = 0; r < 4; r++) {
+        float row0 = d[r * 3] - fmodf(d[r * 3], 3.0f);
+        for (int j = 0; j < 3; j++) assert(d[r * 3 + j] - row0 == fmodf(d[j], 3.0f));
+    }
+    assert(tensr_shuffle(gen, m2, 2) == -1);
+    
+    /* Choice without replacement: Floyd path and permutation path */
+    Tensor* pool = tensr_arange(0.0, 1000.0, 1.0, TENSR_INT64, TENSR_CPU);
+    Tensor* few = tensr_choice(gen, pool, 10, false, NULL);
+    Tensor* most = tensr_choice(gen, pool, 900, false, NULL);
+    assert(few->shape[0] == 10 && most->shape[0] == 900);
+    unsigned char seen[1000];
+    memset(seen, 0, sizeof(seen));
+    for (size_t i = 0; i < 900; i++) {
+        int64_t v = ((int64_t*)most->data)[i];
+        assert(!seen[v]);
+        seen[v] = 1;
+    }
+    memset(seen, 0, sizeof(seen));
+    for (size_t i = 0; i < 10; i++) {
+        int64_t v = ((int64_t*)few->data)[i];
+        assert(v >= 0 && v < 1000 && !seen[v]);
+        seen[v] = 1;
+    }
+    assert(tensr_choice(gen, pool, 1001, false, NULL) == NULL);
+    
+    /* Weighted sampling with and without replacement */
+    Tensor* small = tensr_arange(0.0, 4.0, 1.0, TENSR_INT64, TENSR_CPU);
+    Tensor* w = tensr_create((size_t[]){4}, 1, TENSR_FLOAT64, TENSR_CPU);
+    double wv[] = {1.0, 0.0, 2.0, 7.0};
+    memcpy(w->data, wv, sizeof(wv));
+    Tensor* draws = tensr_choice(gen, small, 50000, true, w);
+    size_t counts[4] = {0};
+    for (size_t i = 0; i < 50000; i++) counts[((int64_t*)draws->data)[i]]++;
+    assert(counts[1] == 0);
+    assert(fabs(counts[0] / 50000.0 - 0.1) < 0.01 && fabs(counts[3] / 50000.0 - 0.7) < 0.01);
+    Tensor* top = tensr_choice(gen, small, 3, false, w);
+    int64_t* tv = (int64_t*)top->data;
+    assert(tv[0] != 1 && tv[1] != 1 && tv[2] != 1);
+    assert(tv[0] != tv[1] && tv[1] != tv[2] && tv[0] != tv[2]);
+    assert(tensr_choice(gen, small, 4, false, w) == NULL);
+    
+    Tensor* ts[] = {p1, p2, m, m2, pool, few, most, small, w, draws, top};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    tensr_generator_free(gen);
+    printf("✓ Permutation and sampling test passed\n");
+}
+
+void test_random_fill() {
+    printf("Testing in-place random fills...\n");
+    TensrGenerator* gen = tensr_generator_create(31);
+    
+    /* Contiguous fills match the allocating versions */
+    size_t shape[] = {5, 7};
+    Tensor* a = tensr_rand_gen(gen, shape, 2, TENSR_CPU);
+    Tensor* b = tensr_zeros(shape, 2, TENSR_FLOAT32, TENSR_CPU);
+    tensr_generator_seed(gen, 31);
+    assert(tensr_rand_(gen, b) == b);
+    assert(memcmp(a->data, b->data, a->size * sizeof(float)) == 0);
+    Tensor* n = tensr_randn_gen(gen, shape, 2, TENSR_CPU);
+    Tensor* fresh = tensr_randn_gen(gen, shape, 2, TENSR_CPU);
+    tensr_generator_seed(gen, 31);
+    tensr_rand_(gen, b);
+    tensr_randn_(gen, b);
+    assert(memcmp(n->data, b->data, n->size * sizeof(float)) == 0);
+    assert(memcmp(fresh->data, b->data, n->size * sizeof(float)) != 0);
+    
+    /* Every other column of a 6x8 float64 tensor, filled through a view */
+    Tensor* base = tensr_zeros((size_t[]){6, 8}, 2, TENSR_FLOAT64, TENSR_CPU);
+    size_t vshape[] = {6, 4};
+    size_t vstrides[] = {8, 2};
+    Tensor view = *base;
+    view.shape = vshape;
+    view.strides = vstrides;
+    view.size = 24;
+    view.owns_data = false;
+    tensr_generator_seed(gen, 32);
+    assert(tensr_uniform_(gen, &view, -2.0, 3.0) == &view);
+    tensr_generator_seed(gen, 32);
+    Tensor* dense = tensr_uniform(gen, -2.0, 3.0, vshape, 2, TENSR_FLOAT64, TENSR_CPU);
+    double* bd = (double*)base->data;
+    double* dd = (double*)dense->data;
+    for (size_t r = 0; r < 6; r++) {
+        for (size_t c = 0; c < 8; c++) {
+            double v = bd[r * 8 + c];
+            if (c % 2) {
+                assert(v == 0.0);
+            } else {
+                assert(v >= -2.0 && v < 3.0);
+                assert(v == dd[r * 4 + c / 2]);
+            }
+        }
+    }
+    
+    assert(tensr_uniform_(gen, base, 1.0, 1.0) == NULL);
+    Tensor* ints = tensr_zeros(shape, 2, TENSR_INT32, TENSR_CPU);
+    assert(tensr_rand_(gen, ints) == NULL);
+    
+    Tensor* ts[] = {a, b, n, fresh, base, dense, ints};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    tensr_generator_free(gen);
+    printf("✓ In-place random fill test passed\n");
+}
+
+/* True if the column takes exactly one value in each of the n bins of [0, 1) */
+static bool is_stratified(const double* x, size_t n, size_t stride) {
+    unsigned char* hit = (unsigned char*)calloc(n, 1);
+    bool ok = true;
+    for (size_t i = 0; i < n; i++) {
+        size_t bin = (size_t)(x[i * stride] * n);
+        if (bin >= n || hit[bin]) ok = false;
+        else hit[bin] = 1;
+    }
+    free(hit);
+    return ok;
+}
+
+void test_qrng() {
+    printf("Testing quasi-random sequences...\n");
+    TensrGenerator* gen = tensr_generator_create(51);
+    
+    /* Gray-code order: 0, 1/2, then (3/4, 1/4) and (1/4, 3/4) */
+    Tensor* s = tensr_sobol(gen, 3000, 6, false, 0, TENSR_FLOAT64);
+    double* sd = (double*)s->data;
+    for (int d = 0; d < 6; d++) assert(sd[d] == 0.0 && sd[6 + d] == 0.5);
+    assert(sd[12] == 0.75 && sd[13] == 0.25 && sd[18] == 0.25 && sd[19] == 0.75);
+    for (int d = 0; d < 6; d++) assert(is_stratified(sd + d, 2048, 6));
+    
+    /* Skip-ahead across chunk boundaries gives the same points */
+    Tensor* tail = tensr_sobol(gen, 1500, 6, false, 1500, TENSR_FLOAT64);
+    assert(memcmp(tail->data, sd + 1500 * 6, 1500 * 6 * sizeof(double)) == 0);
+    
+    /* Scrambling keeps the net property and is reproducible */
+    tensr_generator_seed(gen, 52);
+    Tensor* sc = tensr_sobol(gen, 1024, 5, true, 0, TENSR_FLOAT64);
+    tensr_generator_seed(gen, 52);
+    Tensor* sc2 = tensr_sobol(gen, 1024, 5, true, 0, TENSR_FLOAT64);
+    assert(memcmp(sc->data, sc2->data, 1024 * 5 * sizeof(double)) == 0);
+    assert(memcmp(sc->data, sd, 5 * sizeof(double)) != 0);
+    for (int d = 0; d < 5; d++) assert(is_stratified((double*)sc->data + d, 1024, 5));
+    
+    Tensor* sf = tensr_sobol(gen, 100, 1024, true, 7, TENSR_FLOAT32);
+    for (size_t i = 0; i < sf->size; i++) {
+        float v = ((float*)sf->data)[i];
+        assert(v >= 0.0f && v < 1.0f);
+    }
+    
+    /* Halton: radical inverses in bases 2 and 3 */
+    Tensor* h = tensr_halton(gen, 27, 2, false, 0, TENSR_FLOAT64);
+    double* hd = (double*)h->data;
+    assert(hd[2] == 0.5 && fabs(hd[3] - 1.0 / 3.0) < 1e-15);
+    assert(hd[4] == 0.25 && fabs(hd[7] - 1.0 / 9.0) < 1e-15);
+    Tensor* hs = tensr_halton(gen, 27, 2, true, 0, TENSR_FLOAT64);
+    assert(is_stratified((double*)hs->data + 1, 27, 2));
+    Tensor* hskip = tensr_halton(gen, 10, 2, false, 17, TENSR_FLOAT64);
+    assert(memcmp(hskip->data, hd + 34, 20 * sizeof(double)) == 0);
+    
+    assert(tensr_sobol(gen, 10, 0, false, 0, TENSR_FLOAT64) == NULL);
+    assert(tensr_sobol(gen, 10, 1025, false, 0, TENSR_FLOAT64) == NULL);
+    assert(tensr_halton(gen, 10, 2, false, 0, TENSR_INT32) == NULL);
+    
+    Tensor* ts[] = {s, tail, sc, sc2, sf, h, hs, hskip};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    tensr_generator_free(gen);
+    printf("✓ Quasi-random sequence test passed\n");
+}
+
 void test_io() {
     printf("Testing I/O operations...\n");
     size_t shape[] = {2, 3};
-    Tensor* t = tensr_arange(0.0, 6.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
-    t->shape[0] = 2;
-    t->shape[1] = 3;
-    t->ndim = 2;
+    Tensor* flat = tensr_arange(0.0, 6.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* t = tensr_reshape(flat, shape, 2);
     
     int result = tensr_save("test_tensor.bin", t);
     assert(result == 0);
@@ -166,10 +1058,618 @@ void test_io() {
     assert(loaded->size == t->size);
     
     tensr_free(t);
+    tensr_free(flat);
     tensr_free(loaded);
     printf("✓ I/O operations test passed\n");
 }
 
+void test_load_mmap() {
+    printf("Testing memory-mapped loading...\n");
+    Tensor* flat = tensr_arange(0.0, 12.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* t = tensr_reshape(flat, (size_t[]){3, 4}, 2);
+    assert(tensr_save("test_mmap.bin", t) == 0);
+    
+    /* Read-only mapping points into the file */
+    Tensor* ro = tensr_load_mmap("test_mmap.bin", TENSR_MAP_READONLY);
+    assert(ro && !ro->owns_data && ro->ndim == 2 && ro->shape[0] == 3 && ro->shape[1] == 4);
+    assert(memcmp(ro->data, flat->data, 12 * sizeof(float)) == 0);
+    Tensor* view = tensr_reshape(ro, (size_t[]){12}, 1);
+    Tensor* doubled = tensr_add(view, view);
+    assert(((float*)doubled->data)[11] == 22.0f);
+    tensr_free(view);
+    
+    /* Copy-on-write changes stay private */
+    Tensor* cow = tensr_load_mmap("test_mmap.bin", TENSR_MAP_COPY_ON_WRITE);
+    ((float*)cow->data)[0] = 100.0f;
+    assert(((float*)ro->data)[0] == 0.0f);
+    Tensor* again = tensr_load("test_mmap.bin");
+    assert(((float*)again->data)[0] == 0.0f);
+    
+    /* float64 payloads are aligned, so they are mapped without a copy */
+    Tensor* d = tensr_arange(0.0, 5.0, 0.5, TENSR_FLOAT64, TENSR_CPU);
+    assert(tensr_save("test_mmap64.bin", d) == 0);
+    Tensor* dm = tensr_load_mmap("test_mmap64.bin", TENSR_MAP_READONLY);
+    assert(dm && !dm->owns_data && dm->size == 10);
+    assert(memcmp(dm->data, d->data, 10 * sizeof(double)) == 0);
+    
+    /* Truncated and missing files are rejected */
+    FILE* f = fopen("test_mmap_bad.bin", "wb");
+    fwrite("\x02\0\0\0", 1, 4, f);
+    fclose(f);
+    assert(tensr_load_mmap("test_mmap_bad.bin", TENSR_MAP_READONLY) == NULL);
+    assert(tensr_load_mmap("does_not_exist.bin", TENSR_MAP_READONLY) == NULL);
+    
+    Tensor* ts[] = {t, flat, ro, doubled, cow, again, d, dm};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    remove("test_mmap.bin");
+    remove("test_mmap64.bin");
+    remove("test_mmap_bad.bin");
+    printf("✓ Memory-mapped loading test passed\n");
+}
+
+void test_file_format() {
+    printf("Testing versioned file format...\n");
+    /* Reference XXH64 digests (seed 0); 100 bytes cover the 32-byte stripe loop */
+    unsigned char bytes[100];
+    for (int i = 0; i < 100; i++) bytes[i] = (unsigned char)i;
+    assert(fmt_checksum("", 0) == 0xef46db3751d8e999ull);
+    assert(fmt_checksum("a", 1) == 0xd24ec4f1a98c6e5bull);
+    assert(fmt_checksum("abc", 3) == 0x44bc2cf5ad770999ull);
+    assert(fmt_checksum(bytes, 100) == 0x6ac1e58032166597ull);
+    
+    Tensor* t = tensr_arange(0.0, 24.0, 1.0, TENSR_INT64, TENSR_CPU);
+    assert(tensr_save("test_format.bin", t) == 0);
+    
+    /* Magic, little-endian fields and a 64-byte aligned payload */
+    unsigned char head[64];
+    FILE* f = fopen("test_format.bin", "rb");
+    assert(fread(head, 1, 64, f) == 64);
+    fclose(f);
+    assert(memcmp(head, "TENSR\r\n\x1a", 8) == 0);
+    assert(head[8] == 1 && head[9] == 0);    /* version */
+    assert(head[14] == 1 && head[15] == 0);  /* ndim */
+    assert(head[16] == 64 && head[24] == 64);  /* alignment and payload offset */
+    assert(head[48] == 24 && head[49] == 0);   /* shape[0] */
+    
+    /* Page alignment and checksums */
+    TensrSaveOptions opts = {.alignment = 4096, .checksum = true};
+    assert(tensr_save_ex("test_format_sum.bin", t, &opts) == 0);
+    Tensor* mapped = tensr_load_mmap("test_format_sum.bin", TENSR_MAP_READONLY);
+    assert(mapped && ((uintptr_t)mapped->data % 4096) == 0);
+    assert(memcmp(mapped->data, t->data, 24 * sizeof(int64_t)) == 0);
+    tensr_free(mapped);
+    Tensor* checked = tensr_load("test_format_sum.bin");
+    assert(checked && memcmp(checked->data, t->data, 24 * sizeof(int64_t)) == 0);
+    f = fopen("test_format_sum.bin", "r+b");
+    fseek(f, 4096 + 17, SEEK_SET);
+    fputc(0x7f, f);
+    fclose(f);
+    assert(tensr_load("test_format_sum.bin") == NULL);
+    TensrSaveOptions odd = {.alignment = 48};
+    assert(tensr_save_ex("test_format_odd.bin", t, &odd) == -1);
+    
+    /* Files in the legacy layout still load */
+    size_t ndim = 2, size = 6, shape[] = {2, 3};
+    TensrDType dtype = TENSR_FLOAT32;
+    float values[] = {1, 2, 3, 4, 5, 6};
+    f = fopen("test_format_legacy.bin", "wb");
+    fwrite(&ndim, sizeof(size_t), 1, f);
+    fwrite(&dtype, sizeof(TensrDType), 1, f);
+    fwrite(&size, sizeof(size_t), 1, f);
+    fwrite(shape, sizeof(size_t), 2, f);
+    fwrite(values, sizeof(float), 6, f);
+    fclose(f);
+    Tensor* legacy = tensr_load("test_format_legacy.bin");
+    assert(legacy && legacy->ndim == 2 && legacy->shape[1] == 3);
+    assert(memcmp(legacy->data, values, sizeof(values)) == 0);
+    Tensor* legacy_map = tensr_load_mmap("test_format_legacy.bin", TENSR_MAP_READONLY);
+    assert(legacy_map && memcmp(legacy_map->data, values, sizeof(values)) == 0);
+    
+    Tensor* ts[] = {t, checked, legacy, legacy_map};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    remove("test_format.bin");
+    remove("test_format_sum.bin");
+    remove("test_format_legacy.bin");
+    printf("✓ Versioned file format test passed\n");
+}
+
+void test_load_slice() {
+    printf("Testing partial loads...\n");
+    Tensor* a = tensr_arange(0.0, 120.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* a3 = tensr_reshape(a, (size_t[]){4, 5, 6}, 3);
+    assert(tensr_save("test_slice.bin", a3) == 0);
+    const float* src = (const float*)a->data;
+    
+    /* Leading rows only: one contiguous read */
+    Tensor* rows = tensr_load_slice("test_slice.bin", (size_t[]){1}, (size_t[]){3}, NULL, 1);
+    assert(rows && rows->ndim == 3 && rows->shape[0] == 2 && rows->shape[2] == 6);
+    assert(memcmp(rows->data, src + 30, 60 * sizeof(float)) == 0);
+    
+    /* Strided selection in every dimension, with stop past the end clamped */
+    size_t start[] = {0, 1, 1}, stop[] = {4, 5, 99}, step[] = {2, 3, 2};
+    Tensor* sl = tensr_load_slice("test_slice.bin", start, stop, step, 3);
+    assert(sl && sl->shape[0] == 2 && sl->shape[1] == 2 && sl->shape[2] == 3);
+    size_t n = 0;
+    for (size_t i = 0; i < 4; i += 2)
+        for (size_t j = 1; j < 5; j += 3)
+            for (size_t k = 1; k < 6; k += 2)
+                assert(((float*)sl->data)[n++] == src[i * 30 + j * 6 + k]);
+    
+    /* Legacy files are sliced too */
+    FILE* f = fopen("test_slice_legacy.bin", "wb");
+    size_t ndim = 2, size = 12, shape[] = {3, 4};
+    TensrDType dtype = TENSR_FLOAT32;
+    fwrite(&ndim, sizeof(size_t), 1, f);
+    fwrite(&dtype, sizeof(TensrDType), 1, f);
+    fwrite(&size, sizeof(size_t), 1, f);
+    fwrite(shape, sizeof(size_t), 2, f);
+    fwrite(src, sizeof(float), 12, f);
+    fclose(f);
+    Tensor* col = tensr_load_slice("test_slice_legacy.bin", (size_t[]){0, 2},
+                                   (size_t[]){3, 3}, NULL, 2);
+    assert(col && col->size == 3 && ((float*)col->data)[2] == 10.0f);
+    
+    assert(tensr_load_slice("test_slice.bin", (size_t[]){4}, (size_t[]){5}, NULL, 1) == NULL);
+    assert(tensr_load_slice("test_slice.bin", (size_t[]){0}, (size_t[]){2}, (size_t[]){0}, 1) == NULL);
+    
+    Tensor* ts[] = {a3, a, rows, sl, col};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    remove("test_slice.bin");
+    remove("test_slice_legacy.bin");
+    printf("✓ Partial load test passed\n");
+}
+
+void test_compressed_format() {
+    printf("Testing compressed chunked format...\n");
+    Tensor* ids = tensr_arange(1000.0, 21000.0, 1.0, TENSR_INT64, TENSR_CPU);
+    Tensor* sparse = tensr_zeros((size_t[]){100, 200}, 2, TENSR_FLOAT32, TENSR_CPU);
+    for (size_t i = 0; i < sparse->size; i += 37) ((float*)sparse->data)[i] = (float)i * 0.5f;
+    Tensor* ts[] = {ids, sparse};
+    
+    TensrFilter filters[] = {TENSR_FILTER_AUTO, TENSR_FILTER_NONE, TENSR_FILTER_SHUFFLE,
+                             TENSR_FILTER_BITSHUFFLE, TENSR_FILTER_DELTA};
+    for (size_t k = 0; k < 2; k++) {
+        size_t bytes = ts[k]->size * tensr_dtype_size(ts[k]->dtype);
+        for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+            TensrSaveOptions opts = {.checksum = true, .codec = TENSR_CODEC_LZ,
+                                     .filter = filters[i], .chunk_size = 4096};
+            assert(tensr_save_ex("test_lz.bin", ts[k], &opts) == 0);
+            Tensor* back = tensr_load("test_lz.bin");
+            assert(back && back->ndim == ts[k]->ndim && back->size == ts[k]->size);
+            assert(memcmp(back->data, ts[k]->data, bytes) == 0);
+            tensr_free(back);
+        }
+    }
+    
+    /* Much smaller than the raw payload, and still sliceable and mappable */
+    TensrSaveOptions opts = {.checksum = true, .codec = TENSR_CODEC_LZ,
+                             .filter = TENSR_FILTER_AUTO, .chunk_size = 4096};
+    assert(tensr_save_ex("test_lz.bin", sparse, &opts) == 0);
+    FILE* f = fopen("test_lz.bin", "rb");
+    fseek(f, 0, SEEK_END);
+    long packed = ftell(f);
+    fclose(f);
+    assert(packed < (long)(sparse->size * sizeof(float)) / 4);
+    Tensor* rows = tensr_load_slice("test_lz.bin", (size_t[]){40, 10}, (size_t[]){43, 190},
+                                    (size_t[]){1, 3}, 2);
+    assert(rows && rows->shape[0] == 3 && rows->shape[1] == 60);
+    for (size_t r = 0; r < 3; r++) {
+        for (size_t c = 0; c < 60; c++) {
+            float want = ((float*)sparse->data)[(40 + r) * 200 + 10 + 3 * c];
+            assert(((float*)rows->data)[r * 60 + c] == want);
+        }
+    }
+    Tensor* mapped = tensr_load_mmap("test_lz.bin", TENSR_MAP_READONLY);
+    assert(mapped && mapped->owns_data);
+    assert(memcmp(mapped->data, sparse->data, sparse->size * sizeof(float)) == 0);
+    
+    /* A corrupted chunk fails its checksum */
+    f = fopen("test_lz.bin", "r+b");
+    fseek(f, packed - 8, SEEK_SET);
+    int byte = fgetc(f);
+    fseek(f, packed - 8, SEEK_SET);
+    fputc(byte ^ 0x40, f);
+    fclose(f);
+    assert(tensr_load("test_lz.bin") == NULL);
+    
+    const char* names[] = {"ids"};
+    assert(tensr_save_archive("test_lz.tsra", names, ts, 1, &opts) == -1);
+    
+    Tensor* all[] = {ids, sparse, rows, mapped};
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) tensr_free(all[i]);
+    remove("test_lz.bin");
+    remove("test_lz.tsra");
+    printf("✓ Compressed format test passed\n");
+}
+
+void test_disk_tensor() {
+    printf("Testing disk-backed tensors...\n");
+    size_t shape[] = {300, 50};
+    Tensor* x = tensr_create(shape, 2, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* y = tensr_create(shape, 2, TENSR_FLOAT32, TENSR_CPU);
+    double total = 0.0;
+    for (size_t i = 0; i < x->size; i++) {
+        ((float*)x->data)[i] = (float)(i % 97) - 40.0f;
+        ((float*)y->data)[i] = (float)(i % 13) * 0.25f;
+        total += ((float*)x->data)[i];
+    }
+    
+    /* 4 KB chunks of 20 rows and a two-chunk cache force evictions and write-back */
+    TensrSaveOptions opts = {.checksum = true, .codec = TENSR_CODEC_LZ,
+                             .filter = TENSR_FILTER_AUTO, .chunk_size = 4096};
+    TensrDiskTensor* a = tensr_disk_create("test_disk_a.tsr", shape, 2, TENSR_FLOAT32, &opts,
+                                           8000);
+    TensrDiskTensor* b = tensr_disk_create("test_disk_b.tsr", shape, 2, TENSR_FLOAT32, &opts,
+                                           8000);
+    assert(a && b);
+    size_t ndim;
+    const size_t* got_shape = tensr_disk_shape(a, &ndim);
+    assert(ndim == 2 && got_shape[0] == 300 && got_shape[1] == 50);
+    assert(tensr_disk_dtype(a) == TENSR_FLOAT32);
+    Tensor* zero = tensr_disk_sum(a, NULL, 0, false);
+    assert(zero && ((float*)zero->data)[0] == 0.0f);
+    for (size_t row = 0; row < 300; row += 7) {
+        size_t n = row + 7 <= 300 ? 7 : 300 - row;
+        Tensor* rows = tensr_create((size_t[]){n, 50}, 2, TENSR_FLOAT32, TENSR_CPU);
+        memcpy(rows->data, (float*)x->data + row * 50, n * 50 * sizeof(float));
+        assert(tensr_disk_write(a, row, rows) == 0);
+        tensr_free(rows);
+    }
+    assert(tensr_disk_write(b, 0, y) == 0);
+    assert(tensr_disk_write(b, 1, y) == -1);
+    
+    /* Reductions stream every chunk */
+    Tensor* sum = tensr_disk_sum(a, NULL, 0, false);
+    Tensor* mean = tensr_disk_mean(a, NULL, 0, true);
+    Tensor* mx = tensr_disk_max(a, NULL, 0, false);
+    Tensor* mn = tensr_disk_min(a, NULL, 0, false);
+    assert(sum && ((float*)sum->data)[0] == (float)total);
+    assert(mean && mean->ndim == 2);
+    assert(fabsf(((float*)mean->data)[0] - (float)(total / 15000)) < 1e-5f);
+    assert(mx && ((float*)mx->data)[0] == 56.0f);
+    assert(mn && ((float*)mn->data)[0] == -40.0f);
+    assert(tensr_disk_sum(a, (int[]){0}, 1, false) == NULL);
+    
+    /* Elementwise ops and matmul write to disk tensors block by block */
+    TensrDiskTensor* c = tensr_disk_create("test_disk_c.tsr", shape, 2, TENSR_FLOAT32, &opts, 0);
+    assert(tensr_disk_add(c, a, b) == 0);
+    assert(tensr_disk_mul(b, b, a) == 0);
+    Tensor* w = tensr_create((size_t[]){50, 3}, 2, TENSR_FLOAT32, TENSR_CPU);
+    for (size_t i = 0; i < w->size; i++) ((float*)w->data)[i] = (float)(i % 5) - 2.0f;
+    TensrDiskTensor* p = tensr_disk_create("test_disk_p.tsr", (size_t[]){300, 3}, 2,
+                                           TENSR_FLOAT32, NULL, 0);
+    assert(tensr_disk_matmul(p, a, w) == 0);
+    assert(tensr_disk_matmul(p, b, x) == -1);
+    Tensor* got_c = tensr_disk_read(c, 0, 300);
+    Tensor* got_b = tensr_disk_read(b, 100, 50);
+    Tensor* got_p = tensr_disk_read(p, 0, 300);
+    Tensor* want_p = tensr_matmul(x, w);
+    assert(got_c && got_b && got_p && want_p && got_b->shape[0] == 50);
+    for (size_t i = 0; i < x->size; i++) {
+        float xv = ((float*)x->data)[i], yv = ((float*)y->data)[i];
+        assert(((float*)got_c->data)[i] == xv + yv);
+        if (i >= 5000 && i < 7500) assert(((float*)got_b->data)[i - 5000] == yv * xv);
+    }
+    assert(memcmp(got_p->data, want_p->data, want_p->size * sizeof(float)) == 0);
+    assert(tensr_disk_read(c, 290, 20) == NULL);
+    
+    /* Closed disk tensors are ordinary chunked files */
+    assert(tensr_disk_close(a) == 0 && tensr_disk_close(c) == 0);
+    Tensor* loaded = tensr_load("test_disk_a.tsr");
+    assert(loaded && memcmp(loaded->data, x->data, x->size * sizeof(float)) == 0);
+    tensr_free(loaded);
+    
+    /* Reopen and overwrite rows across a chunk boundary */
+    a = tensr_disk_open("test_disk_a.tsr", NULL, 0);
+    assert(a);
+    Tensor* ones = tensr_ones((size_t[]){30, 50}, 2, TENSR_FLOAT32, TENSR_CPU);
+    assert(tensr_disk_write(a, 135, ones) == 0);
+    assert(tensr_disk_close(a) == 0);
+    loaded = tensr_load("test_disk_a.tsr");
+    assert(loaded);
+    for (size_t i = 0; i < x->size; i++) {
+        float want = i >= 135 * 50 && i < 165 * 50 ? 1.0f : ((float*)x->data)[i];
+        assert(((float*)loaded->data)[i] == want);
+    }
+    tensr_free(loaded);
+    
+    /* Uncompressed chunks, and a tensor that only partly leaves its zeros */
+    TensrSaveOptions raw = {.checksum = true, .filter = TENSR_FILTER_NONE, .chunk_size = 4096};
+    TensrDiskTensor* r = tensr_disk_create("test_disk_r.tsr", shape, 2, TENSR_FLOAT32, &raw, 0);
+    assert(r && tensr_disk_write(r, 10, ones) == 0 && tensr_disk_close(r) == 0);
+    loaded = tensr_load_slice("test_disk_r.tsr", (size_t[]){0, 0}, (size_t[]){50, 1}, NULL, 2);
+    assert(loaded && loaded->size == 50);
+    for (size_t i = 0; i < 50; i++) {
+        assert(((float*)loaded->data)[i] == (i >= 10 && i < 40 ? 1.0f : 0.0f));
+    }
+    tensr_free(loaded);
+    
+    /* Infinite extremes are returned as such, not clamped to the finite range */
+    TensrDiskTensor* inf = tensr_disk_create("test_disk_i.tsr", (size_t[]){4, 2}, 2,
+                                             TENSR_FLOAT64, NULL, 0);
+    Tensor* neg = tensr_full((size_t[]){4, 2}, 2, -INFINITY, TENSR_FLOAT64, TENSR_CPU);
+    assert(inf && tensr_disk_write(inf, 0, neg) == 0);
+    Tensor* imx = tensr_disk_max(inf, NULL, 0, false);
+    assert(imx && isinf(((double*)imx->data)[0]) && ((double*)imx->data)[0] < 0);
+    for (size_t i = 0; i < neg->size; i++) ((double*)neg->data)[i] = INFINITY;
+    assert(tensr_disk_write(inf, 0, neg) == 0);
+    Tensor* imn = tensr_disk_min(inf, NULL, 0, false);
+    assert(imn && isinf(((double*)imn->data)[0]) && ((double*)imn->data)[0] > 0);
+    assert(tensr_disk_close(inf) == 0);
+    tensr_free(neg);
+    tensr_free(imx);
+    tensr_free(imn);
+    remove("test_disk_i.tsr");
+    
+    /* Plain files cannot be opened as disk tensors */
+    tensr_save("test_disk_r.tsr", x);
+    assert(tensr_disk_open("test_disk_r.tsr", NULL, 0) == NULL);
+    
+    assert(tensr_disk_close(b) == 0 && tensr_disk_close(p) == 0);
+    Tensor* all[] = {x, y, zero, sum, mean, mx, mn, w, got_c, got_b, got_p, want_p, ones};
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) tensr_free(all[i]);
+    const char* files[] = {"test_disk_a.tsr", "test_disk_b.tsr", "test_disk_c.tsr",
+                           "test_disk_p.tsr", "test_disk_r.tsr"};
+    for (size_t i = 0; i < 5; i++) remove(files[i]);
+    printf("✓ Disk tensor test passed\n");
+}
+
+void test_writer() {
+    printf("Testing streaming writer...\n");
+    TensrSaveOptions opts = {.checksum = true};
+    TensrWriter* w = tensr_writer_open("test_writer.tsr", TENSR_FLOAT32, (size_t[]){3}, 1, &opts);
+    assert(w);
+    
+    /* Single rows and small blocks are buffered */
+    Tensor* row = tensr_create((size_t[]){3}, 1, TENSR_FLOAT32, TENSR_CPU);
+    for (size_t r = 0; r < 5; r++) {
+        for (size_t j = 0; j < 3; j++) ((float*)row->data)[j] = (float)(r * 3 + j);
+        assert(tensr_writer_append(w, row) == 0);
+    }
+    assert(tensr_writer_flush(w) == 0);
+    Tensor* loaded = tensr_load("test_writer.tsr");
+    assert(loaded && loaded->ndim == 2 && loaded->shape[0] == 5 && loaded->shape[1] == 3);
+    assert(((float*)loaded->data)[14] == 14.0f);
+    tensr_free(loaded);
+    
+    /* A block larger than the buffer is written directly */
+    size_t big = 400000;
+    Tensor* block = tensr_create((size_t[]){big, 3}, 2, TENSR_FLOAT32, TENSR_CPU);
+    for (size_t i = 0; i < block->size; i++) ((float*)block->data)[i] = (float)(i + 15);
+    assert(tensr_writer_append(w, block) == 0);
+    assert(tensr_writer_append(w, row) == 0);
+    
+    /* Mismatched rows and dtypes are rejected */
+    Tensor* wide = tensr_zeros((size_t[]){2, 4}, 2, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* ints = tensr_zeros((size_t[]){2, 3}, 2, TENSR_INT32, TENSR_CPU);
+    assert(tensr_writer_append(w, wide) == -1 && tensr_writer_append(w, ints) == -1);
+    assert(tensr_writer_rows(w) == big + 6);
+    assert(tensr_writer_close(w) == 0);
+    
+    loaded = tensr_load("test_writer.tsr");
+    Tensor* mapped = tensr_load_mmap("test_writer.tsr", TENSR_MAP_READONLY);
+    assert(loaded && mapped && loaded->shape[0] == big + 6 && mapped->shape[0] == big + 6);
+    for (size_t i = 0; i < (big + 5) * 3; i++) {
+        assert(((float*)loaded->data)[i] == (float)i && ((float*)mapped->data)[i] == (float)i);
+    }
+    assert(((float*)mapped->data)[(big + 5) * 3] == 12.0f);
+    tensr_free(loaded);
+    tensr_free(mapped);
+    
+    /* Rows of a 1-D tensor are scalars appended as blocks */
+    TensrWriter* v = tensr_writer_open("test_writer.tsr", TENSR_INT64, NULL, 0, NULL);
+    Tensor* seq = tensr_arange(0.0, 10.0, 1.0, TENSR_INT64, TENSR_CPU);
+    assert(v && tensr_writer_append(v, seq) == 0 && tensr_writer_append(v, seq) == 0);
+    assert(tensr_writer_close(v) == 0);
+    loaded = tensr_load("test_writer.tsr");
+    assert(loaded && loaded->ndim == 1 && loaded->shape[0] == 20);
+    assert(((int64_t*)loaded->data)[13] == 3);
+    tensr_free(loaded);
+    
+    opts.codec = TENSR_CODEC_LZ;
+    assert(tensr_writer_open("test_writer.tsr", TENSR_FLOAT32, (size_t[]){3}, 1, &opts) == NULL);
+    
+    Tensor* all[] = {row, block, wide, ints, seq};
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) tensr_free(all[i]);
+    remove("test_writer.tsr");
+    printf("✓ Streaming writer test passed\n");
+}
+
+static void count_completion(TensrFuture* f, void* ctx) {
+    (void)f;
+    (*(int*)ctx)++;
+}
+
+void test_async_io() {
+    printf("Testing asynchronous save and load...\n");
+    size_t shape[] = {256, 64};
+    Tensor* t = tensr_create(shape, 2, TENSR_FLOAT32, TENSR_CPU);
+    for (size_t i = 0; i < t->size; i++) ((float*)t->data)[i] = (float)i;
+    
+    /* The tensor is snapshotted, so it can change while the save runs */
+    int calls = 0;
+    TensrSaveOptions opts = {.checksum = true};
+    TensrFuture* saves[3];
+    char names[3][32];
+    for (int k = 0; k < 3; k++) {
+        snprintf(names[k], sizeof(names[k]), "test_async_%d.tsr", k);
+        saves[k] = tensr_save_async(names[k], t, k == 0 ? NULL : &opts, count_completion, &calls);
+        assert(saves[k]);
+        for (size_t i = 0; i < t->size; i++) ((float*)t->data)[i] += 1.0f;
+    }
+    for (int k = 0; k < 3; k++) {
+        assert(tensr_future_wait(saves[k]) == 0 && tensr_future_done(saves[k]));
+        assert(tensr_future_take(saves[k]) == NULL);
+        tensr_future_free(saves[k]);
+    }
+    assert(calls == 3);
+    
+    /* Double-buffered reads: the next file loads while the current one is used */
+    TensrFuture* next = tensr_load_async(names[0], NULL, NULL);
+    for (int k = 0; k < 3; k++) {
+        Tensor* cur = tensr_future_take(next);
+        tensr_future_free(next);
+        next = k + 1 < 3 ? tensr_load_async(names[k + 1], NULL, NULL) : NULL;
+        assert(cur && cur->shape[0] == 256 && cur->shape[1] == 64);
+        for (size_t i = 0; i < cur->size; i++) assert(((float*)cur->data)[i] == (float)(i + k));
+        tensr_free(cur);
+    }
+    
+    /* Failures are reported through the future; untaken tensors are freed with it */
+    TensrFuture* missing = tensr_load_async("test_async_missing.tsr", count_completion, &calls);
+    assert(missing && tensr_future_wait(missing) == -1 && tensr_future_take(missing) == NULL);
+    tensr_future_free(missing);
+    assert(calls == 4);
+    tensr_future_free(tensr_load_async(names[1], NULL, NULL));
+    
+    tensr_free(t);
+    for (int k = 0; k < 3; k++) remove(names[k]);
+    printf("✓ Async I/O test passed\n");
+}
+
+void test_archive() {
+    printf("Testing tensor archives...\n");
+    Tensor* w = tensr_arange(0.0, 6.0, 1.0, TENSR_FLOAT32, TENSR_CPU);
+    Tensor* w2 = tensr_reshape(w, (size_t[]){2, 3}, 2);
+    Tensor* ids = tensr_arange(0.0, 5.0, 1.0, TENSR_INT64, TENSR_CPU);
+    Tensor* flags = tensr_ones((size_t[]){3}, 1, TENSR_UINT8, TENSR_CPU);
+    const char* names[] = {"layer.weight", "ids", "flags"};
+    Tensor* tensors[] = {w2, ids, flags};
+    TensrSaveOptions opts = {.alignment = 128, .checksum = true};
+    assert(tensr_save_archive("test_archive.tsra", names, tensors, 3, &opts) == 0);
+    
+    TensrArchive* ar = tensr_archive_open("test_archive.tsra");
+    assert(ar && tensr_archive_count(ar) == 3);
+    assert(strcmp(tensr_archive_name(ar, 0), "layer.weight") == 0);
+    assert(strcmp(tensr_archive_name(ar, 2), "flags") == 0);
+    assert(tensr_archive_name(ar, 3) == NULL);
+    
+    /* Load a single tensor, map another */
+    Tensor* got = tensr_archive_load(ar, "ids");
+    assert(got && got->dtype == TENSR_INT64 && got->size == 5);
+    assert(memcmp(got->data, ids->data, 5 * sizeof(int64_t)) == 0);
+    Tensor* mapped = tensr_archive_load_mmap(ar, "layer.weight", TENSR_MAP_READONLY);
+    assert(mapped && !mapped->owns_data && mapped->ndim == 2 && mapped->shape[1] == 3);
+    assert(((uintptr_t)mapped->data % 128) == 0);
+    assert(memcmp(mapped->data, w->data, 6 * sizeof(float)) == 0);
+    assert(tensr_archive_load(ar, "missing") == NULL);
+    /* Copy-on-write tensors are private to each call */
+    Tensor* cow1 = tensr_archive_load_mmap(ar, "layer.weight", TENSR_MAP_COPY_ON_WRITE);
+    Tensor* cow2 = tensr_archive_load_mmap(ar, "layer.weight", TENSR_MAP_COPY_ON_WRITE);
+    assert(cow1 && cow2 && !cow1->owns_data);
+    ((float*)cow1->data)[0] = 42.0f;
+    assert(((float*)cow2->data)[0] == 0.0f && ((float*)mapped->data)[0] == 0.0f);
+    tensr_archive_close(ar);
+    /* Mapped tensors outlive the archive handle */
+    assert(((float*)mapped->data)[5] == 5.0f && ((float*)cow1->data)[0] == 42.0f);
+    tensr_free(cow1);
+    tensr_free(cow2);
+    
+    /* A corrupted payload fails its own checksum only */
+    FILE* f = fopen("test_archive.tsra", "r+b");
+    unsigned char entry[40];
+    fseek(f, 32, SEEK_SET);
+    assert(fread(entry, 1, 40, f) == 40);
+    long offset = (long)(entry[8] | (entry[9] << 8));
+    fseek(f, offset, SEEK_SET);
+    fputc(0x55, f);
+    fclose(f);
+    ar = tensr_archive_open("test_archive.tsra");
+    assert(tensr_archive_load(ar, "layer.weight") == NULL);
+    Tensor* fl = tensr_archive_load(ar, "flags");
+    assert(fl && memcmp(fl->data, flags->data, 3) == 0);
+    tensr_archive_close(ar);
+    
+    const char* dup[] = {"a", "a"};
+    assert(tensr_save_archive("test_archive_dup.tsra", dup, tensors, 2, NULL) == -1);
+    /* A plain tensor file is not an archive */
+    assert(tensr_save("test_archive_plain.bin", w) == 0);
+    assert(tensr_archive_open("test_archive_plain.bin") == NULL);
+    remove("test_archive_plain.bin");
+    
+    Tensor* ts[] = {w2, w, ids, flags, got, mapped, fl};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    remove("test_archive.tsra");
+    printf("✓ Tensor archive test passed\n");
+}
+
+void test_npy() {
+    printf("Testing NumPy .npy/.npz I/O...\n");
+    Tensor* a = tensr_arange(0.0, 6.0, 1.0, TENSR_FLOAT64, TENSR_CPU);
+    Tensor* a2 = tensr_reshape(a, (size_t[]){2, 3}, 2);
+    assert(tensr_save_npy("test_npy.npy", a2) == 0);
+    Tensor* back = tensr_load_npy("test_npy.npy");
+    assert(back && back->dtype == TENSR_FLOAT64 && back->ndim == 2 && back->shape[1] == 3);
+    assert(memcmp(back->data, a->data, 6 * sizeof(double)) == 0);
+    Tensor* mapped = tensr_load_npy_mmap("test_npy.npy", TENSR_MAP_READONLY);
+    assert(mapped && !mapped->owns_data && ((uintptr_t)mapped->data % 64) == 0);
+    assert(((double*)mapped->data)[4] == 4.0);
+    
+    /* Big-endian, Fortran-ordered int32 array [[0, 1, 2], [3, 4, 5]] */
+    const char dict[] = "{'descr': '>i4', 'fortran_order': True, 'shape': (2, 3), }";
+    unsigned char header[128] = "\x93NUMPY\x01\x00";
+    header[8] = 128 - 10;
+    memset(header + 10, ' ', 118);
+    memcpy(header + 10, dict, sizeof(dict) - 1);
+    header[127] = '\n';
+    const unsigned char column_major[] = {0, 3, 1, 4, 2, 5};
+    FILE* f = fopen("test_npy_f.npy", "wb");
+    fwrite(header, 1, 128, f);
+    for (int i = 0; i < 6; i++) {
+        unsigned char be[4] = {0, 0, 0, column_major[i]};
+        fwrite(be, 1, 4, f);
+    }
+    fclose(f);
+    Tensor* ft = tensr_load_npy("test_npy_f.npy");
+    assert(ft && ft->dtype == TENSR_INT32 && ft->shape[0] == 2 && ft->shape[1] == 3);
+    for (int i = 0; i < 6; i++) assert(((int32_t*)ft->data)[i] == i);
+    /* Byte-swapped data cannot be mapped in place and is copied */
+    Tensor* fm = tensr_load_npy_mmap("test_npy_f.npy", TENSR_MAP_READONLY);
+    assert(fm && fm->owns_data && ((int32_t*)fm->data)[5] == 5);
+    
+    /* Little-endian Fortran data could be mapped, but is reordered to row-major */
+    const char fdict[] = "{'descr': '<f4', 'fortran_order': True, 'shape': (2, 3), }";
+    memset(header + 10, ' ', 117);
+    memcpy(header + 10, fdict, sizeof(fdict) - 1);
+    f = fopen("test_npy_f.npy", "wb");
+    fwrite(header, 1, 128, f);
+    for (int i = 0; i < 6; i++) {
+        float v = (float)column_major[i];
+        uint32_t bits;
+        memcpy(&bits, &v, 4);
+        unsigned char le[4] = {(unsigned char)bits, (unsigned char)(bits >> 8),
+                               (unsigned char)(bits >> 16), (unsigned char)(bits >> 24)};
+        fwrite(le, 1, 4, f);
+    }
+    fclose(f);
+    Tensor* fl = tensr_load_npy_mmap("test_npy_f.npy", TENSR_MAP_READONLY);
+    assert(fl && fl->owns_data && fl->dtype == TENSR_FLOAT32 && fl->shape[1] == 3);
+    for (int i = 0; i < 6; i++) assert(((float*)fl->data)[i] == (float)i);
+    
+    /* .npz members, loaded by name with or without the .npy suffix */
+    Tensor* ids = tensr_arange(0.0, 5.0, 1.0, TENSR_INT64, TENSR_CPU);
+    const char* names[] = {"x", "ids"};
+    Tensor* arrays[] = {a2, ids};
+    assert(tensr_save_npz("test_npy.npz", names, arrays, 2) == 0);
+    Tensor* zi = tensr_load_npz("test_npy.npz", "ids.npy");
+    assert(zi && zi->dtype == TENSR_INT64 && memcmp(zi->data, ids->data, 5 * 8) == 0);
+    Tensor* zx = tensr_load_npz_mmap("test_npy.npz", "x", TENSR_MAP_COPY_ON_WRITE);
+    assert(zx && !zx->owns_data && zx->ndim == 2 && ((uintptr_t)zx->data % 64) == 0);
+    assert(memcmp(zx->data, a->data, 6 * sizeof(double)) == 0);
+    ((double*)zx->data)[0] = 42.0;
+    assert(tensr_load_npz("test_npy.npz", "missing") == NULL);
+    Tensor* zx2 = tensr_load_npz("test_npy.npz", "x");
+    assert(zx2 && ((double*)zx2->data)[0] == 0.0);
+    assert(tensr_load_npy("test_npy.npz") == NULL);
+    
+    Tensor* ts[] = {a2, a, back, mapped, ft, fm, fl, ids, zi, zx, zx2};
+    for (size_t i = 0; i < sizeof(ts) / sizeof(ts[0]); i++) tensr_free(ts[i]);
+    remove("test_npy.npy");
+    remove("test_npy_f.npy");
+    remove("test_npy.npz");
+    printf("✓ NumPy I/O test passed\n");
+}
+
 int main() {
     printf("=== Tensr Library Test Suite ===\n\n");
     
@@ -181,8 +1681,32 @@ int main() {
     test_arithmetic();
     test_reduction();
     test_matmul();
+    test_activation();
+    test_normalization();
+    test_attention();
+    test_embedding();
+    test_dropout();
+    test_optimizers();
+    test_autograd();
     test_random();
+    test_generators();
+    test_random_parallel();
+    test_normal_sampler();
+    test_distributions();
+    test_randint_bounded();
+    test_sampling();
+    test_random_fill();
+    test_qrng();
     test_io();
+    test_load_mmap();
+    test_file_format();
+    test_load_slice();
+    test_compressed_format();
+    test_disk_tensor();
+    test_writer();
+    test_async_io();
+    test_archive();
+    test_npy();
     
     printf("\n=== All tests passed! ===\n");
     return 0;
@@ -14,11 +14,25 @@ option("cuda")
     set_description("Enable CUDA support")
 option_end()
 
+option("openmp")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Parallelize CPU kernels with OpenMP when available")
+option_end()
+
+if has_config("openmp") then
+    -- Optional like CMake's find_package, so toolchains without OpenMP build serially
+    add_requires("openmp", {optional = true})
+end
+
 target("tensr")
     set_kind("static")
     add_files("src/core/tensor.c", "src/core/array.c", "src/core/tensor.cpp")
     add_files("src/ops/*.c")
     add_files("src/linalg/*.c")
+    add_files("src/nn/*.c")
+    add_files("src/optim/*.c")
+    add_files("src/autograd/*.c")
     add_files("src/random/*.c")
     add_files("src/io/*.c")
     add_files("src/fft/*.c")
@@ -29,7 +43,15 @@ target("tensr")
         add_cugencodes("native")
         add_cuflags("-use_fast_math", "-O3")
     end
+
+    if has_config("openmp") then
+        add_packages("openmp", {public = true})
+    end
     
+    if is_plat("linux", "bsd") then
+        add_syslinks("pthread", {public = true})
+    end
+
     add_includedirs("include", {public = true})
     add_headerfiles("include/(**.h)", "include/(**.hpp)")
     